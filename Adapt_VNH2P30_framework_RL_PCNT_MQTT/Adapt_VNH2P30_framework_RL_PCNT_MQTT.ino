@@ -1,5 +1,11 @@
+#include "async_log.h"
+#include "button_input.h"
+#include "control_task.h"
+#include "hot_path_bench.h"
+#include "loop_profiler.h"
 #include "motor_control.h"
 #include "mqtt_client.h"
+#include "session_record.h"
 
 int botao_frente = 36;
 int botao_re = 34;
@@ -11,40 +17,29 @@ int estado_botoes = 0;
 bool block_foward = false;
 bool block_reverse = false;
 
-void leituraBotoes() {
-  if (digitalRead(botao_frente)) {
-    estado_botoes = 1;
-  } else if (digitalRead(botao_re)) {
-    estado_botoes = 2;
-  } else if (digitalRead(botao_esquerda)) {
-    estado_botoes = 3;
-  } else if (digitalRead(botao_direita)) {
-    estado_botoes = 4;
-  } else {
-    estado_botoes = 0;
+// Interrupção nas duas bordas dos quatro botões (todos no banco 32..39)
+void setupBotoes(uint32_t debounce_us) {
+  const uint8_t pins[] = {
+      static_cast<uint8_t>(botao_frente), static_cast<uint8_t>(botao_re),
+      static_cast<uint8_t>(botao_esquerda), static_cast<uint8_t>(botao_direita)};
+  if (!button_input_begin(pins, 4, debounce_us)) {
+    LOG_E(CTRL, "[BOT] Falha ao ligar a interrupção dos botões.");
   }
 }
 
-void setup() {
-
-  Serial.begin(115200);
-  net_mqtt_begin();     // inicializa WiFi + MQTT
-  
-  setupMotor();
-
-  pinMode(botao_frente, INPUT);
-  pinMode(botao_re, INPUT);
-  pinMode(botao_esquerda, INPUT);
-  pinMode(botao_direita, INPUT);
+// Consome os eventos dos botões; a ordem de pins[] é a prioridade: o menor
+// bit pressionado vence (frente, ré, esquerda, direita)
+void leituraBotoes() {
+  const uint8_t pressed = button_input_poll();
+  estado_botoes = pressed ? __builtin_ctz(pressed) + 1 : 0;
 }
 
-void loop() {
-
-  net_mqtt_loop();      // mantém a conexão e processa mensagens
-  
-  encoder(); // leitura dos encoders
-
+// Executado pela tarefa de controle (core 1) a cada ciclo.
+MotionCommand selecionaComando() {
+  LOOP_PROFILE_BEGIN(STAGE_BUTTONS);
   leituraBotoes(); // leitura dos botões
+  LOOP_PROFILE_END(STAGE_BUTTONS);
+  session_record_buttons(estado_botoes);
 
   MotionCommand commandToExecute = MOTION_STOP;
   bool manualControl = true;
@@ -71,5 +66,46 @@ void loop() {
     commandToExecute = get_remote_motion_command();
   }
 
-  apply_motion_command(commandToExecute);
+  return commandToExecute;
+}
+
+// Executado continuamente pela tarefa de rede (core 0).
+void loopRede() {
+  LOOP_PROFILE_BEGIN(STAGE_NET_LOOP);
+  net_mqtt_loop();      // mantém a conexão e processa mensagens
+  LOOP_PROFILE_END(STAGE_NET_LOOP);
+
+  LOOP_PROFILE_BEGIN(STAGE_TELEMETRY);
+  odometry_publish_pending();     // odometria produzida pelo laço de controle
+  LOOP_PROFILE_END(STAGE_TELEMETRY);
+  control_task_publish_stats();   // período/jitter medidos
+  loop_profiler_publish();        // perfil por etapa (robot/loop/profile)
+  session_record_flush();         // gravação de sessão (robot/session)
+}
+
+void setup() {
+
+  Serial.begin(115200);
+  async_log_begin();    // drenagem do log na serial (prioridade mínima)
+  net_mqtt_begin();     // inicializa WiFi + MQTT
+  
+  setupMotor();
+
+  setupBotoes(BUTTON_DEBOUNCE_US);
+
+#if HOT_PATH_BENCH
+  hot_path_bench_log(1000);   // antes das tarefas: nada concorre com os kernels
+#endif
+
+  // Com SESSION_RECORD 1 a gravação começa no primeiro ciclo
+  session_record_start();
+
+  // Controle no core 1 (timer de hardware), rede no core 0
+  control_task_begin(CONTROL_PERIOD_US, selecionaComando);
+  hal_loop_task_start("net", NET_TASK_CORE, NET_TASK_PRIORITY, NET_TASK_STACK, loopRede);
+}
+
+void loop() {
+  // Todo o trabalho roda nas tarefas de controle e de rede.
+  hal_task_end_self();
 }
@@ -0,0 +1,204 @@
+#include "async_log.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+
+#include <Arduino.h>
+#include "hal.h"
+
+static_assert((LOG_RING_SIZE & (LOG_RING_SIZE - 1)) == 0, "LOG_RING_SIZE deve ser potência de 2");
+
+struct LogRecord {
+  const char* fmt;
+  uint32_t t_us;
+  uint8_t level;
+  uint8_t nargs;
+  uint8_t text_length;
+  LogArg args[LOG_MAX_ARGS];
+  char text[LOG_TEXT_MAX];
+};
+
+// Anel limitado de vários produtores (Vyukov): cada slot guarda a posição
+// em que pode ser escrito (seq == pos) ou lido (seq == pos + 1). Produtores
+// reservam a posição com CAS no head e publicam o slot com release; o único
+// consumidor devolve o slot somando o tamanho do anel.
+struct LogSlot {
+  std::atomic<uint32_t> seq;
+  LogRecord record;
+};
+
+struct LogRing {
+  LogSlot slots[LOG_RING_SIZE];
+  std::atomic<uint32_t> head;
+  uint32_t tail;   // só a drenagem
+
+  LogRing() : head(0), tail(0) {
+    for (uint32_t i = 0; i < LOG_RING_SIZE; ++i) slots[i].seq.store(i, std::memory_order_relaxed);
+  }
+};
+
+static LogRing g_ring;
+static std::atomic<uint32_t> g_written(0);
+static std::atomic<uint32_t> g_dropped(0);
+static std::atomic<uint32_t> g_truncated(0);
+static uint32_t g_dropped_reported = 0;   // só a drenagem
+
+static const uint32_t kMask = LOG_RING_SIZE - 1;
+
+void log_detail::add(Packer& p, const char* s) {
+  p.text = s;
+  p.text_length = s ? strlen(s) : 0;
+}
+
+bool async_log_write(uint8_t level, const char* fmt, const LogArg* args, uint8_t nargs,
+                     const char* text, size_t text_length) {
+  uint32_t pos = g_ring.head.load(std::memory_order_relaxed);
+  LogSlot* slot;
+  for (;;) {
+    slot = &g_ring.slots[pos & kMask];
+    const uint32_t seq = slot->seq.load(std::memory_order_acquire);
+    const int32_t diff = static_cast<int32_t>(seq - pos);
+    if (diff == 0) {
+      if (g_ring.head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      g_dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      pos = g_ring.head.load(std::memory_order_relaxed);
+    }
+  }
+
+  LogRecord& r = slot->record;
+  r.fmt = fmt;
+  r.t_us = hal_micros();
+  r.level = level;
+  r.nargs = nargs > LOG_MAX_ARGS ? LOG_MAX_ARGS : nargs;
+  for (uint8_t i = 0; i < r.nargs; ++i) r.args[i] = args[i];
+  if (text_length > LOG_TEXT_MAX) {
+    text_length = LOG_TEXT_MAX;
+    g_truncated.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (text_length) memcpy(r.text, text, text_length);
+  r.text_length = static_cast<uint8_t>(text_length);
+
+  slot->seq.store(pos + 1, std::memory_order_release);
+  g_written.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+static bool pop_record(LogRecord& out) {
+  LogSlot& slot = g_ring.slots[g_ring.tail & kMask];
+  if (slot.seq.load(std::memory_order_acquire) != g_ring.tail + 1) {
+    return false;
+  }
+  out = slot.record;
+  slot.seq.store(g_ring.tail + LOG_RING_SIZE, std::memory_order_release);
+  g_ring.tail++;
+  return true;
+}
+
+// Acrescenta em line[*len] sem passar de size - 1
+static void append(char* line, size_t size, size_t* len, const char* s, size_t n) {
+  if (*len + n > size - 1) n = size - 1 - *len;
+  memcpy(line + *len, s, n);
+  *len += n;
+}
+
+static size_t format_record(const LogRecord& r, char* line, size_t size) {
+  static const char kLevels[] = "-EWID";
+  size_t len = 0;
+  char buf[24];
+  int n = snprintf(buf, sizeof(buf), "%lu %c ", static_cast<unsigned long>(r.t_us / 1000),
+                   r.level < sizeof(kLevels) - 1 ? kLevels[r.level] : '?');
+  append(line, size, &len, buf, n > 0 ? static_cast<size_t>(n) : 0);
+
+  uint8_t arg = 0;
+  for (const char* p = r.fmt; *p; ++p) {
+    if (*p != '%') {
+      append(line, size, &len, p, 1);
+      continue;
+    }
+    ++p;
+    int precision = 2;   // mesmo padrão do Serial.print(float)
+    if (*p == '.' && p[1] >= '0' && p[1] <= '9') {
+      precision = p[1] - '0';
+      p += 2;
+    }
+    const char conv = *p;
+    if (conv == '\0') break;
+    if (conv == '%') {
+      append(line, size, &len, "%", 1);
+      continue;
+    }
+    if (conv == 's') {
+      append(line, size, &len, r.text, r.text_length);
+      continue;
+    }
+    if (arg >= r.nargs) {
+      append(line, size, &len, "?", 1);
+      continue;
+    }
+    const LogArg a = r.args[arg++];
+    switch (conv) {
+      case 'd':
+        n = snprintf(buf, sizeof(buf), "%ld", static_cast<long>(a.i));
+        break;
+      case 'u':
+        n = snprintf(buf, sizeof(buf), "%lu", static_cast<unsigned long>(a.u));
+        break;
+      case 'x':
+        n = snprintf(buf, sizeof(buf), "%lx", static_cast<unsigned long>(a.u));
+        break;
+      case 'c':
+        buf[0] = static_cast<char>(a.i);
+        n = 1;
+        break;
+      case 'f':
+        n = isnan(a.f) ? snprintf(buf, sizeof(buf), "nan")
+                       : snprintf(buf, sizeof(buf), "%.*f", precision, static_cast<double>(a.f));
+        break;
+      default:
+        n = snprintf(buf, sizeof(buf), "%%%c", conv);
+        break;
+    }
+    if (n > static_cast<int>(sizeof(buf)) - 1) n = sizeof(buf) - 1;
+    append(line, size, &len, buf, n > 0 ? static_cast<size_t>(n) : 0);
+  }
+  line[len++] = '\n';
+  return len;
+}
+
+void async_log_drain() {
+  char line[192];
+  LogRecord record;
+  for (int i = 0; i < LOG_DRAIN_BATCH && pop_record(record); ++i) {
+    const size_t len = format_record(record, line, sizeof(line));
+    Serial.write(reinterpret_cast<const uint8_t*>(line), len);
+  }
+
+  const uint32_t dropped = g_dropped.load(std::memory_order_relaxed);
+  if (dropped != g_dropped_reported) {
+    const int n = snprintf(line, sizeof(line), "[LOG] %lu registros descartados (anel cheio)\n",
+                           static_cast<unsigned long>(dropped - g_dropped_reported));
+    g_dropped_reported = dropped;
+    Serial.write(reinterpret_cast<const uint8_t*>(line), static_cast<size_t>(n));
+  }
+}
+
+bool async_log_begin() {
+  return hal_loop_task_start("log", LOG_TASK_CORE, LOG_TASK_PRIORITY, LOG_TASK_STACK,
+                             async_log_drain);
+}
+
+LogStats async_log_stats() {
+  LogStats stats;
+  stats.written = g_written.load(std::memory_order_relaxed);
+  stats.dropped = g_dropped.load(std::memory_order_relaxed);
+  stats.truncated = g_truncated.load(std::memory_order_relaxed);
+  return stats;
+}
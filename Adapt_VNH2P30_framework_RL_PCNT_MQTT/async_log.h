@@ -0,0 +1,140 @@
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Log assíncrono: quem loga só grava um registro binário (formato + até
+// LOG_MAX_ARGS argumentos de 32 bits + um texto curto copiado) num anel sem
+// locks com vários produtores; a tarefa de drenagem, de prioridade mínima
+// no core 0, formata e escreve na serial. Nenhuma tarefa espera a UART.
+//
+// O formato é um literal (o endereço serve de id; só a drenagem lê o
+// texto) com um subconjunto do printf: %d %u %x %c %s %f %.Nf e %%. Cada
+// conversão consome o próximo argumento, na ordem; %s consome o texto do
+// registro (const char* ou log_text(ptr, len)), truncado em LOG_TEXT_MAX.
+//
+// Níveis e filtro por módulo são de compilação: LOG_LEVEL vale para todos e
+// LOG_LEVEL_<MÓDULO> (padrão LOG_LEVEL) para um só; acima do nível a
+// chamada vira código morto. Anel cheio descarta o registro novo e conta em
+// async_log_stats().dropped.
+//
+// Ex.: LOG_I(MQTT, "[MQTT] Yaw recebido: %.2f°", yaw);
+
+#define LOG_NONE  0
+#define LOG_ERROR 1
+#define LOG_WARN  2
+#define LOG_INFO  3
+#define LOG_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_INFO
+#endif
+
+#ifndef LOG_LEVEL_CTRL
+#define LOG_LEVEL_CTRL LOG_LEVEL      // control_task
+#endif
+#ifndef LOG_LEVEL_MOTOR
+#define LOG_LEVEL_MOTOR LOG_LEVEL     // motor_control
+#endif
+#ifndef LOG_LEVEL_ODOM
+#define LOG_LEVEL_ODOM LOG_LEVEL      // velocidades/pose a ~5 Hz
+#endif
+#ifndef LOG_LEVEL_MQTT
+#define LOG_LEVEL_MQTT LOG_LEVEL      // mqtt_client
+#endif
+#ifndef LOG_LEVEL_NET
+#define LOG_LEVEL_NET LOG_LEVEL       // net_connection
+#endif
+#ifndef LOG_LEVEL_PROF
+#define LOG_LEVEL_PROF LOG_LEVEL      // loop_profiler
+#endif
+#ifndef LOG_LEVEL_HAL
+#define LOG_LEVEL_HAL LOG_LEVEL       // hal_esp32
+#endif
+
+#define LOG_RING_SIZE 64        // potência de 2
+#define LOG_MAX_ARGS 4
+#define LOG_TEXT_MAX 48
+#define LOG_DRAIN_BATCH 16      // registros por passada da drenagem
+
+#define LOG_TASK_CORE      0
+#define LOG_TASK_PRIORITY  0    // abaixo da tarefa de rede; cede a cada passada
+#define LOG_TASK_STACK     3072
+
+union LogArg {
+  int32_t i;
+  uint32_t u;
+  float f;
+};
+
+struct LogText {
+  const char* data;
+  size_t length;
+};
+
+inline LogText log_text(const char* data, size_t length) {
+  LogText text = {data, length};
+  return text;
+}
+
+struct LogStats {
+  uint32_t written;
+  uint32_t dropped;     // anel cheio
+  uint32_t truncated;   // texto maior que LOG_TEXT_MAX
+};
+
+// Inicia a tarefa de drenagem; antes dela os registros esperam no anel
+bool async_log_begin();
+// Qualquer tarefa; false se o anel estava cheio
+bool async_log_write(uint8_t level, const char* fmt, const LogArg* args, uint8_t nargs,
+                     const char* text, size_t text_length);
+// Formata e escreve até LOG_DRAIN_BATCH registros (corpo da tarefa)
+void async_log_drain();
+LogStats async_log_stats();
+
+namespace log_detail {
+
+struct Packer {
+  LogArg args[LOG_MAX_ARGS];
+  uint8_t nargs;
+  const char* text;
+  size_t text_length;
+};
+
+inline void put(Packer& p, LogArg arg) {
+  if (p.nargs < LOG_MAX_ARGS) p.args[p.nargs++] = arg;
+}
+inline void add(Packer& p, int v) { LogArg a; a.i = v; put(p, a); }
+inline void add(Packer& p, long v) { LogArg a; a.i = static_cast<int32_t>(v); put(p, a); }
+inline void add(Packer& p, unsigned v) { LogArg a; a.u = v; put(p, a); }
+inline void add(Packer& p, unsigned long v) { LogArg a; a.u = static_cast<uint32_t>(v); put(p, a); }
+inline void add(Packer& p, float v) { LogArg a; a.f = v; put(p, a); }
+inline void add(Packer& p, double v) { add(p, static_cast<float>(v)); }
+inline void add(Packer& p, LogText t) { p.text = t.data; p.text_length = t.length; }
+void add(Packer& p, const char* s);
+
+template <typename... Args>
+inline bool write(uint8_t level, const char* fmt, Args... args) {
+  static_assert(sizeof...(Args) <= LOG_MAX_ARGS + 1, "argumentos demais para um registro");
+  Packer p = {};
+  int expand[] = {0, (add(p, args), 0)...};
+  (void)expand;
+  return async_log_write(level, fmt, p.args, p.nargs, p.text, p.text_length);
+}
+
+}  // namespace log_detail
+
+#define LOG_AT(mod, level, ...)                      \
+  do {                                               \
+    if ((level) <= LOG_LEVEL_##mod) {                \
+      log_detail::write(level, __VA_ARGS__);         \
+    }                                                \
+  } while (0)
+
+#define LOG_E(mod, ...) LOG_AT(mod, LOG_ERROR, __VA_ARGS__)
+#define LOG_W(mod, ...) LOG_AT(mod, LOG_WARN, __VA_ARGS__)
+#define LOG_I(mod, ...) LOG_AT(mod, LOG_INFO, __VA_ARGS__)
+#define LOG_D(mod, ...) LOG_AT(mod, LOG_DEBUG, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,144 @@
+#include "button_input.h"
+
+#include "spsc_ring.h"
+
+// Estado do debounce: só o ISR escreve, ou o poll com o ISR mascarado
+static uint8_t g_count = 0;
+static uint8_t g_bank = 0;
+static uint8_t g_shift[BUTTON_INPUT_MAX] = {};
+static uint32_t g_debounce_us = BUTTON_DEBOUNCE_US;
+static uint8_t g_stable = 0;                          // nível aceito por botão
+static uint32_t g_changed_us[BUTTON_INPUT_MAX] = {};  // última mudança aceita
+static volatile uint8_t g_pending = 0;                // repique sem decisão
+static ButtonInputStats g_stats = {};
+
+static SpscRing<ButtonEvent, BUTTON_EVENT_RING_SIZE> g_events;
+
+// Só a tarefa de controle
+static uint8_t g_pressed = 0;
+static bool g_have_press = false;
+static ButtonEvent g_last_press = {};
+
+static void HAL_ISR_ATTR scan(uint32_t word, uint32_t now_us, bool from_poll) {
+  uint8_t pending = 0;
+  for (uint8_t i = 0; i < g_count; ++i) {
+    const uint8_t bit = 1u << i;
+    const uint8_t level = ((word >> g_shift[i]) & 1u) ? bit : 0;
+    if (level == (g_stable & bit)) {
+      continue;
+    }
+    if (now_us - g_changed_us[i] < g_debounce_us) {
+      pending |= bit;
+      if (!from_poll) {
+        g_stats.bounces++;
+      }
+      continue;
+    }
+    g_stable = (g_stable & ~bit) | level;
+    g_changed_us[i] = now_us;
+    g_stats.events++;
+    if (from_poll) {
+      g_stats.late++;
+    }
+    ButtonEvent ev;
+    ev.t_us = now_us;
+    ev.button = i;
+    ev.pressed = level != 0;
+    if (!g_events.push(ev)) {
+      g_stats.dropped++;
+    }
+  }
+  g_pending = pending;
+}
+
+static void HAL_ISR_ATTR button_input_isr() {
+  const uint32_t now = hal_isr_micros();
+  g_stats.edges++;
+  scan(hal_isr_gpio_read_bank(g_bank), now, false);
+}
+
+bool button_input_begin(const uint8_t* pins, uint8_t count, uint32_t debounce_us) {
+  if (count == 0 || count > BUTTON_INPUT_MAX) {
+    return false;
+  }
+  const uint8_t bank = pins[0] / 32;
+  for (uint8_t i = 0; i < count; ++i) {
+    if (pins[i] / 32 != bank) {
+      return false;
+    }
+  }
+
+  g_count = count;
+  g_bank = bank;
+  g_debounce_us = debounce_us;
+  for (uint8_t i = 0; i < count; ++i) {
+    g_shift[i] = pins[i] % 32;
+    hal_gpio_mode(pins[i], HAL_PIN_INPUT);
+  }
+
+  // Nível atual como aceito, com a janela já vencida: a primeira borda
+  // conta na hora
+  const uint32_t now = hal_micros();
+  const uint32_t word = hal_isr_gpio_read_bank(bank);
+  g_stable = 0;
+  for (uint8_t i = 0; i < count; ++i) {
+    if ((word >> g_shift[i]) & 1u) {
+      g_stable |= 1u << i;
+    }
+    g_changed_us[i] = now - debounce_us;
+  }
+  g_pending = 0;
+  g_pressed = g_stable;
+  g_have_press = false;
+
+  for (uint8_t i = 0; i < count; ++i) {
+    if (!hal_gpio_isr_attach(pins[i], button_input_isr)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint8_t button_input_poll() {
+  if (g_pending) {
+    hal_critical_enter();
+    scan(hal_isr_gpio_read_bank(g_bank), hal_micros(), true);
+    hal_critical_exit();
+  }
+
+  const uint32_t now = hal_micros();
+  uint8_t tapped = 0;
+  ButtonEvent ev;
+  while (g_events.pop(ev)) {
+    const uint8_t bit = 1u << ev.button;
+    if (ev.pressed) {
+      g_pressed |= bit;
+      tapped |= bit;
+      g_last_press = ev;
+      g_have_press = true;
+      // Da borda até o ciclo que passa a usar o botão
+      const uint32_t latency = now - ev.t_us;
+      hal_critical_enter();
+      g_stats.presses++;
+      if (latency > g_stats.latency_max_us) {
+        g_stats.latency_max_us = latency;
+      }
+      hal_critical_exit();
+    } else {
+      g_pressed &= ~bit;
+    }
+  }
+  return g_pressed | tapped;
+}
+
+bool button_input_last_press(ButtonEvent& out) {
+  out = g_last_press;
+  return g_have_press;
+}
+
+ButtonInputStats button_input_stats() {
+  hal_critical_enter();
+  const ButtonInputStats stats = g_stats;
+  hal_critical_exit();
+  return stats;
+}
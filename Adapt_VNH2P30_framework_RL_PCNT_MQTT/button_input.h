@@ -0,0 +1,62 @@
+#ifndef BUTTON_INPUT_H
+#define BUTTON_INPUT_H
+
+#include <stdint.h>
+
+#include "hal.h"
+
+// Botões do controle manual por interrupção de GPIO, sem leitura no laço.
+// Cada borda de qualquer botão chama o mesmo ISR, que lê de uma vez o
+// registrador de entrada do banco (hal_isr_gpio_read_bank) e passa todos os
+// botões pelo debounce por tempo:
+//   - uma mudança de nível é aceita na hora se o botão está parado há pelo
+//     menos debounce_us; o evento leva o instante da borda (hal_isr_micros).
+//     Aceitar na primeira borda não soma atraso ao controle manual, mas um
+//     pulso espúrio isolado conta como um toque;
+//   - mudanças dentro da janela são repique e ficam pendentes.
+// Os eventos (pressionado/solto) vão para um anel SPSC até a tarefa de
+// controle, que os consome uma vez por ciclo (button_input_poll).
+//
+// Se a última borda do repique cai dentro da janela, nenhuma interrupção
+// chega depois dela: o poll confere os pendentes com a janela já vencida e
+// aceita o nível atual, carimbado no instante do poll (contado em `late`).
+//
+// Nível alto = pressionado (resistores de pull-down externos: os pinos 34..39
+// do ESP32 não têm pull interno). Todos os pinos no mesmo banco de 32.
+
+#define BUTTON_INPUT_MAX 8
+#define BUTTON_EVENT_RING_SIZE 32   // potência de 2
+#define BUTTON_DEBOUNCE_US 20000
+
+struct ButtonEvent {
+  uint32_t t_us;      // borda (ou poll, se late), base de hal_micros()
+  uint8_t button;     // índice em pins[]
+  bool pressed;
+};
+
+struct ButtonInputStats {
+  uint32_t edges;           // chamadas do ISR
+  uint32_t bounces;         // mudanças ignoradas dentro da janela
+  uint32_t events;          // eventos aceitos
+  uint32_t late;            // aceitos só pelo poll
+  uint32_t dropped;         // anel cheio
+  uint32_t presses;         // pressionamentos consumidos pelo controle
+  uint32_t latency_max_us;  // borda -> ciclo de controle que a consumiu
+};
+
+// Configura os pinos como entrada e liga a interrupção nas duas bordas. O
+// poll entra em seção crítica para não correr com o ISR: chamar no core da
+// tarefa de controle (setup() roda no core 1). debounce_us = 0 aceita toda
+// borda (reprodução de sessão, em que o gravado já é o estado filtrado).
+bool button_input_begin(const uint8_t* pins, uint8_t count, uint32_t debounce_us);
+
+// Tarefa de controle, uma vez por ciclo: consome os eventos e devolve os
+// botões pressionados (bit i = pins[i]). Um toque mais curto que o ciclo
+// (pressionado e solto entre dois polls) conta como pressionado neste ciclo.
+uint8_t button_input_poll();
+// Pressionamento mais recente consumido pelo poll (instante da borda, para
+// medir a latência do controle manual); false se nenhum ainda
+bool button_input_last_press(ButtonEvent& out);
+ButtonInputStats button_input_stats();
+
+#endif
@@ -0,0 +1,94 @@
+#include "command_gate.h"
+
+#include <string.h>
+
+CommandGate::CommandGate(uint32_t max_age_ms, uint32_t resync_ms)
+    : max_age_ms_(max_age_ms), resync_ms_(resync_ms) {
+  reset();
+}
+
+void CommandGate::reset() {
+  started_ = false;
+  last_accept_ms_ = 0;
+  last_now_ms_ = 0;
+  clock_ms_ = 0;
+  have_offset_ = false;
+  min_offset_[0] = min_offset_[1] = 0;
+  window_start_ms_ = 0;
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+// Idade = offset - menor offset das duas últimas janelas (o do próprio
+// comando incluído: o mais rápido até agora tem idade 0)
+uint32_t CommandGate::age_of(uint64_t sent_ms) {
+  const int64_t offset = static_cast<int64_t>(clock_ms_) - static_cast<int64_t>(sent_ms);
+  if (!have_offset_) {
+    have_offset_ = true;
+    min_offset_[0] = min_offset_[1] = offset;
+    window_start_ms_ = clock_ms_;
+  } else if (clock_ms_ - window_start_ms_ >= COMMAND_GATE_OFFSET_WINDOW_MS) {
+    min_offset_[1] = min_offset_[0];
+    min_offset_[0] = offset;
+    window_start_ms_ = clock_ms_;
+  }
+  if (offset < min_offset_[0]) {
+    min_offset_[0] = offset;
+  }
+  const int64_t base = min_offset_[0] < min_offset_[1] ? min_offset_[0] : min_offset_[1];
+  const int64_t age = offset - base;
+  return age > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(age);
+}
+
+CommandVerdict CommandGate::check(const CommandSequence& seq, uint32_t now_ms) {
+  clock_ms_ += now_ms - last_now_ms_;
+  last_now_ms_ = now_ms;
+
+  if (!seq.has_seq) {
+    stats_.unsequenced++;
+    return CMD_ACCEPTED;
+  }
+
+  bool resync = false;
+  if (started_ && static_cast<int32_t>(seq.seq - stats_.last_seq) <= 0) {
+    if ((now_ms - last_accept_ms_) < resync_ms_) {
+      stats_.reordered++;
+      return CMD_REORDERED;
+    }
+    resync = true;   // remetente reiniciado: a nova contagem vale
+  }
+
+  if (seq.has_sent_ms) {
+    const uint32_t age = age_of(seq.sent_ms);
+    const uint32_t max_age = seq.max_age_ms ? seq.max_age_ms : max_age_ms_;
+    stats_.age_ms_last = age;
+    if (max_age && age > max_age) {
+      stats_.stale++;
+      return CMD_STALE;
+    }
+    if (age > stats_.age_ms_max) {
+      stats_.age_ms_max = age;
+    }
+  }
+  // Só o aceito avança a sequência: um velho recusado não faz os seguintes
+  // parecerem fora de ordem
+  started_ = true;
+  stats_.last_seq = seq.seq;
+  if (resync) {
+    stats_.resyncs++;
+  }
+  last_accept_ms_ = now_ms;
+  stats_.accepted++;
+  return CMD_ACCEPTED;
+}
+
+const char* command_verdict_name(CommandVerdict verdict) {
+  switch (verdict) {
+    case CMD_ACCEPTED:
+      return "ok";
+    case CMD_STALE:
+      return "stale";
+    case CMD_REORDERED:
+      return "reordered";
+  }
+  return "?";
+}
@@ -0,0 +1,78 @@
+#ifndef COMMAND_GATE_H
+#define COMMAND_GATE_H
+
+#include <stdint.h>
+
+#include "command_parser.h"
+
+// Aceite dos comandos remotos com sequência (command_parser.h): antes de
+// chegar à fila de comandos, cada "yaw|pitch|nonce|t0|seq[|max_age_ms]" é
+// recusado se vier fora de ordem ou velho demais.
+//
+// Fora de ordem: seq não é maior que a maior já aceita (comparação serial em
+// 32 bits; repetido também conta). Sem comando aceito há resync_ms o
+// remetente pode ter reiniciado e qualquer seq volta a valer (resyncs).
+//
+// Velho: robô e remetente não têm relógio em comum, então a idade é o
+// atraso além do melhor já visto. Cada comando dá offset = relógio do robô
+// - t0; o menor offset das duas últimas janelas de OFFSET_WINDOW_MS é o
+// atraso mínimo da rede, e idade = offset - mínimo. Passando de max_age_ms
+// (do comando ou, sem ele, o padrão) o comando é recusado. O mínimo por
+// janela acompanha a deriva entre os relógios e um ajuste no do remetente.
+//
+// Comando sem seq passa direto (unsequenced), como antes. Só a tarefa de
+// rede usa o gate.
+
+#define COMMAND_GATE_OFFSET_WINDOW_MS 10000
+
+enum CommandVerdict {
+  CMD_ACCEPTED = 0,
+  CMD_STALE,       // passou da idade máxima
+  CMD_REORDERED,   // seq não maior que a maior já aceita
+};
+
+struct CommandGateStats {
+  uint32_t accepted;      // com seq
+  uint32_t stale;
+  uint32_t reordered;
+  uint32_t unsequenced;   // sem seq, aceitos sem conferir
+  uint32_t resyncs;       // seq aceita de novo depois de resync_ms parado
+  uint32_t last_seq;      // maior seq aceita
+  uint32_t age_ms_last;   // idade do último comando com t0
+  uint32_t age_ms_max;    // maior idade aceita
+};
+
+class CommandGate {
+ public:
+  // max_age_ms 0 desliga a conferência de idade
+  explicit CommandGate(uint32_t max_age_ms = 250, uint32_t resync_ms = 3000);
+
+  void reset();
+  void set_max_age(uint32_t max_age_ms) { max_age_ms_ = max_age_ms; }
+  uint32_t max_age() const { return max_age_ms_; }
+
+  // now_ms: hal_millis() na chegada
+  CommandVerdict check(const CommandSequence& seq, uint32_t now_ms);
+  CommandGateStats stats() const { return stats_; }
+
+ private:
+  uint32_t age_of(uint64_t sent_ms);
+
+  uint32_t max_age_ms_;
+  uint32_t resync_ms_;
+
+  bool started_;          // já viu um comando com seq
+  uint32_t last_accept_ms_;
+  uint32_t last_now_ms_;
+  uint64_t clock_ms_;     // now_ms estendido para 64 bits
+
+  bool have_offset_;
+  int64_t min_offset_[2]; // janela atual e anterior
+  uint64_t window_start_ms_;
+
+  CommandGateStats stats_;
+};
+
+const char* command_verdict_name(CommandVerdict verdict);
+
+#endif
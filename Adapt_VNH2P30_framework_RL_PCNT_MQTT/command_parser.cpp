@@ -0,0 +1,317 @@
+#include "command_parser.h"
+
+#include <math.h>
+#include <string.h>
+
+static bool is_space(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static TextView trim(const char* begin, const char* end) {
+  while (begin < end && is_space(*begin)) ++begin;
+  while (end > begin && is_space(end[-1])) --end;
+  TextView view = {begin, static_cast<size_t>(end - begin)};
+  return view;
+}
+
+// Potências exatas em double até 1e22
+static const double kPow10[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static double pow10_of(int e) {
+  return e < static_cast<int>(sizeof(kPow10) / sizeof(kPow10[0])) ? kPow10[e] : pow(10.0, e);
+}
+
+// Expoente opcional ("e-3", "p+4"); sem dígitos, não é expoente (como em
+// strtod) e p fica onde estava. Valores absurdos saturam.
+static int scan_exponent(const char*& p, const char* end, char lower, char upper) {
+  if (p >= end || (*p != lower && *p != upper)) return 0;
+  const char* q = p + 1;
+  bool negative = false;
+  if (q < end && (*q == '+' || *q == '-')) {
+    negative = *q == '-';
+    ++q;
+  }
+  if (q >= end || !is_digit(*q)) return 0;
+  int e = 0;
+  for (; q < end && is_digit(*q); ++q) {
+    if (e < 100000) e = e * 10 + (*q - '0');
+  }
+  p = q;
+  return negative ? -e : e;
+}
+
+// Mantissa acumulada até 18 dígitos significativos; o resto só conta no
+// expoente (abaixo da resolução do float de qualquer forma).
+static bool scan_decimal(const char* p, const char* end, double& value) {
+  const uint64_t kMantissaLimit = 100000000000000000ull;
+  uint64_t mantissa = 0;
+  int exp10 = 0;
+  bool digits = false;
+
+  for (; p < end && is_digit(*p); ++p) {
+    digits = true;
+    if (mantissa < kMantissaLimit) {
+      mantissa = mantissa * 10 + (*p - '0');
+    } else {
+      ++exp10;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && is_digit(*p); ++p) {
+      digits = true;
+      if (mantissa < kMantissaLimit) {
+        mantissa = mantissa * 10 + (*p - '0');
+        --exp10;
+      }
+    }
+  }
+  if (!digits) return false;
+  exp10 += scan_exponent(p, end, 'e', 'E');
+
+  if (mantissa == 0) {
+    value = 0.0;
+  } else if (exp10 >= 0) {
+    value = exp10 > 400 ? HUGE_VAL : mantissa * pow10_of(exp10);
+  } else {
+    value = exp10 < -400 ? 0.0 : mantissa / pow10_of(-exp10);
+  }
+  return true;
+}
+
+// Depois de "0x": dígitos hex, fração opcional e expoente binário 'p'
+static double scan_hex(const char* p, const char* end) {
+  uint64_t mantissa = 0;
+  int exp2 = 0;
+  int h;
+  for (; p < end && (h = hex_value(*p)) >= 0; ++p) {
+    if ((mantissa >> 60) == 0) {
+      mantissa = (mantissa << 4) | h;
+    } else {
+      exp2 += 4;
+    }
+  }
+  if (p < end && *p == '.') {
+    for (++p; p < end && (h = hex_value(*p)) >= 0; ++p) {
+      if ((mantissa >> 60) == 0) {
+        mantissa = (mantissa << 4) | h;
+        exp2 -= 4;
+      }
+    }
+  }
+  exp2 += scan_exponent(p, end, 'p', 'P');
+  return ldexp(static_cast<double>(mantissa), exp2);
+}
+
+// Valor que atof daria para [p, end): sinal opcional seguido de número
+// decimal ou hex; sem número, 0.
+static double scan_number(const char* p, const char* end) {
+  bool negative = false;
+  if (p < end && (*p == '+' || *p == '-')) {
+    negative = *p == '-';
+    ++p;
+  }
+  double value;
+  if (end - p >= 3 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X') &&
+      (hex_value(p[2]) >= 0 || (p[2] == '.' && end - p >= 4 && hex_value(p[3]) >= 0))) {
+    value = scan_hex(p + 2, end);
+  } else if (!scan_decimal(p, end, value)) {
+    return 0.0;
+  }
+  return negative ? -value : value;
+}
+
+bool parse_angle(TextView field, float& value) {
+  TextView t = trim(field.data, field.data + field.length);
+  if (t.length == 0) {
+    return false;
+  }
+
+  if (t.length == 3 && (t.data[0] | 0x20) == 'n' && (t.data[1] | 0x20) == 'a' &&
+      (t.data[2] | 0x20) == 'n') {
+    value = NAN;
+    return true;
+  }
+
+  const char* end = t.data + t.length;
+  const char* p = t.data;
+  for (; p < end && !is_digit(*p); ++p) {
+    if (*p != '-' && *p != '+' && *p != '.') {
+      return false;
+    }
+  }
+  if (p == end) {
+    return false;
+  }
+
+  float v = static_cast<float>(scan_number(t.data, end));
+  if (isnan(v) || isinf(v)) {
+    return false;
+  }
+  value = v;
+  return true;
+}
+
+bool parse_command(const uint8_t* payload, size_t length, ParsedCommand& out) {
+  if (!payload) {
+    return false;
+  }
+  const char* text = reinterpret_cast<const char*>(payload);
+  const char* nul = static_cast<const char*>(memchr(text, '\0', length));
+  const char* end = nul ? nul : text + length;
+
+  const char* sep[3];
+  const char* p = text;
+  for (int i = 0; i < 3; ++i) {
+    sep[i] = static_cast<const char*>(memchr(p, '|', end - p));
+    if (!sep[i]) return false;
+    p = sep[i] + 1;
+  }
+
+  TextView yaw = trim(text, sep[0]);
+  TextView pitch = trim(sep[0] + 1, sep[1]);
+  TextView nonce = trim(sep[1] + 1, sep[2]);
+  TextView timestamp = trim(sep[2] + 1, end);
+  if (yaw.length == 0 || pitch.length == 0 || nonce.length == 0 || timestamp.length == 0) {
+    return false;
+  }
+
+  float yaw_deg;
+  float pitch_deg;
+  if (!parse_angle(yaw, yaw_deg) || !parse_angle(pitch, pitch_deg)) {
+    return false;
+  }
+
+  out.yaw_deg = yaw_deg;
+  out.pitch_deg = pitch_deg;
+  out.nonce = nonce;
+  out.timestamp = timestamp;
+  return true;
+}
+
+// Decimal sem sinal, todo o campo; false se vazio, com outro caractere ou
+// maior que max
+static bool parse_unsigned(TextView field, uint64_t max, uint64_t& value) {
+  if (field.length == 0) {
+    return false;
+  }
+  uint64_t v = 0;
+  for (size_t i = 0; i < field.length; ++i) {
+    if (!is_digit(field.data[i])) return false;
+    const unsigned digit = field.data[i] - '0';
+    if (v > (max - digit) / 10) return false;
+    v = v * 10 + digit;
+  }
+  value = v;
+  return true;
+}
+
+bool parse_command_sequence(ParsedCommand& cmd, CommandSequence& out) {
+  const char* begin = cmd.timestamp.data;
+  const char* end = begin + cmd.timestamp.length;
+  out.has_seq = false;
+  out.seq = 0;
+  out.max_age_ms = 0;
+  out.has_sent_ms = false;
+  out.sent_ms = 0;
+
+  const char* sep = static_cast<const char*>(memchr(begin, '|', end - begin));
+  TextView t0 = trim(begin, sep ? sep : end);
+  if (sep) {
+    const char* next = static_cast<const char*>(memchr(sep + 1, '|', end - sep - 1));
+    uint64_t seq;
+    if (t0.length == 0 || !parse_unsigned(trim(sep + 1, next ? next : end), UINT32_MAX, seq)) {
+      return false;
+    }
+    uint64_t max_age = 0;
+    if (next && (memchr(next + 1, '|', end - next - 1) ||
+                 !parse_unsigned(trim(next + 1, end), UINT32_MAX, max_age))) {
+      return false;
+    }
+    out.has_seq = true;
+    out.seq = static_cast<uint32_t>(seq);
+    out.max_age_ms = static_cast<uint32_t>(max_age);
+  }
+  uint64_t sent_ms;
+  if (parse_unsigned(t0, UINT64_MAX, sent_ms)) {
+    out.has_sent_ms = true;
+    out.sent_ms = sent_ms;
+  }
+  cmd.timestamp = t0;
+  return true;
+}
+
+bool parse_twist(const uint8_t* payload, size_t length, ParsedTwist& out) {
+  if (!payload) {
+    return false;
+  }
+  const char* text = reinterpret_cast<const char*>(payload);
+  const char* nul = static_cast<const char*>(memchr(text, '\0', length));
+  const char* end = nul ? nul : text + length;
+  const char* sep = static_cast<const char*>(memchr(text, '|', end - text));
+  if (!sep) {
+    return false;
+  }
+  const char* rest = static_cast<const char*>(memchr(sep + 1, '|', end - sep - 1));
+  TextView v = trim(text, sep);
+  TextView w = trim(sep + 1, rest ? rest : end);
+  if (v.length == 0 || w.length == 0) {
+    return false;
+  }
+  float v_value;
+  float w_value;
+  if (!parse_angle(v, v_value) || !parse_angle(w, w_value) || isnan(v_value) ||
+      isnan(w_value)) {
+    return false;
+  }
+
+  CommandSequence& seq = out.sequence;
+  seq.has_seq = false;
+  seq.seq = 0;
+  seq.max_age_ms = 0;
+  seq.has_sent_ms = false;
+  seq.sent_ms = 0;
+  out.head.data = end;
+  out.head.length = 0;
+  if (rest) {
+    // seq|t0[|max_age_ms]
+    const char* t0_sep = static_cast<const char*>(memchr(rest + 1, '|', end - rest - 1));
+    if (!t0_sep) {
+      return false;
+    }
+    const char* age_sep = static_cast<const char*>(memchr(t0_sep + 1, '|', end - t0_sep - 1));
+    const TextView t0 = trim(t0_sep + 1, age_sep ? age_sep : end);
+    uint64_t seq_value;
+    uint64_t max_age = 0;
+    if (!parse_unsigned(trim(rest + 1, t0_sep), UINT32_MAX, seq_value) || t0.length == 0 ||
+        (age_sep && (memchr(age_sep + 1, '|', end - age_sep - 1) ||
+                     !parse_unsigned(trim(age_sep + 1, end), UINT32_MAX, max_age)))) {
+      return false;
+    }
+    seq.has_seq = true;
+    seq.seq = static_cast<uint32_t>(seq_value);
+    seq.max_age_ms = static_cast<uint32_t>(max_age);
+    uint64_t sent_ms;
+    if (parse_unsigned(t0, UINT64_MAX, sent_ms)) {
+      seq.has_sent_ms = true;
+      seq.sent_ms = sent_ms;
+    }
+    out.head = trim(rest + 1, t0.data + t0.length);
+  }
+  out.v_mps = v_value;
+  out.w_radps = w_value;
+  return true;
+}
@@ -0,0 +1,67 @@
+#ifndef COMMAND_PARSER_H
+#define COMMAND_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Parser do comando remoto "yaw|pitch|nonce|timestamp" direto sobre o buffer
+// do callback MQTT, sem alocar: os campos são fatias (TextView) do próprio
+// payload e só valem enquanto ele existir.
+//
+// Regras (as mesmas da versão com String):
+// - o payload termina no primeiro byte NUL, se houver;
+// - separa nos três primeiros '|'; o timestamp é todo o resto;
+// - cada campo perde os espaços das pontas (isspace) e não pode ficar vazio;
+// - ângulo: "nan" (sem diferenciar maiúsculas) vira NAN; senão, antes do
+//   primeiro dígito só pode haver '+', '-' ou '.', e o número é lido como
+//   atof (maior prefixo válido, decimal ou hex; prefixo inválido vale 0).
+//   Resultado infinito é rejeitado.
+
+struct TextView {
+  const char* data;
+  size_t length;
+};
+
+struct ParsedCommand {
+  float yaw_deg;
+  float pitch_deg;  // pode ser NAN
+  TextView nonce;
+  TextView timestamp;
+};
+
+bool parse_command(const uint8_t* payload, size_t length, ParsedCommand& out);
+bool parse_angle(TextView field, float& value);
+
+// Sequência opcional depois do timestamp (command_gate.h):
+//   yaw|pitch|nonce|t0|seq            ou  yaw|pitch|nonce|t0|seq|max_age_ms
+// parse_command deixa tudo isso em timestamp, como o parser antigo; esta
+// função separa: timestamp fica só com t0, e seq e max_age_ms são decimais
+// sem sinal (max_age_ms 0 ou ausente = padrão do robô). t0 em ms do relógio
+// do remetente (Date.now()) vira sent_ms; t0 não numérico só tira a idade.
+// Sem '|' no timestamp o comando não tem sequência (has_seq false). false
+// com campo extra vazio, não numérico ou sobrando.
+struct CommandSequence {
+  bool has_seq;
+  uint32_t seq;
+  uint32_t max_age_ms;
+  bool has_sent_ms;
+  uint64_t sent_ms;
+};
+
+bool parse_command_sequence(ParsedCommand& cmd, CommandSequence& out);
+
+// Twist direto "v|w" ou "v|w|seq|t0[|max_age_ms]" (m/s e rad/s), com os
+// números lidos como os ângulos; NAN é rejeitado. seq, t0 e max_age_ms como
+// em parse_command_sequence; head fica com "seq|t0" (cabeça do pong). Só
+// "v|w" não tem sequência (has_seq false, head vazio). false com seq sem t0,
+// campo vazio, não numérico ou sobrando.
+struct ParsedTwist {
+  float v_mps;
+  float w_radps;
+  TextView head;
+  CommandSequence sequence;
+};
+
+bool parse_twist(const uint8_t* payload, size_t length, ParsedTwist& out);
+
+#endif
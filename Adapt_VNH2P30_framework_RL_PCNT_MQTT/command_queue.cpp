@@ -0,0 +1,121 @@
+#include "command_queue.h"
+
+static_assert((COMMAND_QUEUE_CAPACITY & (COMMAND_QUEUE_CAPACITY - 1)) == 0,
+              "COMMAND_QUEUE_CAPACITY deve ser potência de 2");
+
+static const uint32_t kMask = COMMAND_QUEUE_CAPACITY - 1;
+
+CommandQueue::CommandQueue(CommandQueuePolicy policy) {
+  reset(policy);
+}
+
+void CommandQueue::reset(CommandQueuePolicy policy) {
+  policy_ = policy;
+  next_seq_ = 0;
+  head_.store(0, std::memory_order_relaxed);
+  tail_.store(0, std::memory_order_relaxed);
+  enqueued_.store(0, std::memory_order_relaxed);
+  dropped_full_.store(0, std::memory_order_relaxed);
+  evicted_.store(0, std::memory_order_relaxed);
+  max_depth_.store(0, std::memory_order_relaxed);
+  dropped_superseded_.store(0, std::memory_order_relaxed);
+  consumed_.store(0, std::memory_order_release);
+}
+
+bool CommandQueue::push(MotionCommand command, uint32_t t_ms, Twist twist,
+                        CommandStamp stamp) {
+  const uint32_t seq = next_seq_++;
+  const uint32_t head = head_.load(std::memory_order_relaxed);
+  uint32_t tail = tail_.load(std::memory_order_acquire);
+  uint32_t depth = head - tail;
+
+  if (depth >= COMMAND_QUEUE_CAPACITY) {
+    if (policy_ != CMDQ_LATEST_WINS) {
+      dropped_full_.store(dropped_full_.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+      return false;
+    }
+    // Tira o mais antigo. Se o CAS falha, o consumidor acabou de drenar e já
+    // há espaço; o slot reescrito abaixo é o mais antigo, nunca o head - 1
+    // que um pop() em andamento está copiando
+    if (tail_.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+      evicted_.store(evicted_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      ++tail;
+    }
+    depth = head - tail;
+  }
+
+  CommandRecord& slot = slots_[head & kMask];
+  slot.command = command;
+  slot.twist = twist;
+  slot.stamp = stamp;
+  slot.seq = seq;
+  slot.t_ms = t_ms;
+  // Publica o registro: o consumidor só lê o slot depois de ver o novo head
+  head_.store(head + 1, std::memory_order_release);
+
+  enqueued_.store(enqueued_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (depth + 1 > max_depth_.load(std::memory_order_relaxed)) {
+    max_depth_.store(depth + 1, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+bool CommandQueue::pop(CommandRecord& out) {
+  if (policy_ == CMDQ_LATEST_WINS) {
+    for (;;) {
+      uint32_t tail = tail_.load(std::memory_order_acquire);
+      const uint32_t head = head_.load(std::memory_order_acquire);
+      if (head == tail) {
+        return false;
+      }
+      out = slots_[(head - 1) & kMask];
+      // O produtor só reescreve esse slot depois de tirar o mais antigo, o
+      // que muda tail: com o CAS aceito, a cópia está inteira
+      if (tail_.compare_exchange_strong(tail, head, std::memory_order_acq_rel,
+                                        std::memory_order_relaxed)) {
+        const uint32_t skipped = head - tail - 1;
+        if (skipped) {
+          dropped_superseded_.store(
+              dropped_superseded_.load(std::memory_order_relaxed) + skipped,
+              std::memory_order_relaxed);
+        }
+        consumed_.store(consumed_.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+
+  const uint32_t tail = tail_.load(std::memory_order_relaxed);
+  const uint32_t head = head_.load(std::memory_order_acquire);
+  if (head == tail) {
+    return false;
+  }
+
+  out = slots_[tail & kMask];
+  // Libera o slot para o produtor só depois da cópia
+  tail_.store(tail + 1, std::memory_order_release);
+  consumed_.store(consumed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  return true;
+}
+
+CommandQueueStats CommandQueue::stats() const {
+  CommandQueueStats s;
+  s.enqueued = enqueued_.load(std::memory_order_relaxed);
+  s.dropped_full = dropped_full_.load(std::memory_order_relaxed);
+  // Tirados pelo produtor ou pulados pelo consumidor: os dois foram vencidos
+  // por um comando mais novo
+  s.dropped_superseded = dropped_superseded_.load(std::memory_order_relaxed) +
+                         evicted_.load(std::memory_order_relaxed);
+  s.consumed = consumed_.load(std::memory_order_relaxed);
+  s.max_depth = max_depth_.load(std::memory_order_relaxed);
+  return s;
+}
+
+uint32_t CommandQueue::depth() const {
+  // tail antes de head: garante head >= tail mesmo com os dois lados andando
+  const uint32_t tail = tail_.load(std::memory_order_acquire);
+  return head_.load(std::memory_order_acquire) - tail;
+}
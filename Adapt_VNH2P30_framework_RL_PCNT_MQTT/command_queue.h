@@ -0,0 +1,110 @@
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+// Fila SPSC sem locks de comandos de movimento com carimbo de tempo.
+//
+// Produtor único: a tarefa de rede (callback MQTT, core 0).
+// Consumidor único: a tarefa de controle (core 1).
+// Nenhum dos dois desabilita interrupções nem espera pelo outro. Em CMDQ_FIFO
+// cada lado só escreve o próprio índice (wait-free). Em CMDQ_LATEST_WINS o
+// produtor também avança tail quando a fila está cheia, com CAS; o pop() que
+// perde essa corrida copia de novo o mais recente (lock-free: só repete se
+// a rede empurrou um comando durante a cópia).
+
+enum MotionCommand {
+  MOTION_STOP = 0,
+  MOTION_FORWARD,
+  MOTION_REVERSE,
+  MOTION_TURN_LEFT,
+  MOTION_TURN_RIGHT,
+  MOTION_TWIST,      // velocidades contínuas em CommandRecord::twist
+};
+
+// Referência contínua de velocidade do robô: linear no centro do eixo
+// (> 0 para frente) e angular (> 0 no sentido de phi da odometria).
+struct Twist {
+  float v_mps;
+  float w_radps;
+};
+
+// Potência de 2 (índices livres mascarados)
+#define COMMAND_QUEUE_CAPACITY 16
+
+enum CommandQueuePolicy {
+  // Cada comando é consumido, em ordem, um por pop(). Fila cheia descarta o
+  // comando novo (dropped_full).
+  CMDQ_FIFO = 0,
+  // pop() drena a fila e entrega só o mais recente; os intermediários contam
+  // como dropped_superseded. Fila cheia descarta o mais antigo, então o
+  // último comando (um STOP, por exemplo) sempre chega ao consumidor, mesmo
+  // depois de ele passar vários ciclos sem chamar pop() (botão segurado).
+  CMDQ_LATEST_WINS,
+};
+
+// Carimbos do lado da rede para o rastreio de latência (command_trace.h),
+// em hal_micros(); id 0 = comando sem rastreio.
+struct CommandStamp {
+  uint32_t id;
+  uint32_t received_us;
+  uint32_t parsed_us;
+};
+
+struct CommandRecord {
+  MotionCommand command;
+  Twist twist;     // só em MOTION_TWIST
+  CommandStamp stamp;
+  uint32_t seq;    // atribuída pelo produtor a cada push(), inclusive descartados
+  uint32_t t_ms;   // instante do enfileiramento
+};
+
+struct CommandQueueStats {
+  uint32_t enqueued;
+  uint32_t dropped_full;
+  uint32_t dropped_superseded;
+  uint32_t consumed;
+  uint32_t max_depth;
+};
+
+class CommandQueue {
+ public:
+  explicit CommandQueue(CommandQueuePolicy policy = CMDQ_LATEST_WINS);
+
+  // Só com produtor e consumidor parados.
+  void reset(CommandQueuePolicy policy);
+
+  // Lado do produtor; false só em CMDQ_FIFO com a fila cheia
+  bool push(MotionCommand command, uint32_t t_ms, Twist twist = Twist(),
+            CommandStamp stamp = CommandStamp());
+
+  // Lado do consumidor; false se vazia.
+  bool pop(CommandRecord& out);
+
+  // Qualquer tarefa (contadores individualmente consistentes)
+  CommandQueueStats stats() const;
+  uint32_t depth() const;
+  CommandQueuePolicy policy() const { return policy_; }
+
+ private:
+  CommandRecord slots_[COMMAND_QUEUE_CAPACITY];
+  CommandQueuePolicy policy_;
+
+  std::atomic<uint32_t> head_;  // próxima escrita (só o produtor altera)
+  std::atomic<uint32_t> tail_;  // próxima leitura (só o consumidor altera)
+
+  // Produtor
+  uint32_t next_seq_;
+  std::atomic<uint32_t> enqueued_;
+  std::atomic<uint32_t> dropped_full_;
+  std::atomic<uint32_t> evicted_;     // antigos tirados por push() (LATEST_WINS)
+  std::atomic<uint32_t> max_depth_;
+
+  // Consumidor
+  std::atomic<uint32_t> dropped_superseded_;
+  std::atomic<uint32_t> consumed_;
+};
+
+#endif
@@ -0,0 +1,74 @@
+#include "command_trace.h"
+
+#include <math.h>
+
+#include "spsc_ring.h"
+
+// Estado do rastreio em curso: só a tarefa de controle escreve
+static CommandTrace g_active = {};
+static bool g_active_on = false;
+static float g_lastR = 0.0f;
+static float g_lastL = 0.0f;
+static float g_baseR = 0.0f;
+static float g_baseL = 0.0f;
+
+static SpscRing<CommandTrace, TRACE_RING_SIZE> g_done;
+
+// 0 é "não aconteceu"; um carimbo que cai exatamente em 0 vira 1 µs
+static uint32_t stamp_of(uint32_t now_us) {
+  return now_us ? now_us : 1;
+}
+
+static void finish() {
+  g_done.push(g_active);
+  g_active_on = false;
+}
+
+void command_trace_dequeued(const CommandStamp& stamp, uint32_t now_us) {
+  if (stamp.id == 0) {
+    return;
+  }
+  // Um comando novo encerra o anterior como está
+  if (g_active_on) {
+    finish();
+  }
+  g_active.id = stamp.id;
+  g_active.received_us = stamp.received_us;
+  g_active.parsed_us = stamp.parsed_us;
+  g_active.dequeued_us = stamp_of(now_us);
+  g_active.applied_us = 0;
+  g_active.motion_us = 0;
+  g_active_on = true;
+}
+
+void command_trace_output(uint32_t now_us) {
+  if (!g_active_on || g_active.applied_us) {
+    return;
+  }
+  g_active.applied_us = stamp_of(now_us);
+  g_baseR = g_lastR;
+  g_baseL = g_lastL;
+}
+
+void command_trace_sample(float velR_motor, float velL_motor, uint32_t now_us) {
+  g_lastR = velR_motor;
+  g_lastL = velL_motor;
+  if (!g_active_on || !g_active.applied_us) {
+    return;
+  }
+  if (fabsf(velR_motor - g_baseR) >= TRACE_MOTION_THRESHOLD_RAD_S ||
+      fabsf(velL_motor - g_baseL) >= TRACE_MOTION_THRESHOLD_RAD_S) {
+    g_active.motion_us = stamp_of(now_us);
+    finish();
+  } else if ((now_us - g_active.applied_us) > TRACE_MOTION_TIMEOUT_MS * 1000UL) {
+    finish();
+  }
+}
+
+bool command_trace_pop(CommandTrace& out) {
+  return g_done.pop(out);
+}
+
+uint32_t command_trace_dropped() {
+  return g_done.dropped();
+}
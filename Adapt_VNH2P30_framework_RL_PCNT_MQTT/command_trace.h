@@ -0,0 +1,50 @@
+#ifndef COMMAND_TRACE_H
+#define COMMAND_TRACE_H
+
+#include <stdint.h>
+
+#include "command_queue.h"
+
+// Rastreio de latência de cada comando remoto, em hal_micros():
+//   received  callback MQTT chamado (antes dos prints)
+//   parsed    payload interpretado, logo antes do push na fila
+//   dequeued  pop() da tarefa de controle
+//   applied   primeira escrita na ponte H (direção/PWM) depois do pop
+//   motion    primeiro ciclo do encoder cuja velocidade medida se afastou
+//             da velocidade no instante do applied em pelo menos
+//             TRACE_MOTION_THRESHOLD_RAD_S (no eixo do motor)
+//
+// A rede carimba os dois primeiros e os leva no CommandRecord; a tarefa de
+// controle completa o resto e devolve o rastreio por um anel SPSC. O
+// carimbo motion tem a resolução do período de controle (amostra do
+// encoder); com o perfil de movimento ativo o applied só acontece no ciclo
+// seguinte ao pop, quando a rampa escreve o primeiro PWM.
+//
+// Um campo 0 significa que a etapa não aconteceu: substituído por um
+// comando mais novo antes do pop (0 a partir de dequeued) ou antes de mover
+// (motion 0), ou comando que não muda nada (motion 0 depois de
+// TRACE_MOTION_TIMEOUT_MS).
+
+#define TRACE_MOTION_THRESHOLD_RAD_S 20.0f   // ~2 bordas por janela de 50 ms
+#define TRACE_MOTION_TIMEOUT_MS 1000
+#define TRACE_RING_SIZE 16                   // potência de 2
+
+struct CommandTrace {
+  uint32_t id;
+  uint32_t received_us;
+  uint32_t parsed_us;
+  uint32_t dequeued_us;
+  uint32_t applied_us;
+  uint32_t motion_us;
+};
+
+// Tarefa de controle
+void command_trace_dequeued(const CommandStamp& stamp, uint32_t now_us);
+void command_trace_output(uint32_t now_us);   // ponte H escrita
+void command_trace_sample(float velR_motor, float velL_motor, uint32_t now_us);
+
+// Tarefa de rede: rastreios completos, em ordem
+bool command_trace_pop(CommandTrace& out);
+uint32_t command_trace_dropped();             // anel cheio (rede atrasada)
+
+#endif
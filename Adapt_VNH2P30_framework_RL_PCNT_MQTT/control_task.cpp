@@ -0,0 +1,165 @@
+#include "control_task.h"
+
+#include "async_log.h"
+#include "button_input.h"
+#include "hal.h"
+#include "loop_profiler.h"
+#include "mqtt_client.h"
+#include "safety_stop.h"
+#include "session_record.h"
+
+static MotionCommandSource g_command_source = nullptr;
+static uint32_t g_period_us = CONTROL_PERIOD_US;
+
+// Acumuladores da janela de estatísticas (escritos só pela tarefa de controle)
+static bool g_have_last_start = false;
+static uint32_t g_last_start_us = 0;
+static uint32_t g_cycles = 0;
+static uint32_t g_period_samples = 0;
+static uint64_t g_period_sum_us = 0;
+static uint64_t g_jitter_sum_us = 0;
+static uint32_t g_min_period_us = 0;
+static uint32_t g_max_period_us = 0;
+static uint32_t g_max_jitter_us = 0;
+static uint32_t g_max_exec_us = 0;
+static uint32_t g_overruns = 0;
+
+static void reset_window() {
+  g_cycles = 0;
+  g_period_samples = 0;
+  g_period_sum_us = 0;
+  g_jitter_sum_us = 0;
+  g_min_period_us = 0;
+  g_max_period_us = 0;
+  g_max_jitter_us = 0;
+  g_max_exec_us = 0;
+  g_overruns = 0;
+}
+
+bool control_task_begin(uint32_t period_us, MotionCommandSource source) {
+  g_period_us = period_us;
+  g_command_source = source;
+  reset_window();
+  loop_profiler_set_deadline(STAGE_CONTROL_CYCLE, period_us);
+
+  // Parada de segurança no mesmo core, armada antes do primeiro ciclo
+  if (!safety_stop_begin()) {
+    LOG_E(CTRL, "[CTRL] Falha ao armar a parada de segurança.");
+  }
+  bool started = hal_timer_task_start("control", period_us, CONTROL_TASK_CORE,
+                                      CONTROL_TASK_PRIORITY, CONTROL_TASK_STACK,
+                                      control_task_step);
+  if (started) {
+    LOG_I(CTRL, "[CTRL] Tarefa de controle no core %d, período %u us", CONTROL_TASK_CORE,
+          period_us);
+  } else {
+    LOG_E(CTRL, "[CTRL] Falha ao iniciar a tarefa de controle.");
+  }
+  return started;
+}
+
+void control_task_step() {
+  LOOP_PROFILE_BEGIN(STAGE_CONTROL_CYCLE);
+  uint32_t start = hal_micros();
+
+  const SafetyStopRelease release = safety_stop_feed();
+  if (release == SAFETY_RELEASE_TASK) {
+    // Sem a tarefa por mais que o prazo: o ISR parou as pontes por fora
+    motor_safety_release(true);
+    session_record_break();
+    LOG_W(CTRL, "[CTRL] Parada de segurança: controle voltou depois de %u us parado",
+          g_have_last_start ? start - g_last_start_us : 0);
+  } else if (release == SAFETY_RELEASE_REMOTE) {
+    // Rede parada além do prazo e de volta com um comando novo
+    motor_safety_release(false);
+    session_record_break();
+    LOG_W(CTRL, "[CTRL] Parada de segurança: comando remoto voltou depois do prazo da rede");
+  }
+
+  LOOP_PROFILE_BEGIN(STAGE_ENCODER);
+  encoder();
+  LOOP_PROFILE_END(STAGE_ENCODER);
+
+  MotionCommand command = g_command_source ? g_command_source() : MOTION_STOP;
+  LOOP_PROFILE_BEGIN(STAGE_APPLY_COMMAND);
+  apply_motion_command(command);
+  LOOP_PROFILE_END(STAGE_APPLY_COMMAND);
+  session_record_cycle_end();
+
+  uint32_t exec = hal_micros() - start;
+
+  hal_critical_enter();
+  if (g_have_last_start) {
+    uint32_t period = start - g_last_start_us;
+    uint32_t jitter = (period > g_period_us) ? period - g_period_us : g_period_us - period;
+    if (g_period_samples == 0 || period < g_min_period_us) g_min_period_us = period;
+    if (period > g_max_period_us) g_max_period_us = period;
+    if (jitter > g_max_jitter_us) g_max_jitter_us = jitter;
+    g_period_sum_us += period;
+    g_jitter_sum_us += jitter;
+    g_period_samples++;
+  }
+  g_have_last_start = true;
+  g_last_start_us = start;
+  g_cycles++;
+  if (exec > g_max_exec_us) g_max_exec_us = exec;
+  if (exec > g_period_us) g_overruns++;
+  hal_critical_exit();
+  LOOP_PROFILE_END(STAGE_CONTROL_CYCLE);
+}
+
+ControlTimingStats control_task_stats(bool reset) {
+  ControlTimingStats stats;
+  const SafetyStopStats safety = safety_stop_stats();
+  stats.safety_trips = safety.trips;
+  stats.safety_brakes = safety.brakes;
+  stats.safety_locks = safety.locks;
+  const ButtonInputStats buttons = button_input_stats();
+  stats.button_presses = buttons.presses;
+  stats.button_bounces = buttons.bounces;
+  stats.button_latency_max_us = buttons.latency_max_us;
+  hal_critical_enter();
+  stats.cycles = g_cycles;
+  stats.nominal_period_us = g_period_us;
+  stats.min_period_us = g_min_period_us;
+  stats.max_period_us = g_max_period_us;
+  stats.mean_period_us =
+      g_period_samples ? static_cast<uint32_t>(g_period_sum_us / g_period_samples) : 0;
+  stats.max_jitter_us = g_max_jitter_us;
+  stats.mean_jitter_us =
+      g_period_samples ? static_cast<uint32_t>(g_jitter_sum_us / g_period_samples) : 0;
+  stats.max_exec_us = g_max_exec_us;
+  stats.overruns = g_overruns;
+  if (reset) {
+    reset_window();
+  }
+  hal_critical_exit();
+  return stats;
+}
+
+void control_task_publish_stats() {
+  static unsigned long last_publish = 0;
+  static uint8_t publishes = 0;
+
+  unsigned long now = hal_millis();
+  if ((now - last_publish) < CONTROL_STATS_PERIOD_MS) {
+    return;
+  }
+  // Offline a janela continua acumulando e sai inteira na volta do broker
+  if (!hal_mqtt_connected()) {
+    return;
+  }
+  last_publish = now;
+
+  ControlTimingStats stats = control_task_stats(true);
+  net_publish_control_timing(stats);
+
+  // Na serial, só a cada 10 janelas para não poluir o log
+  if (++publishes >= 10) {
+    publishes = 0;
+    LOG_I(CTRL, "[CTRL] período médio=%u us | min=%u | max=%u", stats.mean_period_us,
+          stats.min_period_us, stats.max_period_us);
+    LOG_I(CTRL, "[CTRL] jitter máx=%u us | exec máx=%u us | overruns=%u", stats.max_jitter_us,
+          stats.max_exec_us, stats.overruns);
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef CONTROL_TASK_H
+#define CONTROL_TASK_H
+
+#include <Arduino.h>
+#include "motor_control.h"
+
+// Laço de controle em tempo real: encoder() + decisão de comando +
+// apply_motion_command(), disparado por timer de hardware em uma tarefa de
+// alta prioridade no core 1. A rede (Wi-Fi/MQTT/publicações) fica no core 0,
+// então um reconnect bloqueante não atrasa o controle.
+
+#define CONTROL_PERIOD_US       50000   // 20 Hz (mesma janela do encoder() original)
+#define CONTROL_TASK_CORE       1
+#define CONTROL_TASK_PRIORITY   20
+#define CONTROL_TASK_STACK      4096
+
+#define NET_TASK_CORE           0
+#define NET_TASK_PRIORITY       1
+#define NET_TASK_STACK          8192
+
+#define CONTROL_STATS_PERIOD_MS 1000    // publicação das estatísticas de período
+
+// Fonte do comando do ciclo (botões têm prioridade sobre o remoto).
+typedef MotionCommand (*MotionCommandSource)();
+
+// Estatísticas de temporização da janela atual (zeradas a cada publicação).
+struct ControlTimingStats {
+  uint32_t cycles;
+  uint32_t nominal_period_us;
+  uint32_t min_period_us;
+  uint32_t max_period_us;
+  uint32_t mean_period_us;
+  uint32_t max_jitter_us;   // max |período medido - nominal|
+  uint32_t mean_jitter_us;
+  uint32_t max_exec_us;     // duração do ciclo mais longo
+  uint32_t overruns;        // ciclos que duraram mais que o período
+  // Parada de segurança (safety_stop.h), acumulados desde o boot
+  uint32_t safety_trips;
+  uint32_t safety_brakes;
+  uint32_t safety_locks;
+  // Botões (button_input.h), acumulados desde o boot
+  uint32_t button_presses;
+  uint32_t button_bounces;
+  uint32_t button_latency_max_us;   // borda -> ciclo que usou o botão
+};
+
+bool control_task_begin(uint32_t period_us, MotionCommandSource source);
+// Um ciclo do laço; chamado pela tarefa de controle.
+void control_task_step();
+
+// Cópia consistente das estatísticas; reset=true inicia uma nova janela.
+ControlTimingStats control_task_stats(bool reset);
+
+// Contexto de rede: publica/imprime as estatísticas a cada CONTROL_STATS_PERIOD_MS.
+void control_task_publish_stats();
+
+#endif
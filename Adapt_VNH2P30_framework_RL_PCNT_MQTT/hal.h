@@ -0,0 +1,182 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Camada fina de abstração de hardware (HAL).
+//
+// motor_control.cpp e mqtt_client.cpp só falam com o hardware por aqui.
+// No ESP32 a implementação fica em hal_esp32.cpp (Arduino + driver PCNT +
+// WiFi/PubSubClient); no build nativo (host/) a implementação simulada fica
+// em host/sim/hal_sim.cpp.
+
+// --------- Relógio ---------
+uint32_t hal_millis();
+uint32_t hal_micros();
+void hal_delay_ms(uint32_t ms);
+uint32_t hal_random32();
+// Contador de ciclos do core atual, para medir trechos curtos (volta a zero
+// a cada ~18 s a 240 MHz); no host, nanossegundos de relógio real
+uint32_t hal_cycle_count();
+uint32_t hal_cycles_per_us();
+
+// --------- GPIO ---------
+enum HalPinMode {
+  HAL_PIN_INPUT = 0,
+  HAL_PIN_OUTPUT,
+};
+
+void hal_gpio_mode(uint8_t pin, HalPinMode mode);
+void hal_gpio_write(uint8_t pin, bool level);
+bool hal_gpio_read(uint8_t pin);
+
+// --------- PWM (LEDC) ---------
+void hal_pwm_setup(uint8_t channel, uint8_t pin, uint32_t freq_hz, uint8_t resolution_bits);
+void hal_pwm_write(uint8_t channel, uint32_t duty);
+
+// --------- Contador de pulsos (PCNT) ---------
+// Canal A conta as bordas, canal B inverte o sentido (quadratura x2).
+// O contador de 16 bits volta a zero em h_lim/l_lim; o evento de limite
+// soma o limite num acumulador de 64 bits (interrupção). Nada é zerado
+// depois do setup: quem lê guarda o total anterior e usa a diferença.
+void hal_pcnt_setup(uint8_t unit, int pulse_pin, int ctrl_pin,
+                    int16_t h_lim, int16_t l_lim);
+// Acumulador + contador. Se o contador já voltou a zero e a interrupção
+// ainda não rodou (evento pendente), a leitura soma o limite ela mesma.
+int64_t hal_pcnt_total(uint8_t unit);
+
+struct HalPcntStats {
+  uint32_t limit_events;  // voltas do contador tratadas pela interrupção
+  uint32_t late_events;   // leituras que corrigiram um evento pendente
+};
+HalPcntStats hal_pcnt_stats(uint8_t unit);
+
+// --------- Captura de bordas do encoder ---------
+// Conta as mesmas bordas do PCNT (as duas do canal A, sentido pelo canal B)
+// e guarda o instante da última, na base de hal_micros(). Os contadores não
+// são zerados: quem lê guarda a leitura anterior e usa as diferenças.
+struct HalEdgeCapture {
+  int32_t edges;          // acumulado com sinal
+  uint32_t last_edge_us;  // instante da borda mais recente
+};
+
+// `unit` é o mesmo índice da unidade PCNT da roda. false se indisponível.
+// A interrupção de borda fica na IRAM (ESP_INTR_FLAG_IRAM) e não perde bordas
+// enquanto a flash apaga um setor.
+bool hal_edge_capture_setup(uint8_t unit, int pin_a, int pin_b);
+// Leitura consistente (contagem e instante da mesma borda).
+HalEdgeCapture hal_edge_capture_read(uint8_t unit);
+
+// --------- Flash (partição de dados "odomlog") ---------
+// Partição própria (partitions.csv do sketch), lida pelo mapeamento na
+// memória sem cópia. Como numa NOR, escrever só leva bits de 1 para 0 e só
+// o apagamento de um setor inteiro volta os bytes a 0xFF. Escrever e apagar
+// bloqueiam e suspendem o cache da flash nos dois cores: só a tarefa de rede.
+#define HAL_FLASH_SECTOR_BYTES 4096
+
+// Encontra e mapeia a partição; false se ela não existir.
+bool hal_flash_begin();
+uint32_t hal_flash_size();                // múltiplo de HAL_FLASH_SECTOR_BYTES
+const uint8_t* hal_flash_data();          // partição inteira, só leitura
+bool hal_flash_erase_sector(uint32_t sector);
+bool hal_flash_write(uint32_t offset, const void* data, size_t length);
+
+// --------- Tarefas e seção crítica ---------
+typedef void (*HalTaskBody)();
+
+// Tarefa de alta prioridade fixa em `core`, acordada a cada period_us pelo
+// ISR de um timer de hardware; body() executa uma vez por disparo.
+bool hal_timer_task_start(const char* name, uint32_t period_us, uint8_t core,
+                          uint8_t priority, uint32_t stack_bytes, HalTaskBody body);
+// Tarefa fixa em `core` que executa body() continuamente (cede 1 tick entre
+// chamadas).
+bool hal_loop_task_start(const char* name, uint8_t core, uint8_t priority,
+                         uint32_t stack_bytes, HalTaskBody body);
+// Encerra a tarefa chamadora (usado pelo loop() do Arduino).
+void hal_task_end_self();
+
+// Timer de hardware próprio que chama isr() a cada period_us em contexto de
+// interrupção, independente das tarefas (continua disparando com qualquer uma
+// delas travada). A interrupção é alocada com ESP_INTR_FLAG_IRAM, então
+// também dispara durante apagamento e gravação da flash, quando o cache está
+// desligado: isr() e tudo o que ela chama ficam na IRAM (HAL_ISR_ATTR), só
+// tocam variáveis na DRAM (nada de const em tabela, que vai para a flash) e
+// só usam as funções hal_isr_* abaixo. Um por firmware.
+typedef void (*HalIsrBody)();
+bool hal_timer_isr_start(uint32_t period_us, HalIsrBody isr);
+
+// Acesso direto aos registradores, seguro dentro do ISR (sem os locks do
+// driver); mesma base de tempo de hal_micros()
+uint32_t hal_isr_micros();
+void hal_isr_gpio_write(uint8_t pin, bool level);
+uint32_t hal_isr_pwm_duty(uint8_t channel);
+void hal_isr_pwm_write(uint8_t channel, uint32_t duty);
+// Palavra de entrada de um banco de GPIO numa leitura só (banco 0: pinos
+// 0..31, banco 1: 32..39 no bit pino - 32)
+uint32_t hal_isr_gpio_read_bank(uint8_t bank);
+
+// Interrupção de GPIO nas duas bordas do pino, atendida no core que chama.
+// Mesmas regras de isr() acima (também alocada na IRAM); vários pinos podem
+// dividir o mesmo isr.
+bool hal_gpio_isr_attach(uint8_t pin, HalIsrBody isr);
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <esp_attr.h>
+#define HAL_ISR_ATTR IRAM_ATTR
+#else
+#define HAL_ISR_ATTR
+#endif
+
+// Seção crítica curta entre tarefas/cores; não chamar nada bloqueante dentro.
+void hal_critical_enter();
+void hal_critical_exit();
+
+// --------- Transporte Wi-Fi/MQTT ---------
+// Nenhuma destas funções bloqueia: a conexão é iniciada e acompanhada por
+// polling (ver net_connection.h).
+typedef void (*HalMqttCallback)(char* topic, uint8_t* payload, unsigned int length);
+
+// Códigos de WiFi.status() (WL_*), repetidos para o código portátil.
+enum HalWifiStatus {
+  HAL_WIFI_IDLE = 0,
+  HAL_WIFI_NO_SSID_AVAIL = 1,
+  HAL_WIFI_CONNECTED = 3,
+  HAL_WIFI_CONNECT_FAILED = 4,
+  HAL_WIFI_CONNECTION_LOST = 5,
+  HAL_WIFI_DISCONNECTED = 6,
+};
+
+void hal_wifi_begin(const char* ssid, const char* password);
+void hal_wifi_disconnect();
+bool hal_wifi_connected();
+int hal_wifi_status();
+const char* hal_wifi_local_ip();
+// MAC de fábrica (eFuse), o mesmo antes e depois do Wi-Fi subir
+void hal_mac_address(uint8_t mac[6]);
+
+enum HalConnectStatus {
+  HAL_CONNECT_IDLE = 0,
+  HAL_CONNECT_PENDING,
+  HAL_CONNECT_OK,
+  HAL_CONNECT_FAILED,
+};
+
+// Configura servidor, TLS (inseguro ou com Root CA) e callback de mensagens.
+void hal_mqtt_setup(const char* host, int port,
+                    bool insecureTLS, const char* root_ca_pem,
+                    HalMqttCallback callback);
+// Inicia uma tentativa de conexão (TCP + TLS + CONNECT). No ESP32 ela roda em
+// uma tarefa auxiliar no core 0; as strings precisam viver até o resultado.
+bool hal_mqtt_connect_start(const char* client_id, const char* username, const char* password);
+// PENDING enquanto a tentativa corre; OK/FAILED são entregues uma única vez.
+HalConnectStatus hal_mqtt_connect_poll();
+void hal_mqtt_disconnect();
+bool hal_mqtt_connected();
+// Códigos do PubSubClient: 0 conectado, <0 erro de transporte, >0 CONNACK.
+int hal_mqtt_state();
+bool hal_mqtt_subscribe(const char* topic);
+bool hal_mqtt_publish(const char* topic, const uint8_t* payload, size_t length);
+void hal_mqtt_loop();
+
+#endif
@@ -0,0 +1,638 @@
+#include "hal.h"
+
+#include <atomic>
+
+#include <Arduino.h>
+#include "async_log.h"
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <PubSubClient.h>
+#include "driver/gpio.h"
+#include "driver/pcnt.h"
+#include "esp_intr_alloc.h"
+#include "esp_timer.h"
+#include "esp_partition.h"
+#include "esp_idf_version.h"
+#if ESP_IDF_VERSION_MAJOR >= 5
+#include "esp_mac.h"
+#else
+#include "esp_system.h"
+#endif
+#include "soc/gpio_struct.h"
+#include "soc/ledc_struct.h"
+#include "soc/pcnt_struct.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// =======================
+// Objetos globais do transporte
+// =======================
+static WiFiClientSecure g_secure_client;
+static PubSubClient     g_mqtt_client(g_secure_client);
+
+static portMUX_TYPE     g_critical_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Timer de hardware 0 com prescaler 80 -> 1 tick = 1 us (APB a 80 MHz)
+static const uint8_t    TIMER_TASK_HW_TIMER = 0;
+static const uint16_t   TIMER_TASK_PRESCALER = 80;
+static hw_timer_t*      g_task_timer = nullptr;
+static TaskHandle_t     g_timer_task_handle = nullptr;
+static HalTaskBody      g_timer_task_body = nullptr;
+
+// Timer de hardware 1 para hal_timer_isr_start (parada de segurança)
+static const uint8_t    TIMER_ISR_HW_TIMER = 1;
+static hw_timer_t*      g_isr_timer = nullptr;
+
+// Tarefa auxiliar que executa o connect() bloqueante do PubSubClient
+static const uint32_t   CONNECT_TASK_STACK = 8192;
+static TaskHandle_t     g_connect_task_handle = nullptr;
+static std::atomic<uint8_t> g_connect_status(HAL_CONNECT_IDLE);
+static char             g_connect_client_id[48];
+static const char*      g_connect_user = nullptr;
+static const char*      g_connect_pass = nullptr;
+
+namespace {
+template <typename Client>
+auto try_set_insecure(Client& client, int)
+    -> decltype(client.setInsecure(), bool()) {
+  client.setInsecure();
+  return true;
+}
+
+template <typename Client>
+bool try_set_insecure(Client& client, ...) {
+  client.setCACert(nullptr);
+  return false;
+}
+}  // namespace
+
+static bool enable_insecure_tls(WiFiClientSecure& client) {
+  return try_set_insecure(client, 0);
+}
+
+static void log_insecure_choice(bool used_set_insecure) {
+  if (used_set_insecure) {
+    LOG_W(HAL, "[TLS] setInsecure() habilitado (teste).");
+  } else {
+    LOG_W(HAL, "[TLS] setCACert(nullptr) aplicado (setInsecure indisponível nesta versão do core).");
+  }
+}
+
+// =======================
+// Relógio
+// =======================
+uint32_t hal_millis() {
+  return millis();
+}
+
+uint32_t hal_micros() {
+  return micros();
+}
+
+uint32_t hal_cycle_count() {
+  return ESP.getCycleCount();
+}
+
+uint32_t hal_cycles_per_us() {
+  return getCpuFrequencyMhz();
+}
+
+void hal_delay_ms(uint32_t ms) {
+  delay(ms);
+}
+
+uint32_t hal_random32() {
+  return esp_random();
+}
+
+// =======================
+// GPIO
+// =======================
+void hal_gpio_mode(uint8_t pin, HalPinMode mode) {
+  pinMode(pin, mode == HAL_PIN_OUTPUT ? OUTPUT : INPUT);
+}
+
+void hal_gpio_write(uint8_t pin, bool level) {
+  digitalWrite(pin, level ? HIGH : LOW);
+}
+
+bool hal_gpio_read(uint8_t pin) {
+  return digitalRead(pin) != LOW;
+}
+
+// =======================
+// PWM (LEDC)
+// =======================
+void hal_pwm_setup(uint8_t channel, uint8_t pin, uint32_t freq_hz, uint8_t resolution_bits) {
+  ledcSetup(channel, freq_hz, resolution_bits);
+  ledcAttachPin(pin, channel);
+}
+
+void hal_pwm_write(uint8_t channel, uint32_t duty) {
+  ledcWrite(channel, duty);
+}
+
+// =======================
+// PCNT
+// =======================
+static const uint8_t PCNT_UNITS = 8;
+
+struct PcntTotal {
+  int64_t accum;       // voltas do contador de 16 bits (interrupção)
+  int16_t h_lim;
+  int16_t l_lim;
+  uint32_t limit_events;
+  uint32_t late_events;
+};
+
+static PcntTotal    g_pcnt_total[PCNT_UNITS];
+static portMUX_TYPE g_pcnt_mux = portMUX_INITIALIZER_UNLOCKED;
+static bool         g_pcnt_isr_installed = false;
+
+static void IRAM_ATTR on_pcnt_limit(void* arg) {
+  const uint8_t unit = static_cast<uint8_t>(reinterpret_cast<uintptr_t>(arg));
+  uint32_t status = 0;
+  pcnt_get_event_status(static_cast<pcnt_unit_t>(unit), &status);
+  PcntTotal& t = g_pcnt_total[unit];
+  portENTER_CRITICAL_ISR(&g_pcnt_mux);
+  if (status & PCNT_EVT_H_LIM) {
+    t.accum += t.h_lim;
+    t.limit_events++;
+  }
+  if (status & PCNT_EVT_L_LIM) {
+    t.accum += t.l_lim;
+    t.limit_events++;
+  }
+  portEXIT_CRITICAL_ISR(&g_pcnt_mux);
+}
+
+void hal_pcnt_setup(uint8_t unit, int pulse_pin, int ctrl_pin,
+                    int16_t h_lim, int16_t l_lim) {
+  if (unit >= PCNT_UNITS) {
+    return;
+  }
+  pcnt_config_t config;
+  config.pulse_gpio_num = pulse_pin;
+  config.ctrl_gpio_num = ctrl_pin;
+  config.channel = PCNT_CHANNEL_0;
+  config.unit = static_cast<pcnt_unit_t>(unit);
+  config.pos_mode = PCNT_COUNT_INC;
+  config.neg_mode = PCNT_COUNT_DEC;
+  config.lctrl_mode = PCNT_MODE_REVERSE;
+  config.hctrl_mode = PCNT_MODE_KEEP;
+  config.counter_h_lim = h_lim;
+  config.counter_l_lim = l_lim;
+  pcnt_unit_config(&config);
+  pcnt_counter_pause(config.unit);
+  pcnt_counter_clear(config.unit);
+
+  PcntTotal& t = g_pcnt_total[unit];
+  portENTER_CRITICAL(&g_pcnt_mux);
+  t.accum = 0;
+  t.h_lim = h_lim;
+  t.l_lim = l_lim;
+  t.limit_events = 0;
+  t.late_events = 0;
+  portEXIT_CRITICAL(&g_pcnt_mux);
+
+  pcnt_event_enable(config.unit, PCNT_EVT_H_LIM);
+  pcnt_event_enable(config.unit, PCNT_EVT_L_LIM);
+  if (!g_pcnt_isr_installed) {
+    g_pcnt_isr_installed = pcnt_isr_service_install(0) == ESP_OK;
+  }
+  pcnt_isr_handler_add(config.unit, on_pcnt_limit,
+                       reinterpret_cast<void*>(static_cast<uintptr_t>(unit)));
+  pcnt_counter_resume(config.unit);
+}
+
+int64_t hal_pcnt_total(uint8_t unit) {
+  if (unit >= PCNT_UNITS) {
+    return 0;
+  }
+  PcntTotal& t = g_pcnt_total[unit];
+  const pcnt_unit_t id = static_cast<pcnt_unit_t>(unit);
+  const uint32_t mask = 1u << unit;
+  int16_t count = 0;
+  uint32_t pending = 0;
+  portENTER_CRITICAL(&g_pcnt_mux);
+  // Interrupção pendente lida antes e depois do contador: se mudou no meio,
+  // o contador pode ser de antes ou depois da volta; lê de novo
+  do {
+    pending = PCNT.int_st.val & mask;
+    pcnt_get_counter_value(id, &count);
+  } while ((PCNT.int_st.val & mask) != pending);
+  int64_t total = t.accum + count;
+  if (pending) {
+    // Contador já voltou a zero, interrupção (outro núcleo ou mascarada
+    // aqui) ainda não somou o limite
+    uint32_t status = 0;
+    pcnt_get_event_status(id, &status);
+    if (status & PCNT_EVT_H_LIM) total += t.h_lim;
+    if (status & PCNT_EVT_L_LIM) total += t.l_lim;
+    t.late_events++;
+  }
+  portEXIT_CRITICAL(&g_pcnt_mux);
+  return total;
+}
+
+HalPcntStats hal_pcnt_stats(uint8_t unit) {
+  HalPcntStats out = {0, 0};
+  if (unit >= PCNT_UNITS) {
+    return out;
+  }
+  portENTER_CRITICAL(&g_pcnt_mux);
+  out.limit_events = g_pcnt_total[unit].limit_events;
+  out.late_events = g_pcnt_total[unit].late_events;
+  portEXIT_CRITICAL(&g_pcnt_mux);
+  return out;
+}
+
+// =======================
+// Captura de bordas do encoder
+// =======================
+// Interrupção de GPIO nas duas bordas do canal A; o instante vem do
+// esp_timer (mesma base de micros()). A latência da interrupção (alguns µs)
+// é pequena perto do intervalo entre bordas (> 1 ms na velocidade máxima).
+static const uint8_t    EDGE_CAPTURE_UNITS = 8;
+
+struct EdgeCaptureState {
+  int32_t edges;
+  uint32_t last_edge_us;
+  uint8_t pin_a;
+  uint8_t pin_b;
+};
+
+static EdgeCaptureState g_edge_capture[EDGE_CAPTURE_UNITS];
+static portMUX_TYPE     g_edge_capture_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// Serviço de interrupção de GPIO com ESP_INTR_FLAG_IRAM, instalado antes do
+// primeiro attachInterrupt (que aceita o serviço já instalado): as bordas do
+// encoder e dos botões continuam chegando durante o apagamento de um setor
+// da flash. Como no Arduino, a interrupção fica no core que chama.
+static void gpio_isr_service_iram() {
+  static bool installed = false;
+  if (!installed) {
+    const esp_err_t err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    installed = err == ESP_OK || err == ESP_ERR_INVALID_STATE;
+  }
+}
+
+// digitalRead() não fica em IRAM: lê o registrador direto
+static inline bool IRAM_ATTR gpio_level_isr(uint8_t pin) {
+  return pin < 32 ? ((GPIO.in >> pin) & 1) : ((GPIO.in1.data >> (pin - 32)) & 1);
+}
+
+static void IRAM_ATTR on_encoder_edge(void* arg) {
+  EdgeCaptureState* state = static_cast<EdgeCaptureState*>(arg);
+  uint32_t now = static_cast<uint32_t>(esp_timer_get_time());
+  // Mesma convenção do PCNT: A igual a B depois da borda conta para frente
+  bool forward = gpio_level_isr(state->pin_a) == gpio_level_isr(state->pin_b);
+  portENTER_CRITICAL_ISR(&g_edge_capture_mux);
+  state->edges += forward ? 1 : -1;
+  state->last_edge_us = now;
+  portEXIT_CRITICAL_ISR(&g_edge_capture_mux);
+}
+
+bool hal_edge_capture_setup(uint8_t unit, int pin_a, int pin_b) {
+  if (unit >= EDGE_CAPTURE_UNITS) {
+    return false;
+  }
+  EdgeCaptureState& state = g_edge_capture[unit];
+  state.edges = 0;
+  state.last_edge_us = micros();
+  state.pin_a = pin_a;
+  state.pin_b = pin_b;
+  gpio_isr_service_iram();
+  attachInterruptArg(pin_a, on_encoder_edge, &state, CHANGE);
+  return true;
+}
+
+HalEdgeCapture hal_edge_capture_read(uint8_t unit) {
+  HalEdgeCapture out = {0, 0};
+  if (unit >= EDGE_CAPTURE_UNITS) {
+    return out;
+  }
+  portENTER_CRITICAL(&g_edge_capture_mux);
+  out.edges = g_edge_capture[unit].edges;
+  out.last_edge_us = g_edge_capture[unit].last_edge_us;
+  portEXIT_CRITICAL(&g_edge_capture_mux);
+  return out;
+}
+
+// =======================
+// Tarefas
+// =======================
+static void IRAM_ATTR on_task_timer() {
+  BaseType_t higher_woken = pdFALSE;
+  vTaskNotifyGiveFromISR(g_timer_task_handle, &higher_woken);
+  if (higher_woken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+static void timer_task_main(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    g_timer_task_body();
+  }
+}
+
+static void loop_task_main(void* arg) {
+  HalTaskBody body = reinterpret_cast<HalTaskBody>(arg);
+  for (;;) {
+    body();
+    vTaskDelay(1);
+  }
+}
+
+bool hal_timer_task_start(const char* name, uint32_t period_us, uint8_t core,
+                          uint8_t priority, uint32_t stack_bytes, HalTaskBody body) {
+  if (g_timer_task_handle || !body || period_us == 0) {
+    return false;
+  }
+
+  g_timer_task_body = body;
+  if (xTaskCreatePinnedToCore(timer_task_main, name, stack_bytes, nullptr, priority,
+                              &g_timer_task_handle, core) != pdPASS) {
+    g_timer_task_handle = nullptr;
+    return false;
+  }
+
+  g_task_timer = timerBegin(TIMER_TASK_HW_TIMER, TIMER_TASK_PRESCALER, true);
+  timerAttachInterrupt(g_task_timer, &on_task_timer, true);
+  timerAlarmWrite(g_task_timer, period_us, true);
+  timerAlarmEnable(g_task_timer);
+  return true;
+}
+
+bool hal_timer_isr_start(uint32_t period_us, HalIsrBody isr) {
+  if (g_isr_timer || !isr || period_us == 0) {
+    return false;
+  }
+  g_isr_timer = timerBegin(TIMER_ISR_HW_TIMER, TIMER_TASK_PRESCALER, true);
+  // ESP_INTR_FLAG_IRAM: sem ele a interrupção fica mascarada nos dois cores
+  // enquanto a flash apaga ou grava (dezenas de ms por setor), justamente
+  // com o robô andando e o broker fora (odometry_store)
+  timerAttachInterruptFlag(g_isr_timer, isr, true, ESP_INTR_FLAG_IRAM);
+  timerAlarmWrite(g_isr_timer, period_us, true);
+  timerAlarmEnable(g_isr_timer);
+  return true;
+}
+
+uint32_t IRAM_ATTR hal_isr_micros() {
+  return static_cast<uint32_t>(esp_timer_get_time());
+}
+
+void IRAM_ATTR hal_isr_gpio_write(uint8_t pin, bool level) {
+  if (pin < 32) {
+    if (level) {
+      GPIO.out_w1ts = 1u << pin;
+    } else {
+      GPIO.out_w1tc = 1u << pin;
+    }
+  } else if (level) {
+    GPIO.out1_w1ts.val = 1u << (pin - 32);
+  } else {
+    GPIO.out1_w1tc.val = 1u << (pin - 32);
+  }
+}
+
+// ledcSetup() põe os canais 0..7 no grupo de alta velocidade (0) e 8..15 no
+// de baixa (1); o duty fica nos 4 bits fracionários de cima do registrador
+uint32_t IRAM_ATTR hal_isr_pwm_duty(uint8_t channel) {
+  return LEDC.channel_group[channel / 8].channel[channel % 8].duty_rd.duty_read >> 4;
+}
+
+void IRAM_ATTR hal_isr_pwm_write(uint8_t channel, uint32_t duty) {
+  const uint8_t group = channel / 8;
+  const uint8_t ch = channel % 8;
+  LEDC.channel_group[group].channel[ch].duty.duty = duty << 4;
+  LEDC.channel_group[group].channel[ch].conf0.sig_out_en = 1;
+  LEDC.channel_group[group].channel[ch].conf1.duty_start = 1;
+  if (group == 1) {
+    LEDC.channel_group[group].channel[ch].conf0.low_speed_update = 1;
+  }
+}
+
+uint32_t IRAM_ATTR hal_isr_gpio_read_bank(uint8_t bank) {
+  return bank == 0 ? GPIO.in : GPIO.in1.data;
+}
+
+bool hal_gpio_isr_attach(uint8_t pin, HalIsrBody isr) {
+  if (!isr || !digitalPinIsValid(pin)) {
+    return false;
+  }
+  // O serviço de GPIO aloca a interrupção no core que chama
+  gpio_isr_service_iram();
+  attachInterrupt(pin, isr, CHANGE);
+  return true;
+}
+
+bool hal_loop_task_start(const char* name, uint8_t core, uint8_t priority,
+                         uint32_t stack_bytes, HalTaskBody body) {
+  if (!body) {
+    return false;
+  }
+  return xTaskCreatePinnedToCore(loop_task_main, name, stack_bytes,
+                                 reinterpret_cast<void*>(body), priority, nullptr,
+                                 core) == pdPASS;
+}
+
+void hal_task_end_self() {
+  vTaskDelete(nullptr);
+}
+
+void hal_critical_enter() {
+  portENTER_CRITICAL(&g_critical_mux);
+}
+
+void hal_critical_exit() {
+  portEXIT_CRITICAL(&g_critical_mux);
+}
+
+// =======================
+// Flash (partição odomlog)
+// =======================
+// Subtipo de dados livre (0x40-0xFE são do usuário); ver partitions.csv
+static const char*             FLASH_PARTITION_LABEL = "odomlog";
+static const uint8_t           FLASH_PARTITION_SUBTYPE = 0x40;
+static const esp_partition_t*  g_flash_partition = nullptr;
+static const uint8_t*          g_flash_map = nullptr;
+
+bool hal_flash_begin() {
+  if (g_flash_map) {
+    return true;
+  }
+  g_flash_partition = esp_partition_find_first(
+      ESP_PARTITION_TYPE_DATA, static_cast<esp_partition_subtype_t>(FLASH_PARTITION_SUBTYPE),
+      FLASH_PARTITION_LABEL);
+  if (!g_flash_partition) {
+    LOG_W(HAL, "[HAL] Partição %s não encontrada (partitions.csv).", FLASH_PARTITION_LABEL);
+    return false;
+  }
+  const void* ptr = nullptr;
+  // O handle não é liberado: o mapeamento vive até o reset
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_partition_mmap_handle_t handle;
+  esp_err_t err = esp_partition_mmap(g_flash_partition, 0, g_flash_partition->size,
+                                     ESP_PARTITION_MMAP_DATA, &ptr, &handle);
+#else
+  spi_flash_mmap_handle_t handle;
+  esp_err_t err = esp_partition_mmap(g_flash_partition, 0, g_flash_partition->size,
+                                     SPI_FLASH_MMAP_DATA, &ptr, &handle);
+#endif
+  if (err != ESP_OK) {
+    LOG_E(HAL, "[HAL] esp_partition_mmap falhou (%d).", static_cast<int>(err));
+    g_flash_partition = nullptr;
+    return false;
+  }
+  g_flash_map = static_cast<const uint8_t*>(ptr);
+  return true;
+}
+
+uint32_t hal_flash_size() {
+  return g_flash_partition ? g_flash_partition->size : 0;
+}
+
+const uint8_t* hal_flash_data() {
+  return g_flash_map;
+}
+
+// O IDF invalida o cache do mapeamento nas regiões apagadas/escritas
+bool hal_flash_erase_sector(uint32_t sector) {
+  if (!g_flash_partition) return false;
+  return esp_partition_erase_range(g_flash_partition, sector * HAL_FLASH_SECTOR_BYTES,
+                                   HAL_FLASH_SECTOR_BYTES) == ESP_OK;
+}
+
+bool hal_flash_write(uint32_t offset, const void* data, size_t length) {
+  if (!g_flash_partition) return false;
+  return esp_partition_write(g_flash_partition, offset, data, length) == ESP_OK;
+}
+
+// =======================
+// Wi-Fi + MQTT (TLS)
+// =======================
+static bool connect_in_progress() {
+  return g_connect_status.load() == HAL_CONNECT_PENDING;
+}
+
+static void connect_task_main(void*) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    bool ok = g_mqtt_client.connect(g_connect_client_id, g_connect_user, g_connect_pass);
+    g_connect_status.store(ok ? HAL_CONNECT_OK : HAL_CONNECT_FAILED);
+  }
+}
+
+void hal_wifi_begin(const char* ssid, const char* password) {
+  WiFi.mode(WIFI_STA);
+  WiFi.begin(ssid, password);
+}
+
+void hal_wifi_disconnect() {
+  WiFi.disconnect();
+}
+
+bool hal_wifi_connected() {
+  return WiFi.status() == WL_CONNECTED;
+}
+
+int hal_wifi_status() {
+  return static_cast<int>(WiFi.status());
+}
+
+const char* hal_wifi_local_ip() {
+  static char buf[16];
+  IPAddress ip = WiFi.localIP();
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  return buf;
+}
+
+void hal_mac_address(uint8_t mac[6]) {
+  esp_efuse_mac_get_default(mac);
+}
+
+void hal_mqtt_setup(const char* host, int port,
+                    bool insecureTLS, const char* root_ca_pem,
+                    HalMqttCallback callback) {
+  // TLS: inseguro para testes OU valida root CA
+  if (insecureTLS) {
+    log_insecure_choice(enable_insecure_tls(g_secure_client));
+  } else if (root_ca_pem && *root_ca_pem) {
+    g_secure_client.setCACert(root_ca_pem);
+    LOG_I(HAL, "[TLS] Root CA configurado (validação ativa).");
+  } else {
+    LOG_W(HAL, "[TLS] Aviso: validação pedida sem Root CA — caindo para modo sem validação.");
+    log_insecure_choice(enable_insecure_tls(g_secure_client));
+  }
+
+  g_mqtt_client.setServer(host, port);
+  g_mqtt_client.setCallback(callback);
+
+  // (Opcional) ajuste de performance
+  // g_mqtt_client.setKeepAlive(30);
+  // Telemetria em lote, estatísticas de rede e perfil passam dos 256 bytes
+  // do padrão
+  g_mqtt_client.setBufferSize(2048);
+}
+
+bool hal_mqtt_connect_start(const char* client_id, const char* username, const char* password) {
+  if (connect_in_progress()) {
+    return false;
+  }
+  if (!g_connect_task_handle &&
+      xTaskCreatePinnedToCore(connect_task_main, "mqtt_connect", CONNECT_TASK_STACK, nullptr,
+                              1, &g_connect_task_handle, 0) != pdPASS) {
+    g_connect_task_handle = nullptr;
+    return false;
+  }
+
+  strncpy(g_connect_client_id, client_id, sizeof(g_connect_client_id) - 1);
+  g_connect_client_id[sizeof(g_connect_client_id) - 1] = '\0';
+  g_connect_user = username;
+  g_connect_pass = password;
+  g_connect_status.store(HAL_CONNECT_PENDING);
+  xTaskNotifyGive(g_connect_task_handle);
+  return true;
+}
+
+HalConnectStatus hal_mqtt_connect_poll() {
+  uint8_t status = g_connect_status.load();
+  if (status == HAL_CONNECT_OK || status == HAL_CONNECT_FAILED) {
+    g_connect_status.store(HAL_CONNECT_IDLE);
+  }
+  return static_cast<HalConnectStatus>(status);
+}
+
+void hal_mqtt_disconnect() {
+  if (!connect_in_progress()) {
+    g_mqtt_client.disconnect();
+  }
+}
+
+// Enquanto a tarefa auxiliar está no connect(), o cliente não é tocado aqui.
+bool hal_mqtt_connected() {
+  return !connect_in_progress() && g_mqtt_client.connected();
+}
+
+int hal_mqtt_state() {
+  return connect_in_progress() ? MQTT_DISCONNECTED : g_mqtt_client.state();
+}
+
+bool hal_mqtt_subscribe(const char* topic) {
+  return !connect_in_progress() && g_mqtt_client.subscribe(topic);
+}
+
+bool hal_mqtt_publish(const char* topic, const uint8_t* payload, size_t length) {
+  if (connect_in_progress()) {
+    return false;
+  }
+  return g_mqtt_client.publish(topic, payload, static_cast<unsigned int>(length));
+}
+
+void hal_mqtt_loop() {
+  if (!connect_in_progress()) {
+    g_mqtt_client.loop();
+  }
+}
@@ -0,0 +1,24 @@
+#include "Arduino.h"
+
+HostSerial Serial;
+
+bool HostSerial::enabled() const {
+  if (enabled_ < 0) {
+    const char* env = getenv("SIM_SERIAL");
+    enabled_ = (env && *env && *env != '0') ? 1 : 0;
+  }
+  return enabled_ != 0;
+}
+
+void HostSerial::write(const char* s) {
+  if (enabled() && s) {
+    fputs(s, stdout);
+  }
+}
+
+size_t HostSerial::write(const uint8_t* buf, size_t size) {
+  if (enabled() && buf) {
+    fwrite(buf, 1, size, stdout);
+  }
+  return size;
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+// Subconjunto mínimo da API Arduino usado pelo firmware, para o build
+// nativo (Linux). Tudo que toca hardware passa por hal.h; aqui só ficam
+// String, Serial e utilidades de linguagem.
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "hal.h"
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+
+#define HEX 16
+#define DEC 10
+
+#define LOW    0
+#define HIGH   1
+#define INPUT  0
+#define OUTPUT 1
+
+#define F(s) (s)
+typedef char __FlashStringHelper;
+
+inline unsigned long millis() { return hal_millis(); }
+inline unsigned long micros() { return hal_micros(); }
+inline void delay(unsigned long ms) { hal_delay_ms(ms); }
+
+inline void pinMode(uint8_t pin, uint8_t mode) {
+  hal_gpio_mode(pin, mode == OUTPUT ? HAL_PIN_OUTPUT : HAL_PIN_INPUT);
+}
+inline int digitalRead(uint8_t pin) { return hal_gpio_read(pin) ? HIGH : LOW; }
+inline void digitalWrite(uint8_t pin, uint8_t level) { hal_gpio_write(pin, level != LOW); }
+
+class String {
+ public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  String(char c) : s_(1, c) {}
+  String(int v, unsigned char base = DEC) { from_integer(static_cast<long>(v), base); }
+  String(unsigned int v, unsigned char base = DEC) { from_unsigned(v, base); }
+  String(long v, unsigned char base = DEC) { from_integer(v, base); }
+  String(unsigned long v, unsigned char base = DEC) { from_unsigned(v, base); }
+  String(float v, unsigned int decimals = 2) { from_double(v, decimals); }
+  String(double v, unsigned int decimals = 2) { from_double(v, decimals); }
+
+  void reserve(size_t n) { s_.reserve(n); }
+  unsigned int length() const { return static_cast<unsigned int>(s_.size()); }
+  const char* c_str() const { return s_.c_str(); }
+  char charAt(unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+
+  int indexOf(char c, unsigned int from = 0) const {
+    size_t pos = s_.find(c, from);
+    return pos == std::string::npos ? -1 : static_cast<int>(pos);
+  }
+
+  String substring(unsigned int from) const {
+    return from >= s_.size() ? String() : String(s_.substr(from));
+  }
+
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+      unsigned int tmp = from;
+      from = to;
+      to = tmp;
+    }
+    if (from >= s_.size()) return String();
+    if (to > s_.size()) to = static_cast<unsigned int>(s_.size());
+    return String(s_.substr(from, to - from));
+  }
+
+  void trim() {
+    size_t begin = 0;
+    size_t end = s_.size();
+    while (begin < end && isspace_c(s_[begin])) ++begin;
+    while (end > begin && isspace_c(s_[end - 1])) --end;
+    s_ = s_.substr(begin, end - begin);
+  }
+
+  void toLowerCase() {
+    for (size_t i = 0; i < s_.size(); ++i) {
+      if (s_[i] >= 'A' && s_[i] <= 'Z') s_[i] = static_cast<char>(s_[i] - 'A' + 'a');
+    }
+  }
+
+  float toFloat() const { return static_cast<float>(atof(s_.c_str())); }
+  long toInt() const { return atol(s_.c_str()); }
+
+  String& operator+=(const String& o) { s_ += o.s_; return *this; }
+  String& operator+=(const char* o) { s_ += (o ? o : ""); return *this; }
+  String& operator+=(char c) { s_ += c; return *this; }
+  String& operator+=(int v) { return *this += String(v); }
+  String& operator+=(unsigned int v) { return *this += String(v); }
+  String& operator+=(long v) { return *this += String(v); }
+  String& operator+=(unsigned long v) { return *this += String(v); }
+
+  friend String operator+(String a, const String& b) { a += b; return a; }
+  friend String operator+(String a, const char* b) { a += b; return a; }
+
+  bool operator==(const String& o) const { return s_ == o.s_; }
+  bool operator==(const char* o) const { return s_ == (o ? o : ""); }
+  bool operator!=(const String& o) const { return !(*this == o); }
+  bool operator!=(const char* o) const { return !(*this == o); }
+
+ private:
+  static bool isspace_c(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+  }
+
+  void from_unsigned(unsigned long v, unsigned char base) {
+    char buf[33];
+    snprintf(buf, sizeof(buf), base == HEX ? "%lx" : "%lu", v);
+    s_ = buf;
+  }
+
+  void from_integer(long v, unsigned char base) {
+    if (base == HEX) {
+      from_unsigned(static_cast<unsigned long>(v), base);
+      return;
+    }
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%ld", v);
+    s_ = buf;
+  }
+
+  void from_double(double v, unsigned int decimals) {
+    if (isnan(v)) { s_ = "nan"; return; }
+    if (isinf(v)) { s_ = "inf"; return; }
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", static_cast<int>(decimals), v);
+    s_ = buf;
+  }
+
+  std::string s_;
+};
+
+// Serial: por padrão descarta a saída (o loop nativo roda milhares de
+// iterações por segundo); SIM_SERIAL=1 no ambiente redireciona para stdout.
+class HostSerial {
+ public:
+  void begin(unsigned long) {}
+  void setEnabled(bool enabled) { enabled_ = enabled; }
+  bool enabled() const;
+
+  void print(const String& s) { write(s.c_str()); }
+  void print(const char* s) { write(s); }
+  void print(char c) { char b[2] = {c, 0}; write(b); }
+  void print(int v) { print(String(v)); }
+  void print(unsigned int v) { print(String(v)); }
+  void print(long v) { print(String(v)); }
+  void print(unsigned long v) { print(String(v)); }
+  void print(double v, int decimals = 2) { print(String(v, decimals)); }
+
+  template <typename T>
+  void println(const T& v) { print(v); write("\n"); }
+  void println(double v, int decimals) { print(v, decimals); write("\n"); }
+  void println() { write("\n"); }
+
+  size_t write(const uint8_t* buf, size_t size);
+
+ private:
+  void write(const char* s);
+  mutable int enabled_ = -1;
+};
+
+extern HostSerial Serial;
@@ -0,0 +1,338 @@
+#include "mqtt_wire.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+
+namespace {
+
+const uint8_t kConnect = 0x10;
+const uint8_t kConnack = 0x20;
+const uint8_t kPublish = 0x30;
+const uint8_t kSubscribe = 0x82;
+const uint8_t kPingreq = 0xC0;
+const uint8_t kDisconnect = 0xE0;
+
+// Acima disso o socket não está drenando: trata como conexão perdida.
+const size_t kMaxOutBuffer = 256 * 1024;
+
+}  // namespace
+
+namespace mqtt_wire {
+
+uint64_t now_ms() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+}
+
+void put_u16(std::vector<uint8_t>& out, uint16_t v) {
+  out.push_back(static_cast<uint8_t>(v >> 8));
+  out.push_back(static_cast<uint8_t>(v & 0xFF));
+}
+
+void put_string(std::vector<uint8_t>& out, const std::string& s) {
+  put_u16(out, static_cast<uint16_t>(s.size()));
+  out.insert(out.end(), s.begin(), s.end());
+}
+
+void encode_packet(uint8_t header, const std::vector<uint8_t>& body, std::vector<uint8_t>& out) {
+  out.push_back(header);
+  size_t remaining = body.size();
+  do {
+    uint8_t digit = remaining % 128;
+    remaining /= 128;
+    if (remaining > 0) digit |= 0x80;
+    out.push_back(digit);
+  } while (remaining > 0);
+  out.insert(out.end(), body.begin(), body.end());
+}
+
+long decode_packet(const uint8_t* buf, size_t length, uint8_t& header,
+                   std::vector<uint8_t>& body) {
+  if (length < 2) return 0;
+  size_t remaining = 0;
+  size_t multiplier = 1;
+  size_t pos = 1;
+  while (true) {
+    if (pos >= length) return 0;
+    if (pos > 4) return -1;
+    uint8_t digit = buf[pos++];
+    remaining += (digit & 0x7F) * multiplier;
+    multiplier *= 128;
+    if ((digit & 0x80) == 0) break;
+  }
+  if (length - pos < remaining) return 0;
+  header = buf[0];
+  body.assign(buf + pos, buf + pos + remaining);
+  return static_cast<long>(pos + remaining);
+}
+
+bool topic_matches(const std::string& filter, const std::string& topic) {
+  size_t f = 0;
+  size_t t = 0;
+  while (f < filter.size()) {
+    if (filter[f] == '#') return true;
+    if (filter[f] == '+') {
+      while (t < topic.size() && topic[t] != '/') ++t;
+      ++f;
+      continue;
+    }
+    if (t >= topic.size() || filter[f] != topic[t]) return false;
+    ++f;
+    ++t;
+  }
+  return t == topic.size();
+}
+
+}  // namespace mqtt_wire
+
+using namespace mqtt_wire;
+
+MqttWireClient::MqttWireClient()
+    : fd_(-1),
+      status_(IDLE),
+      last_error_(ERR_DISCONNECTED),
+      connect_sent_(false),
+      keepalive_s_(30),
+      next_packet_id_(1),
+      deadline_ms_(0),
+      last_tx_ms_(0),
+      bytes_sent_(0),
+      bytes_received_(0) {}
+
+MqttWireClient::~MqttWireClient() {
+  close_socket();
+}
+
+void MqttWireClient::close_socket() {
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  in_.clear();
+  out_.clear();
+}
+
+void MqttWireClient::fail(int error) {
+  close_socket();
+  status_ = FAILED;
+  last_error_ = error;
+}
+
+bool MqttWireClient::start_connect(const char* host, int port, const char* client_id,
+                                   const char* username, const char* password,
+                                   uint16_t keepalive_s, uint32_t timeout_ms) {
+  close_socket();
+  status_ = FAILED;
+  last_error_ = ERR_CONNECT_FAILED;
+
+  char port_str[8];
+  snprintf(port_str, sizeof(port_str), "%d", port);
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* res = nullptr;
+  if (getaddrinfo(host, port_str, &hints, &res) != 0 || !res) return false;
+
+  fd_ = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  if (fd_ < 0) {
+    freeaddrinfo(res);
+    return false;
+  }
+  fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL, 0) | O_NONBLOCK);
+  int rc = ::connect(fd_, res->ai_addr, res->ai_addrlen);
+  freeaddrinfo(res);
+  if (rc != 0 && errno != EINPROGRESS) {
+    close_socket();
+    return false;
+  }
+
+  client_id_ = client_id ? client_id : "";
+  username_ = username ? username : "";
+  password_ = password ? password : "";
+  keepalive_s_ = keepalive_s;
+  connect_sent_ = false;
+  deadline_ms_ = now_ms() + timeout_ms;
+  status_ = CONNECTING;
+  last_error_ = ERR_DISCONNECTED;
+  return true;
+}
+
+MqttWireClient::Status MqttWireClient::poll_connect() {
+  if (status_ != CONNECTING) return status_;
+
+  if (!connect_sent_) {
+    pollfd pfd = {fd_, POLLOUT, 0};
+    if (::poll(&pfd, 1, 0) > 0) {
+      int err = 0;
+      socklen_t len = sizeof(err);
+      getsockopt(fd_, SOL_SOCKET, SO_ERROR, &err, &len);
+      if (err != 0) {
+        fail(ERR_CONNECT_FAILED);
+        return status_;
+      }
+      std::vector<uint8_t> body;
+      put_string(body, "MQTT");
+      body.push_back(4);  // nível de protocolo 3.1.1
+      uint8_t flags = 0x02;  // clean session
+      if (!username_.empty()) flags |= 0x80;
+      if (!password_.empty()) flags |= 0x40;
+      body.push_back(flags);
+      put_u16(body, keepalive_s_);
+      put_string(body, client_id_);
+      if (!username_.empty()) put_string(body, username_);
+      if (!password_.empty()) put_string(body, password_);
+      connect_sent_ = true;
+      if (!queue_packet(kConnect, body)) return status_;
+    }
+  } else {
+    if (!flush()) {
+      fail(ERR_CONNECT_FAILED);
+      return status_;
+    }
+    // O broker pode recusar e fechar na sequência: o CONNACK vem antes do EOF
+    bool open = read_available();
+    uint8_t header = 0;
+    std::vector<uint8_t> body;
+    if (next_packet(header, body)) {
+      if ((header & 0xF0) != kConnack || body.size() < 2) {
+        fail(ERR_CONNECT_FAILED);
+      } else if (body[1] != 0) {
+        fail(body[1]);
+      } else {
+        status_ = CONNECTED;
+        last_error_ = ERR_NONE;
+      }
+      return status_;
+    }
+    if (!open) {
+      fail(ERR_CONNECT_FAILED);
+      return status_;
+    }
+  }
+
+  if (status_ == CONNECTING && now_ms() >= deadline_ms_) {
+    fail(ERR_CONNECTION_TIMEOUT);
+  }
+  return status_;
+}
+
+bool MqttWireClient::queue_packet(uint8_t header, const std::vector<uint8_t>& body) {
+  if (out_.size() > kMaxOutBuffer) {
+    fail(ERR_CONNECTION_LOST);
+    return false;
+  }
+  encode_packet(header, body, out_);
+  last_tx_ms_ = now_ms();
+  return flush();
+}
+
+bool MqttWireClient::flush() {
+  size_t sent = 0;
+  while (sent < out_.size()) {
+    ssize_t n = ::send(fd_, out_.data() + sent, out_.size() - sent, MSG_NOSIGNAL);
+    if (n > 0) {
+      sent += static_cast<size_t>(n);
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    if (n < 0 && errno == EINTR) continue;
+    fail(ERR_CONNECTION_LOST);
+    return false;
+  }
+  out_.erase(out_.begin(), out_.begin() + sent);
+  bytes_sent_ += sent;
+  return true;
+}
+
+bool MqttWireClient::read_available() {
+  uint8_t buf[4096];
+  while (true) {
+    ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+    if (n > 0) {
+      in_.insert(in_.end(), buf, buf + n);
+      bytes_received_ += static_cast<uint64_t>(n);
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+    if (n < 0 && errno == EINTR) continue;
+    return false;  // 0 = o broker fechou (o que já chegou fica em in_)
+  }
+}
+
+bool MqttWireClient::next_packet(uint8_t& header, std::vector<uint8_t>& body) {
+  long used = decode_packet(in_.data(), in_.size(), header, body);
+  if (used < 0) {
+    fail(ERR_CONNECTION_LOST);
+    return false;
+  }
+  if (used == 0) return false;
+  in_.erase(in_.begin(), in_.begin() + used);
+  return true;
+}
+
+bool MqttWireClient::subscribe(const char* topic) {
+  if (!connected()) return false;
+  std::vector<uint8_t> body;
+  put_u16(body, next_packet_id_++);
+  if (next_packet_id_ == 0) next_packet_id_ = 1;
+  put_string(body, topic);
+  body.push_back(0);  // QoS 0
+  return queue_packet(kSubscribe, body);
+}
+
+bool MqttWireClient::publish(const char* topic, const uint8_t* payload, size_t length) {
+  if (!connected()) return false;
+  std::vector<uint8_t> body;
+  put_string(body, topic);
+  body.insert(body.end(), payload, payload + length);
+  return queue_packet(kPublish, body);
+}
+
+bool MqttWireClient::loop(MessageHandler handler, void* ctx, int timeout_ms) {
+  if (!connected()) return false;
+
+  if (timeout_ms > 0) {
+    pollfd pfd = {fd_, POLLIN, 0};
+    ::poll(&pfd, 1, timeout_ms);
+  }
+  bool open = read_available();
+
+  uint8_t header = 0;
+  std::vector<uint8_t> body;
+  while (connected() && next_packet(header, body)) {
+    if ((header & 0xF0) != kPublish || body.size() < 2) continue;
+    size_t topic_len = (static_cast<size_t>(body[0]) << 8) | body[1];
+    size_t pos = 2 + topic_len;
+    if ((header & 0x06) != 0) pos += 2;  // packet id de QoS > 0
+    if (pos > body.size()) continue;
+    std::string topic(reinterpret_cast<const char*>(body.data() + 2), topic_len);
+    if (handler) handler(topic.c_str(), body.data() + pos, body.size() - pos, ctx);
+  }
+  if (!connected()) return false;
+  if (!open) {
+    fail(ERR_CONNECTION_LOST);
+    return false;
+  }
+
+  if (keepalive_s_ > 0 && now_ms() - last_tx_ms_ >= keepalive_s_ * 1000ull) {
+    if (!queue_packet(kPingreq, std::vector<uint8_t>())) return false;
+  }
+  return flush();
+}
+
+void MqttWireClient::disconnect() {
+  if (connected()) {
+    queue_packet(kDisconnect, std::vector<uint8_t>());
+  }
+  close_socket();
+  status_ = IDLE;
+  last_error_ = ERR_DISCONNECTED;
+}
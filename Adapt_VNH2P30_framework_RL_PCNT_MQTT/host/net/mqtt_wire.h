@@ -0,0 +1,98 @@
+#pragma once
+
+// Cliente MQTT 3.1.1 mínimo sobre TCP (sem TLS) para o build nativo e as
+// ferramentas de host. Socket não bloqueante: a conexão avança por
+// poll_connect() e as mensagens chegam por loop(), então nenhum método espera
+// pela rede (exceto a resolução de nome em start_connect()).
+//
+// Só QoS 0 na publicação; inscrições pedem QoS 0.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+class MqttWireClient {
+ public:
+  enum Status {
+    IDLE = 0,
+    CONNECTING,
+    CONNECTED,
+    FAILED,
+  };
+
+  // Mesmos códigos do PubSubClient
+  enum {
+    ERR_CONNECTION_TIMEOUT = -4,
+    ERR_CONNECTION_LOST = -3,
+    ERR_CONNECT_FAILED = -2,
+    ERR_DISCONNECTED = -1,
+    ERR_NONE = 0,
+  };
+
+  typedef void (*MessageHandler)(const char* topic, const uint8_t* payload, size_t length,
+                                 void* ctx);
+
+  MqttWireClient();
+  ~MqttWireClient();
+
+  bool start_connect(const char* host, int port, const char* client_id, const char* username,
+                     const char* password, uint16_t keepalive_s = 30,
+                     uint32_t timeout_ms = 5000);
+  // Avança TCP + CONNECT/CONNACK; devolve CONNECTING até terminar.
+  Status poll_connect();
+
+  bool connected() const { return status_ == CONNECTED; }
+  Status status() const { return status_; }
+  int last_error() const { return last_error_; }
+  int fd() const { return fd_; }
+
+  bool subscribe(const char* topic);
+  bool publish(const char* topic, const uint8_t* payload, size_t length);
+  // Lê o que já chegou, entrega os PUBLISH e mantém o keepalive. timeout_ms
+  // > 0 espera por dados (uso das ferramentas de host).
+  bool loop(MessageHandler handler, void* ctx, int timeout_ms = 0);
+  void disconnect();
+
+  uint64_t bytes_sent() const { return bytes_sent_; }
+  uint64_t bytes_received() const { return bytes_received_; }
+
+ private:
+  void fail(int error);
+  bool queue_packet(uint8_t header, const std::vector<uint8_t>& body);
+  bool flush();
+  bool read_available();
+  // Extrai um pacote completo de in_; false se ainda incompleto.
+  bool next_packet(uint8_t& header, std::vector<uint8_t>& body);
+  void close_socket();
+
+  int fd_;
+  Status status_;
+  int last_error_;
+  bool connect_sent_;
+  uint16_t keepalive_s_;
+  uint16_t next_packet_id_;
+  uint64_t deadline_ms_;
+  uint64_t last_tx_ms_;
+  std::string client_id_;
+  std::string username_;
+  std::string password_;
+  std::vector<uint8_t> in_;
+  std::vector<uint8_t> out_;
+  uint64_t bytes_sent_;
+  uint64_t bytes_received_;
+};
+
+// Utilitários compartilhados com o broker de teste
+namespace mqtt_wire {
+uint64_t now_ms();
+void put_u16(std::vector<uint8_t>& out, uint16_t v);
+void put_string(std::vector<uint8_t>& out, const std::string& s);
+void encode_packet(uint8_t header, const std::vector<uint8_t>& body, std::vector<uint8_t>& out);
+// Decodifica um pacote do início de buf; devolve bytes consumidos (0 se
+// incompleto, -1 se malformado).
+long decode_packet(const uint8_t* buf, size_t length, uint8_t& header,
+                   std::vector<uint8_t>& body);
+bool topic_matches(const std::string& filter, const std::string& topic);
+}  // namespace mqtt_wire
@@ -0,0 +1,294 @@
+// Roda o firmware (setup()/loop()) contra os periféricos simulados e a planta
+// do robô, o mais rápido possível. Serve para profiling (perf), sanitizers e
+// regressão do caminho de controle/odometria sem gravar o ESP32.
+//
+// A tarefa de controle é disparada pelo relógio virtual; a tarefa de rede roda
+// a cada iteração. --outage-at/--outage-for derrubam o broker para exercitar o
+// gerenciador de conexão (backoff/reconexão) enquanto o controle continua no
+// seu período.
+//
+// --telemetry escolhe o formato do tópico de odometria (json, binary, batch);
+// o resumo mostra mensagens e bytes publicados nos tópicos de odometria e o
+// que ficou na flash durante a queda e foi reenviado (odometry_store.h).
+//
+// --command-mode escolhe como yaw|pitch vira movimento (comandos discretos,
+// padrão do firmware, ou twist proporcional); "cortes de PWM" conta as
+// vezes em que uma roda em movimento teve o PWM levado a zero.
+//
+// Com o perfil por etapa ligado (ROBOT_LOOP_PROFILING), o fim mostra a última
+// janela publicada em robot/loop/profile: aqui as durações são o custo real
+// no host, não o relógio simulado.
+//
+// --record grava num arquivo os pedaços publicados em robot/session
+// (ROBOT_SESSION_RECORD), para reproduzir com session_replay.
+//
+// Uso: robot_sim [--seconds S] [--step-us N] [--cmd-period-ms M]
+//                [--outage-at S --outage-for S] [--telemetry F]
+//                [--command-mode discrete|twist] [--record ARQUIVO]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+
+#include "control_task.h"
+#include "loop_profiler.h"
+#include "mqtt_client.h"
+#include "odometry_store.h"
+#include "plant.h"
+#include "robot_config.h"
+#include "session_record.h"
+#include "sim.h"
+
+void setup();
+void loop();
+
+namespace {
+
+struct PublishCapture {
+  std::string last_odometry;
+  unsigned long odometry_messages = 0;
+  unsigned long long odometry_bytes = 0;
+  unsigned long backfill_messages = 0;
+  unsigned long control_cycles = 0;
+  unsigned long max_jitter_us = 0;
+  unsigned long overruns = 0;
+  unsigned long profile_messages = 0;
+  size_t profile_max_bytes = 0;
+  std::string last_profile;
+  FILE* record = nullptr;
+  unsigned long long record_bytes = 0;
+};
+
+unsigned long json_field(const std::string& json, const char* key) {
+  std::string needle = std::string("\"") + key + "\":";
+  size_t pos = json.find(needle);
+  return pos == std::string::npos ? 0 : strtoul(json.c_str() + pos + needle.size(), nullptr, 10);
+}
+
+#if LOOP_PROFILING
+// Campo de uma etapa do JSON do perfil: {"encoder":{"n":..,...},...}
+unsigned long profile_field(const std::string& json, const char* stage, const char* key) {
+  size_t pos = json.find(std::string("\"") + stage + "\":{");
+  return pos == std::string::npos ? 0 : json_field(json.substr(pos), key);
+}
+#endif
+
+void on_publish(const char* topic, const uint8_t* payload, size_t length, void* ctx) {
+  PublishCapture* capture = static_cast<PublishCapture*>(ctx);
+  std::string body(reinterpret_cast<const char*>(payload), length);
+  if (strcmp(topic, "robot/odometry/backfill") == 0) {
+    capture->backfill_messages++;
+  } else if (strncmp(topic, "robot/odometry", 14) == 0) {
+    capture->odometry_messages++;
+    capture->odometry_bytes += length;
+  }
+  if (strcmp(topic, "robot/odometry") == 0) {
+    OdometrySample samples[TELEMETRY_BATCH_MAX_SAMPLES];
+    size_t n = telemetry_decode_odometry_batch(payload, length, samples, TELEMETRY_BATCH_MAX_SAMPLES);
+    if (n == 0 && telemetry_decode_odometry(payload, length, samples[0])) n = 1;
+    if (n > 0) {
+      char text[96];
+      snprintf(text, sizeof(text), "{\"x\":%.6f,\"y\":%.6f,\"phi\":%.6f} (binario, seq %u)",
+               samples[n - 1].x, samples[n - 1].y, samples[n - 1].phi, samples[n - 1].seq);
+      capture->last_odometry = text;
+    } else {
+      capture->last_odometry = body;
+    }
+  } else if (strcmp(topic, "robot/loop/profile") == 0) {
+    capture->profile_messages++;
+    if (length > capture->profile_max_bytes) capture->profile_max_bytes = length;
+    capture->last_profile = body;
+  } else if (strcmp(topic, "robot/session") == 0) {
+    if (capture->record && fwrite(payload, 1, length, capture->record) == length) {
+      capture->record_bytes += length;
+    }
+  } else if (strcmp(topic, "robot/control/timing") == 0) {
+    capture->control_cycles += json_field(body, "cycles");
+    capture->overruns += json_field(body, "overruns");
+    unsigned long jitter = json_field(body, "jitter_max_us");
+    if (jitter > capture->max_jitter_us) capture->max_jitter_us = jitter;
+  }
+}
+
+// Sequência de comandos yaw|pitch que percorre todas as ações remotas.
+const char* const kCommandCycle[][2] = {
+    {"0.0", "-20.0"},  // frente
+    {"-30.0", "0.0"},  // esquerda
+    {"0.0", "-20.0"},  // frente
+    {"30.0", "0.0"},   // direita
+    {"0.0", "20.0"},   // ré
+    {"0.0", "0.0"},    // stop
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double seconds = 60.0;
+  uint32_t step_us = 200;
+  uint32_t cmd_period_ms = 2000;
+  double outage_at = -1.0;
+  double outage_for = 0.0;
+  const char* telemetry = "json";
+  const char* command_mode = "discrete";
+  const char* record_path = nullptr;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--step-us") == 0 && i + 1 < argc) {
+      step_us = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--cmd-period-ms") == 0 && i + 1 < argc) {
+      cmd_period_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--outage-at") == 0 && i + 1 < argc) {
+      outage_at = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--outage-for") == 0 && i + 1 < argc) {
+      outage_for = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) {
+      telemetry = argv[++i];
+    } else if (strcmp(argv[i], "--command-mode") == 0 && i + 1 < argc) {
+      command_mode = argv[++i];
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else {
+      fprintf(stderr,
+              "uso: %s [--seconds S] [--step-us N] [--cmd-period-ms M]"
+              " [--outage-at S --outage-for S] [--telemetry json|binary|batch]"
+              " [--command-mode discrete|twist] [--record ARQUIVO]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (step_us == 0 || cmd_period_ms == 0) {
+    fprintf(stderr, "step-us e cmd-period-ms devem ser > 0\n");
+    return 2;
+  }
+
+  if (strcmp(telemetry, "binary") == 0) {
+    net_set_odom_format(TELEMETRY_BINARY);
+    net_set_odom_debug_format(TELEMETRY_BINARY);
+  } else if (strcmp(telemetry, "batch") == 0) {
+    net_set_odom_format(TELEMETRY_BATCH);
+  } else if (strcmp(telemetry, "json") != 0) {
+    fprintf(stderr, "telemetry deve ser json, binary ou batch\n");
+    return 2;
+  }
+  if (strcmp(command_mode, "discrete") == 0) {
+    net_set_command_mode(REMOTE_DISCRETE);
+  } else if (strcmp(command_mode, "twist") == 0) {
+    net_set_command_mode(REMOTE_TWIST);
+  } else {
+    fprintf(stderr, "command-mode deve ser twist ou discrete\n");
+    return 2;
+  }
+
+  PublishCapture capture;
+  if (record_path) {
+    capture.record = fopen(record_path, "wb");
+    if (!capture.record) {
+      fprintf(stderr, "nao abriu %s\n", record_path);
+      return 2;
+    }
+  }
+  sim_reset();
+  sim_mqtt_set_publish_hook(on_publish, &capture);
+
+  SimPlant plant;
+  plant.attach(100);
+  setup();
+
+  const uint64_t total_us = static_cast<uint64_t>(seconds * 1e6);
+  const uint64_t start_us = sim_clock_us();
+  uint64_t next_cmd_us = start_us;
+  size_t cmd_index = 0;
+  uint64_t iterations = 0;
+  uint32_t nonce = 0;
+  uint32_t pwm_cuts = 0;
+  uint32_t last_duty[2] = {0, 0};
+  if (outage_at >= 0) {
+    uint64_t from = start_us + static_cast<uint64_t>(outage_at * 1e6);
+    sim_broker_schedule_outage(from, from + static_cast<uint64_t>(outage_for * 1e6));
+  }
+
+  auto wall_start = std::chrono::steady_clock::now();
+  while (sim_clock_us() - start_us < total_us) {
+    if (sim_clock_us() >= next_cmd_us) {
+      const size_t n = sizeof(kCommandCycle) / sizeof(kCommandCycle[0]);
+      char payload[64];
+      snprintf(payload, sizeof(payload), "%s|%s|n%u|%llu", kCommandCycle[cmd_index][0],
+               kCommandCycle[cmd_index][1], nonce++,
+               static_cast<unsigned long long>(sim_clock_us() / 1000));
+      sim_mqtt_inject("facemesh/cmd", payload);
+      cmd_index = (cmd_index + 1) % n;
+      next_cmd_us += static_cast<uint64_t>(cmd_period_ms) * 1000;
+    }
+
+    sim_clock_advance_us(step_us);
+    sim_run_loop_tasks();
+    ++iterations;
+    const uint8_t channels[2] = {PWM_CHANNEL_R, PWM_CHANNEL_L};
+    for (int w = 0; w < 2; ++w) {
+      const uint32_t duty = sim_pwm_duty(channels[w]);
+      if (duty == 0 && last_duty[w] != 0) ++pwm_cuts;
+      last_duty[w] = duty;
+    }
+  }
+  // Esvazia o que a gravação ainda tem no anel (pedaço incompleto)
+  if (capture.record) {
+    session_record_stop();
+    for (int i = 0; i < 4; ++i) {
+      sim_clock_advance_us(SESSION_FLUSH_MS * 1000);
+      sim_run_loop_tasks();
+    }
+  }
+  auto wall_end = std::chrono::steady_clock::now();
+  double wall_s = std::chrono::duration<double>(wall_end - wall_start).count();
+
+  SimMqttStats stats = sim_mqtt_stats();
+  printf("variante         : %s\n", Robot::kName);
+  printf("iteracoes rede   : %llu\n", static_cast<unsigned long long>(iterations));
+  printf("tempo simulado   : %.3f s\n", (sim_clock_us() - start_us) * 1e-6);
+  printf("tempo real       : %.3f s\n", wall_s);
+  printf("iteracoes/s      : %.0f\n", wall_s > 0 ? iterations / wall_s : 0.0);
+  printf("ns/iteracao      : %.1f\n", iterations ? wall_s * 1e9 / iterations : 0.0);
+  printf("mensagens        : %u entregues, %u publicadas (%llu bytes)\n", stats.delivered,
+         stats.published, static_cast<unsigned long long>(stats.published_bytes));
+  printf("ciclos controle  : %lu (esperado ~%.0f), jitter max %lu us, overruns %lu\n",
+         capture.control_cycles, (sim_clock_us() - start_us) / double(CONTROL_PERIOD_US),
+         capture.max_jitter_us, capture.overruns);
+  TelemetryStats tlm = net_telemetry_stats();
+  printf("telemetria (%s): %lu msgs, %llu bytes, %u amostras, razao %.2f,"
+         " publish max %u us\n",
+         telemetry, capture.odometry_messages, capture.odometry_bytes, tlm.samples,
+         tlm.sent_bytes ? double(tlm.raw_bytes) / tlm.sent_bytes : 0.0, tlm.publish_us_max);
+  OdometryStoreStats store = odometry_store_stats();
+  printf("flash (odomlog)  : %u guardadas offline, %u reenviadas em %lu msgs, %u pendentes,"
+         " %u sobrescritas\n",
+         tlm.stored, tlm.backfilled, capture.backfill_messages, store.pending, store.overwritten);
+  printf("comando          : %s, %u cortes de PWM\n", command_mode, pwm_cuts);
+  printf("pose verdadeira  : x=%.4f y=%.4f phi=%.4f\n", plant.pose.x, plant.pose.y,
+         plant.pose.phi);
+  printf("odometria        : %s\n", capture.last_odometry.c_str());
+  if (capture.record) {
+    fclose(capture.record);
+    SessionRecordStats rec = session_record_stats();
+    printf("gravacao         : %u ciclos, %u quadros-chave, %u perdidos, %u pedacos,"
+           " %llu bytes em %s\n",
+           rec.cycles, rec.keyframes, rec.lost, rec.chunks, capture.record_bytes, record_path);
+  }
+#if LOOP_PROFILING
+  const std::string& prof = capture.last_profile;
+  printf("perfil           : %lu janelas publicadas (max %zu bytes); ultima, %lu ms:\n",
+         capture.profile_messages, capture.profile_max_bytes, json_field(prof, "window_ms"));
+  for (int i = 0; i < STAGE_COUNT; ++i) {
+    const char* stage = loop_stage_name(static_cast<LoopStage>(i));
+    printf("  %-14s n=%-7lu min %6lu ns  media %6lu ns  max %8lu ns  estouros %lu\n", stage,
+           profile_field(prof, stage, "n"), profile_field(prof, stage, "min_ns"),
+           profile_field(prof, stage, "mean_ns"), profile_field(prof, stage, "max_ns"),
+           profile_field(prof, stage, "misses"));
+  }
+#endif
+  return 0;
+}
@@ -0,0 +1,745 @@
+#include "hal.h"
+#include "sim.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mqtt_wire.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int kNumPins = 40;
+const int kNumPwmChannels = 16;
+const int kNumPcntUnits = 8;
+// Duração simulada de TCP + TLS + CONNECT no broker em memória.
+const uint64_t kConnectLatencyUs = 30000;
+
+struct PcntUnit {
+  int16_t count;
+  int16_t h_lim;
+  int16_t l_lim;
+  int64_t accum;          // voltas já tratadas pela "interrupção"
+  int64_t pending;        // voltas esperando a interrupção (modo atrasado)
+  bool pending_seen;      // uma leitura já viu o evento pendente
+  uint32_t limit_events;
+  uint32_t late_events;
+};
+
+struct EdgeCapture {
+  bool enabled;
+  int32_t edges;
+  uint32_t last_edge_us;
+};
+
+struct TimerTask {
+  uint32_t period_us;
+  uint64_t next_us;
+  HalTaskBody body;
+};
+
+struct InboundMessage {
+  std::string topic;
+  std::vector<uint8_t> payload;
+};
+
+struct SimState {
+  uint64_t clock_us = 0;
+  uint32_t rng = 0x12345678u;
+
+  bool pin_output[kNumPins] = {};
+  bool pin_level[kNumPins] = {};
+  HalIsrBody pin_isr[kNumPins] = {};     // hal_gpio_isr_attach
+  uint32_t pwm_duty[kNumPwmChannels] = {};
+  PcntUnit pcnt[kNumPcntUnits] = {};
+  bool pcnt_events_deferred = false;
+  EdgeCapture capture[kNumPcntUnits] = {};
+
+  SimPlantHook plant_hook = nullptr;
+  void* plant_ctx = nullptr;
+  uint32_t plant_max_step_us = 100;
+  std::vector<TimerTask> timer_tasks;
+  TimerTask isr_timer = {0, 0, nullptr};   // hal_timer_isr_start
+  uint64_t stall_from_us = 0;             // sim_timer_tasks_stall
+  uint64_t stall_to_us = 0;
+  std::vector<HalTaskBody> loop_tasks;
+  bool in_timer_task = false;
+
+  uint8_t mac[6] = {0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01};
+  bool wifi_available = true;
+  bool wifi_started = false;
+  bool broker_available = true;
+  uint64_t outage_from_us = 0;
+  uint64_t outage_to_us = 0;
+  bool mqtt_connected = false;
+  int mqtt_state = -1;
+  bool connect_pending = false;
+  uint64_t connect_done_us = 0;
+  HalMqttCallback callback = nullptr;
+  std::set<std::string> subscriptions;
+  std::deque<InboundMessage> inbound;
+  SimPublishHook publish_hook = nullptr;
+  void* publish_ctx = nullptr;
+  SimPublishHook receive_hook = nullptr;
+  void* receive_ctx = nullptr;
+  uint32_t uplink_bps = 0;            // sim_mqtt_set_uplink; 0 = sem limite
+  uint32_t uplink_buffer = 0;
+  uint64_t uplink_free_at_us = 0;     // quando o buffer de envio esvazia
+  SimMqttStats stats = {};
+};
+
+SimState g_sim;
+
+// Backend TCP opcional (sim_net_use_tcp_broker); sobrevive ao sim_reset().
+struct TcpBackend {
+  bool enabled = false;
+  std::string host;
+  int port = 1883;
+  MqttWireClient client;
+};
+
+TcpBackend g_tcp;
+
+// Flash da partição odomlog (sim_flash_use_file); o arquivo sobrevive ao
+// sim_reset(), a memória não.
+struct FlashBackend {
+  std::string path;
+  uint8_t* data = nullptr;          // mmap do arquivo ou mem.data()
+  std::vector<uint8_t> mem;
+  std::vector<uint32_t> erases;
+};
+
+FlashBackend g_flash;
+
+void flash_close() {
+  if (g_flash.data && !g_flash.path.empty()) {
+    munmap(g_flash.data, SIM_FLASH_BYTES);
+  }
+  g_flash.data = nullptr;
+  g_flash.mem.clear();
+  g_flash.erases.assign(SIM_FLASH_BYTES / HAL_FLASH_SECTOR_BYTES, 0);
+}
+
+bool flash_open() {
+  if (g_flash.data) return true;
+  if (g_flash.path.empty()) {
+    g_flash.mem.assign(SIM_FLASH_BYTES, 0xFF);
+    g_flash.data = g_flash.mem.data();
+    return true;
+  }
+  int fd = open(g_flash.path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  // Arquivo novo ou menor: completa com flash apagada
+  const std::vector<uint8_t> fill(HAL_FLASH_SECTOR_BYTES, 0xFF);
+  for (off_t at = st.st_size; at < static_cast<off_t>(SIM_FLASH_BYTES);) {
+    const size_t n = static_cast<size_t>(
+        std::min<off_t>(static_cast<off_t>(fill.size()), SIM_FLASH_BYTES - at));
+    if (pwrite(fd, fill.data(), n, at) != static_cast<ssize_t>(n)) {
+      close(fd);
+      return false;
+    }
+    at += static_cast<off_t>(n);
+  }
+  void* map = mmap(nullptr, SIM_FLASH_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) return false;
+  g_flash.data = static_cast<uint8_t*>(map);
+  return true;
+}
+
+bool valid_pin(uint8_t pin) { return pin < kNumPins; }
+
+bool broker_up() {
+  if (g_sim.clock_us >= g_sim.outage_from_us && g_sim.clock_us < g_sim.outage_to_us) {
+    return false;
+  }
+  return g_sim.broker_available;
+}
+
+void drop_session(int state) {
+  if (g_sim.mqtt_connected) {
+    g_sim.mqtt_connected = false;
+    g_sim.mqtt_state = state;
+  }
+}
+
+void deliver_tcp_message(const char* topic, const uint8_t* payload, size_t length, void*) {
+  if (!g_sim.callback) return;
+  std::vector<char> t(topic, topic + strlen(topic) + 1);
+  std::vector<uint8_t> p(payload, payload + length);
+  g_sim.stats.delivered++;
+  if (g_sim.receive_hook) {
+    g_sim.receive_hook(topic, payload, length, g_sim.receive_ctx);
+  }
+  g_sim.callback(t.data(), p.data(), static_cast<unsigned int>(p.size()));
+}
+
+}  // namespace
+
+// =======================
+// Controle da simulação
+// =======================
+void sim_reset() {
+  if (g_flash.path.empty()) {
+    flash_close();
+  }
+  SimPublishHook hook = g_sim.publish_hook;
+  void* ctx = g_sim.publish_ctx;
+  SimPublishHook receive_hook = g_sim.receive_hook;
+  void* receive_ctx = g_sim.receive_ctx;
+  g_sim = SimState();
+  g_sim.publish_hook = hook;
+  g_sim.publish_ctx = ctx;
+  g_sim.receive_hook = receive_hook;
+  g_sim.receive_ctx = receive_ctx;
+}
+
+uint64_t sim_clock_us() {
+  return g_sim.clock_us;
+}
+
+void sim_clock_advance_us(uint64_t dt_us) {
+  const uint64_t target = g_sim.clock_us + dt_us;
+  while (g_sim.clock_us < target) {
+    // Interrupções de limite do PCNT atrasadas rodam no passo seguinte à
+    // leitura que as viu pendentes
+    for (int i = 0; i < kNumPcntUnits; ++i) {
+      PcntUnit& u = g_sim.pcnt[i];
+      if (u.pending_seen) {
+        u.accum += u.pending;
+        u.pending = 0;
+        u.pending_seen = false;
+      }
+    }
+    uint64_t next = target;
+    if (g_sim.plant_hook && g_sim.clock_us + g_sim.plant_max_step_us < next) {
+      next = g_sim.clock_us + g_sim.plant_max_step_us;
+    }
+    for (size_t i = 0; i < g_sim.timer_tasks.size(); ++i) {
+      if (g_sim.timer_tasks[i].next_us > g_sim.clock_us && g_sim.timer_tasks[i].next_us < next) {
+        next = g_sim.timer_tasks[i].next_us;
+      }
+    }
+    if (g_sim.isr_timer.body && g_sim.isr_timer.next_us < next) {
+      next = g_sim.isr_timer.next_us;
+    }
+
+    if (g_sim.plant_hook) {
+      g_sim.plant_hook(static_cast<uint32_t>(next - g_sim.clock_us), g_sim.plant_ctx);
+    }
+    g_sim.clock_us = next;
+
+    // O ISR interrompe qualquer tarefa, inclusive uma de timer
+    if (g_sim.isr_timer.body && g_sim.isr_timer.next_us <= g_sim.clock_us) {
+      g_sim.isr_timer.next_us += g_sim.isr_timer.period_us;
+      g_sim.isr_timer.body();
+    }
+
+    // Uma tarefa de timer que bloqueia (não deveria) não dispara a si mesma.
+    if (g_sim.in_timer_task) continue;
+    const bool stalled =
+        g_sim.clock_us >= g_sim.stall_from_us && g_sim.clock_us < g_sim.stall_to_us;
+    for (size_t i = 0; i < g_sim.timer_tasks.size(); ++i) {
+      TimerTask& task = g_sim.timer_tasks[i];
+      if (task.next_us <= g_sim.clock_us) {
+        task.next_us += task.period_us;
+        if (stalled) continue;
+        g_sim.in_timer_task = true;
+        task.body();
+        g_sim.in_timer_task = false;
+      }
+    }
+  }
+}
+
+void sim_set_plant_hook(SimPlantHook hook, void* ctx, uint32_t max_step_us) {
+  g_sim.plant_hook = hook;
+  g_sim.plant_ctx = ctx;
+  g_sim.plant_max_step_us = max_step_us ? max_step_us : 1;
+}
+
+void sim_timer_tasks_stall(uint64_t from_us, uint64_t to_us) {
+  g_sim.stall_from_us = from_us;
+  g_sim.stall_to_us = to_us;
+}
+
+void sim_run_loop_tasks() {
+  for (size_t i = 0; i < g_sim.loop_tasks.size(); ++i) {
+    g_sim.loop_tasks[i]();
+  }
+}
+
+bool sim_gpio_level(uint8_t pin) {
+  return valid_pin(pin) && g_sim.pin_level[pin];
+}
+
+void sim_gpio_set_input(uint8_t pin, bool level) {
+  if (!valid_pin(pin) || g_sim.pin_level[pin] == level) return;
+  g_sim.pin_level[pin] = level;
+  if (g_sim.pin_isr[pin]) g_sim.pin_isr[pin]();
+}
+
+uint32_t sim_pwm_duty(uint8_t channel) {
+  return channel < kNumPwmChannels ? g_sim.pwm_duty[channel] : 0;
+}
+
+void sim_pcnt_add(uint8_t unit, int32_t pulses) {
+  if (unit >= kNumPcntUnits) return;
+  PcntUnit& u = g_sim.pcnt[unit];
+  int step = pulses >= 0 ? 1 : -1;
+  for (int32_t n = pulses >= 0 ? pulses : -pulses; n > 0; --n) {
+    int32_t next = u.count + step;
+    if ((u.h_lim != 0 && next >= u.h_lim) || (u.l_lim != 0 && next <= u.l_lim)) {
+      (g_sim.pcnt_events_deferred ? u.pending : u.accum) += next;
+      u.limit_events++;
+      next = 0;
+    }
+    u.count = static_cast<int16_t>(next);
+  }
+}
+
+void sim_pcnt_defer_events(bool deferred) {
+  g_sim.pcnt_events_deferred = deferred;
+}
+
+void sim_encoder_edges(uint8_t unit, int32_t edges, uint64_t last_edge_us) {
+  if (unit >= kNumPcntUnits || edges == 0) return;
+  EdgeCapture& c = g_sim.capture[unit];
+  c.edges += edges;
+  c.last_edge_us = static_cast<uint32_t>(last_edge_us);
+}
+
+void sim_set_mac(const uint8_t mac[6]) {
+  memcpy(g_sim.mac, mac, sizeof(g_sim.mac));
+}
+
+void sim_wifi_set_available(bool available) {
+  g_sim.wifi_available = available;
+}
+
+void sim_broker_set_available(bool available) {
+  g_sim.broker_available = available;
+  if (!available) drop_session(-3);
+}
+
+void sim_broker_drop_connection() {
+  drop_session(-3);
+}
+
+void sim_net_use_tcp_broker(const char* host, int port) {
+  g_tcp.client.disconnect();
+  g_tcp.enabled = host != nullptr;
+  g_tcp.host = host ? host : "";
+  g_tcp.port = port;
+}
+
+void sim_broker_schedule_outage(uint64_t from_us, uint64_t to_us) {
+  g_sim.outage_from_us = from_us;
+  g_sim.outage_to_us = to_us;
+}
+
+void sim_mqtt_set_publish_hook(SimPublishHook hook, void* ctx) {
+  g_sim.publish_hook = hook;
+  g_sim.publish_ctx = ctx;
+}
+
+void sim_mqtt_set_receive_hook(SimPublishHook hook, void* ctx) {
+  g_sim.receive_hook = hook;
+  g_sim.receive_ctx = ctx;
+}
+
+void sim_mqtt_set_uplink(uint32_t bytes_per_s, uint32_t buffer_bytes) {
+  g_sim.uplink_bps = bytes_per_s;
+  g_sim.uplink_buffer = buffer_bytes;
+  g_sim.uplink_free_at_us = g_sim.clock_us;
+}
+
+// O publish bloqueia até a mensagem caber no buffer de envio, que esvazia a
+// uplink_bps; de dentro de uma tarefa de timer o relógio não pode andar
+static void uplink_write(size_t bytes) {
+  if (!g_sim.uplink_bps) return;
+  const uint64_t now = g_sim.clock_us;
+  const uint64_t start = g_sim.uplink_free_at_us > now ? g_sim.uplink_free_at_us : now;
+  g_sim.uplink_free_at_us = start + bytes * 1000000u / g_sim.uplink_bps;
+  const uint64_t window_us = static_cast<uint64_t>(g_sim.uplink_buffer) * 1000000u /
+                             g_sim.uplink_bps;
+  if (!g_sim.in_timer_task && g_sim.uplink_free_at_us > now + window_us) {
+    sim_clock_advance_us(g_sim.uplink_free_at_us - window_us - now);
+  }
+}
+
+bool sim_mqtt_inject(const char* topic, const uint8_t* payload, size_t length) {
+  if (!g_sim.mqtt_connected) return false;
+  InboundMessage msg;
+  msg.topic = topic;
+  msg.payload.assign(payload, payload + length);
+  g_sim.inbound.push_back(msg);
+  return true;
+}
+
+bool sim_mqtt_inject(const char* topic, const char* payload) {
+  return sim_mqtt_inject(topic, reinterpret_cast<const uint8_t*>(payload), strlen(payload));
+}
+
+SimMqttStats sim_mqtt_stats() {
+  return g_sim.stats;
+}
+
+// =======================
+// hal.h — relógio
+// =======================
+uint32_t hal_millis() {
+  return static_cast<uint32_t>(g_sim.clock_us / 1000u);
+}
+
+uint32_t hal_micros() {
+  return static_cast<uint32_t>(g_sim.clock_us);
+}
+
+// Perfil no host: custo real de execução, não o relógio simulado
+uint32_t hal_cycle_count() {
+  return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+}
+
+uint32_t hal_cycles_per_us() {
+  return 1000;
+}
+
+void hal_delay_ms(uint32_t ms) {
+  sim_clock_advance_us(static_cast<uint64_t>(ms) * 1000u);
+}
+
+uint32_t hal_random32() {
+  // xorshift32: determinístico entre execuções
+  uint32_t x = g_sim.rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  g_sim.rng = x;
+  return x;
+}
+
+// =======================
+// hal.h — GPIO / PWM / PCNT
+// =======================
+void hal_gpio_mode(uint8_t pin, HalPinMode mode) {
+  if (valid_pin(pin)) g_sim.pin_output[pin] = (mode == HAL_PIN_OUTPUT);
+}
+
+void hal_gpio_write(uint8_t pin, bool level) {
+  if (valid_pin(pin)) g_sim.pin_level[pin] = level;
+}
+
+bool hal_gpio_read(uint8_t pin) {
+  return sim_gpio_level(pin);
+}
+
+void hal_pwm_setup(uint8_t channel, uint8_t, uint32_t, uint8_t) {
+  if (channel < kNumPwmChannels) g_sim.pwm_duty[channel] = 0;
+}
+
+void hal_pwm_write(uint8_t channel, uint32_t duty) {
+  if (channel < kNumPwmChannels) g_sim.pwm_duty[channel] = duty;
+}
+
+void hal_pcnt_setup(uint8_t unit, int, int, int16_t h_lim, int16_t l_lim) {
+  if (unit >= kNumPcntUnits) return;
+  g_sim.pcnt[unit] = PcntUnit();
+  g_sim.pcnt[unit].h_lim = h_lim;
+  g_sim.pcnt[unit].l_lim = l_lim;
+}
+
+bool hal_edge_capture_setup(uint8_t unit, int, int) {
+  if (unit >= kNumPcntUnits) return false;
+  EdgeCapture& c = g_sim.capture[unit];
+  c.enabled = true;
+  c.edges = 0;
+  c.last_edge_us = static_cast<uint32_t>(g_sim.clock_us);
+  return true;
+}
+
+HalEdgeCapture hal_edge_capture_read(uint8_t unit) {
+  HalEdgeCapture out = {0, 0};
+  if (unit < kNumPcntUnits && g_sim.capture[unit].enabled) {
+    out.edges = g_sim.capture[unit].edges;
+    out.last_edge_us = g_sim.capture[unit].last_edge_us;
+  }
+  return out;
+}
+
+int64_t hal_pcnt_total(uint8_t unit) {
+  if (unit >= kNumPcntUnits) return 0;
+  PcntUnit& u = g_sim.pcnt[unit];
+  int64_t total = u.accum + u.count;
+  // Como no ESP32: evento pendente é somado pela própria leitura
+  if (u.pending != 0) {
+    total += u.pending;
+    u.late_events++;
+    u.pending_seen = true;
+  }
+  return total;
+}
+
+HalPcntStats hal_pcnt_stats(uint8_t unit) {
+  HalPcntStats out = {0, 0};
+  if (unit < kNumPcntUnits) {
+    out.limit_events = g_sim.pcnt[unit].limit_events;
+    out.late_events = g_sim.pcnt[unit].late_events;
+  }
+  return out;
+}
+
+void sim_flash_use_file(const char* path) {
+  flash_close();
+  g_flash.path = path ? path : "";
+}
+
+uint32_t sim_flash_erase_count(uint32_t sector) {
+  return sector < g_flash.erases.size() ? g_flash.erases[sector] : 0;
+}
+
+// =======================
+// hal.h — flash (NOR em memória ou em arquivo)
+// =======================
+bool hal_flash_begin() {
+  return flash_open();
+}
+
+uint32_t hal_flash_size() {
+  return g_flash.data ? SIM_FLASH_BYTES : 0;
+}
+
+const uint8_t* hal_flash_data() {
+  return g_flash.data;
+}
+
+bool hal_flash_erase_sector(uint32_t sector) {
+  if (!g_flash.data || sector >= SIM_FLASH_BYTES / HAL_FLASH_SECTOR_BYTES) return false;
+  memset(g_flash.data + sector * HAL_FLASH_SECTOR_BYTES, 0xFF, HAL_FLASH_SECTOR_BYTES);
+  if (g_flash.erases.size() <= sector) g_flash.erases.resize(sector + 1, 0);
+  g_flash.erases[sector]++;
+  return true;
+}
+
+bool hal_flash_write(uint32_t offset, const void* data, size_t length) {
+  if (!g_flash.data || offset > SIM_FLASH_BYTES || length > SIM_FLASH_BYTES - offset) {
+    return false;
+  }
+  const uint8_t* src = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < length; ++i) g_flash.data[offset + i] &= src[i];
+  return true;
+}
+
+// =======================
+// hal.h — tarefas (disparadas pelo relógio virtual)
+// =======================
+bool hal_timer_task_start(const char*, uint32_t period_us, uint8_t, uint8_t, uint32_t,
+                          HalTaskBody body) {
+  if (!body || period_us == 0) return false;
+  TimerTask task;
+  task.period_us = period_us;
+  task.next_us = g_sim.clock_us + period_us;
+  task.body = body;
+  g_sim.timer_tasks.push_back(task);
+  return true;
+}
+
+bool hal_timer_isr_start(uint32_t period_us, HalIsrBody isr) {
+  if (g_sim.isr_timer.body || !isr || period_us == 0) return false;
+  g_sim.isr_timer.period_us = period_us;
+  g_sim.isr_timer.next_us = g_sim.clock_us + period_us;
+  g_sim.isr_timer.body = isr;
+  return true;
+}
+
+uint32_t hal_isr_micros() {
+  return static_cast<uint32_t>(g_sim.clock_us);
+}
+
+void hal_isr_gpio_write(uint8_t pin, bool level) {
+  hal_gpio_write(pin, level);
+}
+
+uint32_t hal_isr_pwm_duty(uint8_t channel) {
+  return sim_pwm_duty(channel);
+}
+
+void hal_isr_pwm_write(uint8_t channel, uint32_t duty) {
+  hal_pwm_write(channel, duty);
+}
+
+uint32_t hal_isr_gpio_read_bank(uint8_t bank) {
+  uint32_t word = 0;
+  for (int i = 0; i < 32; ++i) {
+    const int pin = bank * 32 + i;
+    if (pin < kNumPins && g_sim.pin_level[pin]) word |= 1u << i;
+  }
+  return word;
+}
+
+bool hal_gpio_isr_attach(uint8_t pin, HalIsrBody isr) {
+  if (!valid_pin(pin) || !isr) return false;
+  g_sim.pin_isr[pin] = isr;
+  return true;
+}
+
+bool hal_loop_task_start(const char*, uint8_t, uint8_t, uint32_t, HalTaskBody body) {
+  if (!body) return false;
+  g_sim.loop_tasks.push_back(body);
+  return true;
+}
+
+void hal_task_end_self() {}
+
+void hal_critical_enter() {}
+
+void hal_critical_exit() {}
+
+// =======================
+// hal.h — Wi-Fi / MQTT (broker em memória)
+// =======================
+void hal_wifi_begin(const char*, const char*) {
+  g_sim.wifi_started = true;
+}
+
+void hal_wifi_disconnect() {
+  g_sim.wifi_started = false;
+}
+
+bool hal_wifi_connected() {
+  return g_sim.wifi_started && g_sim.wifi_available;
+}
+
+int hal_wifi_status() {
+  if (!g_sim.wifi_started) return HAL_WIFI_IDLE;
+  return g_sim.wifi_available ? HAL_WIFI_CONNECTED : HAL_WIFI_NO_SSID_AVAIL;
+}
+
+const char* hal_wifi_local_ip() {
+  return "127.0.0.1";
+}
+
+void hal_mac_address(uint8_t mac[6]) {
+  memcpy(mac, g_sim.mac, sizeof(g_sim.mac));
+}
+
+void hal_mqtt_setup(const char*, int, bool, const char*, HalMqttCallback callback) {
+  g_sim.callback = callback;
+}
+
+bool hal_mqtt_connect_start(const char* client_id, const char* username, const char* password) {
+  if (g_sim.connect_pending) return false;
+  g_sim.mqtt_connected = false;
+  g_sim.mqtt_state = -1;
+  g_sim.connect_pending = true;
+  if (g_tcp.enabled) {
+    g_tcp.client.start_connect(g_tcp.host.c_str(), g_tcp.port, client_id, username, password);
+    return true;
+  }
+  g_sim.connect_done_us = g_sim.clock_us + kConnectLatencyUs;
+  return true;
+}
+
+HalConnectStatus hal_mqtt_connect_poll() {
+  if (!g_sim.connect_pending) return HAL_CONNECT_IDLE;
+
+  bool ok = false;
+  if (g_tcp.enabled) {
+    MqttWireClient::Status status = g_tcp.client.poll_connect();
+    if (status == MqttWireClient::CONNECTING) return HAL_CONNECT_PENDING;
+    ok = status == MqttWireClient::CONNECTED && hal_wifi_connected();
+    g_sim.mqtt_state = g_tcp.client.last_error();
+  } else {
+    if (g_sim.clock_us < g_sim.connect_done_us) return HAL_CONNECT_PENDING;
+    ok = hal_wifi_connected() && broker_up();
+    g_sim.mqtt_state = ok ? 0 : -2;
+  }
+
+  g_sim.connect_pending = false;
+  if (!ok) {
+    if (g_tcp.enabled) g_tcp.client.disconnect();
+    return HAL_CONNECT_FAILED;
+  }
+  g_sim.mqtt_connected = true;
+  g_sim.subscriptions.clear();
+  g_sim.stats.connects++;
+  return HAL_CONNECT_OK;
+}
+
+void hal_mqtt_disconnect() {
+  if (g_tcp.enabled) g_tcp.client.disconnect();
+  drop_session(-1);
+}
+
+bool hal_mqtt_connected() {
+  if (g_sim.connect_pending) return false;
+  if (!hal_wifi_connected()) {
+    drop_session(-3);
+  } else if (g_tcp.enabled) {
+    if (g_sim.mqtt_connected && !g_tcp.client.connected()) drop_session(g_tcp.client.last_error());
+  } else if (!broker_up()) {
+    drop_session(-3);
+  }
+  return g_sim.mqtt_connected;
+}
+
+int hal_mqtt_state() {
+  // Mesma convenção do PubSubClient: 0 conectado, -1 desconectado,
+  // -2 falha de conexão, -3 conexão perdida, -4 timeout
+  return hal_mqtt_connected() ? 0 : g_sim.mqtt_state;
+}
+
+bool hal_mqtt_subscribe(const char* topic) {
+  if (!hal_mqtt_connected()) return false;
+  if (g_tcp.enabled) return g_tcp.client.subscribe(topic);
+  g_sim.subscriptions.insert(topic);
+  return true;
+}
+
+bool hal_mqtt_publish(const char* topic, const uint8_t* payload, size_t length) {
+  if (!hal_mqtt_connected()) return false;
+  uplink_write(strlen(topic) + length + 5);   // + cabeçalho MQTT
+  if (g_tcp.enabled && !g_tcp.client.publish(topic, payload, length)) return false;
+  g_sim.stats.published++;
+  g_sim.stats.published_bytes += length;
+  if (g_sim.publish_hook) {
+    g_sim.publish_hook(topic, payload, length, g_sim.publish_ctx);
+  }
+  return true;
+}
+
+void hal_mqtt_loop() {
+  if (g_tcp.enabled) {
+    if (hal_mqtt_connected()) g_tcp.client.loop(deliver_tcp_message, nullptr);
+    return;
+  }
+  while (hal_mqtt_connected() && !g_sim.inbound.empty()) {
+    InboundMessage msg = g_sim.inbound.front();
+    g_sim.inbound.pop_front();
+    if (!g_sim.callback || g_sim.subscriptions.count(msg.topic) == 0) continue;
+    std::vector<char> topic(msg.topic.begin(), msg.topic.end());
+    topic.push_back('\0');
+    g_sim.stats.delivered++;
+    if (g_sim.receive_hook) {
+      g_sim.receive_hook(topic.data(), msg.payload.data(), msg.payload.size(), g_sim.receive_ctx);
+    }
+    g_sim.callback(topic.data(), msg.payload.data(),
+                   static_cast<unsigned int>(msg.payload.size()));
+  }
+}
@@ -0,0 +1,93 @@
+#include "plant.h"
+
+#include <math.h>
+
+#include "motor_control.h"
+#include "sim.h"
+
+namespace {
+
+// Tensão aplicada pela ponte H: +duty (CW), -duty (CCW), 0 com freio (INA=INB)
+// e corrente nula com enable desligado (motor em roda livre).
+double bridge_voltage(uint8_t pin_a, uint8_t pin_b, uint8_t channel, double supply_v) {
+  bool a = sim_gpio_level(pin_a);
+  bool b = sim_gpio_level(pin_b);
+  double duty = sim_pwm_duty(channel) / 255.0;
+  if (!a && b) return duty * supply_v;
+  if (a && !b) return -duty * supply_v;
+  return 0.0;
+}
+
+}  // namespace
+
+SimPlant::SimPlant()
+    : gear_reduction(Robot::kGearReduction),
+      wheel_radius(Robot::kWheelRadiusM),
+      wheel_base(Robot::kWheelBaseM),
+      pulses_per_rev(Robot::kPulsesPerRev) {}
+
+void SimPlant::step(uint32_t dt_us) {
+  const double dt = dt_us * 1e-6;
+  const uint8_t pins_a[2] = {Robot::kMotorRA, Robot::kMotorLA};
+  const uint8_t pins_b[2] = {Robot::kMotorRB, Robot::kMotorLB};
+  const uint8_t enables[2] = {Robot::kEnableR, Robot::kEnableL};
+  const uint8_t channels[2] = {PWM_CHANNEL_R, PWM_CHANNEL_L};
+  const uint8_t units[2] = {PCNT_UNIT_R, PCNT_UNIT_L};
+
+  for (int i = 0; i < 2; ++i) {
+    const SimMotorParams& p = params[i];
+    SimWheelState& w = wheel[i];
+
+    if (sim_gpio_level(enables[i])) {
+      double v = bridge_voltage(pins_a[i], pins_b[i], channels[i], p.supply_v);
+      w.current = (v - p.ke * w.omega) / p.resistance;
+    } else {
+      w.current = 0.0;
+    }
+
+    double torque = p.kt * w.current - p.friction * w.omega;
+    w.omega += (torque / p.inertia) * dt;
+
+    const double before = w.pulse_accum;
+    const double delta = w.omega * dt / (2.0 * M_PI) * pulses_per_rev;
+    w.pulse_accum += delta;
+    int32_t whole = static_cast<int32_t>(w.pulse_accum);
+    if (whole != 0) {
+      // Instante em que o acumulador cruzou a última borda dentro do passo
+      double fraction = (whole - before) / delta;
+      uint64_t edge_us = sim_clock_us() + static_cast<uint64_t>(fraction * dt_us);
+      w.pulse_accum -= whole;
+      w.pulses += whole;
+      sim_pcnt_add(units[i], whole);
+      sim_encoder_edges(units[i], whole, edge_us);
+    }
+  }
+
+  // Integração exata de arco para a pose de referência
+  double v_r = wheel[MOTOR_R].omega / gear_reduction * wheel_radius;
+  double v_l = wheel[MOTOR_L].omega / gear_reduction * wheel_radius;
+  double v = 0.5 * (v_r + v_l);
+  double w = (v_r - v_l) / wheel_base;
+  double dphi = w * dt;
+  if (fabs(dphi) < 1e-9) {
+    pose.x += v * dt * cos(pose.phi);
+    pose.y += v * dt * sin(pose.phi);
+  } else {
+    double r = v / w;
+    pose.x += r * (sin(pose.phi + dphi) - sin(pose.phi));
+    pose.y -= r * (cos(pose.phi + dphi) - cos(pose.phi));
+  }
+  pose.phi = remainder(pose.phi + dphi, 2.0 * M_PI);
+}
+
+static void plant_hook(uint32_t dt_us, void* ctx) {
+  static_cast<SimPlant*>(ctx)->step(dt_us);
+}
+
+void SimPlant::attach(uint32_t max_step_us) {
+  sim_set_plant_hook(plant_hook, this, max_step_us);
+}
+
+void SimPlant::detach() {
+  sim_set_plant_hook(nullptr, nullptr, 0);
+}
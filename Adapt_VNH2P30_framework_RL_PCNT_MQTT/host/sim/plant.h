@@ -0,0 +1,56 @@
+#pragma once
+
+// Planta simulada do robô diferencial: dois motores DC com ponte H VNH2SP30,
+// redução, encoder de quadratura no eixo do motor e pose "verdadeira"
+// integrada de forma exata. Lê direção/PWM/enable dos periféricos simulados
+// e devolve pulsos ao PCNT simulado.
+
+#include <stdint.h>
+
+#include "robot_config.h"
+
+struct SimMotorParams {
+  double supply_v = 12.0;        // tensão da bateria (V)
+  double resistance = 2.0;       // resistência de armadura (ohm)
+  // Constantes de FEM (V·s/rad) e de torque (N·m/A) da velocidade em vazio
+  // da variante (Robot::kMotorFreeSpeedRadS a 12 V)
+  double ke = 12.0 / Robot::kMotorFreeSpeedRadS;
+  double kt = 12.0 / Robot::kMotorFreeSpeedRadS;
+  double inertia = 3.6e-5;       // inércia refletida no eixo do motor (kg·m²)
+  double friction = 2.0e-6;      // atrito viscoso (N·m·s/rad)
+};
+
+struct SimWheelState {
+  double omega = 0.0;            // velocidade do eixo do motor (rad/s)
+  double current = 0.0;          // corrente de armadura (A)
+  double pulse_accum = 0.0;      // fração de pulso ainda não entregue ao PCNT
+  int64_t pulses = 0;            // total de pulsos gerados
+};
+
+struct SimPose {
+  double x = 0.0;
+  double y = 0.0;
+  double phi = 0.0;
+};
+
+class SimPlant {
+ public:
+  SimPlant();
+
+  // Avança a planta dt_us microssegundos usando as saídas atuais dos
+  // periféricos simulados; não mexe no relógio.
+  void step(uint32_t dt_us);
+
+  // Registra a planta no relógio simulado: daqui em diante toda chamada a
+  // sim_clock_advance_us()/hal_delay_ms() também a integra.
+  void attach(uint32_t max_step_us);
+  void detach();
+
+  SimMotorParams params[2];
+  SimWheelState wheel[2];        // índices MOTOR_R / MOTOR_L
+  SimPose pose;                  // pose verdadeira (referência)
+  double gear_reduction;
+  double wheel_radius;
+  double wheel_base;
+  double pulses_per_rev;
+};
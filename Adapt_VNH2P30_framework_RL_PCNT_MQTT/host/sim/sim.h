@@ -0,0 +1,106 @@
+#pragma once
+
+// Controle dos periféricos simulados que implementam hal.h no build nativo.
+// O relógio é virtual: só avança por sim_clock_advance_us() ou hal_delay_ms(),
+// o que permite rodar o loop de controle muito mais rápido que o tempo real.
+// Ao avançar, o relógio passo a passo integra a planta registrada e dispara
+// as tarefas de timer (hal_timer_task_start) nos seus instantes exatos —
+// inclusive durante um hal_delay_ms() bloqueante da tarefa de rede.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Restaura relógio, GPIO, PWM, PCNT, tarefas e broker simulado ao estado
+// inicial (mantém o hook de publicação).
+void sim_reset();
+
+// --------- Relógio ---------
+uint64_t sim_clock_us();
+void sim_clock_advance_us(uint64_t dt_us);
+
+// Planta física avançada junto com o relógio em passos de no máximo
+// max_step_us. Passar nullptr remove a planta.
+typedef void (*SimPlantHook)(uint32_t dt_us, void* ctx);
+void sim_set_plant_hook(SimPlantHook hook, void* ctx, uint32_t max_step_us);
+
+// --------- Tarefas ---------
+// Executa uma vez cada tarefa registrada com hal_loop_task_start().
+void sim_run_loop_tasks();
+
+// Tarefas de timer travadas em [from_us, to_us) do relógio virtual: o timer
+// dispara mas body() não roda, como uma tarefa presa em outro ponto. Os ISRs
+// de hal_timer_isr_start continuam disparando.
+void sim_timer_tasks_stall(uint64_t from_us, uint64_t to_us);
+
+// --------- GPIO ---------
+bool sim_gpio_level(uint8_t pin);
+// Força o nível de um pino de entrada (botões); se o nível muda, chama na
+// hora o ISR do pino (hal_gpio_isr_attach), como uma borda.
+void sim_gpio_set_input(uint8_t pin, bool level);
+
+// --------- PWM ---------
+uint32_t sim_pwm_duty(uint8_t channel);
+
+// --------- PCNT ---------
+// Soma pulsos na unidade respeitando h_lim/l_lim (o contador volta a zero
+// ao atingir o limite, como no periférico real).
+void sim_pcnt_add(uint8_t unit, int32_t pulses);
+// Atrasa a interrupção de limite até o passo do relógio seguinte à próxima
+// leitura (hal_pcnt_total), que assim sempre vê o contador já zerado sem o
+// acumulador atualizado.
+void sim_pcnt_defer_events(bool deferred);
+// Bordas para a captura do encoder (hal_edge_capture_*): quantidade com
+// sinal e instante da última, no relógio virtual.
+void sim_encoder_edges(uint8_t unit, int32_t edges, uint64_t last_edge_us);
+
+// --------- Flash (partição odomlog) ---------
+// Partição de SIM_FLASH_BYTES com semântica de NOR (escrever só zera bits).
+// Em memória (padrão) sim_reset() a apaga; num arquivo (criado com 0xFF se
+// faltar e mapeado com mmap) o conteúdo sobrevive a sim_reset() e entre
+// execuções, como a flash depois de um reboot. path = nullptr volta à memória.
+#define SIM_FLASH_BYTES (256u * 1024u)   // igual ao partitions.csv
+void sim_flash_use_file(const char* path);
+// Apagamentos do setor desde sim_flash_use_file() (ou sim_reset(), em memória)
+uint32_t sim_flash_erase_count(uint32_t sector);
+
+// --------- Wi-Fi / broker ---------
+typedef void (*SimPublishHook)(const char* topic, const uint8_t* payload, size_t length,
+                               void* ctx);
+
+// MAC devolvido por hal_mac_address() (id do robô na frota); sim_reset()
+// volta ao padrão 24:0a:c4:00:00:01
+void sim_set_mac(const uint8_t mac[6]);
+void sim_wifi_set_available(bool available);
+// Broker fora do ar derruba a sessão atual e recusa novas conexões.
+void sim_broker_set_available(bool available);
+// Derruba só a sessão atual (o broker continua aceitando conexões).
+void sim_broker_drop_connection();
+// Agenda uma queda do broker em [from_us, to_us) do relógio virtual; vale
+// mesmo enquanto a tarefa de rede está presa em um hal_delay_ms().
+void sim_broker_schedule_outage(uint64_t from_us, uint64_t to_us);
+// Troca o broker em memória por um broker MQTT real via TCP (sem TLS), com
+// o cliente não bloqueante de host/net. host = nullptr volta ao broker em
+// memória. O relógio continua virtual; os timeouts do socket são de parede.
+void sim_net_use_tcp_broker(const char* host, int port);
+void sim_mqtt_set_publish_hook(SimPublishHook hook, void* ctx);
+// Chamado com cada mensagem entregue ao firmware, logo antes do callback
+void sim_mqtt_set_receive_hook(SimPublishHook hook, void* ctx);
+// Uplink lento: cada publish entra num buffer de envio de buffer_bytes que
+// esvazia a bytes_per_s e, se não couber, bloqueia avançando o relógio (com
+// as tarefas de timer), como o write num socket TCP cheio. O hook de
+// publicação vê a mensagem quando o publish retorna. 0 = sem limite (padrão,
+// e o de sim_reset()).
+void sim_mqtt_set_uplink(uint32_t bytes_per_s, uint32_t buffer_bytes);
+// Enfileira uma mensagem do broker; é entregue ao callback no próximo
+// hal_mqtt_loop() se o tópico estiver inscrito.
+bool sim_mqtt_inject(const char* topic, const uint8_t* payload, size_t length);
+bool sim_mqtt_inject(const char* topic, const char* payload);
+
+struct SimMqttStats {
+  uint32_t connects;
+  uint32_t published;
+  uint64_t published_bytes;
+  uint32_t delivered;
+};
+
+SimMqttStats sim_mqtt_stats();
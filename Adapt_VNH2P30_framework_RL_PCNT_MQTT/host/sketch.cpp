@@ -0,0 +1,2 @@
+// Compila o sketch Arduino (setup()/loop()) sem alterações no build nativo.
+#include "../Adapt_VNH2P30_framework_RL_PCNT_MQTT.ino"
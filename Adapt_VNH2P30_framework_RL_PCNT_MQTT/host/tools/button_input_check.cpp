@@ -0,0 +1,320 @@
+// Confere os botões por interrupção (button_input.h) com o firmware inteiro
+// no simulador: --presses pressionamentos sorteados entre os quatro botões,
+// um de cada vez, cada borda com até --max-bounces repiques em --bounce-ms.
+// Uma parte (--tap-pct) é de toques de até 40 ms, mais curtos que o ciclo de
+// controle; o resto fica 150..600 ms pressionado. Os repiques da soltura de
+// um toque mais curto que a janela de debounce caem dentro dela e só o poll
+// fecha o evento (late).
+//
+// A cada ciclo de controle a ferramenta lê o estado usado (estado_botoes) e,
+// para comparar, o que a leitura antiga por digitalRead() teria visto no
+// mesmo instante (os pinos crus, mesma prioridade). Mostra por
+// pressionamento o erro do instante conhecido pelo firmware (o carimbo da
+// borda; antes, só o ciclo que leu o pino), a latência da borda até o ciclo
+// que usou o botão e quantos toques cada leitura perdeu.
+//
+// Sai com código 1 se algum pressionamento não gerar exatamente um evento de
+// pressionar e um de soltar, um carimbo não for o da primeira borda, um
+// toque se perder, a latência passar de um período de controle ou um ciclo
+// usar um botão que não está pressionado.
+//
+// Uso: button_input_check [--presses N] [--tap-pct P] [--bounce-ms MS]
+//                         [--max-bounces N] [--seed S] [--record ARQUIVO]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "button_input.h"
+#include "control_task.h"
+#include "motor_control.h"
+#include "plant.h"
+#include "sim.h"
+
+void setup();
+extern int botao_frente;
+extern int botao_re;
+extern int botao_esquerda;
+extern int botao_direita;
+extern int estado_botoes;
+
+namespace {
+
+int g_failures = 0;
+
+void check(bool ok, const char* what) {
+  printf("  %-58s %s\n", what, ok ? "ok" : "FALHOU");
+  if (!ok) g_failures++;
+}
+
+const uint64_t kStepUs = 1000;
+
+struct Options {
+  int presses = 300;
+  int tap_pct = 25;
+  uint32_t bounce_ms = 5;
+  int max_bounces = 6;
+  uint32_t seed = 1;
+  FILE* record = nullptr;
+};
+
+struct Edge {
+  uint64_t t_us;
+  uint8_t pin;
+  bool level;
+};
+
+struct Press {
+  uint8_t button;       // 0..3, ordem de prioridade do sketch
+  uint64_t down_us;     // primeira borda ao pressionar
+  uint64_t up_us;       // primeira borda ao soltar
+  bool tap;
+  long new_first_cycle_us = -1;
+  long old_first_cycle_us = -1;
+  long stamp_error_us = -1;   // carimbo do firmware - down_us
+};
+
+uint32_t g_rng = 1;
+
+uint32_t rnd(uint32_t lo, uint32_t hi) {
+  g_rng = g_rng * 1664525u + 1013904223u;
+  return lo + (g_rng >> 8) % (hi - lo + 1);
+}
+
+void on_publish(const char* topic, const uint8_t* payload, size_t length, void* ctx) {
+  FILE* record = static_cast<FILE*>(ctx);
+  if (record && strcmp(topic, "robot/session") == 0) {
+    fwrite(payload, 1, length, record);
+  }
+}
+
+// Borda com repiques: o nível final é `level`, a primeira borda em t.
+// Devolve o instante da última.
+uint64_t bounce(std::vector<Edge>& edges, uint64_t t, uint8_t pin, bool level, const Options& opt) {
+  edges.push_back({t, pin, level});
+  const uint32_t n = rnd(0, opt.max_bounces);
+  // 2n bordas alternadas, cada uma num pedaço de bounce_ms
+  const uint32_t slot = opt.bounce_ms * 1000 / (2 * n + 1);
+  for (uint32_t k = 1; k <= 2 * n && slot > 1; ++k) {
+    edges.push_back({t + k * slot + rnd(0, slot / 2), pin, (k % 2) ? !level : level});
+  }
+  return edges.back().t_us;
+}
+
+uint32_t cycle_seq() {
+  OdometrySample s;
+  return odometry_latest_sample(s) ? s.seq : 0;
+}
+
+int code_of(bool a, bool b, bool c, bool d) {
+  return a ? 1 : b ? 2 : c ? 3 : d ? 4 : 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  const char* record_path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--presses") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+      opt.presses = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--tap-pct") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0 &&
+               atoi(argv[i + 1]) <= 100) {
+      opt.tap_pct = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--bounce-ms") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0 &&
+               atoi(argv[i + 1]) * 1000 < BUTTON_DEBOUNCE_US) {
+      opt.bounce_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--max-bounces") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0) {
+      opt.max_bounces = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      opt.seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else {
+      fprintf(stderr,
+              "uso: %s [--presses N] [--tap-pct P] [--bounce-ms MS] [--max-bounces N] "
+              "[--seed S] [--record ARQUIVO]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (record_path) {
+    opt.record = fopen(record_path, "wb");
+    if (!opt.record) {
+      fprintf(stderr, "nao consegui criar %s\n", record_path);
+      return 1;
+    }
+  }
+  g_rng = opt.seed ? opt.seed : 1;
+
+  sim_reset();
+  sim_mqtt_set_publish_hook(on_publish, opt.record);
+  SimPlant plant;
+  plant.attach(100);
+  setup();
+
+  const uint8_t pins[4] = {static_cast<uint8_t>(botao_frente), static_cast<uint8_t>(botao_re),
+                           static_cast<uint8_t>(botao_esquerda),
+                           static_cast<uint8_t>(botao_direita)};
+
+  // Roteiro: um botão por vez, com folga entre eles maior que um ciclo
+  std::vector<Press> presses;
+  std::vector<Edge> edges;
+  uint64_t t = sim_clock_us() + 1000000 + rnd(0, 49999);
+  int short_taps = 0;
+  for (int i = 0; i < opt.presses; ++i) {
+    Press p;
+    p.button = static_cast<uint8_t>(rnd(0, 3));
+    p.tap = static_cast<int>(rnd(0, 99)) < opt.tap_pct;
+    p.down_us = t;
+    p.up_us = t + (p.tap ? rnd(opt.bounce_ms * 1000 + 1000, 40000) : rnd(150000, 600000));
+    bounce(edges, p.down_us, pins[p.button], true, opt);
+    // Todas as bordas da soltura dentro da janela: nenhuma interrupção a fecha
+    if (bounce(edges, p.up_us, pins[p.button], false, opt) - p.down_us < BUTTON_DEBOUNCE_US) {
+      short_taps++;
+    }
+    presses.push_back(p);
+    t = p.up_us + rnd(100000, 400000);
+  }
+  std::stable_sort(edges.begin(), edges.end(),
+                   [](const Edge& a, const Edge& b) { return a.t_us < b.t_us; });
+  const uint64_t end_us = t + 200000;
+  const uint64_t period_us = CONTROL_PERIOD_US;
+
+  const ButtonInputStats before = button_input_stats();
+  size_t next_edge = 0;
+  size_t current = 0;   // pressionamento mais recente já começado
+  bool started = false;
+  uint32_t seq = cycle_seq();
+  unsigned long cycles = 0;
+  unsigned long wrong_cycles = 0;   // botão usado sem estar pressionado
+  uint32_t checked_press_us = 0xFFFFFFFFu;
+  while (sim_clock_us() < end_us) {
+    uint64_t target = sim_clock_us() + kStepUs;
+    if (next_edge < edges.size() && edges[next_edge].t_us < target) {
+      target = edges[next_edge].t_us;
+    }
+    sim_clock_advance_us(target - sim_clock_us());
+    sim_run_loop_tasks();
+
+    // Um ciclo de controle rodou neste passo: nenhuma borda desde então
+    const uint32_t now_seq = cycle_seq();
+    if (now_seq != seq) {
+      seq = now_seq;
+      cycles++;
+      const uint64_t now = sim_clock_us();
+      const int old_code = code_of(sim_gpio_level(pins[0]), sim_gpio_level(pins[1]),
+                                   sim_gpio_level(pins[2]), sim_gpio_level(pins[3]));
+      if (started) {
+        Press& p = presses[current];
+        const int want = p.button + 1;
+        // Vale até um ciclo depois da soltura (toque mais curto que o ciclo)
+        const bool window = now >= p.down_us && now < p.up_us + period_us;
+        if (estado_botoes == want && window) {
+          if (p.new_first_cycle_us < 0) {
+            p.new_first_cycle_us = static_cast<long>(now - p.down_us);
+          }
+        } else if (estado_botoes != 0) {
+          wrong_cycles++;
+        }
+        if (old_code == want && window && p.old_first_cycle_us < 0) {
+          p.old_first_cycle_us = static_cast<long>(now - p.down_us);
+        }
+        ButtonEvent ev;
+        if (button_input_last_press(ev) && ev.t_us != checked_press_us &&
+            ev.button == p.button) {
+          checked_press_us = ev.t_us;
+          p.stamp_error_us =
+              static_cast<long>(static_cast<uint32_t>(ev.t_us - static_cast<uint32_t>(p.down_us)));
+        }
+      } else if (estado_botoes != 0) {
+        wrong_cycles++;
+      }
+    }
+
+    while (next_edge < edges.size() && edges[next_edge].t_us <= sim_clock_us()) {
+      const Edge& e = edges[next_edge++];
+      sim_gpio_set_input(e.pin, e.level);
+      if (e.level && started && current + 1 < presses.size() &&
+          presses[current + 1].down_us == e.t_us) {
+        current++;
+      } else if (e.level && !started && presses[0].down_us == e.t_us) {
+        started = true;
+      }
+    }
+  }
+  const ButtonInputStats stats = button_input_stats();
+
+  // Resumo por pressionamento
+  int new_missed = 0, old_missed = 0, taps = 0, old_taps_missed = 0, stamped = 0, stamp_exact = 0;
+  long latency_max = 0, latency_sum = 0, old_error_max = 0, old_error_sum = 0;
+  long stamp_error_max = 0, stamp_error_sum = 0;
+  int latency_n = 0, old_n = 0;
+  for (const Press& p : presses) {
+    if (p.tap) taps++;
+    if (p.new_first_cycle_us < 0) {
+      new_missed++;
+    } else {
+      latency_max = std::max(latency_max, p.new_first_cycle_us);
+      latency_sum += p.new_first_cycle_us;
+      latency_n++;
+    }
+    if (p.old_first_cycle_us < 0) {
+      old_missed++;
+      if (p.tap) old_taps_missed++;
+    } else {
+      old_error_max = std::max(old_error_max, p.old_first_cycle_us);
+      old_error_sum += p.old_first_cycle_us;
+      old_n++;
+    }
+    if (p.stamp_error_us >= 0) {
+      stamped++;
+      if (p.stamp_error_us == 0) stamp_exact++;
+      stamp_error_max = std::max(stamp_error_max, p.stamp_error_us);
+      stamp_error_sum += p.stamp_error_us;
+    }
+  }
+
+  const uint32_t edges_seen = stats.edges - before.edges;
+  const uint32_t events = stats.events - before.events;
+  printf("%d pressionamentos (%d toques, %d soltos dentro do debounce de %u ms), %lu ciclos\n",
+         opt.presses, taps, short_taps, BUTTON_DEBOUNCE_US / 1000, cycles);
+  printf("bordas: %zu roteiro, %u no ISR, %u repiques ignorados, %u eventos (%u late), "
+         "%u descartados\n",
+         edges.size(), edges_seen, stats.bounces - before.bounces, events,
+         stats.late - before.late, stats.dropped - before.dropped);
+  printf("%-34s %12s %12s\n", "", "leitura", "interrupcao");
+  printf("%-34s %12d %12d\n", "pressionamentos perdidos", old_missed, new_missed);
+  printf("%-34s %12d %12d\n", "  toques perdidos", old_taps_missed, new_missed);
+  printf("%-34s %12.2f %12.2f\n", "erro do instante, medio (ms)",
+         old_n ? old_error_sum * 1e-3 / old_n : 0.0,
+         stamped ? stamp_error_sum * 1e-3 / stamped : 0.0);
+  printf("%-34s %12.2f %12.2f\n", "erro do instante, max (ms)", old_error_max * 1e-3,
+         stamp_error_max * 1e-3);
+  printf("borda -> ciclo que usou o botao: media %.2f ms, max %.2f ms "
+         "(button_latency_max_us %u)\n",
+         latency_n ? latency_sum * 1e-3 / latency_n : 0.0, latency_max * 1e-3,
+         stats.latency_max_us);
+
+  check(edges_seen == edges.size(), "uma interrupcao por borda");
+  check(events == 2u * static_cast<uint32_t>(opt.presses) && stats.dropped == before.dropped,
+        "um evento ao pressionar e um ao soltar, sem repique");
+  check(stats.late - before.late == static_cast<uint32_t>(short_taps),
+        "soltura dentro da janela fechada pelo poll (late)");
+  check(stats.presses - before.presses == static_cast<uint32_t>(opt.presses),
+        "todo pressionamento consumido pelo controle");
+  check(stamped > 0 && stamp_exact == stamped, "carimbo = instante da primeira borda");
+  check(new_missed == 0, "nenhum toque perdido");
+  // A ferramenta vê o ciclo no fim do passo (até kStepUs depois)
+  check(latency_max <= static_cast<long>(period_us + kStepUs) &&
+            stats.latency_max_us <= static_cast<uint32_t>(period_us),
+        "latencia ate o ciclo <= um periodo de controle");
+  check(wrong_cycles == 0, "nenhum ciclo com botao fantasma");
+
+  if (opt.record) fclose(opt.record);
+  printf(g_failures ? "FALHOU\n" : "ok\n");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,374 @@
+// Confere o aceite de comandos com sequência (command_gate.h) com o firmware
+// inteiro numa rede ruim simulada entre o remetente e o robô: cada comando
+// yaw|pitch|nonce|t0|seq|max_age_ms sai a --rate-hz, leva 30..50 ms e, com
+// probabilidade --late-pct, mais 100..800 ms (broker na nuvem segurando a
+// mensagem). Os atrasados chegam depois de mais novos: fora de ordem. A cada
+// --stall-every-s o link trava 300..900 ms e tudo o que saiu nesse tempo
+// chega junto no fim, em ordem mas velho.
+//
+// Para cada comando o pong diz ok, stale ou reordered. A ferramenta refaz a
+// conta do lado de fora (atraso além do menor visto, maior seq já
+// entregue) e mostra o que teria movido o robô sem o aceite: comandos
+// velhos e fora de ordem e o maior atraso executado. Depois para o
+// remetente por 4 s e recomeça a contagem do seq em 1 (remetente
+// reiniciado), que tem de voltar a valer, e manda uma sequência curta em que
+// um comando recusado por idade vem antes de outros em ordem. Por fim, o
+// mesmo no tópico de twist direto (v|w|seq|t0[|max_age_ms], gate próprio):
+// em ordem, fora de ordem, preso na rede e um "v|w" sem sequência.
+//
+// Sai com código 1 se algum comando ficar sem pong, um aceito vier fora de
+// ordem ou passar da idade máxima (com 10 ms de folga para a janela do
+// mínimo), um recusado não merecer, os contadores de robot/cmd/stats não
+// fecharem, o reinício não for aceito, um comando recusado por idade fizer
+// os seguintes, em ordem, parecerem fora de ordem ou um twist velho ou fora
+// de ordem mover o robô.
+//
+// Uso: command_gate_check [--seconds S] [--rate-hz R] [--late-pct P]
+//                         [--stall-every-s S] [--max-age-ms MS] [--seed N]
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "mqtt_client.h"
+#include "plant.h"
+#include "sim.h"
+
+void setup();
+
+namespace {
+
+int g_failures = 0;
+
+void check(bool ok, const char* what) {
+  printf("  %-58s %s\n", what, ok ? "ok" : "FALHOU");
+  if (!ok) g_failures++;
+}
+
+const uint64_t kSenderEpochMs = 1700000000000ull;   // t0 como Date.now()
+const uint32_t kToleranceMs = 10;
+
+struct Command {
+  uint32_t seq;
+  uint64_t sent_us;
+  uint64_t delivered_us = 0;
+  unsigned order = 0;          // ordem de entrega (vários no mesmo passo)
+  uint32_t extra_ms = 0;       // atraso além do menor entregue até ele
+  bool behind = false;         // seq <= maior já entregue
+  bool out_of_order = false;   // seq <= maior já aceita (pelos pongs)
+  std::string status;
+};
+
+struct Capture {
+  std::map<std::string, Command> commands;   // nonce
+  unsigned delivered = 0;
+  unsigned long cmd_stats = 0;
+  std::string last_cmd_stats;
+};
+
+void on_publish(const char* topic, const uint8_t* payload, size_t length, void* ctx) {
+  Capture& c = *static_cast<Capture*>(ctx);
+  const std::string text(reinterpret_cast<const char*>(payload), length);
+  if (strcmp(topic, "facemesh/pong") == 0) {
+    const size_t bar = text.find('|');
+    auto it = c.commands.find(text.substr(0, bar));
+    // Twist direto: a cabeça é seq|t0
+    if (it == c.commands.end()) it = c.commands.find("t" + text.substr(0, bar));
+    if (it == c.commands.end()) return;
+    // nonce|t0|executed_at|yaw|pitch|acao|status|...
+    size_t pos = 0;
+    for (int i = 0; i < 6 && pos != std::string::npos; ++i) pos = text.find('|', pos + 1);
+    if (pos == std::string::npos) return;
+    it->second.status = text.substr(pos + 1, text.find('|', pos + 1) - pos - 1);
+  } else if (strcmp(topic, "robot/cmd/stats") == 0) {
+    c.cmd_stats++;
+    c.last_cmd_stats = text;
+  }
+}
+
+struct Network {
+  double late_pct;
+  uint64_t stall_every_us;   // 0: sem travadas
+};
+
+struct Scheduled {
+  std::string nonce;
+  std::string payload;
+  const char* topic;
+};
+
+void run_sim_until(uint64_t until_us, std::multimap<uint64_t, Scheduled>& wire, Capture& capture) {
+  while (sim_clock_us() < until_us) {
+    while (!wire.empty() && wire.begin()->first <= sim_clock_us()) {
+      Command& cmd = capture.commands[wire.begin()->second.nonce];
+      cmd.delivered_us = sim_clock_us();
+      cmd.order = ++capture.delivered;
+      sim_mqtt_inject(wire.begin()->second.topic, wire.begin()->second.payload.c_str());
+      wire.erase(wire.begin());
+    }
+    sim_clock_advance_us(200);
+    sim_run_loop_tasks();
+  }
+}
+
+// Um comando na rede: sai em sent_us, chega em deliver_us
+void send_one(std::multimap<uint64_t, Scheduled>& wire, Capture& capture, const char* nonce,
+              uint32_t seq, uint64_t sent_us, uint64_t deliver_us, uint32_t max_age_ms) {
+  char payload[96];
+  snprintf(payload, sizeof(payload), "0|%s|%s|%" PRIu64 "|%u|%u", seq % 4 < 2 ? "-20" : "0",
+           nonce, kSenderEpochMs + sent_us / 1000, seq, max_age_ms);
+  Command cmd;
+  cmd.seq = seq;
+  cmd.sent_us = sent_us;
+  capture.commands[nonce] = cmd;
+  wire.insert(std::make_pair(deliver_us, Scheduled{nonce, payload, "facemesh/cmd"}));
+}
+
+// Twist direto com sequência; chave "t" + seq, como a cabeça do pong
+void send_twist(std::multimap<uint64_t, Scheduled>& wire, Capture& capture, uint32_t seq,
+                uint64_t sent_us, uint64_t deliver_us) {
+  char payload[96];
+  snprintf(payload, sizeof(payload), "0.10|0.00|%u|%" PRIu64, seq,
+           kSenderEpochMs + sent_us / 1000);
+  const std::string key = "t" + std::to_string(seq);
+  Command cmd;
+  cmd.seq = seq;
+  cmd.sent_us = sent_us;
+  capture.commands[key] = cmd;
+  wire.insert(std::make_pair(deliver_us, Scheduled{key, payload, "robot/cmd_vel"}));
+}
+
+// Envia n comandos a partir de first_seq, um a cada period_us, com atraso
+// aleatório; o nonce é tag + seq
+void send(std::multimap<uint64_t, Scheduled>& wire, Capture& capture, uint64_t start_us,
+          uint64_t period_us, char tag, uint32_t first_seq, unsigned n, const Network& net,
+          uint32_t max_age_ms, std::mt19937& rng) {
+  std::uniform_int_distribution<int> base_ms(30, 50);
+  std::uniform_int_distribution<int> late_ms(100, 800);
+  std::uniform_int_distribution<int> stall_ms(300, 900);
+  std::uniform_real_distribution<double> coin(0.0, 100.0);
+  uint64_t stall_start = start_us + net.stall_every_us / 2;
+  uint64_t stall_end = stall_start + stall_ms(rng) * 1000ull;
+  for (unsigned i = 0; i < n; ++i) {
+    const uint32_t seq = first_seq + i;
+    const uint64_t sent_us = start_us + i * period_us;
+    uint64_t deliver_us = sent_us + base_ms(rng) * 1000ull;
+    if (coin(rng) < net.late_pct) deliver_us += late_ms(rng) * 1000ull;
+    if (net.stall_every_us && sent_us >= stall_end) {
+      stall_start += net.stall_every_us;
+      stall_end = stall_start + stall_ms(rng) * 1000ull;
+    }
+    if (net.stall_every_us && sent_us >= stall_start) {
+      const uint64_t released_us = stall_end + base_ms(rng) * 1000ull;
+      if (released_us > deliver_us) deliver_us = released_us;
+    }
+    char nonce[24];
+    snprintf(nonce, sizeof(nonce), "%c%u", tag, seq);
+    send_one(wire, capture, nonce, seq, sent_us, deliver_us, max_age_ms);
+  }
+}
+
+// Atraso além do menor visto e ordem, na ordem de entrega. Fora de ordem é
+// contra a maior seq aceita (o gate ignora as recusadas), e a ferramenta
+// confere a ordem dos aceitos pelos pongs.
+void classify(Capture& capture, char tag) {
+  std::vector<Command*> delivered;
+  for (auto& kv : capture.commands) {
+    if (kv.second.delivered_us && kv.first[0] == tag) {
+      delivered.push_back(&kv.second);
+    }
+  }
+  std::sort(delivered.begin(), delivered.end(), [](const Command* a, const Command* b) {
+    return a->order < b->order;
+  });
+  uint64_t min_delay_us = UINT64_MAX;
+  uint32_t max_seq = 0;
+  uint32_t max_accepted = 0;
+  bool any = false;
+  bool any_accepted = false;
+  for (Command* cmd : delivered) {
+    const uint64_t delay = cmd->delivered_us - cmd->sent_us;
+    min_delay_us = std::min(min_delay_us, delay);
+    cmd->extra_ms = static_cast<uint32_t>((delay - min_delay_us) / 1000);
+    cmd->behind = any && cmd->seq <= max_seq;
+    max_seq = any ? std::max(max_seq, cmd->seq) : cmd->seq;
+    any = true;
+    cmd->out_of_order = any_accepted && cmd->seq <= max_accepted;
+    if (cmd->status == "ok") {
+      max_accepted = any_accepted ? std::max(max_accepted, cmd->seq) : cmd->seq;
+      any_accepted = true;
+    }
+  }
+}
+
+unsigned long json_field(const std::string& json, const char* name) {
+  const std::string key = std::string("\"") + name + "\":";
+  const size_t pos = json.find(key);
+  return pos == std::string::npos ? 0 : strtoul(json.c_str() + pos + key.size(), nullptr, 10);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double seconds = 60.0;
+  double rate_hz = 20.0;
+  Network net = {15.0, 5000000};
+  uint32_t max_age_ms = 250;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+      seconds = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--rate-hz") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+      rate_hz = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--late-pct") == 0 && i + 1 < argc && atof(argv[i + 1]) >= 0) {
+      net.late_pct = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--stall-every-s") == 0 && i + 1 < argc &&
+               atof(argv[i + 1]) >= 0) {
+      net.stall_every_us = static_cast<uint64_t>(atof(argv[++i]) * 1e6);
+    } else if (strcmp(argv[i], "--max-age-ms") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+      max_age_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+    } else {
+      fprintf(stderr,
+              "uso: %s [--seconds S] [--rate-hz R] [--late-pct P] [--stall-every-s S] "
+              "[--max-age-ms MS] [--seed N]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  Capture capture;
+  std::multimap<uint64_t, Scheduled> wire;
+  std::mt19937 rng(seed);
+  sim_reset();
+  sim_mqtt_set_publish_hook(on_publish, &capture);
+  SimPlant plant;
+  plant.attach(100);
+  setup();
+  run_sim_until(sim_clock_us() + 2000000, wire, capture);   // conecta
+
+  const uint64_t period_us = static_cast<uint64_t>(1e6 / rate_hz);
+  const unsigned n = static_cast<unsigned>(seconds * rate_hz);
+  printf("%u comandos a %.0f Hz, %.0f%% atrasados 100..800 ms, travada a cada %.1f s, "
+         "idade maxima %u ms\n",
+         n, rate_hz, net.late_pct, net.stall_every_us * 1e-6, max_age_ms);
+  send(wire, capture, sim_clock_us(), period_us, 'g', 1, n, net, max_age_ms, rng);
+  run_sim_until(sim_clock_us() + static_cast<uint64_t>(seconds * 1e6) + 2000000, wire, capture);
+  classify(capture, 'g');
+  const CommandGateStats first = net_command_gate_stats();
+
+  // Remetente reiniciado: 4 s parado e seq de novo a partir de 1, sem atraso
+  const uint64_t restart_us = sim_clock_us() + 4000000;
+  send(wire, capture, restart_us, period_us, 'r', 1, 20, Network{0.0, 0}, max_age_ms, rng);
+  run_sim_until(restart_us + 20 * period_us + 200000, wire, capture);
+
+  // Velho e depois em ordem (última aceita: r20, bem menos de 3 s antes, sem
+  // resync). Um recusado por idade não pode avançar a sequência:
+  //   s21a  seq 21 preso 600 ms na rede: stale
+  //   s21b  o mesmo seq 21 reenviado na hora: ok
+  //   s23   seq 23 com max_age_ms 20, 150 ms na rede: stale
+  //   s22   seq 22, saiu antes do 23 e chega depois, dentro dos 250 ms: ok
+  //   s24   seq 24 na hora: ok
+  const uint64_t t = sim_clock_us() + 100000;
+  send_one(wire, capture, "s21a", 21, t, t + 600000, max_age_ms);
+  send_one(wire, capture, "s21b", 21, t + 600000, t + 640000, max_age_ms);
+  send_one(wire, capture, "s22", 22, t + 790000, t + 960000, max_age_ms);
+  send_one(wire, capture, "s23", 23, t + 800000, t + 950000, 20);
+  send_one(wire, capture, "s24", 24, t + 1100000, t + 1140000, max_age_ms);
+  run_sim_until(t + 1140000 + 7000000, wire, capture);
+
+  // Twist direto (gate próprio, seq começa em 1):
+  //   t1, t3  em ordem: ok
+  //   t2      saiu antes do 3 e chega depois: reordered
+  //   t4      preso 600 ms na rede: stale
+  //   t5      na hora: ok
+  //   "v|w"   sem sequência: passa sem pong (unsequenced)
+  const uint64_t tw = sim_clock_us() + 100000;
+  send_twist(wire, capture, 1, tw, tw + 40000);
+  send_twist(wire, capture, 2, tw + 100000, tw + 300000);
+  send_twist(wire, capture, 3, tw + 150000, tw + 190000);
+  send_twist(wire, capture, 4, tw + 400000, tw + 1000000);
+  send_twist(wire, capture, 5, tw + 1100000, tw + 1140000);
+  wire.insert(std::make_pair(tw + 1300000, Scheduled{"tplain", "0|0", "robot/cmd_vel"}));
+  run_sim_until(tw + 1300000 + 6000000, wire, capture);
+  const CommandGateStats twist_stats = net_twist_gate_stats();
+  sim_mqtt_set_publish_hook(nullptr, nullptr);
+
+  unsigned long unanswered = 0, accepted = 0, stale = 0, reordered = 0;
+  unsigned long bad_accept = 0, bad_reject = 0;
+  unsigned long would_stale = 0, would_reorder = 0;
+  uint32_t max_extra_all = 0, max_extra_accepted = 0;
+  unsigned long restart_ok = 0;
+  for (const auto& kv : capture.commands) {
+    const Command& cmd = kv.second;
+    if (kv.first[0] == 'r') {
+      if (cmd.status == "ok") restart_ok++;
+      continue;
+    }
+    if (kv.first[0] == 's' || kv.first[0] == 't') continue;
+    if (cmd.status.empty()) {
+      unanswered++;
+      continue;
+    }
+    if (cmd.behind) {
+      would_reorder++;
+    } else if (cmd.extra_ms > max_age_ms) {
+      would_stale++;
+    }
+    max_extra_all = std::max(max_extra_all, cmd.extra_ms);
+    if (cmd.status == "ok") {
+      accepted++;
+      max_extra_accepted = std::max(max_extra_accepted, cmd.extra_ms);
+      if (cmd.out_of_order || cmd.extra_ms > max_age_ms + kToleranceMs) bad_accept++;
+    } else if (cmd.status == "stale") {
+      stale++;
+      if (cmd.out_of_order || cmd.extra_ms + kToleranceMs < max_age_ms) bad_reject++;
+    } else if (cmd.status == "reordered") {
+      reordered++;
+      if (!cmd.out_of_order) bad_reject++;
+    }
+  }
+
+  printf("sem o aceite: %lu velhos e %lu fora de ordem moveriam o robo, atraso extra ate %u ms\n",
+         would_stale, would_reorder, max_extra_all);
+  printf("com o aceite: %lu aceitos, %lu stale, %lu reordered, atraso extra ate %u ms\n",
+         accepted, stale, reordered, max_extra_accepted);
+  printf("robot/cmd/stats (%lu publicacoes): %s\n", capture.cmd_stats,
+         capture.last_cmd_stats.c_str());
+  check(unanswered == 0, "todo comando teve pong");
+  check(bad_accept == 0, "aceitos em ordem e dentro da idade maxima");
+  check(bad_reject == 0, "recusados pelo motivo certo");
+  check(first.accepted == accepted && first.stale == stale && first.reordered == reordered,
+        "contadores do gate = pongs");
+  check(capture.cmd_stats > 0 && json_field(capture.last_cmd_stats, "accepted") >= accepted,
+        "robot/cmd/stats publicado");
+  check(restart_ok == 20, "remetente reiniciado (seq 1 depois de 4 s) aceito");
+  const auto status = [&capture](const char* nonce) { return capture.commands[nonce].status; };
+  printf("velho e depois em ordem: s21a %s, s21b %s, s23 %s, s22 %s, s24 %s\n",
+         status("s21a").c_str(), status("s21b").c_str(), status("s23").c_str(),
+         status("s22").c_str(), status("s24").c_str());
+  check(status("s21a") == "stale" && status("s23") == "stale" && status("s21b") == "ok" &&
+            status("s22") == "ok" && status("s24") == "ok",
+        "recusado por idade nao avanca a sequencia");
+  printf("twist direto: t1 %s, t3 %s, t2 %s, t4 %s, t5 %s; gate %u ok, %u stale, %u reordered,"
+         " %u sem seq\n",
+         status("t1").c_str(), status("t3").c_str(), status("t2").c_str(), status("t4").c_str(),
+         status("t5").c_str(), twist_stats.accepted, twist_stats.stale, twist_stats.reordered,
+         twist_stats.unsequenced);
+  check(status("t1") == "ok" && status("t3") == "ok" && status("t2") == "reordered" &&
+            status("t4") == "stale" && status("t5") == "ok",
+        "twist direto passa pelo aceite (pong ok/reordered/stale)");
+  check(twist_stats.accepted == 3 && twist_stats.stale == 1 && twist_stats.reordered == 1 &&
+            twist_stats.unsequenced == 1 && json_field(capture.last_cmd_stats, "twist_stale") == 1,
+        "contadores do twist em robot/cmd/stats");
+  printf("%s\n", g_failures ? "FALHOU" : "ok");
+  return g_failures ? 1 : 0;
+}
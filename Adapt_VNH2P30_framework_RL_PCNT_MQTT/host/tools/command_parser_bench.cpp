@@ -0,0 +1,140 @@
+// Mensagens por segundo e chamadas ao heap por mensagem do parser de
+// comandos: versão antiga (cópia para String + substring/trim/toLowerCase)
+// contra command_parser.h, sobre comandos no formato que o cliente de
+// face-mesh publica. Conta as alocações substituindo o operator new global.
+//
+// No host a String é um std::string com small-string optimization, então
+// campos curtos não alocam e a contagem da versão antiga fica abaixo da do
+// ESP32, onde toda String não vazia vai para o heap.
+//
+// Sai com código 1 se o parser novo alocar ou discordar do antigo.
+//
+// Uso: command_parser_bench [--messages N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "command_parser.h"
+#include "command_parser_legacy.h"
+
+namespace {
+unsigned long g_heap_calls = 0;
+volatile float g_sink = 0.0f;
+}  // namespace
+
+void* operator new(size_t size) {
+  ++g_heap_calls;
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size) {
+  ++g_heap_calls;
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+namespace {
+
+std::vector<std::string> make_messages(size_t n) {
+  std::vector<std::string> out;
+  out.reserve(n);
+  uint32_t state = 12345;
+  for (size_t i = 0; i < n; ++i) {
+    state = state * 1664525u + 1013904223u;
+    float yaw = (static_cast<int>(state >> 8) % 9000) / 100.0f - 45.0f;
+    float pitch = (static_cast<int>(state >> 4) % 6000) / 100.0f - 30.0f;
+    char buf[80];
+    if (i % 10 == 0) {
+      snprintf(buf, sizeof(buf), "%.2f|nan|%08x|%lu", yaw, state,
+               1718000000000ul + static_cast<unsigned long>(i) * 33);
+    } else {
+      snprintf(buf, sizeof(buf), "%.2f|%.2f|%08x|%lu", yaw, pitch, state,
+               1718000000000ul + static_cast<unsigned long>(i) * 33);
+    }
+    out.push_back(buf);
+  }
+  return out;
+}
+
+struct Result {
+  double msgs_per_s;
+  double heap_per_msg;
+};
+
+template <typename Parse>
+Result bench(const std::vector<std::string>& messages, size_t total, Parse parse) {
+  unsigned long heap0 = g_heap_calls;
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < total; ++i) {
+    const std::string& m = messages[i % messages.size()];
+    parse(reinterpret_cast<const uint8_t*>(m.data()), m.size());
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  Result r;
+  r.msgs_per_s = total / s;
+  r.heap_per_msg = double(g_heap_calls - heap0) / total;
+  return r;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t total = 2000000;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--messages") == 0 && i + 1 < argc) {
+      total = strtoul(argv[++i], nullptr, 10);
+    } else {
+      fprintf(stderr, "uso: %s [--messages N]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (total == 0) total = 1;
+
+  std::vector<std::string> messages = make_messages(1024);
+
+  size_t mismatches = 0;
+  for (const std::string& m : messages) {
+    ParsedCommand cmd;
+    float yaw, pitch;
+    String nonce, timestamp;
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(m.data());
+    bool ok = parse_command(data, m.size(), cmd);
+    bool legacy_ok = legacy_parse_bytes(data, m.size(), yaw, pitch, nonce, timestamp);
+    if (ok != legacy_ok || !ok || cmd.yaw_deg != yaw ||
+        (cmd.pitch_deg != pitch && !(isnan(cmd.pitch_deg) && isnan(pitch)))) {
+      ++mismatches;
+    }
+  }
+
+  Result legacy = bench(messages, total, [](const uint8_t* data, size_t size) {
+    float yaw, pitch;
+    String nonce, timestamp;
+    if (legacy_parse_bytes(data, size, yaw, pitch, nonce, timestamp)) g_sink += yaw;
+  });
+  Result view = bench(messages, total, [](const uint8_t* data, size_t size) {
+    ParsedCommand cmd;
+    if (parse_command(data, size, cmd)) g_sink += cmd.yaw_deg;
+  });
+
+  printf("%zu mensagens (ex.: \"%s\")\n", total, messages[1].c_str());
+  printf("%-16s %14s %14s\n", "parser", "msgs/s", "heap/msg");
+  printf("%-16s %14.0f %14.2f\n", "String (antigo)", legacy.msgs_per_s, legacy.heap_per_msg);
+  printf("%-16s %14.0f %14.2f\n", "TextView", view.msgs_per_s, view.heap_per_msg);
+  printf("%.1fx mais rapido, %zu divergencias\n", view.msgs_per_s / legacy.msgs_per_s,
+         mismatches);
+  return mismatches == 0 && view.heap_per_msg == 0.0 ? 0 : 1;
+}
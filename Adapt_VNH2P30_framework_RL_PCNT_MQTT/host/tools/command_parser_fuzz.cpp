@@ -0,0 +1,236 @@
+// Fuzz diferencial do parser de comandos: cada entrada passa pelo parser sem
+// alocação (command_parser.h) e pela versão antiga com String
+// (command_parser_legacy.h). Aceite/rejeição e nonce/timestamp têm de ser
+// idênticos; os ângulos podem diferir em no máximo 1 ulp (o antigo passa por
+// atof em double, o novo converte direto).
+//
+// As entradas são mutações de um corpus de comandos válidos e casos de
+// borda (NaN, hex, expoentes fora do float, espaços, NUL, sinais repetidos).
+// Sai com código 1 na primeira divergência, mostrando a entrada.
+//
+// Também compila como alvo do libFuzzer:
+//   clang++ -fsanitize=fuzzer,address -DCOMMAND_PARSER_LIBFUZZER ...
+//
+// Uso: command_parser_fuzz [--iterations N] [--seed S]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "command_parser.h"
+#include "command_parser_legacy.h"
+
+namespace {
+
+bool same_float(float a, float b) {
+  if (isnan(a) || isnan(b)) return isnan(a) && isnan(b);
+  if (a == b) return signbit(a) == signbit(b);
+  return nextafterf(a, b) == b;
+}
+
+bool same_text(const TextView& view, const String& s) {
+  return view.length == s.length() && memcmp(view.data, s.c_str(), view.length) == 0;
+}
+
+void print_input(const uint8_t* data, size_t size) {
+  fprintf(stderr, "entrada (%zu bytes): \"", size);
+  for (size_t i = 0; i < size; ++i) {
+    uint8_t c = data[i];
+    if (c >= 0x20 && c < 0x7F && c != '"' && c != '\\') {
+      fputc(c, stderr);
+    } else {
+      fprintf(stderr, "\\x%02x", c);
+    }
+  }
+  fprintf(stderr, "\"\n");
+}
+
+// true se os dois parsers concordam
+bool check(const uint8_t* data, size_t size) {
+  ParsedCommand cmd;
+  bool ok = parse_command(data, size, cmd);
+
+  float yaw = 0.0f;
+  float pitch = 0.0f;
+  String nonce;
+  String timestamp;
+  bool legacy_ok = legacy_parse_bytes(data, size, yaw, pitch, nonce, timestamp);
+
+  if (ok != legacy_ok) {
+    fprintf(stderr, "aceite diverge: novo=%d antigo=%d\n", ok, legacy_ok);
+    return false;
+  }
+  if (!ok) return true;
+  if (!same_float(cmd.yaw_deg, yaw) || !same_float(cmd.pitch_deg, pitch)) {
+    fprintf(stderr, "angulos divergem: novo=(%.9g, %.9g) antigo=(%.9g, %.9g)\n", cmd.yaw_deg,
+            cmd.pitch_deg, yaw, pitch);
+    return false;
+  }
+  if (!same_text(cmd.nonce, nonce) || !same_text(cmd.timestamp, timestamp)) {
+    fprintf(stderr, "nonce/timestamp divergem\n");
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (!check(data, size)) {
+    print_input(data, size);
+    abort();
+  }
+  return 0;
+}
+
+#ifndef COMMAND_PARSER_LIBFUZZER
+
+namespace {
+
+const char* const kSeeds[] = {
+    "12.50|-3.25|a1b2c3|1718000000123",
+    "-8|nan|n|t",
+    "0|NaN|nonce|0",
+    "  4.5 \t| -11 |\tx y \r|  99  ",
+    "+.5|-.5|n|t",
+    "1e3|-2E-2|n|t",
+    "1e39|0|n|t",
+    "-1e39|0|n|t",
+    "3.4028235e38|0|n|t",
+    "1e-50|0|n|t",
+    "0x1p4|0x.8|n|t",
+    "0x1p200|0|n|t",
+    "0x|0X1g|n|t",
+    "--5|+-1|n|t",
+    ".-5|..5|n|t",
+    "12abc|7.5.3|n|t",
+    "1|2|3",
+    "|||",
+    "1|2| |t",
+    "1|2|n| ",
+    "nan|nana|n|t",
+    "inf|1|n|t",
+    "1|2|n|t|extra|fields",
+    "00000000000000000000000000000001.5|1|n|t",
+    "123456789012345678901234567890|0.000000000000000000000000000001|n|t",
+    "1e+|1e-x|n|t",
+};
+
+const char kAlphabet[] = "0123456789+-.eEpPxXnNaAfF| \t\r\n\v\f";
+
+std::string random_number(std::mt19937& rng) {
+  std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+  char buf[48];
+  switch (rng() % 4) {
+    case 0: snprintf(buf, sizeof(buf), "%.2f", angle(rng)); break;
+    case 1: snprintf(buf, sizeof(buf), "%.9g", angle(rng)); break;
+    case 2:
+      snprintf(buf, sizeof(buf), "%e", angle(rng) * powf(10.0f, float(rng() % 80) - 40));
+      break;
+    default: snprintf(buf, sizeof(buf), "%a", angle(rng)); break;
+  }
+  return buf;
+}
+
+std::string random_command(std::mt19937& rng) {
+  char tail[48];
+  snprintf(tail, sizeof(tail), "|%08x|%u", static_cast<unsigned>(rng()),
+           static_cast<unsigned>(rng()));
+  return random_number(rng) + "|" + random_number(rng) + tail;
+}
+
+void mutate(std::string& s, std::mt19937& rng) {
+  int edits = 1 + rng() % 4;
+  for (int e = 0; e < edits; ++e) {
+    size_t pos = s.empty() ? 0 : rng() % (s.size() + 1);
+    switch (rng() % 6) {
+      case 0:  // insere caractere "interessante"
+        s.insert(pos, 1, kAlphabet[rng() % (sizeof(kAlphabet) - 1)]);
+        break;
+      case 1:  // insere byte qualquer (inclui NUL e >= 0x80)
+        s.insert(pos, 1, static_cast<char>(rng() & 0xFF));
+        break;
+      case 2:  // apaga um trecho
+        if (!s.empty() && pos < s.size()) s.erase(pos, 1 + rng() % 3);
+        break;
+      case 3:  // troca um caractere
+        if (pos < s.size()) s[pos] = kAlphabet[rng() % (sizeof(kAlphabet) - 1)];
+        break;
+      case 4:  // duplica um trecho
+        if (pos < s.size()) s.insert(pos, s.substr(pos, 1 + rng() % 6));
+        break;
+      default:  // expoente grande
+        s.insert(pos, rng() % 2 ? "e38" : "e-46");
+        break;
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  unsigned long iterations = 2000000;
+  unsigned long seed = 1;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = strtoul(argv[++i], nullptr, 10);
+    } else {
+      fprintf(stderr, "uso: %s [--iterations N] [--seed S]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  std::mt19937 rng(static_cast<uint32_t>(seed));
+  std::vector<std::string> corpus(kSeeds, kSeeds + sizeof(kSeeds) / sizeof(kSeeds[0]));
+  unsigned long accepted = 0;
+
+  // O corpus inicial também entra sem mutação
+  for (const std::string& seed_input : corpus) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(seed_input.data());
+    if (!check(data, seed_input.size())) {
+      print_input(data, seed_input.size());
+      return 1;
+    }
+  }
+
+  for (unsigned long it = 0; it < iterations; ++it) {
+    std::string input;
+    uint32_t pick = rng() % 8;
+    if (pick == 0) {
+      input = random_command(rng);
+    } else {
+      input = corpus[rng() % corpus.size()];
+      if (pick == 1 && input.size() > 2) {  // emenda com outro do corpus
+        const std::string& other = corpus[rng() % corpus.size()];
+        input = input.substr(0, rng() % input.size()) + other.substr(rng() % other.size());
+      }
+      mutate(input, rng);
+    }
+
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(input.data());
+    if (!check(data, input.size())) {
+      print_input(data, input.size());
+      fprintf(stderr, "iteracao %lu, seed %lu\n", it, seed);
+      return 1;
+    }
+    ParsedCommand cmd;
+    if (parse_command(data, input.size(), cmd)) {
+      ++accepted;
+      // Entradas aceitas alimentam o corpus (limitado)
+      if (corpus.size() < 4096 && rng() % 16 == 0) corpus.push_back(input);
+    }
+  }
+
+  printf("%lu entradas, %lu aceitas, %lu rejeitadas, 0 divergencias\n", iterations, accepted,
+         iterations - accepted);
+  return 0;
+}
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef COMMAND_PARSER_LEGACY_H
+#define COMMAND_PARSER_LEGACY_H
+
+// Parser com String que o mqtt_client usava antes de command_parser.h,
+// copiado sem mudanças de lógica. Serve de referência para o fuzz
+// (mesmo aceite/rejeição) e de base de comparação no benchmark.
+
+#include <Arduino.h>
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+inline bool legacy_parse_angle_field(const String& src, float& value) {
+  String trimmed = src;
+  trimmed.trim();
+  if (trimmed.length() == 0) {
+    return false;
+  }
+
+  String lower = trimmed;
+  lower.toLowerCase();
+  if (lower == F("nan")) {
+    value = NAN;
+    return true;
+  }
+
+  bool hasDigit = false;
+  for (size_t i = 0; i < static_cast<size_t>(trimmed.length()); ++i) {
+    char c = trimmed.charAt(i);
+    if (isdigit(static_cast<unsigned char>(c))) {
+      hasDigit = true;
+      break;
+    }
+    if (c != '-' && c != '+' && c != '.') {
+      return false;
+    }
+  }
+
+  if (!hasDigit) {
+    return false;
+  }
+
+  value = trimmed.toFloat();
+  if (isnan(value) || isinf(value)) {
+    return false;
+  }
+
+  return true;
+}
+
+inline bool legacy_parse_command_payload(const String& payload,
+                                         float& yawDeg,
+                                         float& pitchDeg,
+                                         String& nonce,
+                                         String& timestamp) {
+  int first_sep = payload.indexOf('|');
+  if (first_sep < 0) return false;
+
+  int second_sep = payload.indexOf('|', first_sep + 1);
+  if (second_sep < 0) return false;
+
+  int third_sep = payload.indexOf('|', second_sep + 1);
+  if (third_sep < 0) return false;
+
+  String yawStr = payload.substring(0, first_sep);
+  yawStr.trim();
+
+  String pitchStr = payload.substring(first_sep + 1, second_sep);
+  pitchStr.trim();
+
+  nonce = payload.substring(second_sep + 1, third_sep);
+  nonce.trim();
+
+  timestamp = payload.substring(third_sep + 1);
+  timestamp.trim();
+
+  if (yawStr.length() == 0 || pitchStr.length() == 0 || nonce.length() == 0 ||
+      timestamp.length() == 0) {
+    return false;
+  }
+
+  if (!legacy_parse_angle_field(yawStr, yawDeg)) {
+    return false;
+  }
+
+  if (!legacy_parse_angle_field(pitchStr, pitchDeg)) {
+    return false;
+  }
+
+  return true;
+}
+
+// Como o antigo mqtt_callback: copia o payload byte a byte para uma String.
+// No ESP32 as buscas da String param no primeiro NUL; aqui o corte é explícito.
+inline bool legacy_parse_bytes(const uint8_t* payload, size_t length, float& yawDeg,
+                               float& pitchDeg, String& nonce, String& timestamp) {
+  String msg;
+  msg.reserve(length);
+  for (size_t i = 0; i < length && payload[i] != 0; ++i) {
+    msg += static_cast<char>(payload[i]);
+  }
+  return legacy_parse_command_payload(msg, yawDeg, pitchDeg, nonce, timestamp);
+}
+
+#endif
@@ -0,0 +1,286 @@
+// Estresse da CommandQueue: produtor e consumidor em threads separadas, sem
+// pausas, para expor corridas de memória que o ESP32 (dois cores) também
+// teria. Cada registro carrega um padrão derivado da sequência; o consumidor
+// confere integridade (nenhum slot lido pela metade), ordem estritamente
+// crescente e que todo comando ausente foi contado como descartado.
+//
+// Rodar também com -DCMAKE_CXX_FLAGS=-fsanitize=thread.
+//
+// Com a fila cheia o produtor cede a vez: a maior parte dos push entra e os
+// dois lados se alternam nos mesmos slots, em vez de o produtor bater na fila
+// cheia o tempo todo (com um core só, quase nenhum push chegaria ao slot).
+// --no-backoff volta a saturar a fila (caminho de descarte). No latest o
+// push nunca falha: com a fila cheia ele tira o mais antigo e só depois cede.
+// --producer-delay-ns controla a taxa de chegada.
+//
+// Depois, o caso do consumidor pausado (botão segurado no controle manual):
+// o produtor enche a fila muito além da capacidade com o consumidor parado e
+// termina com um STOP; ao voltar, o latest tem de entregar esse STOP, e o
+// FIFO os COMMAND_QUEUE_CAPACITY primeiros, com o resto em dropped_full.
+// Em --pause-rounds rodadas, o produtor segue empurrando enquanto o
+// consumidor retoma, para cruzar o CAS dos dois lados.
+//
+// Sai com código 1 se a integridade ou os contadores falharem ou, com
+// backoff, se menos de --min-enqueued-pct dos push entrarem na fila (no FIFO
+// todo enfileirado tem de ser consumido; no latest o consumidor fica com o
+// mais novo de cada leva e o resto conta como substituído).
+//
+// Uso: command_queue_stress [--count N] [--policy fifo|latest|both]
+//                           [--producer-delay-ns P] [--consumer-delay-ns D]
+//                           [--no-backoff] [--min-enqueued-pct P]
+//                           [--pause-rounds R]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "command_queue.h"
+
+namespace {
+
+const uint32_t kStampKey = 0xA5A5A5A5u;
+
+MotionCommand command_for(uint32_t seq) {
+  return static_cast<MotionCommand>(seq % 5);
+}
+
+void spin_ns(uint32_t ns) {
+  if (ns == 0) return;
+  auto until = std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+  while (std::chrono::steady_clock::now() < until) {
+  }
+}
+
+struct Options {
+  uint32_t count = 5000000;
+  uint32_t producer_delay_ns = 50;
+  uint32_t consumer_delay_ns = 0;
+  bool backoff = true;
+  double min_enqueued_pct = 90.0;
+  uint32_t pause_rounds = 2000;
+};
+
+bool run(CommandQueuePolicy policy, const Options& opt) {
+  const uint32_t count = opt.count;
+  CommandQueue queue(policy);
+  std::atomic<int> ready(0);
+  std::atomic<bool> producer_done(false);
+
+  uint64_t errors = 0;
+  uint64_t gaps = 0;
+  uint32_t popped = 0;
+  int64_t last_seq = -1;
+
+  // Os dois lados começam juntos (criar a thread custa mais que a fila inteira)
+  auto wait_start = [&ready] {
+    ready.fetch_add(1);
+    while (ready.load() < 2) {
+      std::this_thread::yield();
+    }
+  };
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::thread consumer([&] {
+    CommandRecord record;
+    wait_start();
+    while (true) {
+      bool done = producer_done.load(std::memory_order_acquire);
+      if (!queue.pop(record)) {
+        if (done) break;
+        // Com um core só, ceder é o que deixa o produtor avançar
+        std::this_thread::yield();
+        continue;
+      }
+      ++popped;
+      if (record.command != command_for(record.seq) || record.t_ms != (record.seq ^ kStampKey)) {
+        ++errors;
+      }
+      if (static_cast<int64_t>(record.seq) <= last_seq) {
+        ++errors;
+      } else {
+        gaps += record.seq - last_seq - 1;
+      }
+      last_seq = record.seq;
+      spin_ns(opt.consumer_delay_ns);
+    }
+  });
+
+  std::thread producer([&] {
+    wait_start();
+    for (uint32_t seq = 0; seq < count; ++seq) {
+      // No latest o push com a fila cheia entra tirando o mais antigo
+      const bool full = queue.depth() >= COMMAND_QUEUE_CAPACITY;
+      if ((!queue.push(command_for(seq), seq ^ kStampKey) || full) && opt.backoff) {
+        // Fila cheia: deixa o consumidor esvaziar antes do próximo
+        std::this_thread::yield();
+      }
+      spin_ns(opt.producer_delay_ns);
+    }
+    producer_done.store(true, std::memory_order_release);
+  });
+
+  producer.join();
+  consumer.join();
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  CommandQueueStats s = queue.stats();
+  // Comandos no fim da sequência que nunca chegaram também são lacunas
+  gaps += count - 1 - (last_seq < 0 ? -1 : last_seq);
+
+  bool ok = errors == 0;
+  ok = ok && s.enqueued + s.dropped_full == count;
+  ok = ok && s.consumed == popped;
+  ok = ok && s.consumed + s.dropped_superseded == s.enqueued;
+  ok = ok && gaps == static_cast<uint64_t>(s.dropped_full) + s.dropped_superseded;
+  ok = ok && queue.depth() == 0;
+  if (policy == CMDQ_FIFO) ok = ok && s.dropped_superseded == 0;
+
+  // Sem isso o teste passa com o produtor batendo na fila cheia e os dois
+  // lados quase nunca se cruzando
+  const double enqueued_pct = count ? 100.0 * s.enqueued / count : 0.0;
+  const double consumed_pct = s.enqueued ? 100.0 * s.consumed / s.enqueued : 0.0;
+  if (opt.backoff) ok = ok && enqueued_pct >= opt.min_enqueued_pct;
+
+  printf("%-7s: %u push em %.3f s (%.1f ns/push) | enfileirados %u (%.1f %%), cheia %u,"
+         " substituidos %u, consumidos %u (%.1f %%), prof. max %u | erros %llu -> %s\n",
+         policy == CMDQ_FIFO ? "fifo" : "latest", count, wall_s,
+         count ? wall_s * 1e9 / count : 0.0, s.enqueued, enqueued_pct, s.dropped_full,
+         s.dropped_superseded, s.consumed, consumed_pct, s.max_depth,
+         static_cast<unsigned long long>(errors), ok ? "OK" : "FALHA");
+  return ok;
+}
+
+// Consumidor parado enquanto o produtor empurra `burst` comandos, o último
+// um STOP; depois o consumidor volta e o produtor ainda empurra `tail`
+// comandos concorrendo com ele
+bool run_paused(CommandQueuePolicy policy, const Options& opt) {
+  const uint32_t burst = COMMAND_QUEUE_CAPACITY * 4;
+  const uint32_t tail = COMMAND_QUEUE_CAPACITY * 2;
+  uint32_t rounds_ok = 0;
+  uint32_t push_failed = 0;
+  uint64_t errors = 0;
+  CommandQueueStats total = {};
+
+  for (uint32_t round = 0; round < opt.pause_rounds; ++round) {
+    CommandQueue queue(policy);
+    std::atomic<bool> resumed(false);
+    std::atomic<bool> producer_done(false);
+    uint32_t first_seq = 0;
+    bool first_stop = false;
+    uint32_t popped = 0;
+    int64_t last_seq = -1;
+
+    std::thread consumer([&] {
+      while (!resumed.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      CommandRecord record;
+      while (true) {
+        bool done = producer_done.load(std::memory_order_acquire);
+        if (!queue.pop(record)) {
+          if (done) break;
+          std::this_thread::yield();
+          continue;
+        }
+        if (popped == 0) {
+          first_seq = record.seq;
+          first_stop = record.command == MOTION_STOP;
+        }
+        ++popped;
+        if (record.t_ms != (record.seq ^ kStampKey) ||
+            static_cast<int64_t>(record.seq) <= last_seq) {
+          ++errors;
+        }
+        last_seq = record.seq;
+      }
+    });
+
+    for (uint32_t seq = 0; seq < burst; ++seq) {
+      // O último da leva é o STOP que o consumidor tem de ver ao voltar
+      const MotionCommand command = seq + 1 == burst ? MOTION_STOP : MOTION_FORWARD;
+      if (!queue.push(command, seq ^ kStampKey)) ++push_failed;
+    }
+    resumed.store(true, std::memory_order_release);
+    for (uint32_t seq = burst; seq < burst + tail; ++seq) {
+      if (!queue.push(MOTION_FORWARD, seq ^ kStampKey)) ++push_failed;
+      spin_ns(opt.producer_delay_ns);
+    }
+    producer_done.store(true, std::memory_order_release);
+    consumer.join();
+
+    CommandQueueStats s = queue.stats();
+    bool ok = s.consumed == popped && s.consumed + s.dropped_superseded == s.enqueued &&
+              s.enqueued + s.dropped_full == burst + tail && queue.depth() == 0;
+    if (policy == CMDQ_LATEST_WINS) {
+      // O consumidor pode ter voltado já depois de alguns push da cauda; o
+      // que ele não pode é ver algo mais velho que o STOP
+      ok = ok && s.dropped_full == 0 && first_seq >= burst - 1 &&
+           (first_seq != burst - 1 || first_stop) &&
+           last_seq == static_cast<int64_t>(burst + tail - 1);
+    } else {
+      ok = ok && first_seq == 0 && s.dropped_full >= burst - COMMAND_QUEUE_CAPACITY;
+    }
+    if (ok) ++rounds_ok;
+    total.enqueued += s.enqueued;
+    total.dropped_full += s.dropped_full;
+    total.dropped_superseded += s.dropped_superseded;
+    total.consumed += s.consumed;
+  }
+
+  const bool ok = errors == 0 && rounds_ok == opt.pause_rounds &&
+                  (policy == CMDQ_FIFO || push_failed == 0);
+  printf("%-7s: pausa %u rodadas (%u push com o consumidor parado, %u com ele"
+         " voltando) | ok %u, push recusados %u, cheia %u, substituidos %u,"
+         " consumidos %u | erros %llu -> %s\n",
+         policy == CMDQ_FIFO ? "fifo" : "latest", opt.pause_rounds, burst, tail, rounds_ok,
+         push_failed, total.dropped_full, total.dropped_superseded, total.consumed,
+         static_cast<unsigned long long>(errors), ok ? "OK" : "FALHA");
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  const char* policy = "both";
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+      opt.count = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+      policy = argv[++i];
+    } else if (strcmp(argv[i], "--producer-delay-ns") == 0 && i + 1 < argc) {
+      opt.producer_delay_ns = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--consumer-delay-ns") == 0 && i + 1 < argc) {
+      opt.consumer_delay_ns = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--no-backoff") == 0) {
+      opt.backoff = false;
+    } else if (strcmp(argv[i], "--min-enqueued-pct") == 0 && i + 1 < argc) {
+      opt.min_enqueued_pct = strtod(argv[++i], nullptr);
+    } else if (strcmp(argv[i], "--pause-rounds") == 0 && i + 1 < argc) {
+      opt.pause_rounds = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else {
+      fprintf(stderr,
+              "uso: %s [--count N] [--policy fifo|latest|both] [--producer-delay-ns P]"
+              " [--consumer-delay-ns D] [--no-backoff] [--min-enqueued-pct P]"
+              " [--pause-rounds R]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  bool ok = true;
+  if (strcmp(policy, "fifo") == 0 || strcmp(policy, "both") == 0) {
+    ok = run(CMDQ_FIFO, opt) && ok;
+    ok = run_paused(CMDQ_FIFO, opt) && ok;
+  }
+  if (strcmp(policy, "latest") == 0 || strcmp(policy, "both") == 0) {
+    ok = run(CMDQ_LATEST_WINS, opt) && ok;
+    ok = run_paused(CMDQ_LATEST_WINS, opt) && ok;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+// Soak do gerenciador de conexão contra um broker MQTT real (mosquitto ou
+// flaky_broker). Roda o firmware inteiro com a planta simulada; o relógio
+// virtual acompanha o tempo de parede para que backoff e timeouts valham em
+// segundos reais. Mede quanto cada passada da tarefa de rede (loopRede) custa
+// — com o gerenciador não bloqueante ela deve ficar em microssegundos mesmo
+// durante quedas — e se a tarefa de controle manteve o período.
+//
+// Uso: conn_soak [--host H] [--port P] [--seconds S]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "control_task.h"
+#include "net_connection.h"
+#include "plant.h"
+#include "sim.h"
+
+void setup();
+
+namespace {
+
+struct Capture {
+  unsigned long control_cycles = 0;
+  unsigned long overruns = 0;
+  unsigned long odometry = 0;
+};
+
+unsigned long json_field(const std::string& json, const char* key) {
+  std::string needle = std::string("\"") + key + "\":";
+  size_t pos = json.find(needle);
+  return pos == std::string::npos ? 0 : strtoul(json.c_str() + pos + needle.size(), nullptr, 10);
+}
+
+void on_publish(const char* topic, const uint8_t* payload, size_t length, void* ctx) {
+  Capture* capture = static_cast<Capture*>(ctx);
+  if (strcmp(topic, "robot/control/timing") == 0) {
+    std::string body(reinterpret_cast<const char*>(payload), length);
+    capture->control_cycles += json_field(body, "cycles");
+    capture->overruns += json_field(body, "overruns");
+  } else if (strcmp(topic, "robot/odometry") == 0) {
+    capture->odometry++;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* host = "127.0.0.1";
+  int port = 1883;
+  double seconds = 30.0;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+      host = argv[++i];
+    } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "uso: %s [--host H] [--port P] [--seconds S]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  Capture capture;
+  sim_reset();
+  sim_net_use_tcp_broker(host, port);
+  sim_mqtt_set_publish_hook(on_publish, &capture);
+
+  SimPlant plant;
+  plant.attach(100);
+  setup();
+
+  typedef std::chrono::steady_clock Clock;
+  const Clock::time_point start = Clock::now();
+  Clock::time_point last = start;
+  std::vector<uint32_t> pass_us;
+  pass_us.reserve(static_cast<size_t>(seconds * 1000) + 16);
+
+  while (std::chrono::duration<double>(Clock::now() - start).count() < seconds) {
+    Clock::time_point now = Clock::now();
+    sim_clock_advance_us(
+        std::chrono::duration_cast<std::chrono::microseconds>(now - last).count());
+    last = now;
+
+    Clock::time_point t0 = Clock::now();
+    sim_run_loop_tasks();
+    pass_us.push_back(static_cast<uint32_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - t0).count()));
+    usleep(1000);
+  }
+
+  ConnStats stats = conn_stats();
+  std::sort(pass_us.begin(), pass_us.end());
+  uint32_t p50 = pass_us.empty() ? 0 : pass_us[pass_us.size() / 2];
+  uint32_t p99 = pass_us.empty() ? 0 : pass_us[pass_us.size() * 99 / 100];
+  uint32_t pmax = pass_us.empty() ? 0 : pass_us.back();
+  double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+  printf("broker           : %s:%d, %.1f s\n", host, port, elapsed_s);
+  printf("estado final     : %s\n", conn_state_name(stats.state));
+  printf("sessoes          : %u (reconexoes %u, quedas %u, falhas %u)\n", stats.mqtt_connects,
+         stats.reconnects, stats.disconnects, stats.failed_attempts);
+  printf("offline          : %u ms (%.1f%%), ultimo erro %ld\n", stats.disconnected_ms,
+         elapsed_s > 0 ? stats.disconnected_ms / (elapsed_s * 10.0) : 0.0,
+         static_cast<long>(stats.last_error));
+  printf("loopRede         : p50 %u us, p99 %u us, max %u us (%zu passadas)\n", p50, p99, pmax,
+         pass_us.size());
+  printf("conn_poll max    : %u us\n", stats.max_poll_us);
+  printf("ciclos controle  : %lu (esperado ~%.0f), overruns %lu, odometria %lu msgs\n",
+         capture.control_cycles, elapsed_s * 1e6 / CONTROL_PERIOD_US, capture.overruns,
+         capture.odometry);
+  return 0;
+}
@@ -0,0 +1,120 @@
+// Confere a contagem dos encoders quando o laço de controle fica parado
+// (por exemplo preso numa reconexão bloqueante) com as rodas girando: o
+// robô anda com PWM máximo, encoder() deixa de ser chamado por S segundos e
+// depois roda uma vez. Compara o total de 64 bits (hal_pcnt_total) com os
+// pulsos gerados pela planta e mostra o que o método antigo (ler e zerar o
+// contador de 16 bits, que volta a zero em ±Robot::kPcntLimit) teria lido.
+//
+// Cada parada roda duas vezes: com a interrupção de limite imediata e
+// atrasada até depois da leitura (sim_pcnt_defer_events), o que exercita a
+// correção de evento pendente em hal_pcnt_total.
+//
+// "pose" compara o deslocamento da odometria durante a parada com o da pose
+// verdadeira.
+//
+// Sai com código 1 se alguma contagem se perder.
+//
+// Uso: encoder_stall_check [--stall-s S]...
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "motor_control.h"
+#include "plant.h"
+#include "sim.h"
+
+namespace {
+
+struct Outcome {
+  int64_t generated;   // pulsos da planta na roda direita
+  int64_t counted;     // total de 64 bits lido pelo firmware
+  int64_t legacy;      // o que ler-e-zerar teria somado
+  EncoderStats stats;
+  double pose_err;     // deslocamento da odometria − verdadeiro (m)
+};
+
+Outcome run(double stall_s, bool deferred) {
+  sim_reset();
+  sim_pcnt_defer_events(deferred);
+  SimPlant plant;
+  plant.attach(100);
+  setupMotor();
+  Stop();
+  encoder();
+
+  const uint32_t period_us = 50000;
+  // Acelera sob controle e então trava o PWM no máximo
+  Forward(255, 255);
+  for (int i = 0; i < 40; ++i) {
+    sim_clock_advance_us(period_us);
+    encoder();
+  }
+  motorGo(MOTOR_R, CW, 255);
+  motorGo(MOTOR_L, CW, 255);
+
+  const int64_t before = encoder_stats().totalR;
+  const int64_t generated_before = plant.wheel[MOTOR_R].pulses;
+  OdometrySample start;
+  odometry_latest_sample(start);
+  const SimPose true_start = plant.pose;
+  // Laço parado: o relógio anda, encoder() não roda
+  sim_clock_advance_us(static_cast<uint64_t>(stall_s * 1e6));
+  sim_clock_advance_us(period_us);
+  encoder();
+
+  Outcome out;
+  out.stats = encoder_stats();
+  out.generated = plant.wheel[MOTOR_R].pulses - generated_before;
+  out.counted = out.stats.totalR - before;
+  // Contador de 16 bits zerado a cada ciclo: só sobra o resto do limite
+  out.legacy = out.generated % Robot::kPcntLimit;
+
+  OdometrySample sample;
+  odometry_latest_sample(sample);
+  out.pose_err = hypot(sample.x - start.x, sample.y - start.y) -
+                 hypot(plant.pose.x - true_start.x, plant.pose.y - true_start.y);
+  plant.detach();
+  Stop();
+  return out;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  std::vector<double> stalls;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--stall-s") == 0 && i + 1 < argc && atof(argv[i + 1]) >= 0) {
+      stalls.push_back(atof(argv[++i]));
+    } else {
+      fprintf(stderr, "uso: %s [--stall-s S]...\n", argv[0]);
+      return 2;
+    }
+  }
+  if (stalls.empty()) {
+    const double defaults[] = {1.0, 10.0, 20.0, 60.0, 300.0};
+    stalls.assign(defaults, defaults + sizeof(defaults) / sizeof(defaults[0]));
+  }
+
+  printf("roda direita com PWM 255; limite do contador +-%d\n", Robot::kPcntLimit);
+  printf("%9s %-9s %10s %10s %8s %12s %8s %8s %8s %10s\n", "parada(s)", "evento", "pulsos",
+         "total64", "perdidos", "antigo leria", "limites", "atrasos", "pcnt-cap", "pose (m)");
+  bool ok = true;
+  for (double stall : stalls) {
+    for (int deferred = 0; deferred < 2; ++deferred) {
+      Outcome o = run(stall, deferred != 0);
+      const int64_t lost = o.generated - o.counted;
+      if (lost != 0) ok = false;
+      printf("%9.0f %-9s %10lld %10lld %8lld %12lld %8u %8u %8d %10.4f\n", stall,
+             deferred ? "atrasado" : "imediato", static_cast<long long>(o.generated),
+             static_cast<long long>(o.counted), static_cast<long long>(lost),
+             static_cast<long long>(o.legacy), o.stats.limit_events, o.stats.late_events,
+             o.stats.capture_diff, o.pose_err);
+    }
+  }
+  printf("%s\n", ok ? "OK: nenhuma contagem perdida" : "FALHA: contagens perdidas");
+  return ok ? 0 : 1;
+}
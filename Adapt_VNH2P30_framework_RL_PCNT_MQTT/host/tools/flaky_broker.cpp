@@ -0,0 +1,297 @@
+// Broker MQTT 3.1.1 mínimo (QoS 0, curingas + e #) que derruba clientes de
+// propósito, para exercitar o gerenciador de conexão contra falhas reais de
+// TCP. Um só thread com poll(); não persiste nada nem guarda retained.
+//
+// Uso: flaky_broker [--port P] [--drop-every-ms N] [--refuse-for-ms M]
+//                   [--connack-delay-ms D] [--seconds S]
+//   --drop-every-ms   fecha todas as conexões a cada N ms
+//   --refuse-for-ms   após cada queda, responde CONNACK rc=3 por M ms
+//   --connack-delay-ms atrasa o CONNACK (broker lento)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "mqtt_wire.h"
+
+using namespace mqtt_wire;
+
+namespace {
+
+struct Client {
+  int fd = -1;
+  bool connected = false;
+  uint64_t connack_at_ms = 0;  // != 0: CONNACK pendente (atraso simulado)
+  uint8_t connack_rc = 0;
+  std::string id;
+  std::vector<std::string> filters;
+  std::vector<uint8_t> in;
+  std::vector<uint8_t> out;
+};
+
+struct Counters {
+  unsigned long connects = 0;
+  unsigned long refused = 0;
+  unsigned long drops = 0;
+  unsigned long published = 0;
+  unsigned long routed = 0;
+};
+
+volatile sig_atomic_t g_stop = 0;
+
+void on_signal(int) { g_stop = 1; }
+
+bool read_string(const std::vector<uint8_t>& body, size_t& pos, std::string& out) {
+  if (pos + 2 > body.size()) return false;
+  size_t len = (static_cast<size_t>(body[pos]) << 8) | body[pos + 1];
+  pos += 2;
+  if (pos + len > body.size()) return false;
+  out.assign(reinterpret_cast<const char*>(body.data() + pos), len);
+  pos += len;
+  return true;
+}
+
+void send_packet(Client& c, uint8_t header, const std::vector<uint8_t>& body) {
+  encode_packet(header, body, c.out);
+}
+
+void route(std::vector<Client>& clients, const std::string& topic, const uint8_t* payload,
+           size_t length, Counters& counters) {
+  std::vector<uint8_t> body;
+  put_string(body, topic);
+  body.insert(body.end(), payload, payload + length);
+  for (Client& c : clients) {
+    if (!c.connected) continue;
+    for (const std::string& f : c.filters) {
+      if (topic_matches(f, topic)) {
+        send_packet(c, 0x30, body);
+        counters.routed++;
+        break;
+      }
+    }
+  }
+}
+
+// false = fechar a conexão
+bool handle_packet(std::vector<Client>& clients, size_t index, uint8_t header,
+                   const std::vector<uint8_t>& body, uint64_t now, uint64_t refuse_until,
+                   uint32_t connack_delay_ms, Counters& counters) {
+  Client& c = clients[index];
+  uint8_t type = header & 0xF0;
+  if (!c.connected && c.connack_at_ms == 0 && type != 0x10) return false;
+
+  switch (type) {
+    case 0x10: {  // CONNECT
+      size_t pos = 0;
+      std::string proto;
+      if (!read_string(body, pos, proto) || pos + 4 > body.size()) return false;
+      pos += 4;  // nível, flags, keepalive
+      read_string(body, pos, c.id);
+      c.connack_rc = now < refuse_until ? 3 : 0;
+      c.connack_at_ms = now + connack_delay_ms;
+      return true;
+    }
+    case 0x30: {  // PUBLISH
+      size_t pos = 0;
+      std::string topic;
+      if (!read_string(body, pos, topic)) return false;
+      uint8_t qos = (header >> 1) & 0x03;
+      if (qos > 0) {
+        if (pos + 2 > body.size()) return false;
+        std::vector<uint8_t> ack(body.begin() + pos, body.begin() + pos + 2);
+        pos += 2;
+        if (qos == 1) send_packet(c, 0x40, ack);
+      }
+      counters.published++;
+      route(clients, topic, body.data() + pos, body.size() - pos, counters);
+      return true;
+    }
+    case 0x80: {  // SUBSCRIBE
+      if (body.size() < 2) return false;
+      std::vector<uint8_t> ack(body.begin(), body.begin() + 2);
+      size_t pos = 2;
+      std::string filter;
+      while (pos < body.size() && read_string(body, pos, filter) && pos < body.size()) {
+        pos++;  // QoS pedido
+        clients[index].filters.push_back(filter);
+        ack.push_back(0);
+      }
+      send_packet(clients[index], 0x90, ack);
+      return true;
+    }
+    case 0xC0:  // PINGREQ
+      send_packet(c, 0xD0, std::vector<uint8_t>());
+      return true;
+    case 0xE0:  // DISCONNECT
+      return false;
+    default:
+      return true;
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int port = 1883;
+  uint32_t drop_every_ms = 0;
+  uint32_t refuse_for_ms = 0;
+  uint32_t connack_delay_ms = 0;
+  double seconds = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--drop-every-ms") == 0 && i + 1 < argc) {
+      drop_every_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--refuse-for-ms") == 0 && i + 1 < argc) {
+      refuse_for_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--connack-delay-ms") == 0 && i + 1 < argc) {
+      connack_delay_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else {
+      fprintf(stderr,
+              "uso: %s [--port P] [--drop-every-ms N] [--refuse-for-ms M]"
+              " [--connack-delay-ms D] [--seconds S]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  signal(SIGPIPE, SIG_IGN);
+
+  int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+  int yes = 1;
+  setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(static_cast<uint16_t>(port));
+  if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+      listen(listen_fd, 16) != 0) {
+    perror("flaky_broker: bind/listen");
+    return 1;
+  }
+  fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL, 0) | O_NONBLOCK);
+  fprintf(stderr, "flaky_broker: ouvindo em 127.0.0.1:%d\n", port);
+
+  std::vector<Client> clients;
+  Counters counters;
+  const uint64_t start = now_ms();
+  uint64_t next_drop = drop_every_ms ? start + drop_every_ms : 0;
+  uint64_t refuse_until = 0;
+
+  while (!g_stop && (seconds <= 0 || now_ms() - start < seconds * 1000)) {
+    std::vector<pollfd> fds;
+    fds.push_back({listen_fd, POLLIN, 0});
+    for (const Client& c : clients) {
+      fds.push_back({c.fd, static_cast<short>(POLLIN | (c.out.empty() ? 0 : POLLOUT)), 0});
+    }
+    poll(fds.data(), fds.size(), 5);
+    uint64_t now = now_ms();
+
+    if (fds[0].revents & POLLIN) {
+      int fd;
+      while ((fd = accept(listen_fd, nullptr, nullptr)) >= 0) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        Client c;
+        c.fd = fd;
+        clients.push_back(c);
+      }
+    }
+
+    std::vector<bool> keep(clients.size(), true);
+    for (size_t i = 0; i < clients.size(); ++i) {
+      uint8_t buf[4096];
+      ssize_t n;
+      while ((n = recv(clients[i].fd, buf, sizeof(buf), 0)) > 0) {
+        clients[i].in.insert(clients[i].in.end(), buf, buf + n);
+      }
+      if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) keep[i] = false;
+
+      uint8_t header;
+      std::vector<uint8_t> body;
+      long used;
+      while (keep[i] &&
+             (used = decode_packet(clients[i].in.data(), clients[i].in.size(), header, body)) !=
+                 0) {
+        if (used < 0) {
+          keep[i] = false;
+          break;
+        }
+        clients[i].in.erase(clients[i].in.begin(), clients[i].in.begin() + used);
+        keep[i] = handle_packet(clients, i, header, body, now, refuse_until, connack_delay_ms,
+                                counters);
+      }
+
+      Client& c = clients[i];
+      if (keep[i] && c.connack_at_ms != 0 && now >= c.connack_at_ms) {
+        c.connack_at_ms = 0;
+        send_packet(c, 0x20, std::vector<uint8_t>{0, c.connack_rc});
+        if (c.connack_rc == 0) {
+          c.connected = true;
+          counters.connects++;
+        } else {
+          counters.refused++;
+        }
+      }
+    }
+
+    if (next_drop && now >= next_drop) {
+      for (size_t i = 0; i < clients.size(); ++i) {
+        if (clients[i].connected) counters.drops++;
+        keep[i] = false;
+      }
+      refuse_until = now + refuse_for_ms;
+      next_drop = now + drop_every_ms;
+    }
+
+    for (size_t i = 0; i < clients.size(); ++i) {
+      Client& c = clients[i];
+      while (keep[i] && !c.out.empty()) {
+        ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+          c.out.erase(c.out.begin(), c.out.begin() + n);
+        } else {
+          if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) keep[i] = false;
+          break;
+        }
+      }
+      // CONNACK recusado: o broker fecha logo após enviar
+      if (keep[i] && !c.connected && c.connack_at_ms == 0 && !c.id.empty() && c.out.empty()) {
+        keep[i] = false;
+      }
+    }
+
+    std::vector<Client> alive;
+    for (size_t i = 0; i < clients.size(); ++i) {
+      if (keep[i]) {
+        alive.push_back(clients[i]);
+      } else {
+        close(clients[i].fd);
+      }
+    }
+    clients.swap(alive);
+  }
+
+  for (const Client& c : clients) close(c.fd);
+  close(listen_fd);
+  fprintf(stderr,
+          "flaky_broker: %lu conexoes, %lu recusadas, %lu derrubadas, %lu publicacoes,"
+          " %lu entregas\n",
+          counters.connects, counters.refused, counters.drops, counters.published,
+          counters.routed);
+  return 0;
+}
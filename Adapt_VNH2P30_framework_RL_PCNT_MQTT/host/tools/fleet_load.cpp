@@ -0,0 +1,448 @@
+// Gerador de carga da frota (net_set_fleet): sobe N robôs simulados contra
+// um broker MQTT real (mosquitto; flaky_broker serve para testar). Cada robô
+// é um processo com o firmware inteiro, a planta e o cliente TCP de
+// host/net. O MAC é distinto (id 02f1ee<índice>) e o relógio virtual segue o
+// de parede, como no conn_soak. Para cada N de --robots, a ferramenta mede
+// durante --seconds:
+//   telemetria  mensagens/s e kB/s recebidos em <raiz>/+/robot/odometry[/debug]
+//               e a fração do que os robôs publicaram que chegou
+//   fan-out     um comando em <raiz>/<grupo>/facemesh/cmd a cada
+//               --cmd-period-ms; latência do publish até o callback do
+//               firmware de cada robô (p50/p99/máx), a latência até o último
+//               robô de cada comando e a fração entregue. Inclui a espera até
+//               a próxima passada da tarefa de rede (--tick-ms).
+//   CPU         do broker (/proc/<pid>/stat, --broker-pid ou pelo nome em
+//               --broker-name, padrão mosquitto) e de todos os robôs somados;
+//               com os robôs perto de 100 % por núcleo, o gargalo é a máquina
+//               que gera a carga, não o broker.
+// Os robôs escrevem as latências e contagens num mapeamento compartilhado;
+// o relógio monotônico é o mesmo em todos os processos.
+//
+// Uso: fleet_load [--host H] [--port P] [--robots 10,50,100] [--seconds S]
+//                 [--warmup-s W] [--cmd-period-ms M] [--tick-ms T]
+//                 [--telemetry json|binary|batch] [--root R] [--group G]
+//                 [--broker-pid PID | --broker-name NOME]
+
+#include <dirent.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mqtt_client.h"
+#include "mqtt_wire.h"
+#include "plant.h"
+#include "sim.h"
+
+void setup();
+
+namespace {
+
+const int kMaxRobots = 1024;
+const int kCmdSlots = 256;   // comandos por etapa
+
+// Escrito pelos robôs, lido pelo gerador (MAP_SHARED, antes do fork)
+struct Shared {
+  std::atomic<uint32_t> connected[kMaxRobots];
+  std::atomic<uint32_t> published[kMaxRobots];   // odometria + debug
+  std::atomic<uint32_t> latency_us[kMaxRobots][kCmdSlots];   // +1; 0 = não chegou
+};
+
+struct Options {
+  const char* host = "127.0.0.1";
+  int port = 1883;
+  std::vector<int> robots = {10, 50, 100};
+  double seconds = 20.0;
+  double warmup_s = 10.0;
+  uint32_t cmd_period_ms = 500;
+  uint32_t tick_ms = 2;
+  TelemetryFormat format = TELEMETRY_JSON;
+  const char* root = "fleet";
+  const char* group = "all";
+  long broker_pid = 0;
+  const char* broker_name = "mosquitto";
+};
+
+uint64_t now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// ---------------- Robô (processo filho) ----------------
+
+volatile sig_atomic_t g_stop = 0;
+
+void on_term(int) {
+  g_stop = 1;
+}
+
+struct RobotCtx {
+  int index;
+  Shared* shared;
+  std::string group_cmd;
+};
+
+bool is_odometry(const char* topic) {
+  const char* tail = strstr(topic, "/robot/odometry");
+  return tail &&
+         (strcmp(tail, "/robot/odometry") == 0 || strcmp(tail, "/robot/odometry/debug") == 0);
+}
+
+void on_robot_publish(const char* topic, const uint8_t*, size_t, void* ctx) {
+  RobotCtx& r = *static_cast<RobotCtx*>(ctx);
+  if (is_odometry(topic)) {
+    r.shared->published[r.index].fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// yaw|pitch|c<slot>|<t0 em µs do relógio monotônico>
+void on_robot_receive(const char* topic, const uint8_t* payload, size_t length, void* ctx) {
+  const uint64_t arrived = now_us();
+  RobotCtx& r = *static_cast<RobotCtx*>(ctx);
+  if (r.group_cmd != topic) return;
+  std::string text(reinterpret_cast<const char*>(payload), length);
+  const size_t pitch = text.find('|');
+  const size_t nonce = pitch == std::string::npos ? pitch : text.find('|', pitch + 1);
+  const size_t stamp = nonce == std::string::npos ? nonce : text.find('|', nonce + 1);
+  if (stamp == std::string::npos || text[nonce + 1] != 'c') return;
+  const unsigned long slot = strtoul(text.c_str() + nonce + 2, nullptr, 10);
+  const uint64_t sent = strtoull(text.c_str() + stamp + 1, nullptr, 10);
+  if (slot >= static_cast<unsigned long>(kCmdSlots) || sent > arrived) return;
+  r.shared->latency_us[r.index][slot].store(static_cast<uint32_t>(arrived - sent) + 1,
+                                            std::memory_order_relaxed);
+}
+
+void run_robot(int index, const Options& o, Shared* shared) {
+  signal(SIGTERM, on_term);
+  const pid_t parent = getppid();
+  const uint8_t mac[6] = {0x02, 0xf1, 0xee, static_cast<uint8_t>(index >> 16),
+                          static_cast<uint8_t>(index >> 8), static_cast<uint8_t>(index)};
+  RobotCtx ctx = {index, shared, std::string(o.root) + "/" + o.group + "/facemesh/cmd"};
+  sim_reset();
+  sim_set_mac(mac);
+  sim_net_use_tcp_broker(o.host, o.port);
+  sim_mqtt_set_publish_hook(on_robot_publish, &ctx);
+  sim_mqtt_set_receive_hook(on_robot_receive, &ctx);
+  net_set_fleet(o.root, o.group);
+  net_set_odom_format(o.format);
+
+  SimPlant plant;
+  plant.attach(100);
+  setup();
+
+  uint64_t last = now_us();
+  while (!g_stop && getppid() == parent) {
+    const uint64_t now = now_us();
+    sim_clock_advance_us(now - last);
+    last = now;
+    sim_run_loop_tasks();
+    shared->connected[index].store(hal_mqtt_connected() ? 1 : 0, std::memory_order_relaxed);
+    usleep(o.tick_ms * 1000);
+  }
+  shared->connected[index].store(0, std::memory_order_relaxed);
+}
+
+// ---------------- Gerador ----------------
+
+// utime + stime em ticks; -1 sem o processo
+long long cpu_ticks(long pid) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%ld/stat", pid);
+  FILE* f = fopen(path, "r");
+  if (!f) return -1;
+  char buf[1024];
+  const size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+  fclose(f);
+  buf[n] = '\0';
+  // Campos depois do "(comm)": o 14º e o 15º da linha
+  const char* p = strrchr(buf, ')');
+  if (!p) return -1;
+  unsigned long long utime = 0;
+  unsigned long long stime = 0;
+  const int fields = sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+                            &utime, &stime);
+  if (fields != 2) return -1;
+  return static_cast<long long>(utime + stime);
+}
+
+long find_pid(const char* name) {
+  DIR* dir = opendir("/proc");
+  if (!dir) return 0;
+  long found = 0;
+  while (dirent* e = readdir(dir)) {
+    const long pid = strtol(e->d_name, nullptr, 10);
+    if (pid <= 0) continue;
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%ld/comm", pid);
+    FILE* f = fopen(path, "r");
+    if (!f) continue;
+    char comm[64] = "";
+    if (fgets(comm, sizeof(comm), f)) comm[strcspn(comm, "\n")] = '\0';
+    fclose(f);
+    if (strcmp(comm, name) == 0) {
+      found = pid;
+      break;
+    }
+  }
+  closedir(dir);
+  return found;
+}
+
+struct Monitor {
+  const char* root;
+  uint64_t messages = 0;
+  uint64_t bytes = 0;
+  std::set<std::string> ids;
+};
+
+void on_monitor(const char* topic, const uint8_t*, size_t length, void* ctx) {
+  Monitor& m = *static_cast<Monitor*>(ctx);
+  if (!is_odometry(topic)) return;
+  m.messages++;
+  m.bytes += length;
+  const char* id = topic + strlen(m.root) + 1;
+  m.ids.insert(std::string(id, strcspn(id, "/")));
+}
+
+double percentile(std::vector<double>& v, double p) {
+  if (v.empty()) return 0.0;
+  std::sort(v.begin(), v.end());
+  size_t rank = static_cast<size_t>(p / 100.0 * v.size() + 0.999999);
+  if (rank < 1) rank = 1;
+  if (rank > v.size()) rank = v.size();
+  return v[rank - 1];
+}
+
+long long sum_ticks(const std::vector<pid_t>& pids) {
+  long long total = 0;
+  for (pid_t pid : pids) {
+    const long long t = cpu_ticks(pid);
+    if (t > 0) total += t;
+  }
+  return total;
+}
+
+uint64_t sum_published(Shared* shared, int n) {
+  uint64_t total = 0;
+  for (int i = 0; i < n; ++i) total += shared->published[i].load(std::memory_order_relaxed);
+  return total;
+}
+
+bool run_step(int n, const Options& o, Shared* shared, long broker_pid) {
+  for (int i = 0; i < n; ++i) {
+    shared->connected[i].store(0);
+    shared->published[i].store(0);
+    for (int c = 0; c < kCmdSlots; ++c) shared->latency_us[i][c].store(0);
+  }
+
+  fflush(stdout);
+  std::vector<pid_t> pids;
+  for (int i = 0; i < n; ++i) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+      run_robot(i, o, shared);
+      _exit(0);
+    }
+    if (pid < 0) {
+      perror("fork");
+      break;
+    }
+    pids.push_back(pid);
+  }
+
+  MqttWireClient client;
+  Monitor monitor;
+  monitor.root = o.root;
+  char client_id[32];
+  snprintf(client_id, sizeof(client_id), "fleet_load-%d", static_cast<int>(getpid()));
+  bool ok = client.start_connect(o.host, o.port, client_id, nullptr, nullptr);
+  while (ok && client.poll_connect() == MqttWireClient::CONNECTING) usleep(1000);
+  const std::string odom = std::string(o.root) + "/+/robot/odometry";
+  ok = ok && client.connected() && client.subscribe(odom.c_str()) &&
+       client.subscribe((odom + "/debug").c_str());
+  if (!ok) {
+    fprintf(stderr, "falha ao conectar em %s:%d (rc=%d)\n", o.host, o.port, client.last_error());
+  }
+
+  // Aquecimento: todos conectados ou o prazo
+  const uint64_t warm_end = now_us() + static_cast<uint64_t>(o.warmup_s * 1e6);
+  int connected = 0;
+  while (ok && now_us() < warm_end && connected < n) {
+    client.loop(on_monitor, &monitor, 20);
+    connected = 0;
+    for (int i = 0; i < n; ++i) connected += shared->connected[i].load() ? 1 : 0;
+  }
+
+  const std::string cmd_topic = std::string(o.root) + "/" + o.group + "/facemesh/cmd";
+  monitor = Monitor();
+  monitor.root = o.root;
+  const long long broker0 = broker_pid ? cpu_ticks(broker_pid) : -1;
+  const long long robots0 = sum_ticks(pids);
+  const uint64_t published0 = sum_published(shared, n);
+  const uint64_t start = now_us();
+  const uint64_t end = start + static_cast<uint64_t>(o.seconds * 1e6);
+  uint64_t next_cmd = start;
+  int commands = 0;
+  while (ok && now_us() < end) {
+    if (commands < kCmdSlots && now_us() >= next_cmd) {
+      char payload[64];
+      const int len = snprintf(payload, sizeof(payload), "0|0|c%d|%" PRIu64, commands, now_us());
+      client.publish(cmd_topic.c_str(), reinterpret_cast<const uint8_t*>(payload),
+                     static_cast<size_t>(len));
+      commands++;
+      next_cmd += static_cast<uint64_t>(o.cmd_period_ms) * 1000;
+    }
+    if (!client.loop(on_monitor, &monitor, 5)) {
+      fprintf(stderr, "conexão do gerador perdida (rc=%d)\n", client.last_error());
+      ok = false;
+    }
+  }
+  const double elapsed = (now_us() - start) * 1e-6;
+  const uint64_t published = sum_published(shared, n) - published0;
+  const long long robots1 = sum_ticks(pids);
+  const long long broker1 = broker_pid ? cpu_ticks(broker_pid) : -1;
+  const uint64_t received = monitor.messages;
+  const uint64_t received_bytes = monitor.bytes;
+  // O último comando ainda pode estar a caminho (só a latência conta daqui)
+  const uint64_t drain_end = now_us() + 500000;
+  while (ok && now_us() < drain_end) client.loop(on_monitor, &monitor, 5);
+  client.disconnect();
+
+  for (pid_t pid : pids) kill(pid, SIGTERM);
+  for (pid_t pid : pids) waitpid(pid, nullptr, 0);
+
+  std::vector<double> latency_ms;
+  std::vector<double> last_ms;   // até o último robô, comandos entregues a todos
+  for (int c = 0; c < commands; ++c) {
+    double worst = 0.0;
+    int got = 0;
+    for (int i = 0; i < n; ++i) {
+      const uint32_t v = shared->latency_us[i][c].load();
+      if (!v) continue;
+      const double ms = (v - 1) * 1e-3;
+      latency_ms.push_back(ms);
+      worst = std::max(worst, ms);
+      got++;
+    }
+    if (got == n) last_ms.push_back(worst);
+  }
+  const double expected = static_cast<double>(commands) * n;
+  const double delivered = expected > 0 ? 100.0 * latency_ms.size() / expected : 0.0;
+  const double arrived = published ? 100.0 * received / published : 0.0;
+  const double hz = static_cast<double>(sysconf(_SC_CLK_TCK));
+  const double p50 = percentile(latency_ms, 50.0);
+  const double p99 = percentile(latency_ms, 99.0);
+  const double pmax = latency_ms.empty() ? 0.0 : latency_ms.back();
+
+  char broker_cpu[16] = "-";
+  if (broker0 >= 0 && broker1 >= 0) {
+    snprintf(broker_cpu, sizeof(broker_cpu), "%.1f", (broker1 - broker0) / hz / elapsed * 100.0);
+  }
+  printf("%6d %6d %5zu %9.0f %8.1f %6.1f %8.1f %8.1f %8.1f %8.1f %6.1f %7s %7.0f\n", n,
+         connected, monitor.ids.size(), received / elapsed, received_bytes / elapsed / 1024.0,
+         arrived, p50, p99, pmax, percentile(last_ms, 50.0), delivered, broker_cpu,
+         (robots1 - robots0) / hz / elapsed * 100.0);
+  return ok;
+}
+
+bool parse_robots(const char* text, std::vector<int>& out) {
+  out.clear();
+  for (const char* p = text; *p;) {
+    char* end = nullptr;
+    const long n = strtol(p, &end, 10);
+    if (end == p || n <= 0 || n > kMaxRobots) return false;
+    out.push_back(static_cast<int>(n));
+    p = *end == ',' ? end + 1 : end;
+    if (*end && *end != ',') return false;
+  }
+  return !out.empty();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options o;
+  for (int i = 1; i < argc; ++i) {
+    const bool has = i + 1 < argc;
+    if (strcmp(argv[i], "--host") == 0 && has) {
+      o.host = argv[++i];
+    } else if (strcmp(argv[i], "--port") == 0 && has) {
+      o.port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--robots") == 0 && has && parse_robots(argv[i + 1], o.robots)) {
+      ++i;
+    } else if (strcmp(argv[i], "--seconds") == 0 && has && atof(argv[i + 1]) > 0) {
+      o.seconds = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--warmup-s") == 0 && has && atof(argv[i + 1]) >= 0) {
+      o.warmup_s = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--cmd-period-ms") == 0 && has && atoi(argv[i + 1]) > 0) {
+      o.cmd_period_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--tick-ms") == 0 && has && atoi(argv[i + 1]) > 0) {
+      o.tick_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--telemetry") == 0 && has) {
+      const char* f = argv[++i];
+      if (strcmp(f, "json") == 0) {
+        o.format = TELEMETRY_JSON;
+      } else if (strcmp(f, "binary") == 0) {
+        o.format = TELEMETRY_BINARY;
+      } else if (strcmp(f, "batch") == 0) {
+        o.format = TELEMETRY_BATCH;
+      } else {
+        fprintf(stderr, "telemetry deve ser json, binary ou batch\n");
+        return 2;
+      }
+    } else if (strcmp(argv[i], "--root") == 0 && has && *argv[i + 1]) {
+      o.root = argv[++i];
+    } else if (strcmp(argv[i], "--group") == 0 && has && *argv[i + 1]) {
+      o.group = argv[++i];
+    } else if (strcmp(argv[i], "--broker-pid") == 0 && has) {
+      o.broker_pid = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--broker-name") == 0 && has) {
+      o.broker_name = argv[++i];
+    } else {
+      fprintf(stderr,
+              "uso: %s [--host H] [--port P] [--robots 10,50,100] [--seconds S]"
+              " [--warmup-s W] [--cmd-period-ms M] [--tick-ms T]"
+              " [--telemetry json|binary|batch] [--root R] [--group G]"
+              " [--broker-pid PID | --broker-name NOME]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  void* map = mmap(nullptr, sizeof(Shared), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS,
+                   -1, 0);
+  if (map == MAP_FAILED) {
+    perror("mmap");
+    return 1;
+  }
+  Shared* shared = new (map) Shared();
+  const long broker_pid = o.broker_pid ? o.broker_pid : find_pid(o.broker_name);
+
+  printf("broker %s:%d (pid %s), %.0f s por etapa, comando a cada %u ms em %s/%s/facemesh/cmd\n",
+         o.host, o.port, broker_pid ? std::to_string(broker_pid).c_str() : "?", o.seconds,
+         o.cmd_period_ms, o.root, o.group);
+  printf("%6s %6s %5s %9s %8s %6s %8s %8s %8s %8s %6s %7s %7s\n", "robos", "conect", "ids",
+         "tlm msg/s", "tlm kB/s", "chega%", "fan p50", "fan p99", "fan max", "ultimo", "entr%",
+         "brk cpu", "rob cpu");
+  printf("%6s %6s %5s %9s %8s %6s %8s %8s %8s %8s %6s %7s %7s\n", "", "", "", "", "", "", "ms",
+         "ms", "ms", "p50 ms", "", "%", "%");
+  bool ok = true;
+  for (int n : o.robots) {
+    ok = run_step(n, o, shared, broker_pid) && ok;
+  }
+  munmap(map, sizeof(Shared));
+  return ok ? 0 : 1;
+}
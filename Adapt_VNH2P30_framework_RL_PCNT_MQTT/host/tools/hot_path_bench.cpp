@@ -0,0 +1,219 @@
+// Micro-bancada dos caminhos quentes (hot_path_bench.h) no HAL simulado,
+// com saída em JSON e comparação com uma linha de base: cada kernel é a
+// mediana de --repeats lotes de --iterations chamadas, em ns por chamada, e
+// fica com o melhor de --rounds passadas por todos os kernels.
+//
+// A comparação não usa ns absolutos, que mudam de uma máquina para outra
+// (e, numa máquina compartilhada, de um minuto para outro): o melhor lote
+// de cada kernel é dividido pelo melhor lote do kernel `reference` (só hash
+// e ponto flutuante) intercalado com ele, e a mediana dessas razões entre as
+// passadas vai para a seção "relative" do JSON. Com --baseline, sai com código 1 se algum kernel
+// ficar mais de --threshold % acima da razão guardada (kernels novos ou
+// ausentes só são avisados). O JSON também guarda a máquina onde
+// foi gravado ("host") e o comando para regravar ("refresh"), usado depois
+// de uma mudança aceita no custo de algum kernel.
+//
+// Uso: hot_path_bench [--iterations N] [--repeats R] [--rounds P]
+//                     [--json ARQ|-] [--baseline ARQ] [--threshold PCT]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+#include "hot_path_bench.h"
+#include "motor_control.h"
+#include "sim.h"
+
+namespace {
+
+bool read_file(const char* path, std::string& out) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return false;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.append(buf, n);
+  fclose(f);
+  return true;
+}
+
+// "nome": valor dentro do objeto `section`; NAN se ausente
+double baseline_value(const std::string& json, const char* section, const char* name) {
+  const size_t start = json.find(std::string("\"") + section + "\"");
+  if (start == std::string::npos) return NAN;
+  const size_t end = json.find('}', start);
+  const std::string key = std::string("\"") + name + "\":";
+  const size_t pos = json.find(key, start);
+  if (pos == std::string::npos || pos > end) return NAN;
+  return strtod(json.c_str() + pos + key.size(), nullptr);
+}
+
+// Modelo da CPU (Linux); "desconhecida" fora dele
+std::string cpu_model() {
+  std::string cpuinfo;
+  if (read_file("/proc/cpuinfo", cpuinfo)) {
+    const size_t key = cpuinfo.find("model name");
+    const size_t colon = cpuinfo.find(':', key);
+    if (key != std::string::npos && colon != std::string::npos) {
+      const size_t start = cpuinfo.find_first_not_of(' ', colon + 1);
+      const size_t end = cpuinfo.find('\n', start);
+      std::string model = cpuinfo.substr(start, end - start);
+      for (char& c : model) {
+        if (c == '"' || c == '\\') c = ' ';
+      }
+      return model;
+    }
+  }
+  return "desconhecida";
+}
+
+enum Section { SECTION_MEDIAN, SECTION_MIN, SECTION_RELATIVE };
+
+void write_section(FILE* f, const char* section, const HotPathResult* results, size_t count,
+                   Section which, bool last) {
+  fprintf(f, "  \"%s\": {\n", section);
+  for (size_t i = 0; i < count; ++i) {
+    const char* sep = i + 1 < count ? "," : "";
+    if (which == SECTION_RELATIVE) {
+      fprintf(f, "    \"%s\":%.3f%s\n", results[i].name, results[i].relative, sep);
+    } else {
+      fprintf(f, "    \"%s\":%.1f%s\n", results[i].name,
+              which == SECTION_MIN ? results[i].ns_min : results[i].ns_per_op, sep);
+    }
+  }
+  fprintf(f, "  }%s\n", last ? "" : ",");
+}
+
+void write_json(FILE* f, const HotPathResult* results, size_t count, uint32_t iterations,
+                unsigned repeats) {
+  fprintf(f, "{\n  \"unit\": \"ns/op\",\n  \"iterations\": %u,\n  \"repeats\": %u,\n",
+          iterations, repeats);
+  fprintf(f, "  \"host\": \"%s\",\n", cpu_model().c_str());
+  fprintf(f,
+          "  \"refresh\": \"./build/hot_path_bench --repeats 15 --rounds 15 --json"
+          " host/tools/hot_path_baseline.json\",\n");
+  write_section(f, "kernels", results, count, SECTION_MEDIAN, false);
+  write_section(f, "min", results, count, SECTION_MIN, false);
+  write_section(f, "relative", results, count, SECTION_RELATIVE, true);
+  fprintf(f, "}\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint32_t iterations = 20000;
+  unsigned repeats = 9;
+  unsigned rounds = 5;
+  const char* json_path = nullptr;
+  const char* baseline_path = nullptr;
+  double threshold_pct = 10.0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0) {
+      iterations = static_cast<uint32_t>(atol(argv[++i]));
+    } else if (strcmp(argv[i], "--repeats") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+      repeats = static_cast<unsigned>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+      rounds = static_cast<unsigned>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json_path = argv[++i];
+    } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+      baseline_path = argv[++i];
+    } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+      threshold_pct = atof(argv[++i]);
+    } else {
+      fprintf(stderr,
+              "uso: %s [--iterations N] [--repeats R] [--rounds P] [--json ARQ|-]"
+              " [--baseline ARQ] [--threshold PCT]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (repeats > HOT_PATH_MAX_REPEATS) repeats = HOT_PATH_MAX_REPEATS;
+  if (rounds > HOT_PATH_MAX_REPEATS) rounds = HOT_PATH_MAX_REPEATS;
+
+  std::string baseline;
+  if (baseline_path && !read_file(baseline_path, baseline)) {
+    fprintf(stderr, "não consegui ler a linha de base %s\n", baseline_path);
+    return 2;
+  }
+
+  sim_reset();
+  setupMotor();
+  Stop();
+  encoder();   // primeira chamada só arma o dt
+
+  // Várias passadas por todos os kernels: os ns ficam com o melhor de cada,
+  // a razão com a mediana (uma fase lenta da máquina pega só uma passada)
+  HotPathResult results[HOT_PATH_KERNELS];
+  float relatives[HOT_PATH_KERNELS][HOT_PATH_MAX_REPEATS];
+  size_t count = 0;
+  for (unsigned round = 0; round < rounds; ++round) {
+    HotPathResult pass[HOT_PATH_KERNELS];
+    count = hot_path_bench_run(pass, HOT_PATH_KERNELS, iterations, static_cast<uint8_t>(repeats));
+    for (size_t i = 0; i < count; ++i) {
+      if (round == 0) {
+        results[i] = pass[i];
+      } else {
+        results[i].ns_per_op = fminf(results[i].ns_per_op, pass[i].ns_per_op);
+        results[i].ns_min = fminf(results[i].ns_min, pass[i].ns_min);
+      }
+      relatives[i][round] = pass[i].relative;
+    }
+  }
+  for (size_t i = 0; i < count; ++i) {
+    std::sort(relatives[i], relatives[i] + rounds);
+    results[i].relative = relatives[i][rounds / 2];
+  }
+
+  if (baseline_path) {
+    const std::string key = "\"host\": \"";
+    const size_t start = baseline.find(key);
+    const size_t end = start == std::string::npos ? start : baseline.find('"', start + key.size());
+    printf("linha de base de %s; esta máquina: %s\n",
+           end == std::string::npos ? "máquina não registrada"
+                                    : baseline.substr(start + key.size(),
+                                                      end - start - key.size()).c_str(),
+           cpu_model().c_str());
+  }
+
+  bool regression = false;
+  printf("%-16s %10s %10s %8s", "kernel", "ns/op", "min", "x ref");
+  if (baseline_path) printf(" %8s %8s", "base", "delta");
+  printf("\n");
+  for (size_t i = 0; i < count; ++i) {
+    const HotPathResult& r = results[i];
+    const double relative = r.relative;
+    printf("%-16s %10.1f %10.1f %8.3f", r.name, r.ns_per_op, r.ns_min, relative);
+    if (baseline_path && i > 0) {
+      const double base = baseline_value(baseline, "relative", r.name);
+      if (isnan(base) || base <= 0.0) {
+        printf(" %8s %8s  (sem linha de base)", "-", "-");
+      } else {
+        const double delta = 100.0 * (relative - base) / base;
+        const bool bad = delta > threshold_pct;
+        regression |= bad;
+        printf(" %8.3f %+7.1f%%%s", base, delta, bad ? "  REGRESSAO" : "");
+      }
+    }
+    printf("\n");
+  }
+
+  if (json_path) {
+    FILE* f = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+    if (!f) {
+      fprintf(stderr, "não consegui gravar %s\n", json_path);
+      return 2;
+    }
+    write_json(f, results, count, iterations, repeats);
+    if (f != stdout) fclose(f);
+  }
+
+  if (regression) {
+    printf("regressão acima de %.1f%% contra %s\n", threshold_pct, baseline_path);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,233 @@
+// Latência de ponta a ponta dos comandos remotos a partir do rastreio
+// (command_trace.h): inscreve-se nos tópicos de pong e de rastreio de um
+// broker local e, ao fim, mostra p50/p99/p99,9 de cada etapa do caminho no
+// robô (pelo rastreio, que sai depois do pong com as etapas preenchidas):
+//   parse      recebido -> interpretado
+//   fila       interpretado -> retirado pela tarefa de controle
+//   aplicar    retirado -> ponte H escrita
+//   movimento  ponte H escrita -> primeiro ciclo do encoder com movimento
+//   total      recebido -> movimento
+// Os carimbos são do relógio do robô (µs, 32 bits), então só diferenças
+// entre eles entram na conta. Etapas com carimbo 0 (comando substituído ou
+// que não mexeu no robô) ficam fora do percentil e são contadas à parte.
+//
+// Com --send N a ferramenta também publica N comandos yaw|pitch|nonce|t0
+// em --cmd-topic, alternando frente/parada/giro/parada para que cada um
+// mude a velocidade; o t0 é o relógio dela, e o pong de volta (que sai
+// assim que o robô aceita o comando) dá a ida e volta completa. O tempo
+// fora do robô é a ida e volta menos recebido -> interpretado.
+//
+// Uso: latency_report [--host H] [--port P] [--topic T] [--trace-topic T]
+//                     [--seconds S] [--send N] [--rate-hz R] [--cmd-topic T]
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "mqtt_wire.h"
+
+namespace {
+
+enum Stage {
+  STAGE_PARSE = 0,
+  STAGE_QUEUE,
+  STAGE_APPLY,
+  STAGE_MOTION,
+  STAGE_TOTAL,
+  STAGE_ROUND_TRIP,
+  STAGE_OFF_ROBOT,
+  STAGE_COUNT,
+};
+
+const char* const kStageNames[STAGE_COUNT] = {
+    "parse", "fila", "aplicar", "movimento", "total", "ida e volta", "fora do robo",
+};
+
+const char* const kNoncePrefix = "lat-";
+
+struct Report {
+  std::string pong_topic;
+  std::vector<double> us[STAGE_COUNT];
+  unsigned long pongs = 0;
+  unsigned long traces = 0;
+  unsigned long malformed = 0;
+  unsigned long superseded = 0;   // nunca retirado da fila
+  unsigned long no_motion = 0;    // aplicado sem mudar a velocidade
+  uint64_t start_us = 0;
+};
+
+uint64_t now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Pong e rastreio:
+// nonce|timestamp|executed_at|yaw|pitch|acao|status|rx|parse|deq|apply|motion
+void on_message(const char* topic, const uint8_t* payload, size_t length, void* ctx) {
+  Report& report = *static_cast<Report*>(ctx);
+  const uint64_t arrived_us = now_us();
+  std::vector<std::string> fields;
+  std::string field;
+  for (size_t i = 0; i < length; ++i) {
+    if (payload[i] == '|') {
+      fields.push_back(field);
+      field.clear();
+    } else {
+      field += static_cast<char>(payload[i]);
+    }
+  }
+  fields.push_back(field);
+  if (fields.size() < 12) {
+    report.malformed++;
+    return;
+  }
+  uint32_t stamp[5];
+  for (int i = 0; i < 5; ++i) {
+    stamp[i] = static_cast<uint32_t>(strtoul(fields[7 + i].c_str(), nullptr, 10));
+  }
+
+  if (report.pong_topic == topic) {
+    report.pongs++;
+    // Ida e volta só dos comandos enviados por esta ferramenta
+    if (fields[0].compare(0, strlen(kNoncePrefix), kNoncePrefix) == 0) {
+      const uint64_t sent_us = report.start_us + strtoull(fields[1].c_str(), nullptr, 10);
+      const double rtt = static_cast<double>(arrived_us - sent_us);
+      report.us[STAGE_ROUND_TRIP].push_back(rtt);
+      if (stamp[0] && stamp[1]) {
+        report.us[STAGE_OFF_ROBOT].push_back(rtt - static_cast<uint32_t>(stamp[1] - stamp[0]));
+      }
+    }
+    return;
+  }
+  report.traces++;
+
+  // Diferença módulo 2^32 entre dois carimbos presentes
+  for (int i = 0; i < 4; ++i) {
+    if (stamp[i] && stamp[i + 1]) {
+      report.us[STAGE_PARSE + i].push_back(static_cast<uint32_t>(stamp[i + 1] - stamp[i]));
+    }
+  }
+  if (!stamp[2]) {
+    report.superseded++;
+  } else if (stamp[3] && !stamp[4]) {
+    report.no_motion++;
+  }
+  if (stamp[0] && stamp[4]) {
+    report.us[STAGE_TOTAL].push_back(static_cast<uint32_t>(stamp[4] - stamp[0]));
+  }
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+  // Posto mais próximo
+  size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.999999);
+  if (rank < 1) rank = 1;
+  if (rank > sorted.size()) rank = sorted.size();
+  return sorted[rank - 1];
+}
+
+// Frente, parada, giro à esquerda, parada (yaw|pitch em graus)
+void send_command(MqttWireClient& client, const char* topic, unsigned long index,
+                  uint64_t start_us) {
+  static const float kPattern[4][2] = {{0.0f, -30.0f}, {0.0f, 0.0f}, {-30.0f, 0.0f}, {0.0f, 0.0f}};
+  const float* cmd = kPattern[index % 4];
+  char payload[96];
+  const int n = snprintf(payload, sizeof(payload), "%.1f|%.1f|%s%lu|%" PRIu64, cmd[0], cmd[1],
+                         kNoncePrefix, index, now_us() - start_us);
+  client.publish(topic, reinterpret_cast<const uint8_t*>(payload), static_cast<size_t>(n));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* host = "127.0.0.1";
+  int port = 1883;
+  const char* topic = "facemesh/pong";
+  const char* trace_topic = "facemesh/pong/trace";
+  const char* cmd_topic = "facemesh/cmd";
+  double seconds = 30.0;
+  unsigned long send = 0;
+  double rate_hz = 10.0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+      host = argv[++i];
+    } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--topic") == 0 && i + 1 < argc) {
+      topic = argv[++i];
+    } else if (strcmp(argv[i], "--trace-topic") == 0 && i + 1 < argc) {
+      trace_topic = argv[++i];
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--send") == 0 && i + 1 < argc) {
+      send = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--rate-hz") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+      rate_hz = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--cmd-topic") == 0 && i + 1 < argc) {
+      cmd_topic = argv[++i];
+    } else {
+      fprintf(stderr,
+              "uso: %s [--host H] [--port P] [--topic T] [--trace-topic T] [--seconds S]"
+              " [--send N] [--rate-hz R] [--cmd-topic T]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  MqttWireClient client;
+  if (!client.start_connect(host, port, "latency_report", nullptr, nullptr)) {
+    fprintf(stderr, "falha ao conectar em %s:%d\n", host, port);
+    return 1;
+  }
+  while (client.poll_connect() == MqttWireClient::CONNECTING) {
+    usleep(1000);
+  }
+  if (!client.connected() || !client.subscribe(topic) || !client.subscribe(trace_topic)) {
+    fprintf(stderr, "falha ao conectar em %s:%d (rc=%d)\n", host, port, client.last_error());
+    return 1;
+  }
+  printf("inscrito em %s e %s em %s:%d por %.0f s", topic, trace_topic, host, port, seconds);
+  if (send) printf(", enviando %lu comandos a %.1f Hz em %s", send, rate_hz, cmd_topic);
+  printf("\n");
+
+  Report report;
+  report.pong_topic = topic;
+  report.start_us = now_us();
+  const uint64_t period_us = static_cast<uint64_t>(1e6 / rate_hz);
+  const uint64_t end_us = report.start_us + static_cast<uint64_t>(seconds * 1e6);
+  unsigned long sent = 0;
+  uint64_t next_send_us = report.start_us;
+  while (now_us() < end_us) {
+    if (sent < send && now_us() >= next_send_us) {
+      send_command(client, cmd_topic, sent++, report.start_us);
+      next_send_us += period_us;
+    }
+    if (!client.loop(on_message, &report, 5)) {
+      fprintf(stderr, "conexão perdida (rc=%d)\n", client.last_error());
+      break;
+    }
+  }
+  client.disconnect();
+
+  printf("pongs=%lu rastreios=%lu malformados=%lu substituidos=%lu sem movimento=%lu\n",
+         report.pongs, report.traces, report.malformed, report.superseded, report.no_motion);
+  printf("%-14s %7s %10s %10s %10s %10s\n", "etapa (us)", "n", "p50", "p99", "p99.9", "max");
+  for (int s = 0; s < STAGE_COUNT; ++s) {
+    std::vector<double>& v = report.us[s];
+    if (v.empty()) {
+      printf("%-14s %7d %10s %10s %10s %10s\n", kStageNames[s], 0, "-", "-", "-", "-");
+      continue;
+    }
+    std::sort(v.begin(), v.end());
+    printf("%-14s %7zu %10.0f %10.0f %10.0f %10.0f\n", kStageNames[s], v.size(),
+           percentile(v, 50.0), percentile(v, 99.0), percentile(v, 99.9), v.back());
+  }
+  return report.traces ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+// Trocas de comando na planta simulada com a referência em degrau
+// (comportamento original), em trapézio e em curva S (motion_profile.h),
+// sempre com o PID de speed_controller.h. Cada cenário acomoda o comando
+// inicial e então troca para o final; a planta é lida a cada 1 ms para não
+// perder o pico de corrente logo depois de cada mudança de PWM.
+//
+// Métricas (pior das duas rodas): tempo até o alvo (entrar e ficar na faixa
+// de ±2 % da referência padrão em torno da velocidade final), pico e RMS da
+// corrente de armadura durante a troca, maior aceleração do eixo do motor e
+// sobressinal. A aceleração do eixo é o que vira escorregamento no chão; a
+// planta não modela o pneu, então ela é a medida usada aqui.
+//
+// --accel/--jerk trocam os limites do eixo linear; o angular segue na mesma
+// proporção do padrão.
+//
+// Uso: motion_profile_bench [--seconds S] [--accel A] [--jerk J]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "control_task.h"
+#include "motor_control.h"
+#include "plant.h"
+#include "sim.h"
+
+namespace {
+
+// Referência dos comandos padrão (pwmToTargetVelocity(159)), rad/s no motor
+const double kTarget = 159.0 * Robot::kMotorRadSPerPwm;
+const double kBand = 0.02;
+const uint32_t kSampleUs = 1000;
+
+struct Scenario {
+  const char* name;
+  MotionCommand from;
+  MotionCommand to;
+  double final_r;  // velocidade final esperada de cada roda (com sinal)
+  double final_l;
+};
+
+const Scenario kScenarios[] = {
+    {"partida", MOTION_STOP, MOTION_FORWARD, kTarget, kTarget},
+    {"parada", MOTION_FORWARD, MOTION_STOP, 0.0, 0.0},
+    {"frente->re", MOTION_FORWARD, MOTION_REVERSE, -kTarget, -kTarget},
+    {"frente->esq.", MOTION_FORWARD, MOTION_TURN_LEFT, -kTarget, kTarget},
+};
+
+struct Variant {
+  const char* name;
+  MotionProfileMode mode;
+};
+
+const Variant kVariants[] = {
+    {"degrau", PROFILE_STEP},
+    {"trapezio", PROFILE_TRAPEZOID},
+    {"curva S", PROFILE_SCURVE},
+};
+
+struct Metrics {
+  double reach_ms;
+  double peak_a;
+  double rms_a;
+  double peak_accel;   // rad/s² no eixo do motor
+  double overshoot_pct;
+};
+
+Metrics run(const Scenario& sc, const MotionProfileConfig& config, double seconds) {
+  sim_reset();
+  SimPlant plant;
+  plant.attach(100);
+  setupMotor();
+  motor_set_motion_profile(config);
+  Stop();
+  encoder();
+
+  // Acomoda o comando inicial
+  apply_motion_command(sc.from);
+  const uint32_t period_us = CONTROL_PERIOD_US;
+  for (int i = 0; i < 60; ++i) {
+    sim_clock_advance_us(period_us);
+    encoder();
+  }
+
+  Metrics m = {0, 0, 0, 0, 0};
+  const double finals[2] = {sc.final_r, sc.final_l};
+  double last_out[2] = {0, 0};       // último instante fora da faixa (ms)
+  double prev_omega[2] = {plant.wheel[MOTOR_R].omega, plant.wheel[MOTOR_L].omega};
+  double sum_sq = 0;
+  size_t samples = 0;
+
+  apply_motion_command(sc.to);
+  const size_t cycles = static_cast<size_t>(seconds * 1e6 / period_us);
+  for (size_t c = 0; c < cycles; ++c) {
+    for (uint32_t t = 0; t < period_us; t += kSampleUs) {
+      sim_clock_advance_us(kSampleUs);
+      const double now_ms = (c * period_us + t + kSampleUs) / 1000.0;
+      for (int w = 0; w < 2; ++w) {
+        const SimWheelState& s = plant.wheel[w];
+        m.peak_a = fmax(m.peak_a, fabs(s.current));
+        sum_sq += s.current * s.current;
+        const double accel = (s.omega - prev_omega[w]) / (kSampleUs * 1e-6);
+        m.peak_accel = fmax(m.peak_accel, fabs(accel));
+        prev_omega[w] = s.omega;
+        if (fabs(s.omega - finals[w]) > kBand * kTarget) last_out[w] = now_ms;
+        // Sobressinal: passar da velocidade final no sentido do movimento
+        if (finals[w] != 0.0) {
+          const double over = (s.omega - finals[w]) * (finals[w] > 0 ? 1.0 : -1.0);
+          m.overshoot_pct = fmax(m.overshoot_pct, 100.0 * over / kTarget);
+        }
+      }
+      ++samples;
+    }
+    encoder();
+  }
+  plant.detach();
+  Stop();
+
+  m.reach_ms = fmax(last_out[0], last_out[1]);
+  if (m.reach_ms >= seconds * 1000.0 - 1.0) m.reach_ms = INFINITY;
+  m.rms_a = sqrt(sum_sq / (2.0 * samples));
+  return m;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double seconds = 3.0;
+  MotionProfileConfig base = motion_profile_default_config();
+  const float angular_ratio = base.angular.accel / base.linear.accel;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--accel") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+      base.linear.accel = static_cast<float>(atof(argv[++i]));
+    } else if (strcmp(argv[i], "--jerk") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+      base.linear.jerk = static_cast<float>(atof(argv[++i]));
+    } else {
+      fprintf(stderr, "uso: %s [--seconds S] [--accel A] [--jerk J]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (seconds < 1.0) seconds = 1.0;
+  base.angular.accel = base.linear.accel * angular_ratio;
+  base.angular.jerk = base.linear.jerk * angular_ratio;
+
+  printf("referencia %.1f rad/s no motor, linear %.2f m/s2 / %.1f m/s3, angular %.2f rad/s2"
+         " / %.1f rad/s3\n",
+         kTarget, base.linear.accel, base.linear.jerk, base.angular.accel, base.angular.jerk);
+  printf("%-14s %-9s %10s %9s %9s %12s %9s\n", "troca", "perfil", "alvo (ms)", "pico (A)",
+         "rms (A)", "acel (r/s2)", "sobr. (%)");
+  for (const Scenario& sc : kScenarios) {
+    for (const Variant& var : kVariants) {
+      MotionProfileConfig config = base;
+      config.mode = var.mode;
+      const Metrics m = run(sc, config, seconds);
+      printf("%-14s %-9s", sc.name, var.name);
+      if (isinf(m.reach_ms)) {
+        printf(" %10s", "nunca");
+      } else {
+        printf(" %10.0f", m.reach_ms);
+      }
+      printf(" %9.2f %9.2f %12.0f %9.1f\n", m.peak_a, m.rms_a, m.peak_accel, m.overshoot_pct);
+    }
+  }
+  return 0;
+}
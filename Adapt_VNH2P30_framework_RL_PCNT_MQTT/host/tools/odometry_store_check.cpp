@@ -0,0 +1,324 @@
+// Confere o store-and-forward da odometria (odometry_store.h) com a flash
+// simulada num arquivo (sim_flash_use_file):
+//
+//   queda    o firmware inteiro roda com o broker fora do ar por S segundos
+//            e o robô andando (botão de frente segurado); a odometria ao
+//            vivo (lote) e o reenvio em robot/odometry/backfill juntos têm
+//            de cobrir todo seq, sem buraco nem repetição, com o t_ms
+//            original (um período de controle entre seqs vizinhos) e o
+//            reenvio dentro do ritmo configurado. Nenhum setor pode ser
+//            apagado durante a queda: a gravação usa os já apagados.
+//   reboot   grava, reenvia parte, corta um registro ao meio e remonta a
+//            partição do arquivo: o reenvio continua na amostra seguinte e
+//            o registro cortado é pulado.
+//   desgaste grava 3,5 voltas da partição sem reenviar, com o robô parado
+//            (apaga à frente antes de cada amostra): os apagamentos por
+//            setor diferem no máximo em 1 e ficam as amostras mais novas.
+//            Sem apagar (robô andando), a gravação para no fim dos setores
+//            apagados e conta o resto em skipped.
+//
+// Sai com código 1 se alguma verificação falhar.
+//
+// Uso: odometry_store_check [--outage-s S] [--flash ARQUIVO]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <map>
+#include <string>
+
+#include "control_task.h"
+#include "mqtt_client.h"
+#include "odometry_store.h"
+#include "plant.h"
+#include "sim.h"
+
+void setup();
+extern int botao_frente;
+
+namespace {
+
+int g_failures = 0;
+
+void check(bool ok, const char* what) {
+  printf("  %-58s %s\n", what, ok ? "ok" : "FALHOU");
+  if (!ok) g_failures++;
+}
+
+struct Capture {
+  std::map<uint32_t, uint32_t> live;       // seq -> t_ms
+  std::map<uint32_t, uint32_t> backfill;
+  unsigned long backfill_messages = 0;
+  size_t backfill_max_samples = 0;
+  uint64_t backfill_min_gap_us = UINT64_MAX;
+  uint64_t last_backfill_us = 0;
+  uint64_t first_backfill_us = 0;
+};
+
+void on_publish(const char* topic, const uint8_t* payload, size_t length, void* ctx) {
+  Capture& c = *static_cast<Capture*>(ctx);
+  const bool live = strcmp(topic, "robot/odometry") == 0;
+  const bool backfill = strcmp(topic, "robot/odometry/backfill") == 0;
+  if (!live && !backfill) return;
+  OdometrySample samples[TELEMETRY_BATCH_MAX_SAMPLES];
+  const size_t n =
+      telemetry_decode_odometry_batch(payload, length, samples, TELEMETRY_BATCH_MAX_SAMPLES);
+  std::map<uint32_t, uint32_t>& into = live ? c.live : c.backfill;
+  for (size_t i = 0; i < n; ++i) into[samples[i].seq] = samples[i].t_ms;
+  if (backfill) {
+    const uint64_t now = sim_clock_us();
+    if (c.backfill_messages == 0) {
+      c.first_backfill_us = now;
+    } else if (now - c.last_backfill_us < c.backfill_min_gap_us) {
+      c.backfill_min_gap_us = now - c.last_backfill_us;
+    }
+    c.last_backfill_us = now;
+    c.backfill_messages++;
+    if (n > c.backfill_max_samples) c.backfill_max_samples = n;
+  }
+}
+
+void run_outage(const char* flash, double outage_s) {
+  printf("queda do broker por %.0f s\n", outage_s);
+  unlink(flash);
+  sim_flash_use_file(flash);
+  Capture capture;
+  sim_reset();
+  sim_mqtt_set_publish_hook(on_publish, &capture);
+  net_set_odom_format(TELEMETRY_BATCH);   // seq/t_ms de cada amostra ao vivo
+  SimPlant plant;
+  plant.attach(100);
+  setup();
+
+  const uint64_t start = sim_clock_us();
+  const uint64_t outage_from = start + 5000000;
+  const uint64_t outage_to = outage_from + static_cast<uint64_t>(outage_s * 1e6);
+  sim_broker_schedule_outage(outage_from, outage_to);
+  // Anda a queda inteira: a flash não pode ser apagada nesse intervalo
+  const uint64_t press_from = outage_from - 1000000;
+  bool pressed = false;
+  bool in_outage = false;
+  bool released = false;
+  uint32_t erases_at_outage = 0;
+  uint32_t erases_during_outage = 0;
+  auto total_erases = [] {
+    uint32_t sum = 0;
+    for (uint32_t s = 0; s < SIM_FLASH_BYTES / HAL_FLASH_SECTOR_BYTES; ++s) {
+      sum += sim_flash_erase_count(s);
+    }
+    return sum;
+  };
+  // Depois da volta: reconexão (backoff) + reenvio a 5x o tempo real
+  const uint64_t limit = outage_to + static_cast<uint64_t>(outage_s * 1e6) + 30000000;
+  uint64_t drained_at = 0;
+  while (sim_clock_us() < limit) {
+    sim_clock_advance_us(200);
+    sim_run_loop_tasks();
+    const uint64_t now = sim_clock_us();
+    if (!pressed && now >= press_from) {
+      sim_gpio_set_input(static_cast<uint8_t>(botao_frente), true);
+      pressed = true;
+    }
+    if (!in_outage && now >= outage_from) {
+      erases_at_outage = total_erases();
+      in_outage = true;
+    }
+    if (!released && now >= outage_to) {
+      erases_during_outage = total_erases() - erases_at_outage;
+      sim_gpio_set_input(static_cast<uint8_t>(botao_frente), false);
+      released = true;
+    }
+    if (sim_clock_us() > outage_to && odometry_store_stats().pending == 0) {
+      if (!drained_at) drained_at = sim_clock_us();
+      if (sim_clock_us() - drained_at > 2000000) break;   // ao vivo depois do reenvio
+    }
+  }
+  sim_mqtt_set_publish_hook(nullptr, nullptr);
+
+  std::map<uint32_t, uint32_t> all = capture.live;
+  unsigned long duplicates = 0;
+  for (const auto& kv : capture.backfill) {
+    if (!all.insert(kv).second) duplicates++;
+  }
+  unsigned long missing = 0;
+  unsigned long bad_t = 0;
+  const uint32_t period_ms = CONTROL_PERIOD_US / 1000;
+  const uint32_t first = all.empty() ? 0 : all.begin()->first;
+  const uint32_t last = all.empty() ? 0 : all.rbegin()->first;
+  for (uint32_t seq = first; !all.empty() && seq < last; ++seq) {
+    auto a = all.find(seq);
+    auto b = all.find(seq + 1);
+    if (a == all.end()) {
+      missing++;
+    } else if (b != all.end() && b->second - a->second != period_ms) {
+      bad_t++;
+    }
+  }
+
+  OdometryStoreStats st = odometry_store_stats();
+  TelemetryStats tlm = net_telemetry_stats();
+  const double backfill_s = (capture.last_backfill_us - capture.first_backfill_us) * 1e-6;
+  printf("  ao vivo %zu, reenviadas %zu em %lu mensagens (%.1f s), guardadas %u\n",
+         capture.live.size(), capture.backfill.size(), capture.backfill_messages, backfill_s,
+         tlm.stored);
+  printf("  seq %u..%u: %lu faltando, %lu repetidas, %lu com t_ms fora do periodo\n", first,
+         last, missing, duplicates, bad_t);
+  printf("  menor intervalo entre reenvios %.0f ms, maior lote %zu amostras\n",
+         capture.backfill_messages > 1 ? capture.backfill_min_gap_us * 1e-3 : 0.0,
+         capture.backfill_max_samples);
+  printf("  setores apagados durante a queda %u, depois %u; %u prontos no fim\n",
+         erases_during_outage, total_erases() - erases_at_outage - erases_during_outage,
+         st.erased_ahead);
+  check(st.mounted, "particao montada");
+  check(capture.backfill.size() >= outage_s * 1000 / period_ms * 0.95,
+        "queda inteira guardada e reenviada");
+  check(missing == 0 && duplicates == 0, "ao vivo + reenvio cobrem todo seq uma vez");
+  check(bad_t == 0, "t_ms original (um periodo entre seqs vizinhos)");
+  check(capture.backfill_messages < 2 || capture.backfill_min_gap_us >= 200000,
+        "reenvio no ritmo (>= 200 ms entre lotes)");
+  check(capture.backfill_max_samples <= 20, "lotes de no maximo 20 amostras");
+  check(st.pending == 0 && st.overwritten == 0 && st.corrupt == 0 && st.skipped == 0,
+        "nada pendente ou perdido");
+  check(released && erases_during_outage == 0, "nenhum apagamento com o robo andando offline");
+}
+
+OdometrySample make_sample(uint32_t seq) {
+  OdometrySample s = {};
+  s.seq = seq;
+  s.t_ms = 1000 + seq * 50;
+  s.x = seq * 0.001f;
+  return s;
+}
+
+void run_reboot(const char* flash) {
+  printf("reboot com registro cortado\n");
+  unlink(flash);
+  sim_flash_use_file(flash);
+  sim_reset();
+  odometry_store_begin();
+  const uint32_t total = 300;   // mais de dois setores
+  for (uint32_t i = 0; i < total; ++i) {
+    odometry_store_erase_ahead(true);
+    odometry_store_append(make_sample(i));
+  }
+  OdometrySample out[TELEMETRY_BATCH_MAX_SAMPLES];
+  uint32_t sent = 0;
+  for (int batch = 0; batch < 7; ++batch) {
+    const size_t n = odometry_store_peek(out, 20);
+    odometry_store_consume(n);
+    sent += n;
+  }
+  // Energia cortada no meio do próximo registro: parte dos bytes escrita
+  const uint8_t half[12] = {ODOM_STORE_MARK, 0xFF, 0x12, 0x34, 0x52, 0x01, 0x01, 0x00};
+  const uint32_t slots = (HAL_FLASH_SECTOR_BYTES - ODOM_STORE_HEADER_BYTES) / ODOM_STORE_RECORD_BYTES;
+  const uint32_t next = total % slots;
+  const uint32_t sector = total / slots;
+  hal_flash_write(sector * HAL_FLASH_SECTOR_BYTES + ODOM_STORE_HEADER_BYTES +
+                      next * ODOM_STORE_RECORD_BYTES,
+                  half, sizeof(half));
+
+  sim_reset();   // o arquivo fica
+  odometry_store_begin();
+  OdometryStoreStats st = odometry_store_stats();
+  printf("  %u gravadas, %u reenviadas antes do reboot; depois: %u pendentes\n", total, sent,
+         st.pending);
+  check(st.pending == total - sent + 1, "pendentes (e o registro cortado) sobrevivem ao reboot");
+  size_t n = odometry_store_peek(out, 1);
+  check(n == 1 && out[0].seq == sent && out[0].t_ms == 1000 + sent * 50,
+        "reenvio continua na amostra seguinte, com t_ms original");
+  odometry_store_append(make_sample(total));
+  uint32_t expect = sent;
+  bool ordered = true;
+  while ((n = odometry_store_peek(out, 20)) > 0) {
+    for (size_t i = 0; i < n; ++i) ordered = ordered && out[i].seq == expect++;
+    odometry_store_consume(n);
+  }
+  st = odometry_store_stats();
+  check(ordered && expect == total + 1, "todas em ordem, registro cortado pulado");
+  check(st.corrupt == 1, "registro cortado contado como corrompido");
+}
+
+void run_wear() {
+  printf("desgaste sem reenvio\n");
+  sim_flash_use_file(nullptr);
+  sim_reset();
+  odometry_store_begin();
+  OdometryStoreStats st = odometry_store_stats();
+  const uint32_t total = st.capacity * 7 / 2;
+  for (uint32_t i = 0; i < total; ++i) {
+    odometry_store_erase_ahead(true);
+    odometry_store_append(make_sample(i));
+  }
+  st = odometry_store_stats();
+  const uint32_t sectors = SIM_FLASH_BYTES / HAL_FLASH_SECTOR_BYTES;
+  uint32_t min_erases = UINT32_MAX;
+  uint32_t max_erases = 0;
+  for (uint32_t s = 0; s < sectors; ++s) {
+    const uint32_t e = sim_flash_erase_count(s);
+    if (e < min_erases) min_erases = e;
+    if (e > max_erases) max_erases = e;
+  }
+  OdometrySample oldest;
+  const size_t n = odometry_store_peek(&oldest, 1);
+  printf("  %u gravadas em %u registros: %u pendentes, %u sobrescritas,"
+         " apagamentos por setor %u..%u\n",
+         total, st.capacity, st.pending, st.overwritten, min_erases, max_erases);
+  check(max_erases - min_erases <= 1, "apagamentos iguais em todos os setores (+-1)");
+  check(st.pending + st.overwritten == total, "pendentes + sobrescritas = gravadas");
+  check(st.pending >= st.capacity - (st.capacity / sectors), "particao cheia menos um setor");
+  check(n == 1 && oldest.seq == total - st.pending, "ficam as amostras mais novas");
+
+  // Robô andando: nenhum apagamento, a gravação para nos setores apagados
+  sim_reset();
+  odometry_store_begin();
+  st = odometry_store_stats();
+  const uint32_t ready = st.erased_ahead;
+  uint32_t stored = 0;
+  for (uint32_t i = 0; i < st.capacity; ++i) {
+    if (odometry_store_append(make_sample(i))) stored++;
+  }
+  const uint32_t slots = st.capacity / sectors;
+  st = odometry_store_stats();
+  printf("  sem apagar: %u setores prontos, %u gravadas, %u recusadas\n", ready, stored,
+         st.skipped);
+  check(st.erases == 0 && stored == ready * slots && st.skipped == st.capacity - stored,
+        "sem apagar, grava so nos setores prontos e conta o resto");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double outage_s = 60.0;
+  std::string flash;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--outage-s") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+      outage_s = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--flash") == 0 && i + 1 < argc) {
+      flash = argv[++i];
+    } else {
+      fprintf(stderr, "uso: %s [--outage-s S] [--flash ARQUIVO]\n", argv[0]);
+      return 2;
+    }
+  }
+  const bool temporary = flash.empty();
+  if (temporary) {
+    char path[] = "/tmp/odomlog_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+      perror("mkstemp");
+      return 2;
+    }
+    close(fd);
+    flash = path;
+  }
+
+  run_outage(flash.c_str(), outage_s);
+  run_reboot(flash.c_str());
+  run_wear();
+
+  if (temporary) unlink(flash.c_str());
+  printf("%s\n", g_failures ? "FALHOU" : "ok");
+  return g_failures ? 1 : 0;
+}
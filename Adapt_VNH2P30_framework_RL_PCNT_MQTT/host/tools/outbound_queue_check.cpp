@@ -0,0 +1,233 @@
+// Confere a fila de saída do MQTT (outbound_queue.h) com o firmware inteiro
+// num uplink lento (sim_mqtt_set_uplink): o publish bloqueia como num socket
+// TCP cheio, e telemetria + debug passam da vazão do link.
+//
+// Três rodadas de S segundos (padrão 60 s, 800 B/s, buffer de 1460 B), com
+// um comando yaw|pitch|nonce|t0 a cada --cmd-period-ms (alternando
+// frente/parada) e odometria em binário (seq e t_ms em cada quadro):
+//   livre       uplink sem limite (referência)
+//   sem fila    uplink lento, cada mensagem direto ao socket (como antes)
+//   com fila    uplink lento, fila com prioridade
+// Para cada uma mostra o pong (comando injetado -> pong publicado), a saída
+// do rastreio (etapa mais recente carimbada -> rastreio publicado), a idade
+// da pose ao sair (relógio - t_ms) e os contadores por classe da fila. Os instantes são os do fim do publish.
+//
+// Sai com código 1 se, com a fila, algum comando ficar sem pong, o pong não
+// sair antes que sem ela, a pose não for coalescida ou o debug não for
+// descartado sob contrapressão.
+//
+// Uso: outbound_queue_check [--seconds S] [--uplink-bps B] [--buffer BYTES]
+//                           [--cmd-period-ms MS]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "mqtt_client.h"
+#include "plant.h"
+#include "sim.h"
+
+void setup();
+
+namespace {
+
+int g_failures = 0;
+
+void check(bool ok, const char* what) {
+  printf("  %-58s %s\n", what, ok ? "ok" : "FALHOU");
+  if (!ok) g_failures++;
+}
+
+double percentile(std::vector<double> v, double p) {
+  if (v.empty()) return 0.0;
+  std::sort(v.begin(), v.end());
+  size_t rank = static_cast<size_t>(p / 100.0 * v.size() + 0.999999);
+  if (rank < 1) rank = 1;
+  if (rank > v.size()) rank = v.size();
+  return v[rank - 1];
+}
+
+struct Run {
+  const char* name;
+  uint32_t uplink_bps;
+  bool queue;
+};
+
+struct Capture {
+  std::map<std::string, uint64_t> injected;   // nonce -> relógio
+  std::vector<double> pong_ms;                // injetado -> pong
+  std::vector<double> exit_ms;                // rastreio completo -> publicado
+  std::vector<double> pose_age_ms;
+  unsigned long debug = 0;
+  unsigned long bytes = 0;
+};
+
+// Último campo do rastreio com carimbo não nulo (aplicado ou movimento), em µs
+uint32_t last_stamp(const std::vector<std::string>& fields) {
+  uint32_t last = 0;
+  for (size_t i = 9; i < fields.size() && i < 12; ++i) {
+    const uint32_t v = static_cast<uint32_t>(strtoul(fields[i].c_str(), nullptr, 10));
+    if (v) last = v;
+  }
+  return last;
+}
+
+void on_publish(const char* topic, const uint8_t* payload, size_t length, void* ctx) {
+  Capture& c = *static_cast<Capture*>(ctx);
+  const uint64_t now = sim_clock_us();
+  c.bytes += length;
+  const bool pong = strcmp(topic, "facemesh/pong") == 0;
+  if (pong || strcmp(topic, "facemesh/pong/trace") == 0) {
+    std::vector<std::string> fields(1);
+    for (size_t i = 0; i < length; ++i) {
+      if (payload[i] == '|') {
+        fields.emplace_back();
+      } else {
+        fields.back() += static_cast<char>(payload[i]);
+      }
+    }
+    if (fields.size() < 12) return;
+    if (!pong) {
+      const uint32_t stamp = last_stamp(fields);
+      if (stamp) c.exit_ms.push_back((static_cast<uint32_t>(now) - stamp) * 1e-3);
+      return;
+    }
+    auto it = c.injected.find(fields[0]);
+    if (it == c.injected.end()) return;
+    c.pong_ms.push_back((now - it->second) * 1e-3);
+    c.injected.erase(it);
+  } else if (strcmp(topic, "robot/odometry") == 0) {
+    OdometrySample s;
+    if (telemetry_decode_odometry(payload, length, s)) {
+      c.pose_age_ms.push_back(static_cast<uint32_t>(now / 1000) - s.t_ms);
+    }
+  } else if (strcmp(topic, "robot/odometry/debug") == 0) {
+    c.debug++;
+  }
+}
+
+struct Result {
+  unsigned long commands = 0;
+  unsigned long unanswered = 0;
+  double pong_p50 = 0, pong_p99 = 0, exit_p99 = 0;
+  OutboundClassStats out[OUTBOUND_CLASS_COUNT] = {};
+};
+
+Result run(const Run& r, double seconds, uint32_t buffer, uint32_t cmd_period_ms) {
+  Capture capture;
+  sim_reset();
+  sim_mqtt_set_publish_hook(on_publish, &capture);
+  net_set_odom_format(TELEMETRY_BINARY);
+  net_set_outbound_queue(r.queue);
+  SimPlant plant;
+  plant.attach(100);
+  setup();
+
+  // Conecta com o link livre; o limite vale a partir do primeiro comando
+  const uint64_t start = sim_clock_us() + 2000000;
+  while (sim_clock_us() < start) {
+    sim_clock_advance_us(200);
+    sim_run_loop_tasks();
+  }
+  sim_mqtt_set_uplink(r.uplink_bps, buffer);
+  const uint64_t end = start + static_cast<uint64_t>(seconds * 1e6);
+  uint64_t next_cmd = start;
+  Result res;
+  while (sim_clock_us() < end + 3000000) {
+    // Com a tarefa de rede presa num publish o relógio pula vários períodos:
+    // os comandos chegaram ao broker no horário e esperam a leitura
+    while (sim_clock_us() >= next_cmd && next_cmd < end) {
+      char nonce[16];
+      char payload[64];
+      snprintf(nonce, sizeof(nonce), "q%lu", res.commands);
+      snprintf(payload, sizeof(payload), "0|%s|%s|%lu", res.commands % 2 ? "0" : "-20", nonce,
+               static_cast<unsigned long>(next_cmd / 1000));
+      capture.injected[nonce] = next_cmd;
+      sim_mqtt_inject("facemesh/cmd", payload);
+      res.commands++;
+      next_cmd += static_cast<uint64_t>(cmd_period_ms) * 1000;
+    }
+    sim_clock_advance_us(200);
+    sim_run_loop_tasks();
+  }
+  sim_mqtt_set_publish_hook(nullptr, nullptr);
+  sim_mqtt_set_uplink(0, 0);
+  net_set_outbound_queue(true);
+
+  res.unanswered = capture.injected.size();
+  res.pong_p50 = percentile(capture.pong_ms, 50.0);
+  res.pong_p99 = percentile(capture.pong_ms, 99.0);
+  res.exit_p99 = percentile(capture.exit_ms, 99.0);
+  for (int c = 0; c < OUTBOUND_CLASS_COUNT; ++c) {
+    res.out[c] = net_outbound_stats(static_cast<OutboundClass>(c));
+  }
+
+  printf("%-9s  pong p50 %7.1f ms  p99 %7.1f ms  saida p99 %7.1f ms  sem pong %lu/%lu\n",
+         r.name, res.pong_p50, res.pong_p99, res.exit_p99, res.unanswered, res.commands);
+  printf("%-9s  pose %5zu (idade p50 %6.1f ms, p99 %6.1f ms)  debug %5lu  %.0f B/s\n", "",
+         capture.pose_age_ms.size(), percentile(capture.pose_age_ms, 50.0),
+         percentile(capture.pose_age_ms, 99.0), capture.debug,
+         capture.bytes / (seconds + 3.0));
+  if (r.queue) {
+    static const char* const kClass[OUTBOUND_CLASS_COUNT] = {"pong", "pose", "debug"};
+    for (int c = 0; c < OUTBOUND_CLASS_COUNT; ++c) {
+      const OutboundClassStats& st = res.out[c];
+      printf("%-9s  %-5s na fila %6u  enviadas %6u  coalescidas %6u  descartadas %6u\n", "",
+             kClass[c], st.queued, st.sent, st.coalesced, st.dropped);
+    }
+  }
+  return res;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double seconds = 60.0;
+  uint32_t uplink_bps = 800;   // menos que a pose binária a 20 Hz com os pongs
+  uint32_t buffer = 1460;
+  uint32_t cmd_period_ms = 500;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+      seconds = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--uplink-bps") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+      uplink_bps = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--buffer") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+      buffer = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--cmd-period-ms") == 0 && i + 1 < argc &&
+               atoi(argv[i + 1]) > 0) {
+      cmd_period_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else {
+      fprintf(stderr,
+              "uso: %s [--seconds S] [--uplink-bps B] [--buffer BYTES] [--cmd-period-ms MS]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  printf("uplink %u B/s, buffer de envio %u B, comando a cada %u ms, %.0f s\n", uplink_bps,
+         buffer, cmd_period_ms, seconds);
+  const Run runs[] = {
+      {"livre", 0, true},
+      {"sem fila", uplink_bps, false},
+      {"com fila", uplink_bps, true},
+  };
+  Result results[3];
+  for (int i = 0; i < 3; ++i) {
+    results[i] = run(runs[i], seconds, buffer, cmd_period_ms);
+  }
+
+  const Result& direct = results[1];
+  const Result& queued = results[2];
+  check(queued.unanswered == 0 && queued.out[OUTBOUND_ACK].dropped == 0,
+        "com fila: todo comando teve pong");
+  check(queued.pong_p99 < direct.pong_p99, "com fila: pong p99 abaixo do sem fila");
+  check(queued.out[OUTBOUND_POSE].coalesced > 0, "com fila: pose coalescida (a ultima vence)");
+  check(queued.out[OUTBOUND_DEBUG].dropped > 0, "com fila: debug descartado sob contrapressao");
+  printf("%s\n", g_failures ? "FALHOU" : "ok");
+  return g_failures ? 1 : 0;
+}
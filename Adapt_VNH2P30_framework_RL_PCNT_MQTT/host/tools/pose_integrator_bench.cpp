@@ -0,0 +1,185 @@
+// Erro de pose e custo por atualização dos integradores de pose_integrator.h
+// contra trajetórias de referência. A verdade é integrada em double com
+// passos de 0,1 ms; cada ciclo de controle (50 ms) entrega ao integrador o
+// avanço ds e o giro dphi exatos do ciclo, em float, como o firmware recebe
+// das contagens. Assim o erro medido é só o da integração e dos acumuladores.
+//
+// Trajetórias: círculo; reta longa (centenas de metros, onde o float perde
+// resolução); "oito" com curvatura variável; círculo longe da origem.
+// No "oito" sobra um erro que nenhum método remove: com w variando dentro do
+// ciclo, (ds, dphi) não diz em que ponto do ciclo a curva aconteceu.
+//
+// Uso: pose_integrator_bench [--minutes M]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "pose_integrator.h"
+
+namespace {
+
+const double kPeriodS = 0.05;
+const int kSubsteps = 500;  // 0,1 ms
+
+struct Trajectory {
+  const char* name;
+  double x0, y0, phi0;
+  double (*v)(double t);  // m/s
+  double (*w)(double t);  // rad/s
+};
+
+double v_circle(double) { return 0.5; }
+double w_circle(double) { return 0.4; }
+double v_line(double) { return 1.0; }
+double w_line(double) { return 0.0; }
+double v_eight(double) { return 0.6; }
+double w_eight(double t) { return 0.8 * sin(2.0 * M_PI * t / 20.0); }
+double v_far(double) { return 0.8; }
+double w_far(double) { return 0.25; }
+
+const Trajectory kTrajectories[] = {
+    {"circulo", 0.0, 0.0, 0.0, v_circle, w_circle},
+    {"reta longa", 0.0, 0.0, 0.3, v_line, w_line},
+    {"oito", 0.0, 0.0, 0.0, v_eight, w_eight},
+    {"circulo a 80 m", 80.0, -60.0, 1.0, v_far, w_far},
+};
+
+struct Step {
+  float ds;
+  float dphi;
+  double x, y, phi;  // verdade no fim do ciclo
+};
+
+double wrap(double a) {
+  return a - 2.0 * M_PI * floor((a + M_PI) / (2.0 * M_PI));
+}
+
+std::vector<Step> reference(const Trajectory& tr, double seconds) {
+  std::vector<Step> steps;
+  const size_t n = static_cast<size_t>(seconds / kPeriodS);
+  steps.reserve(n);
+  double x = tr.x0, y = tr.y0, phi = tr.phi0;
+  const double h = kPeriodS / kSubsteps;
+  for (size_t i = 0; i < n; ++i) {
+    double ds = 0, dphi = 0;
+    for (int k = 0; k < kSubsteps; ++k) {
+      const double t = i * kPeriodS + (k + 0.5) * h;
+      const double v = tr.v(t), w = tr.w(t);
+      // Ponto médio no subpasso, em double
+      const double mid = phi + 0.5 * w * h;
+      x += v * h * cos(mid);
+      y += v * h * sin(mid);
+      phi += w * h;
+      ds += v * h;
+      dphi += w * h;
+    }
+    steps.push_back({static_cast<float>(ds), static_cast<float>(dphi), x, y, phi});
+  }
+  return steps;
+}
+
+struct Variant {
+  const char* name;
+  PoseIntegratorConfig config;
+};
+
+const Variant kVariants[] = {
+    {"euler/float (orig.)", {POSE_EULER, POSE_ACC_FLOAT, false}},
+    {"euler/kahan", {POSE_EULER, POSE_ACC_KAHAN, false}},
+    {"rk2/float", {POSE_RK2, POSE_ACC_FLOAT, false}},
+    {"rk2/kahan", {POSE_RK2, POSE_ACC_KAHAN, false}},
+    {"arco/float", {POSE_ARC, POSE_ACC_FLOAT, false}},
+    {"arco/kahan", {POSE_ARC, POSE_ACC_KAHAN, false}},
+    {"arco/double", {POSE_ARC, POSE_ACC_DOUBLE, false}},
+    {"arco/kahan/poli", {POSE_ARC, POSE_ACC_KAHAN, true}},
+    {"arco/float/poli", {POSE_ARC, POSE_ACC_FLOAT, true}},
+};
+
+struct Result {
+  double final_err;
+  double max_err;
+  double heading_err;
+};
+
+void start(PoseState& pose, const Trajectory& tr) {
+  pose_reset(pose);
+  pose.x = static_cast<float>(tr.x0);
+  pose.y = static_cast<float>(tr.y0);
+  pose.phi = static_cast<float>(tr.phi0);
+  pose.x_wide = tr.x0;
+  pose.y_wide = tr.y0;
+}
+
+Result evaluate(const Trajectory& tr, const std::vector<Step>& steps,
+                const PoseIntegratorConfig& config) {
+  PoseState pose;
+  start(pose, tr);
+  Result r = {0, 0, 0};
+  for (const Step& s : steps) {
+    pose_integrate(pose, config, s.ds, s.dphi);
+    const double err = hypot(pose.x - s.x, pose.y - s.y);
+    if (err > r.max_err) r.max_err = err;
+    r.final_err = err;
+    r.heading_err = fabs(wrap(pose.phi - s.phi));
+  }
+  return r;
+}
+
+volatile float g_sink = 0;
+
+double cost_ns(const Trajectory& tr, const std::vector<Step>& steps,
+               const PoseIntegratorConfig& config) {
+  const int rounds = 50;
+  PoseState pose;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int k = 0; k < rounds; ++k) {
+    start(pose, tr);
+    for (const Step& s : steps) pose_integrate(pose, config, s.ds, s.dphi);
+    g_sink = g_sink + pose.x;
+  }
+  double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  return sec * 1e9 / (static_cast<double>(rounds) * steps.size());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double minutes = 10.0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--minutes") == 0 && i + 1 < argc) {
+      minutes = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "uso: %s [--minutes M]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (minutes <= 0) minutes = 1.0;
+
+  // Precisão do polinômio contra a libm
+  double trig_err = 0;
+  for (int i = -20000; i <= 20000; ++i) {
+    const float a = i * 0.001f;
+    float s, c;
+    pose_fast_sincos(a, s, c);
+    trig_err = fmax(trig_err, fmax(fabs(s - sin(a)), fabs(c - cos(a))));
+  }
+
+  printf("%.0f min por trajetoria, ciclo de %.0f ms; erro max do polinomio sin/cos %.1e\n",
+         minutes, kPeriodS * 1000, trig_err);
+  printf("%-16s %-20s %12s %12s %12s %9s\n", "trajetoria", "integrador", "erro fim (m)",
+         "erro max (m)", "rumo (rad)", "ns/ciclo");
+  for (const Trajectory& tr : kTrajectories) {
+    const std::vector<Step> steps = reference(tr, minutes * 60.0);
+    for (const Variant& var : kVariants) {
+      Result r = evaluate(tr, steps, var.config);
+      printf("%-16s %-20s %12.2e %12.2e %12.2e %9.1f\n", tr.name, var.name, r.final_err,
+             r.max_err, r.heading_err, cost_ns(tr, steps, var.config));
+    }
+  }
+  return 0;
+}
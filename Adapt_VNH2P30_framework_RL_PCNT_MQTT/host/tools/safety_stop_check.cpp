@@ -0,0 +1,335 @@
+// Confere a parada de segurança (safety_stop.h) com o firmware inteiro no
+// simulador: o robô anda para frente com um comando remoto a cada 200 ms e,
+// em regime, a tarefa de controle trava por --stall-ms (sim_timer_tasks_stall:
+// o timer dispara e o ciclo não roda), enquanto a rede segue entregando
+// comandos. A cada 100 µs a ferramenta olha as pontes H e mede, a partir do
+// último ciclo, quando o duty começou a cair, quando as duas pontes ficaram
+// em freio (INA = INB = 0, duty 0) e quando EN caiu; a reação é o atraso
+// além do prazo de cada degrau.
+//
+// Três rodadas:
+//   sem parada  parada de segurança desligada (como antes): o PWM fica
+//   com parada  degraus configurados (padrão 100/200/1000 ms)
+//   rede parada a tarefa de rede trava em vez da de controle; o ISR aplica
+//               os mesmos degraus a partir do prazo da rede (--remote-ms,
+//               padrão 3 s) e a rede volta depois do último
+// Na rede parada os tempos contam do último comando. Mostra também quanto o
+// robô andou depois do último ciclo e, na volta do controle (ou da rede), se
+// os comandos enfileirados durante a trava foram descartados e em quanto
+// tempo um comando novo voltou a mover o robô.
+//
+// Sai com código 1 se algum degrau reagir mais de 10 ms depois do prazo, o
+// robô não parar antes do que sem a parada, um comando velho mover o robô na
+// volta, EN não for religado ou os contadores não fecharem.
+//
+// Uso: safety_stop_check [--stall-ms MS] [--decel-ms MS] [--brake-ms MS]
+//                        [--lock-ms MS] [--decel-step N] [--remote-ms MS]
+//                        [--record ARQUIVO]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "motor_control.h"
+#include "plant.h"
+#include "safety_stop.h"
+#include "sim.h"
+
+void setup();
+
+namespace {
+
+int g_failures = 0;
+
+void check(bool ok, const char* what) {
+  printf("  %-58s %s\n", what, ok ? "ok" : "FALHOU");
+  if (!ok) g_failures++;
+}
+
+const uint64_t kStepUs = 100;
+const uint64_t kCommandPeriodUs = 200000;
+const double kReactionLimitMs = 10.0;
+
+enum Scenario { NO_SAFETY, SAFETY, NET_STALL };
+
+struct Options {
+  uint32_t stall_ms = 2000;
+  SafetyStopConfig config = safety_stop_default_config();
+  FILE* record = nullptr;
+};
+
+struct Result {
+  double decel_ms = -1;    // depois do último ciclo
+  double brake_ms = -1;
+  double lock_ms = -1;
+  double speed_before = 0; // m/s
+  double travel_m = 0;     // do último ciclo até parar (ou até a volta)
+  double stopped_ms = -1;  // rodas abaixo de 1 % da velocidade
+  bool stale_moved = false;
+  bool enable_back = false;
+  double resume_ms = -1;   // volta -> ponte acionada de novo
+  SafetyStopStats stats = {};
+};
+
+void on_publish(const char* topic, const uint8_t* payload, size_t length, void* ctx) {
+  FILE* record = static_cast<FILE*>(ctx);
+  if (record && strcmp(topic, "robot/session") == 0) {
+    fwrite(payload, 1, length, record);
+  }
+}
+
+bool driving(uint8_t pin_a, uint8_t pin_b, uint8_t channel) {
+  return sim_gpio_level(pin_a) != sim_gpio_level(pin_b) && sim_pwm_duty(channel) > 0;
+}
+
+bool braked() {
+  return !sim_gpio_level(Robot::kMotorRA) && !sim_gpio_level(Robot::kMotorRB) &&
+         !sim_gpio_level(Robot::kMotorLA) && !sim_gpio_level(Robot::kMotorLB) &&
+         sim_pwm_duty(PWM_CHANNEL_R) == 0 && sim_pwm_duty(PWM_CHANNEL_L) == 0;
+}
+
+bool any_driving() {
+  return driving(Robot::kMotorRA, Robot::kMotorRB, PWM_CHANNEL_R) ||
+         driving(Robot::kMotorLA, Robot::kMotorLB, PWM_CHANNEL_L);
+}
+
+double wheel_speed(const SimPlant& plant) {
+  return 0.5 * (fabs(plant.wheel[MOTOR_R].omega) + fabs(plant.wheel[MOTOR_L].omega)) /
+         plant.gear_reduction * plant.wheel_radius;
+}
+
+struct Driver {
+  uint64_t next_command_us = 0;
+  bool commands = true;
+  bool net = true;
+  unsigned long sent = 0;
+  uint64_t last_command_us = 0;
+
+  void step() {
+    if (commands && sim_clock_us() >= next_command_us) {
+      last_command_us = sim_clock_us();
+      char payload[48];
+      snprintf(payload, sizeof(payload), "0|-20|s%lu|%lu", sent++,
+               static_cast<unsigned long>(sim_clock_us() / 1000));
+      sim_mqtt_inject("facemesh/cmd", payload);
+      next_command_us = sim_clock_us() + kCommandPeriodUs;
+    }
+    sim_clock_advance_us(kStepUs);
+    if (net) sim_run_loop_tasks();
+  }
+};
+
+uint32_t cycle_seq() {
+  OdometrySample s;
+  return odometry_latest_sample(s) ? s.seq : 0;
+}
+
+// Avança até o passo de um ciclo de controle (a amostra de odometria muda)
+uint64_t sync_to_cycle(Driver& driver) {
+  const uint32_t seq = cycle_seq();
+  while (cycle_seq() == seq) {
+    driver.step();
+  }
+  return sim_clock_us();
+}
+
+Result run(Scenario scenario, const Options& opt) {
+  SafetyStopConfig config = opt.config;
+  if (scenario == NO_SAFETY) config.brake_ms = 0;
+  safety_stop_set_config(config);
+
+  sim_reset();
+  sim_mqtt_set_publish_hook(on_publish, scenario == SAFETY ? opt.record : nullptr);
+  SimPlant plant;
+  plant.attach(100);
+  setup();
+  const SafetyStopStats before = safety_stop_stats();
+
+  Driver driver;
+  const uint64_t cruise_until = sim_clock_us() + 5000000;   // conecta e acelera
+  while (sim_clock_us() < cruise_until) driver.step();
+
+  Result r;
+  r.speed_before = wheel_speed(plant);
+  const uint64_t last_cycle = sync_to_cycle(driver);
+  const double x0 = plant.pose.x;
+  const double y0 = plant.pose.y;
+  const uint64_t stall_end = last_cycle + static_cast<uint64_t>(opt.stall_ms) * 1000;
+  if (scenario == NET_STALL) {
+    // Rede presa: nada é lido nem publicado; o controle segue
+    driver.net = false;
+    driver.commands = false;
+  } else {
+    sim_timer_tasks_stall(last_cycle + 1, stall_end);
+  }
+
+  // Rede parada: os tempos contam do último comando, não do último ciclo
+  const uint64_t origin = scenario == NET_STALL ? driver.last_command_us : last_cycle;
+  const uint32_t duty0 = sim_pwm_duty(PWM_CHANNEL_R);
+  const uint32_t last_tier_ms = config.lock_ms > config.brake_ms ? config.lock_ms : config.brake_ms;
+  const uint64_t end =
+      scenario == NET_STALL
+          ? origin + (static_cast<uint64_t>(config.remote_ms) + last_tier_ms + 500) * 1000
+          : stall_end;
+  while (sim_clock_us() < end) {
+    driver.step();
+    const double t_ms = (sim_clock_us() - origin) * 1e-3;
+    if (r.decel_ms < 0 && sim_pwm_duty(PWM_CHANNEL_R) < duty0) r.decel_ms = t_ms;
+    if (r.brake_ms < 0 && braked()) r.brake_ms = t_ms;
+    if (r.lock_ms < 0 && !sim_gpio_level(Robot::kEnableR) && !sim_gpio_level(Robot::kEnableL)) {
+      r.lock_ms = t_ms;
+    }
+    if (r.stopped_ms < 0 && wheel_speed(plant) < 0.01 * r.speed_before) r.stopped_ms = t_ms;
+  }
+  r.travel_m = hypot(plant.pose.x - x0, plant.pose.y - y0);
+
+  if (scenario == SAFETY) {
+    // Controle de volta: o primeiro ciclo vem com a fila cheia de comandos da
+    // trava e tem de ficar parado; o próximo comando enviado move de novo
+    sync_to_cycle(driver);
+    const uint64_t resumed = sim_clock_us();
+    r.stale_moved = any_driving();
+    r.enable_back = sim_gpio_level(Robot::kEnableR) && sim_gpio_level(Robot::kEnableL);
+    while (sim_clock_us() < resumed + 1000000 && r.resume_ms < 0) {
+      driver.step();
+      if (any_driving()) r.resume_ms = (sim_clock_us() - resumed) * 1e-3;
+    }
+  } else if (scenario == NET_STALL) {
+    // Rede de volta: o próprio primeiro comando solta as pontes e anda
+    r.stale_moved = any_driving();
+    driver.net = true;
+    driver.commands = true;
+    driver.next_command_us = sim_clock_us();
+    const uint64_t resumed = sim_clock_us();
+    while (sim_clock_us() < resumed + 1000000 && r.resume_ms < 0) {
+      driver.step();
+      if (any_driving()) {
+        r.resume_ms = (sim_clock_us() - resumed) * 1e-3;
+        r.enable_back = sim_gpio_level(Robot::kEnableR) && sim_gpio_level(Robot::kEnableL);
+      }
+    }
+  }
+  sim_timer_tasks_stall(0, 0);
+  sim_mqtt_set_publish_hook(nullptr, nullptr);
+
+  const SafetyStopStats after = safety_stop_stats();
+  r.stats.trips = after.trips - before.trips;
+  r.stats.remote_trips = after.remote_trips - before.remote_trips;
+  r.stats.brakes = after.brakes - before.brakes;
+  r.stats.locks = after.locks - before.locks;
+  r.stats.recoveries = after.recoveries - before.recoveries;
+  return r;
+}
+
+void print_ms(const char* label, double ms) {
+  if (ms < 0) {
+    printf("  %-9s -\n", label);
+  } else {
+    printf("  %-9s %8.1f ms\n", label, ms);
+  }
+}
+
+void print(const char* name, const Result& r, const char* origin) {
+  printf("%s: %.2f m/s antes; andou %.3f m depois do %s\n", name, r.speed_before, r.travel_m,
+         origin);
+  print_ms("desacel.", r.decel_ms);
+  print_ms("freio", r.brake_ms);
+  print_ms("EN em 0", r.lock_ms);
+  print_ms("parado", r.stopped_ms);
+}
+
+bool reacted(double observed_ms, uint32_t deadline_ms) {
+  return observed_ms >= deadline_ms && observed_ms - deadline_ms <= kReactionLimitMs;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  const char* record_path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--stall-ms") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+      opt.stall_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--decel-ms") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0) {
+      opt.config.decel_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--brake-ms") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+      opt.config.brake_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--lock-ms") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0) {
+      opt.config.lock_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--decel-step") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0 &&
+               atoi(argv[i + 1]) <= 255) {
+      opt.config.decel_step = static_cast<uint8_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--remote-ms") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+      opt.config.remote_ms = static_cast<uint32_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else {
+      fprintf(stderr,
+              "uso: %s [--stall-ms MS] [--decel-ms MS] [--brake-ms MS] [--lock-ms MS] "
+              "[--decel-step N] [--remote-ms MS] [--record ARQUIVO]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (record_path) {
+    opt.record = fopen(record_path, "wb");
+    if (!opt.record) {
+      fprintf(stderr, "nao consegui criar %s\n", record_path);
+      return 1;
+    }
+  }
+
+  const SafetyStopConfig& c = opt.config;
+  const bool decel_tier = c.decel_ms && c.decel_ms < c.brake_ms;
+  const bool lock_tier = c.lock_ms && c.lock_ms < opt.stall_ms;
+  printf("trava de %u ms; degraus: desacelera %u ms (-%u por tique), freia %u ms, EN %u ms;"
+         " rede %u ms\n",
+         opt.stall_ms, c.decel_ms, c.decel_step, c.brake_ms, c.lock_ms, c.remote_ms);
+  // A gravação de sessão segue de uma rodada para a outra: a gravada vem antes
+  const Result on = run(SAFETY, opt);
+  const Result off = run(NO_SAFETY, opt);
+  print("sem parada", off, "ultimo ciclo");
+  print("com parada", on, "ultimo ciclo");
+  printf("  volta: %s, EN %s, comando novo move em %.1f ms\n",
+         on.stale_moved ? "comando velho moveu" : "parado", on.enable_back ? "religado" : "em 0",
+         on.resume_ms);
+  printf("  contadores: %u disparos, %u freios, %u EN, %u voltas\n", on.stats.trips,
+         on.stats.brakes, on.stats.locks, on.stats.recoveries);
+  const Result net = run(NET_STALL, opt);
+  print("rede parada", net, "ultimo comando");
+  printf("  volta: EN %s, comando novo move em %.1f ms\n", net.enable_back ? "religado" : "em 0",
+         net.resume_ms);
+  printf("  contadores: %u disparos (%u da rede), %u freios, %u EN, %u voltas\n", net.stats.trips,
+         net.stats.remote_trips, net.stats.brakes, net.stats.locks, net.stats.recoveries);
+  if (opt.record) fclose(opt.record);
+
+  check(off.brake_ms < 0 && off.stopped_ms < 0, "sem parada: o PWM fica durante a trava");
+  check(!decel_tier || reacted(on.decel_ms, c.decel_ms), "desacelera ate 10 ms depois do prazo");
+  check(reacted(on.brake_ms, c.brake_ms), "freia ate 10 ms depois do prazo");
+  check(!lock_tier || reacted(on.lock_ms, c.lock_ms), "desliga EN ate 10 ms depois do prazo");
+  check(on.stopped_ms >= 0 && on.travel_m < off.travel_m, "para antes do que sem a parada");
+  check(!on.stale_moved && on.enable_back, "na volta: parado e com EN religado");
+  check(on.resume_ms >= 0 && on.resume_ms <= kCommandPeriodUs * 1e-3 + 100.0,
+        "comando novo volta a mover");
+  check(on.stats.trips == 1 && on.stats.brakes == 1 && on.stats.locks == (lock_tier ? 1u : 0u) &&
+            on.stats.recoveries == 1,
+        "contadores da parada de seguranca");
+  // Rede: o primeiro degrau no prazo, os outros com a mesma distância
+  const uint32_t first_ms = decel_tier ? c.decel_ms : c.brake_ms;
+  const bool net_lock_tier = c.lock_ms > first_ms;
+  check(!decel_tier || reacted(net.decel_ms, c.remote_ms),
+        "rede parada: desacelera ate 10 ms depois do prazo da rede");
+  check(reacted(net.brake_ms, c.remote_ms + c.brake_ms - first_ms),
+        "rede parada: freia ate 10 ms depois do degrau");
+  check(!net_lock_tier || reacted(net.lock_ms, c.remote_ms + c.lock_ms - first_ms),
+        "rede parada: desliga EN ate 10 ms depois do degrau");
+  check(net.stopped_ms >= 0 && !net.stale_moved, "rede parada: o robo para");
+  check(net.enable_back && net.resume_ms >= 0 && net.resume_ms <= 150.0,
+        "rede de volta: o primeiro comando religa EN e move");
+  check(net.stats.trips == 1 && net.stats.remote_trips == 1 && net.stats.brakes == 1 &&
+            net.stats.locks == (net_lock_tier ? 1u : 0u) && net.stats.recoveries == 1,
+        "rede parada: contadores da parada de seguranca");
+  printf("%s\n", g_failures ? "FALHOU" : "ok");
+  return g_failures ? 1 : 0;
+}
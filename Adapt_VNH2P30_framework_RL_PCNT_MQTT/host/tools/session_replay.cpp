@@ -0,0 +1,339 @@
+// Reproduz uma sessão gravada pelo firmware (session_record.h) no build
+// nativo e confere, bit a bit, que o laço de controle toma as mesmas decisões:
+// cada ciclo passa pelas mesmas funções da tarefa de controle (encoder_step,
+// selecionaComando do sketch, apply_motion_command) com as entradas gravadas,
+// e o sentido/PWM resultante é comparado com o que foi para a ponte H. Em
+// cada quadro-chave o ControlState inteiro (pose, PID, perfil, estimadores,
+// comando remoto) é comparado com o gravado e então recarregado, de modo que
+// uma divergência aparece no ciclo em que começa e não contamina o resto.
+//
+// Entrada: o arquivo com os pedaços concatenados (robot_sim --record ou
+// --capture), um log serial com linhas "@REC <hex>" (--serial, sink
+// SESSION_SINK_SERIAL) ou, com --capture, os pedaços do tópico robot/session
+// de um broker por S segundos, gravados no arquivo e reproduzidos em seguida.
+//
+// --speed 1 reproduz no ritmo gravado, 2 no dobro; 0 (padrão) o mais rápido
+// possível. Ciclos depois de um pedaço perdido (SYNC fora de sequência ou
+// GAP) são pulados até o próximo quadro-chave.
+//
+// Gravações do ESP32 reproduzidas no host podem divergir na pose por
+// diferenças da libm; gravações do robot_sim reproduzem bit a bit.
+//
+// Sai com código 1 se algum ciclo ou quadro-chave divergir.
+//
+// Uso: session_replay ARQUIVO [--speed X]
+//      session_replay --serial LOG [--speed X]
+//      session_replay --capture ARQUIVO [--host H] [--port P] [--topic T]
+//                     [--seconds S] [--speed X]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "motor_control.h"
+#include "mqtt_wire.h"
+#include "session_record.h"
+#include "sim.h"
+
+// Sketch (.ino): pinos dos botões e a seleção do comando de cada ciclo
+extern int botao_frente;
+extern int botao_re;
+extern int botao_esquerda;
+extern int botao_direita;
+MotionCommand selecionaComando();
+void setupBotoes(uint32_t debounce_us);
+
+namespace {
+
+struct Replay {
+  unsigned long cycles = 0;
+  unsigned long skipped = 0;          // fora de sincronia (antes de um quadro-chave)
+  unsigned long keyframes = 0;
+  unsigned long keyframes_checked = 0;
+  unsigned long keyframes_diverged = 0;
+  unsigned long output_mismatches = 0;
+  unsigned long gaps = 0;             // GAP ou SYNC fora de sequência
+  unsigned long lost = 0;             // ciclos perdidos informados pelos GAPs
+  unsigned long chunks = 0;
+  long first_divergence = -1;         // ciclo
+  uint64_t recorded_us = 0;
+};
+
+uint64_t now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool read_file(const char* path, std::vector<uint8_t>& out) {
+  FILE* f = fopen(path, "rb");
+  if (!f) return false;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+int hex_value(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Linhas "@REC <hex>" em qualquer ponto do log; o resto é ignorado
+bool read_serial_log(const char* path, std::vector<uint8_t>& out) {
+  FILE* f = fopen(path, "r");
+  if (!f) return false;
+  static char line[8 + 2 * SESSION_CHUNK_BYTES + 64];
+  while (fgets(line, sizeof(line), f)) {
+    const char* p = strstr(line, "@REC ");
+    if (!p) continue;
+    p += 5;
+    std::vector<uint8_t> chunk;
+    int hi, lo;
+    while ((hi = hex_value(p[0])) >= 0 && (lo = hex_value(p[1])) >= 0) {
+      chunk.push_back(static_cast<uint8_t>(hi << 4 | lo));
+      p += 2;
+    }
+    out.insert(out.end(), chunk.begin(), chunk.end());
+  }
+  fclose(f);
+  return true;
+}
+
+void on_chunk(const char* topic, const uint8_t* payload, size_t length, void* ctx) {
+  (void)topic;
+  FILE* f = static_cast<FILE*>(ctx);
+  fwrite(payload, 1, length, f);
+}
+
+bool capture(const char* path, const char* host, int port, const char* topic, double seconds) {
+  FILE* f = fopen(path, "wb");
+  if (!f) {
+    fprintf(stderr, "nao abriu %s\n", path);
+    return false;
+  }
+  MqttWireClient client;
+  if (!client.start_connect(host, port, "session_replay", nullptr, nullptr)) {
+    fprintf(stderr, "falha ao conectar em %s:%d\n", host, port);
+    fclose(f);
+    return false;
+  }
+  while (client.poll_connect() == MqttWireClient::CONNECTING) {
+    usleep(1000);
+  }
+  if (!client.connected() || !client.subscribe(topic)) {
+    fprintf(stderr, "falha ao conectar em %s:%d (rc=%d)\n", host, port, client.last_error());
+    fclose(f);
+    return false;
+  }
+  printf("gravando %s de %s:%d por %.0f s em %s\n", topic, host, port, seconds, path);
+  const uint64_t end_us = now_us() + static_cast<uint64_t>(seconds * 1e6);
+  while (now_us() < end_us) {
+    if (!client.loop(on_chunk, f, 5)) {
+      fprintf(stderr, "conexão perdida (rc=%d)\n", client.last_error());
+      break;
+    }
+  }
+  client.disconnect();
+  fclose(f);
+  return true;
+}
+
+void set_buttons(uint8_t state) {
+  sim_gpio_set_input(static_cast<uint8_t>(botao_frente), state == 1);
+  sim_gpio_set_input(static_cast<uint8_t>(botao_re), state == 2);
+  sim_gpio_set_input(static_cast<uint8_t>(botao_esquerda), state == 3);
+  sim_gpio_set_input(static_cast<uint8_t>(botao_direita), state == 4);
+}
+
+void note_divergence(Replay& r) {
+  if (r.first_divergence < 0) r.first_divergence = static_cast<long>(r.cycles);
+}
+
+// Um ciclo da tarefa de controle (control_task_step) sobre as entradas gravadas
+void replay_cycle(Replay& r, const SessionCycle& cycle) {
+  set_buttons(cycle.buttons);
+  if (cycle.has_command) {
+    set_remote_command_record(cycle.command);
+  }
+  encoder_step(cycle.in);
+  apply_motion_command(selecionaComando());
+
+  const ControlOutputs out = control_outputs();
+  if (out.dirR != cycle.out.dirR || out.dirL != cycle.out.dirL || out.pwmR != cycle.out.pwmR ||
+      out.pwmL != cycle.out.pwmL) {
+    if (r.output_mismatches == 0) {
+      printf("ciclo %lu (t=%u ms): gravado dir %u/%u pwm %u/%u, reproduzido dir %u/%u pwm %u/%u\n",
+             r.cycles, cycle.in.t_ms, cycle.out.dirR, cycle.out.dirL, cycle.out.pwmR,
+             cycle.out.pwmL, out.dirR, out.dirL, out.pwmR, out.pwmL);
+    }
+    r.output_mismatches++;
+    note_divergence(r);
+  }
+  r.cycles++;
+}
+
+void check_keyframe(Replay& r, const SessionKeyframe& key) {
+  ControlState now;
+  control_state_save(now);
+  uint8_t expected[SESSION_KEYFRAME_MAX_BYTES];
+  uint8_t actual[SESSION_KEYFRAME_MAX_BYTES];
+  const size_t n = session_encode_state(key.state, expected, sizeof(expected));
+  session_encode_state(now, actual, sizeof(actual));
+  r.keyframes_checked++;
+  if (memcmp(expected, actual, n) == 0) {
+    return;
+  }
+  if (r.keyframes_diverged == 0) {
+    size_t at = 0;
+    while (at < n && expected[at] == actual[at]) ++at;
+    printf("quadro-chave no ciclo %lu (t=%u ms): estado difere no byte %zu;"
+           " pose gravada %.9g %.9g %.9g, reproduzida %.9g %.9g %.9g\n",
+           r.cycles, key.base.t_ms, at, key.state.pose.x, key.state.pose.y,
+           key.state.pose.phi, now.pose.x, now.pose.y, now.pose.phi);
+  }
+  r.keyframes_diverged++;
+  note_divergence(r);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  const char* serial_path = nullptr;
+  const char* capture_path = nullptr;
+  const char* host = "127.0.0.1";
+  int port = 1883;
+  const char* topic = "robot/session";
+  double seconds = 30.0;
+  double speed = 0.0;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--serial") == 0 && i + 1 < argc) {
+      serial_path = argv[++i];
+    } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+      capture_path = argv[++i];
+    } else if (strcmp(argv[i], "--host") == 0 && i + 1 < argc) {
+      host = argv[++i];
+    } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+      port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--topic") == 0 && i + 1 < argc) {
+      topic = argv[++i];
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc && atof(argv[i + 1]) >= 0) {
+      speed = atof(argv[++i]);
+    } else if (argv[i][0] != '-' && !path) {
+      path = argv[i];
+    } else {
+      path = nullptr;
+      serial_path = capture_path = nullptr;
+      break;
+    }
+  }
+  if ((path != nullptr) + (serial_path != nullptr) + (capture_path != nullptr) != 1) {
+    fprintf(stderr,
+            "uso: %s ARQUIVO | --serial LOG | --capture ARQUIVO [--host H] [--port P]"
+            " [--topic T] [--seconds S] [--speed X]\n",
+            argv[0]);
+    return 2;
+  }
+
+  std::vector<uint8_t> data;
+  if (capture_path) {
+    if (!capture(capture_path, host, port, topic, seconds)) return 1;
+    path = capture_path;
+  }
+  const bool loaded = serial_path ? read_serial_log(serial_path, data) : read_file(path, data);
+  if (!loaded) {
+    fprintf(stderr, "nao abriu %s\n", serial_path ? serial_path : path);
+    return 1;
+  }
+
+  // Só o que encoder()/apply_motion_command() tocam: sem tarefas nem rede
+  sim_reset();
+  setupMotor();
+  // O gravado já é o estado filtrado: cada borda conta na hora
+  setupBotoes(0);
+
+  Replay r;
+  SessionDecoder decoder;
+  session_decoder_reset(decoder);
+  SessionEvent ev;
+  size_t pos = 0;
+  bool synced = false;
+  bool have_seq = false;
+  uint32_t next_seq = 0;
+  uint32_t last_us = 0;   // t_us do ciclo anterior
+  int rc;
+  const uint64_t wall_start = now_us();
+  while ((rc = session_decode(decoder, data.data(), data.size(), pos, ev)) == 1) {
+    switch (ev.type) {
+      case SESSION_SYNC:
+        r.chunks++;
+        if (have_seq && ev.chunk_seq != next_seq) {
+          r.gaps++;
+          synced = false;
+        }
+        have_seq = true;
+        next_seq = ev.chunk_seq + 1;
+        break;
+      case SESSION_GAP:
+        r.gaps++;
+        r.lost += ev.lost;
+        synced = false;
+        break;
+      case SESSION_KEYFRAME:
+        r.keyframes++;
+        if (synced) check_keyframe(r, ev.keyframe);
+        session_config_apply(ev.keyframe.config);
+        control_state_load(ev.keyframe.state);
+        last_us = ev.keyframe.base.t_us;
+        synced = true;
+        break;
+      case SESSION_CYCLE: {
+        if (!synced) {
+          r.skipped++;
+          break;
+        }
+        r.recorded_us += ev.cycle.in.t_us - last_us;
+        last_us = ev.cycle.in.t_us;
+        if (speed > 0) {
+          const uint64_t due = wall_start + static_cast<uint64_t>(r.recorded_us / speed);
+          const uint64_t now = now_us();
+          if (due > now) std::this_thread::sleep_for(std::chrono::microseconds(due - now));
+        }
+        replay_cycle(r, ev.cycle);
+        break;
+      }
+    }
+  }
+  const double wall_s = (now_us() - wall_start) * 1e-6;
+  if (rc < 0) {
+    printf("registro invalido no byte %zu de %zu; reproducao interrompida\n", pos, data.size());
+  }
+
+  printf("pedacos          : %lu (%zu bytes), %lu lacunas, %lu ciclos perdidos na gravacao\n",
+         r.chunks, data.size(), r.gaps, r.lost);
+  printf("ciclos           : %lu reproduzidos, %lu pulados ate um quadro-chave\n", r.cycles,
+         r.skipped);
+  printf("quadros-chave    : %lu, %lu conferidos, %lu divergentes\n", r.keyframes,
+         r.keyframes_checked, r.keyframes_diverged);
+  printf("sentido/PWM      : %lu ciclos divergentes", r.output_mismatches);
+  if (r.first_divergence >= 0) printf(" (primeira divergencia no ciclo %ld)", r.first_divergence);
+  printf("\n");
+  printf("tempo gravado    : %.3f s\n", r.recorded_us * 1e-6);
+  printf("tempo real       : %.3f s (%.0f ciclos/s, %.1fx o tempo real)\n", wall_s,
+         wall_s > 0 ? r.cycles / wall_s : 0.0, wall_s > 0 ? r.recorded_us * 1e-6 / wall_s : 0.0);
+
+  const bool exact = rc == 0 && r.cycles > 0 && r.first_divergence < 0;
+  printf("%s\n", exact ? "reproducao bit a bit" : r.cycles ? "DIVERGENTE" : "nenhum ciclo reproduzido");
+  return exact ? 0 : 1;
+}
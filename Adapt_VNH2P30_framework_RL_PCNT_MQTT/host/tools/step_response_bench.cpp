@@ -0,0 +1,213 @@
+// Resposta ao degrau do regulador de velocidade das rodas na planta simulada:
+// o regulador original (±PWM_STEP por ciclo + synchronizeWheels) contra o
+// PID com feedforward de speed_controller.h. Cada cenário parte do repouso,
+// aplica o comando "frente" com a referência padrão e roda encoder() no
+// período da tarefa de controle, lendo a velocidade verdadeira da planta.
+//
+// Métricas por roda (pior das duas): subida 10–90 %, sobressinal, tempo de
+// acomodação na faixa de ±2 % e erro em regime (média do último segundo).
+// "rumo" é o desvio de heading da pose verdadeira no fim: o comando é seguir
+// reto, então mede quanto a falta de sincronismo entre as rodas entorta o
+// caminho (o que o acoplamento cruzado corrige).
+//
+// Cenários: planta nominal; roda esquerda 20 % mais fraca (resistência e
+// atrito maiores); e, no meio do movimento, carga extra na roda direita.
+//
+// --estimator escolhe a medida de velocidade do regulador (velocity_estimator.h)
+// e --period-ms o período do laço, para avaliar laços mais rápidos que os
+// 50 ms da tarefa de controle. O perfil de movimento fica em degrau: a
+// medida é a do regulador (motion_profile_bench compara os perfis).
+//
+// Uso: step_response_bench [--seconds S] [--kp X] [--ki X] [--kd X]
+//                          [--kff X] [--kc X] [--tau S]
+//                          [--estimator count|mt] [--period-ms N]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "control_task.h"
+#include "motor_control.h"
+#include "plant.h"
+#include "sim.h"
+
+namespace {
+
+// Referência do comando "frente" (pwmToTargetVelocity(159))
+const double kTarget = 159.0 * Robot::kMotorRadSPerPwm;
+const double kBand = 0.02;
+
+struct Scenario {
+  const char* name;
+  double left_weakness;   // fração a mais de resistência/atrito na esquerda
+  double load_at_s;       // instante da carga extra na direita (< 0: sem)
+};
+
+struct Metrics {
+  double rise_ms;
+  double overshoot_pct;
+  double settle_ms;
+  double steady_err_pct;
+  double heading_deg;
+  double recover_ms;      // volta à faixa depois da carga (cenário de carga)
+};
+
+// Métricas de uma roda; amostras a cada período de controle
+void wheel_metrics(const std::vector<double>& w, double period_ms, size_t window,
+                   size_t load_index, Metrics& m) {
+  const size_t n = load_index ? load_index : w.size();
+  double t10 = -1, t90 = -1, peak = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (t10 < 0 && w[i] >= 0.1 * kTarget) t10 = i * period_ms;
+    if (t90 < 0 && w[i] >= 0.9 * kTarget) t90 = i * period_ms;
+    if (w[i] > peak) peak = w[i];
+  }
+  double rise = (t10 >= 0 && t90 >= 0) ? t90 - t10 : INFINITY;
+  double overshoot = peak > kTarget ? 100.0 * (peak - kTarget) / kTarget : 0.0;
+  // Acomodação: último instante fora da faixa antes da carga
+  double settle = 0;
+  for (size_t i = 0; i < n; ++i) {
+    if (fabs(w[i] - kTarget) > kBand * kTarget) settle = (i + 1) * period_ms;
+  }
+  if (settle >= n * period_ms) settle = INFINITY;
+
+  double err = 0;
+  for (size_t i = w.size() - window; i < w.size(); ++i) err += w[i] - kTarget;
+  err = 100.0 * fabs(err / window) / kTarget;
+
+  double recover = 0;
+  if (load_index) {
+    for (size_t i = load_index; i < w.size(); ++i) {
+      if (fabs(w[i] - kTarget) > kBand * kTarget) recover = (i + 1 - load_index) * period_ms;
+    }
+    if (load_index + recover / period_ms >= w.size()) recover = INFINITY;
+  }
+
+  if (rise > m.rise_ms) m.rise_ms = rise;
+  if (overshoot > m.overshoot_pct) m.overshoot_pct = overshoot;
+  if (settle > m.settle_ms) m.settle_ms = settle;
+  if (err > m.steady_err_pct) m.steady_err_pct = err;
+  if (recover > m.recover_ms) m.recover_ms = recover;
+}
+
+Metrics run(const Scenario& sc, SpeedControllerMode mode, double seconds, uint32_t period_us) {
+  sim_reset();
+  SimPlant plant;
+  plant.params[MOTOR_L].resistance *= 1.0 + sc.left_weakness;
+  plant.params[MOTOR_L].friction *= 1.0 + 10.0 * sc.left_weakness;
+  plant.attach(100);
+
+  setupMotor();
+  motor_set_speed_controller(mode);
+  Stop();
+  encoder();  // primeira chamada só zera os contadores
+
+  const size_t steps = static_cast<size_t>(seconds * 1e6 / period_us);
+  const size_t load_index =
+      sc.load_at_s > 0 ? static_cast<size_t>(sc.load_at_s * 1e6 / period_us) : 0;
+  std::vector<double> wr, wl;
+
+  apply_motion_command(MOTION_FORWARD);
+  for (size_t i = 0; i < steps; ++i) {
+    if (load_index && i == load_index) plant.params[MOTOR_R].friction *= 40.0;
+    sim_clock_advance_us(period_us);
+    encoder();
+    wr.push_back(plant.wheel[MOTOR_R].omega);
+    wl.push_back(plant.wheel[MOTOR_L].omega);
+  }
+  plant.detach();
+  apply_motion_command(MOTION_STOP);
+
+  Metrics m = {0, 0, 0, 0, 0, 0};
+  const size_t window = static_cast<size_t>(1e6 / period_us);
+  wheel_metrics(wr, period_us / 1000.0, window, load_index, m);
+  wheel_metrics(wl, period_us / 1000.0, window, load_index, m);
+  m.heading_deg = fabs(plant.pose.phi) * 180.0 / M_PI;
+  return m;
+}
+
+void print_ms(double v) {
+  if (isinf(v)) {
+    printf(" %9s", "nunca");
+  } else {
+    printf(" %9.0f", v);
+  }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double seconds = 8.0;
+  uint32_t period_us = CONTROL_PERIOD_US;
+  VelocityEstimatorMode estimator = DEFAULT_VELOCITY_ESTIMATOR;
+  SpeedPidGains gains = speed_pid_default_gains();
+  for (int i = 1; i < argc; ++i) {
+    float* gain = nullptr;
+    if (strcmp(argv[i], "--kp") == 0) gain = &gains.kp;
+    if (strcmp(argv[i], "--ki") == 0) gain = &gains.ki;
+    if (strcmp(argv[i], "--kd") == 0) gain = &gains.kd;
+    if (strcmp(argv[i], "--kff") == 0) gain = &gains.kff;
+    if (strcmp(argv[i], "--kc") == 0) gain = &gains.kc;
+    if (strcmp(argv[i], "--tau") == 0) gain = &gains.ref_tau_s;
+    if (gain && i + 1 < argc) {
+      *gain = static_cast<float>(atof(argv[++i]));
+    } else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--period-ms") == 0 && i + 1 < argc &&
+               atoi(argv[i + 1]) > 0) {
+      period_us = static_cast<uint32_t>(atoi(argv[++i])) * 1000;
+    } else if (strcmp(argv[i], "--estimator") == 0 && i + 1 < argc &&
+               (strcmp(argv[i + 1], "count") == 0 || strcmp(argv[i + 1], "mt") == 0)) {
+      estimator = strcmp(argv[++i], "mt") == 0 ? VELOCITY_MT : VELOCITY_COUNT;
+    } else {
+      fprintf(stderr,
+              "uso: %s [--seconds S] [--kp X] [--ki X] [--kd X] [--kff X] [--kc X]"
+              " [--tau S] [--estimator count|mt] [--period-ms N]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (seconds < 3.0) seconds = 3.0;
+  motor_set_speed_gains(gains);
+  motor_set_velocity_estimator(estimator);
+  MotionProfileConfig profile = motion_profile_default_config();
+  profile.mode = PROFILE_STEP;
+  motor_set_motion_profile(profile);
+
+  const Scenario scenarios[] = {
+      {"nominal", 0.0, -1.0},
+      {"roda esq. fraca", 0.2, -1.0},
+      {"carga na dir.", 0.0, seconds / 2},
+  };
+
+  printf("referencia %.1f rad/s no motor, periodo %u ms, velocidade por %s, %.0f s por"
+         " cenario\n",
+         kTarget, period_us / 1000, estimator == VELOCITY_MT ? "m/t" : "contagem", seconds);
+  printf("PID: kp=%.3f ki=%.3f kd=%.3f kff=%.2f kc=%.2f tau=%.3f s\n", gains.kp, gains.ki,
+         gains.kd, gains.kff, gains.kc, gains.ref_tau_s);
+  printf("%-16s %-8s %9s %9s %9s %9s %9s %9s\n", "cenario", "ctrl", "subida", "sobres.",
+         "acomod.", "erro reg", "rumo", "recup.");
+  printf("%-16s %-8s %9s %9s %9s %9s %9s %9s\n", "", "", "(ms)", "(%)", "(ms)", "(%)",
+         "(graus)", "(ms)");
+  for (const Scenario& sc : scenarios) {
+    const SpeedControllerMode modes[] = {SPEED_CTRL_STEPPER, SPEED_CTRL_PID};
+    for (SpeedControllerMode mode : modes) {
+      Metrics m = run(sc, mode, seconds, period_us);
+      printf("%-16s %-8s", sc.name, mode == SPEED_CTRL_PID ? "pid" : "degrau");
+      print_ms(m.rise_ms);
+      printf(" %9.1f", m.overshoot_pct);
+      print_ms(m.settle_ms);
+      printf(" %9.2f %9.2f", m.steady_err_pct, m.heading_deg);
+      if (sc.load_at_s > 0) {
+        print_ms(m.recover_ms);
+      } else {
+        printf(" %9s", "-");
+      }
+      printf("\n");
+    }
+  }
+  return 0;
+}
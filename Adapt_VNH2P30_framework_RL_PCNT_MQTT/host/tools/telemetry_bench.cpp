@@ -0,0 +1,250 @@
+// Compara o custo de codificar a telemetria de odometria em JSON (String +
+// String(float, 6), como o firmware sempre fez) e no quadro binário de
+// telemetry_codec.h: tempo por amostra e bytes no fio (payload + cabeçalho
+// MQTT PUBLISH; o overhead do TLS é o mesmo por registro e fica de fora).
+// Também confere o round-trip do decodificador binário e mede o lote
+// delta/varint (TELEMETRY_BATCH) para alguns tamanhos de lote, por amostra.
+//
+// O tempo absoluto é do host; no ESP32 a diferença cresce, porque a
+// formatação de float e o malloc da String são bem mais caros lá.
+//
+// Uso: telemetry_bench [--samples N]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "telemetry_codec.h"
+
+namespace {
+
+volatile size_t g_sink = 0;
+
+size_t mqtt_wire_bytes(const char* topic, size_t payload) {
+  size_t remaining = 2 + strlen(topic) + payload;
+  size_t varint = remaining < 128 ? 1 : remaining < 16384 ? 2 : 3;
+  return 1 + varint + remaining;
+}
+
+std::vector<OdometrySample> make_samples(size_t n) {
+  std::vector<OdometrySample> samples(n);
+  for (size_t i = 0; i < n; ++i) {
+    OdometrySample& s = samples[i];
+    float t = i * 0.05f;
+    s.seq = static_cast<uint32_t>(i + 1);
+    s.t_ms = static_cast<uint32_t>(i * 50);
+    s.dt_ms = 50;
+    s.x = 3.0f * cosf(t * 0.1f);
+    s.y = -2.0f * sinf(t * 0.13f);
+    s.phi = fmodf(t * 0.2f, 6.283185f) - 3.141593f;
+    s.contagemR = static_cast<int16_t>(900 * sinf(t));
+    s.contagemL = static_cast<int16_t>(-870 * sinf(t * 1.1f));
+    s.velR = 11.5f * sinf(t);
+    s.velL = -10.9f * sinf(t * 1.1f);
+  }
+  return samples;
+}
+
+struct Result {
+  double ns_per_sample;
+  double payload_bytes;
+  double wire_bytes;
+};
+
+template <typename Encode>
+Result bench(const std::vector<OdometrySample>& samples, const char* topic, Encode encode) {
+  size_t bytes = 0;
+  size_t wire = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (const OdometrySample& s : samples) {
+    size_t n = encode(s);
+    bytes += n;
+    wire += mqtt_wire_bytes(topic, n);
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0)
+                  .count();
+  Result r;
+  r.ns_per_sample = ns / samples.size();
+  r.payload_bytes = double(bytes) / samples.size();
+  r.wire_bytes = double(wire) / samples.size();
+  return r;
+}
+
+// Lote com odometria + debug; resultados por amostra (o lote substitui as
+// duas mensagens avulsas).
+Result bench_batch(const std::vector<OdometrySample>& samples, size_t per_batch,
+                   double& max_pos_err, size_t& decode_errors) {
+  TelemetryBatch batch;
+  size_t bytes = 0;
+  size_t wire = 0;
+  telemetry_batch_begin(batch, true);
+
+  auto emit = [&] {
+    bytes += batch.length;
+    wire += mqtt_wire_bytes("robot/odometry", batch.length);
+    g_sink += batch.buf[batch.length - 1];
+    telemetry_batch_begin(batch, true);
+  };
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (const OdometrySample& s : samples) {
+    if (!telemetry_batch_add(batch, s)) {  // cheio por bytes
+      emit();
+      telemetry_batch_add(batch, s);
+    }
+    if (batch.count >= per_batch) emit();
+  }
+  if (batch.count > 0) emit();
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0)
+                  .count();
+
+  // Round-trip (fora da medição): erro de quantização e campos exatos
+  max_pos_err = 0;
+  decode_errors = 0;
+  OdometrySample decoded[TELEMETRY_BATCH_MAX_SAMPLES];
+  size_t first = 0;
+  while (first < samples.size()) {
+    telemetry_batch_begin(batch, true);
+    size_t n = 0;
+    while (first + n < samples.size() && n < per_batch &&
+           telemetry_batch_add(batch, samples[first + n])) {
+      ++n;
+    }
+    if (telemetry_decode_odometry_batch(batch.buf, batch.length, decoded,
+                                        TELEMETRY_BATCH_MAX_SAMPLES) != n) {
+      ++decode_errors;
+    } else {
+      for (size_t i = 0; i < n; ++i) {
+        const OdometrySample& a = samples[first + i];
+        const OdometrySample& b = decoded[i];
+        if (a.seq != b.seq || a.t_ms != b.t_ms || a.contagemR != b.contagemR ||
+            a.contagemL != b.contagemL || a.dt_ms != b.dt_ms ||
+            fabsf(a.velR - b.velR) > 1e-4f || fabsf(a.phi - b.phi) > 1e-5f) {
+          ++decode_errors;
+        }
+        double err = fmax(fabs(a.x - b.x), fabs(a.y - b.y));
+        if (err > max_pos_err) max_pos_err = err;
+      }
+    }
+    first += n;
+  }
+
+  Result r;
+  r.ns_per_sample = ns / samples.size();
+  r.payload_bytes = double(bytes) / samples.size();
+  r.wire_bytes = double(wire) / samples.size();
+  return r;
+}
+
+void print_row(const char* name, const Result& r) {
+  printf("%-16s %10.1f %12.1f %12.1f\n", name, r.ns_per_sample, r.payload_bytes, r.wire_bytes);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  size_t n = 200000;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+      n = strtoul(argv[++i], nullptr, 10);
+    } else {
+      fprintf(stderr, "uso: %s [--samples N]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (n == 0) n = 1;
+
+  std::vector<OdometrySample> samples = make_samples(n);
+  const char* odom_topic = "robot/odometry";
+  const char* debug_topic = "robot/odometry/debug";
+
+  Result json_odom = bench(samples, odom_topic, [](const OdometrySample& s) {
+    String out;
+    telemetry_odometry_json(s, out);
+    g_sink += out.c_str()[0];
+    return static_cast<size_t>(out.length());
+  });
+  Result json_debug = bench(samples, debug_topic, [](const OdometrySample& s) {
+    String out;
+    telemetry_odometry_debug_json(s, out);
+    g_sink += out.c_str()[0];
+    return static_cast<size_t>(out.length());
+  });
+  Result bin_odom = bench(samples, odom_topic, [](const OdometrySample& s) {
+    uint8_t frame[TELEMETRY_ODOMETRY_FRAME_SIZE];
+    size_t len = telemetry_encode_odometry(s, frame, sizeof(frame));
+    g_sink += frame[len - 1];
+    return len;
+  });
+  Result bin_debug = bench(samples, debug_topic, [](const OdometrySample& s) {
+    uint8_t frame[TELEMETRY_DEBUG_FRAME_SIZE];
+    size_t len = telemetry_encode_odometry_debug(s, frame, sizeof(frame));
+    g_sink += frame[len - 1];
+    return len;
+  });
+
+  // Round-trip exato (floats são copiados bit a bit)
+  size_t mismatches = 0;
+  for (const OdometrySample& s : samples) {
+    uint8_t frame[TELEMETRY_DEBUG_FRAME_SIZE];
+    OdometrySample d = {};
+    telemetry_encode_odometry(s, frame, sizeof(frame));
+    bool ok = telemetry_decode_odometry(frame, TELEMETRY_ODOMETRY_FRAME_SIZE, d) &&
+              d.seq == s.seq && d.t_ms == s.t_ms && d.x == s.x && d.y == s.y && d.phi == s.phi;
+    telemetry_encode_odometry_debug(s, frame, sizeof(frame));
+    ok = ok && telemetry_decode_odometry_debug(frame, TELEMETRY_DEBUG_FRAME_SIZE, d) &&
+         d.contagemR == s.contagemR && d.contagemL == s.contagemL && d.velR == s.velR &&
+         d.velL == s.velL && d.dt_ms == s.dt_ms;
+    if (!ok) ++mismatches;
+  }
+
+  printf("%zu amostras\n", n);
+  printf("%-16s %10s %12s %12s\n", "formato", "ns/amostra", "payload (B)", "no fio (B)");
+  print_row("json odometria", json_odom);
+  print_row("bin  odometria", bin_odom);
+  print_row("json debug", json_debug);
+  print_row("bin  debug", bin_debug);
+  printf("odometria: %.1fx mais rapido, %.0f%% dos bytes no fio\n",
+         json_odom.ns_per_sample / bin_odom.ns_per_sample,
+         100.0 * bin_odom.wire_bytes / json_odom.wire_bytes);
+  printf("debug    : %.1fx mais rapido, %.0f%% dos bytes no fio\n",
+         json_debug.ns_per_sample / bin_debug.ns_per_sample,
+         100.0 * bin_debug.wire_bytes / json_debug.wire_bytes);
+  printf("round-trip binario: %zu divergencias\n", mismatches);
+
+  // Lote: compara com odometria + debug avulsos (duas mensagens por amostra)
+  Result json_pair = {json_odom.ns_per_sample + json_debug.ns_per_sample,
+                      json_odom.payload_bytes + json_debug.payload_bytes,
+                      json_odom.wire_bytes + json_debug.wire_bytes};
+  Result bin_pair = {bin_odom.ns_per_sample + bin_debug.ns_per_sample,
+                     bin_odom.payload_bytes + bin_debug.payload_bytes,
+                     bin_odom.wire_bytes + bin_debug.wire_bytes};
+  printf("\npor amostra (odometria + debug)\n");
+  printf("%-16s %10s %12s %12s %10s\n", "formato", "ns/amostra", "payload (B)", "no fio (B)",
+         "razao json");
+  printf("%-16s %10.1f %12.1f %12.1f %10.2f\n", "json avulso", json_pair.ns_per_sample,
+         json_pair.payload_bytes, json_pair.wire_bytes, 1.0);
+  printf("%-16s %10.1f %12.1f %12.1f %10.2f\n", "bin  avulso", bin_pair.ns_per_sample,
+         bin_pair.payload_bytes, bin_pair.wire_bytes, json_pair.wire_bytes / bin_pair.wire_bytes);
+  const size_t batch_sizes[] = {5, 10, 32, 64};
+  size_t batch_errors = 0;
+  double worst_err = 0;
+  for (size_t per_batch : batch_sizes) {
+    double err;
+    size_t errors;
+    Result r = bench_batch(samples, per_batch, err, errors);
+    char name[32];
+    snprintf(name, sizeof(name), "lote de %zu", per_batch);
+    printf("%-16s %10.1f %12.1f %12.1f %10.2f\n", name, r.ns_per_sample, r.payload_bytes,
+           r.wire_bytes, json_pair.wire_bytes / r.wire_bytes);
+    batch_errors += errors;
+    if (err > worst_err) worst_err = err;
+  }
+  printf("round-trip lote: %zu divergencias, erro max de posicao %.2e m\n", batch_errors,
+         worst_err);
+  return mismatches == 0 && batch_errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,208 @@
+// Compara os estimadores de velocidade de velocity_estimator.h (contagem por
+// janela x M/T com carimbo de tempo das bordas) em sinais de encoder
+// sintéticos: o perfil de velocidade verdadeiro é integrado em passos de
+// 10 µs, cada borda ganha o instante exato (mais um atraso de interrupção
+// sorteado em 0..jitter) e os estimadores rodam nos períodos de controle de
+// 50, 10 e 5 ms. O erro é contra a velocidade verdadeira no instante da
+// amostra, em rad/s no eixo do motor (11 bordas por volta).
+//
+// Perfis: velocidades constantes baixas e nominal, rampa, senoide e uma
+// senoide em torno de zero (inversões e paradas). No fim, o custo de cada
+// atualização no host e a taxa máxima de bordas, que é a carga da
+// interrupção de captura no ESP32.
+//
+// Uso: velocity_estimator_bench [--seconds S] [--jitter-us N] [--seed N]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+#include "velocity_estimator.h"
+
+namespace {
+
+const double kEdgesPerRev = 11.0;
+const double kStepUs = 10.0;
+
+volatile float g_sink = 0;
+
+double edges_to_rad(double edges_per_s) {
+  return edges_per_s / kEdgesPerRev * 2.0 * M_PI;
+}
+
+double rad_to_edges(double rad_s) {
+  return rad_s * kEdgesPerRev / (2.0 * M_PI);
+}
+
+struct Profile {
+  const char* name;
+  double (*speed)(double t);  // rad/s no eixo do motor
+};
+
+double slow_5(double) { return 5.0; }
+double slow_30(double) { return 30.0; }
+double nominal(double) { return 250.0; }
+double ramp(double t) { return fmin(400.0, 100.0 * t); }
+double sine(double t) { return 150.0 + 100.0 * sin(2.0 * M_PI * 0.5 * t); }
+double reversal(double t) { return 60.0 * sin(2.0 * M_PI * 0.25 * t); }
+
+const Profile kProfiles[] = {
+    {"constante 5", slow_5},     {"constante 30", slow_30}, {"constante 250", nominal},
+    {"rampa 0-400", ramp},       {"senoide 150+-100", sine}, {"inversao +-60", reversal},
+};
+
+struct ErrorStats {
+  double sum_sq;
+  double max_abs;
+  size_t n;
+
+  void add(double e) {
+    sum_sq += e * e;
+    if (fabs(e) > max_abs) max_abs = fabs(e);
+    ++n;
+  }
+  double rms() const { return n ? sqrt(sum_sq / n) : 0.0; }
+};
+
+struct Result {
+  ErrorStats count;
+  ErrorStats mt;
+  double max_edge_rate;
+};
+
+uint32_t g_rng = 1;
+uint32_t next_random() {
+  g_rng ^= g_rng << 13;
+  g_rng ^= g_rng >> 17;
+  g_rng ^= g_rng << 5;
+  return g_rng;
+}
+
+// Captura gerada pelo perfil; amostras a cada período, fora do primeiro
+// segundo (partida dos estimadores)
+Result run(const Profile& profile, double seconds, uint32_t period_us, uint32_t jitter_us) {
+  Result r = {{0, 0, 0}, {0, 0, 0}, 0};
+  HalEdgeCapture capture = {0, 0};
+  MtVelocityEstimator mt;
+  mt_velocity_reset(mt);
+
+  double position = 0.0;  // em bordas
+  int64_t floor_pos = 0;
+  int32_t last_count = 0;
+  const size_t steps = static_cast<size_t>(seconds * 1e6 / kStepUs);
+  const size_t per_period = static_cast<size_t>(period_us / kStepUs);
+  uint32_t last_sample_us = 0;
+
+  for (size_t i = 1; i <= steps; ++i) {
+    const double t0 = (i - 1) * kStepUs * 1e-6;
+    const double rate = rad_to_edges(profile.speed(t0 + 0.5 * kStepUs * 1e-6));
+    if (fabs(rate) > r.max_edge_rate) r.max_edge_rate = fabs(rate);
+    const double before = position;
+    position += rate * kStepUs * 1e-6;
+    const int64_t now_floor = static_cast<int64_t>(floor(position));
+    if (now_floor != floor_pos) {
+      // Última borda cruzada no passo, interpolada
+      const double edge_pos = now_floor > floor_pos ? static_cast<double>(now_floor)
+                                                    : static_cast<double>(now_floor + 1);
+      const double fraction = (edge_pos - before) / (position - before);
+      double edge_us = (i - 1 + fraction) * kStepUs;
+      if (jitter_us) edge_us += next_random() % (jitter_us + 1);
+      capture.edges += static_cast<int32_t>(now_floor - floor_pos);
+      capture.last_edge_us = static_cast<uint32_t>(edge_us);
+      floor_pos = now_floor;
+    }
+
+    if (i % per_period == 0) {
+      const uint32_t now_us = static_cast<uint32_t>(i * kStepUs);
+      const double truth = profile.speed(now_us * 1e-6);
+      const float count = count_velocity(capture.edges - last_count, now_us - last_sample_us);
+      // A captura pode ter borda com atraso depois de now_us: como no
+      // firmware, vale o que a interrupção já registrou
+      const float est = mt_velocity_update(mt, capture, now_us);
+      last_count = capture.edges;
+      last_sample_us = now_us;
+      if (now_us >= 1000000) {
+        r.count.add(edges_to_rad(count) - truth);
+        r.mt.add(edges_to_rad(est) - truth);
+      }
+    }
+  }
+  return r;
+}
+
+// ns por atualização do M/T sobre capturas pré-geradas (velocidade nominal)
+double mt_cost_ns(size_t updates) {
+  std::vector<HalEdgeCapture> captures(updates);
+  const double rate = rad_to_edges(250.0);
+  for (size_t i = 0; i < updates; ++i) {
+    const double t_us = (i + 1) * 10000.0;
+    const int32_t edges = static_cast<int32_t>(rate * t_us * 1e-6);
+    captures[i].edges = edges;
+    captures[i].last_edge_us = static_cast<uint32_t>(edges / rate * 1e6);
+  }
+  MtVelocityEstimator mt;
+  mt_velocity_reset(mt);
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < updates; ++i) {
+    g_sink = g_sink + mt_velocity_update(mt, captures[i], static_cast<uint32_t>((i + 1) * 10000));
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  return s * 1e9 / updates;
+}
+
+double count_cost_ns(size_t updates) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < updates; ++i) {
+    g_sink = g_sink + count_velocity(static_cast<int32_t>(i & 63), 10000 + (i & 7));
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  return s * 1e9 / updates;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double seconds = 10.0;
+  uint32_t jitter_us = 5;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--jitter-us") == 0 && i + 1 < argc) {
+      jitter_us = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      g_rng = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+      if (g_rng == 0) g_rng = 1;
+    } else {
+      fprintf(stderr, "uso: %s [--seconds S] [--jitter-us N] [--seed N]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (seconds < 2.0) seconds = 2.0;
+
+  printf("erro contra a velocidade verdadeira (rad/s no motor), %.0f s por perfil,"
+         " atraso de captura 0..%u us\n",
+         seconds, jitter_us);
+  printf("%-18s %8s %11s %11s %11s %11s\n", "perfil", "periodo", "cont. rms", "cont. max",
+         "m/t rms", "m/t max");
+  double max_edge_rate = 0;
+  const uint32_t periods_us[] = {50000, 10000, 5000};
+  for (const Profile& profile : kProfiles) {
+    for (uint32_t period_us : periods_us) {
+      Result r = run(profile, seconds, period_us, jitter_us);
+      if (r.max_edge_rate > max_edge_rate) max_edge_rate = r.max_edge_rate;
+      printf("%-18s %5u ms %11.2f %11.2f %11.2f %11.2f\n", profile.name, period_us / 1000,
+             r.count.rms(), r.count.max_abs, r.mt.rms(), r.mt.max_abs);
+    }
+  }
+
+  const size_t updates = 2000000;
+  printf("\ncusto por atualizacao (host): contagem %.1f ns, m/t %.1f ns\n",
+         count_cost_ns(updates), mt_cost_ns(updates));
+  printf("taxa maxima de bordas nos perfis: %.0f/s por roda (interrupcoes de captura)\n",
+         max_edge_rate);
+  return 0;
+}
@@ -0,0 +1,177 @@
+#include "hot_path_bench.h"
+
+#if HOT_PATH_BENCH
+
+#include <string.h>
+
+#include <Arduino.h>
+#include "async_log.h"
+#include "command_parser.h"
+#include "hal.h"
+#include "motor_control.h"
+#include "mqtt_client.h"
+#include "telemetry_codec.h"
+
+// Resultados que o compilador não pode descartar
+static volatile uint32_t g_sink = 0;
+
+static const char kPayload[] = "-12.50|4.25|a1b2c3d4|1700000000123";
+
+static OdometrySample bench_sample() {
+  OdometrySample sample = {};
+  sample.seq = 1234;
+  sample.t_ms = 987654;
+  sample.dt_ms = 50;
+  sample.x = 1.2345f;
+  sample.y = -0.5432f;
+  sample.phi = 0.7854f;
+  sample.contagemR = 37;
+  sample.contagemL = 36;
+  sample.velR_motor = 206.3f;
+  sample.velL_motor = 201.1f;
+  sample.velR = 1.40f;
+  sample.velL = 1.36f;
+  sample.x_dot = 0.123f;
+  sample.y_dot = 0.045f;
+  sample.phi_dot = 0.012f;
+  return sample;
+}
+
+// Só aritmética e bytes, sem nada do firmware: mede a máquina na mesma
+// execução, para comparar os outros kernels em múltiplos dele
+static void kernel_reference(uint32_t iterations) {
+  float acc = 0.0f;
+  for (uint32_t i = 0; i < iterations; ++i) {
+    uint32_t hash = 2166136261u ^ i;   // FNV-1a
+    for (size_t b = 0; b < sizeof(kPayload) - 1; ++b) {
+      hash = (hash ^ static_cast<uint8_t>(kPayload[b])) * 16777619u;
+    }
+    acc = acc * 0.999f + static_cast<float>(hash & 0xFFu) * 0.01f;
+    g_sink += hash;
+  }
+  g_sink += static_cast<uint32_t>(acc);
+}
+
+static void kernel_parse_command(uint32_t iterations) {
+  ParsedCommand cmd;
+  for (uint32_t i = 0; i < iterations; ++i) {
+    parse_command(reinterpret_cast<const uint8_t*>(kPayload), sizeof(kPayload) - 1, cmd);
+    g_sink += cmd.nonce.length;
+  }
+}
+
+static void kernel_execute_command(uint32_t iterations) {
+  String executed;
+  for (uint32_t i = 0; i < iterations; ++i) {
+    // Alterna as faixas para não cair sempre no mesmo ramo
+    const float yaw = (i & 1) ? -20.0f : 3.0f;
+    const float pitch = (i & 2) ? -15.0f : 0.0f;
+    net_execute_head_command(yaw, pitch, executed);
+    g_sink += get_remote_motion_command();
+  }
+}
+
+static void kernel_odometry_json(uint32_t iterations) {
+  const OdometrySample sample = bench_sample();
+  for (uint32_t i = 0; i < iterations; ++i) {
+    String payload;
+    telemetry_odometry_json(sample, payload);
+    g_sink += payload.length();
+  }
+}
+
+static void kernel_odometry_binary(uint32_t iterations) {
+  const OdometrySample sample = bench_sample();
+  uint8_t frame[TELEMETRY_DEBUG_FRAME_SIZE];
+  for (uint32_t i = 0; i < iterations; ++i) {
+    g_sink += telemetry_encode_odometry(sample, frame, sizeof(frame));
+  }
+}
+
+static void kernel_encoder(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; ++i) {
+    encoder();
+  }
+}
+
+static void kernel_motor_go(uint32_t iterations) {
+  for (uint32_t i = 0; i < iterations; ++i) {
+    const uint8_t direction = (i & 1) ? CW : CCW;
+    motorGo(MOTOR_R, direction, 0);
+    motorGo(MOTOR_L, direction, 0);
+  }
+  motorGo(MOTOR_R, BRAKE, 0);
+  motorGo(MOTOR_L, BRAKE, 0);
+}
+
+struct Kernel {
+  const char* name;
+  void (*run)(uint32_t iterations);
+};
+
+static const Kernel kKernels[HOT_PATH_KERNELS] = {
+    {"reference", kernel_reference},
+    {"parse_command", kernel_parse_command},
+    {"execute_command", kernel_execute_command},
+    {"odometry_json", kernel_odometry_json},
+    {"odometry_binary", kernel_odometry_binary},
+    {"encoder", kernel_encoder},
+    {"motor_go", kernel_motor_go},
+};
+
+static float batch_ns(const Kernel& kernel, uint32_t iterations) {
+  const uint32_t start = hal_cycle_count();
+  kernel.run(iterations);
+  const uint32_t cycles = hal_cycle_count() - start;
+  return static_cast<float>(cycles) * 1000.0f / hal_cycles_per_us() / iterations;
+}
+
+size_t hot_path_bench_run(HotPathResult* out, size_t cap, uint32_t iterations,
+                          uint8_t repeats) {
+  if (iterations == 0) iterations = 1;
+  if (repeats == 0) repeats = 1;
+  if (repeats > HOT_PATH_MAX_REPEATS) repeats = HOT_PATH_MAX_REPEATS;
+
+  const Kernel& reference = kKernels[0];
+  size_t count = 0;
+  for (const Kernel& kernel : kKernels) {
+    if (count >= cap) break;
+    batch_ns(kernel, iterations);   // aquecimento (caches, heap, estado inicial)
+    float samples[HOT_PATH_MAX_REPEATS];
+    float ref_min = 0.0f;
+    for (uint8_t r = 0; r < repeats; ++r) {
+      // Referência logo antes de cada lote: os dois pegam a mesma fase da
+      // máquina (frequência, outro processo no core)
+      if (&kernel != &reference) {
+        const float ref_ns = batch_ns(reference, iterations);
+        if (r == 0 || ref_ns < ref_min) ref_min = ref_ns;
+      }
+      // Inserção ordenada: poucos lotes
+      const float ns = batch_ns(kernel, iterations);
+      uint8_t j = r;
+      while (j > 0 && samples[j - 1] > ns) {
+        samples[j] = samples[j - 1];
+        --j;
+      }
+      samples[j] = ns;
+    }
+    HotPathResult& result = out[count++];
+    result.name = kernel.name;
+    result.iterations = iterations;
+    result.ns_per_op = samples[repeats / 2];
+    result.ns_min = samples[0];
+    result.relative = ref_min > 0.0f ? samples[0] / ref_min : 1.0f;
+  }
+  return count;
+}
+
+void hot_path_bench_log(uint32_t iterations) {
+  HotPathResult results[HOT_PATH_KERNELS];
+  const size_t count = hot_path_bench_run(results, HOT_PATH_KERNELS, iterations, 5);
+  for (size_t i = 0; i < count; ++i) {
+    LOG_I(CTRL, "[BENCH] %s: %.1f ns/op (mín %.1f, %.2fx ref, lotes de %u)", results[i].name,
+          results[i].ns_per_op, results[i].ns_min, results[i].relative, results[i].iterations);
+  }
+}
+
+#endif
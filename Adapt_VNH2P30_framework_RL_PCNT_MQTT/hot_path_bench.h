@@ -0,0 +1,53 @@
+#ifndef HOT_PATH_BENCH_H
+#define HOT_PATH_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Micro-bancada dos caminhos quentes do firmware, medida no contador de
+// ciclos (hal_cycle_count): os mesmos kernels rodam no host, sobre o HAL
+// simulado (host/tools/hot_path_bench, com JSON e comparação com a linha
+// de base), e no ESP32, com HOT_PATH_BENCH 1 no build do sketch
+// (hot_path_bench_log() no setup, antes das tarefas; a bancada mexe no
+// estado do controle e só deixa a ponte H em freio com PWM 0).
+//
+// Kernels:
+//   reference         hash e ponto flutuante sem código do firmware; cada
+//                     lote dos outros kernels vem logo depois de um lote
+//                     dele, e a razão entre os melhores (`relative`) muda
+//                     bem menos de uma máquina para outra que os ns
+//   parse_command     parse_command() de um payload yaw|pitch|nonce|t0
+//   execute_command   net_execute_head_command() + retirada da fila
+//   odometry_json     payload JSON de net_publish_odometry()
+//   odometry_binary   quadro binário de net_publish_odometry()
+//   encoder           encoder(): velocidade, cinemática, pose, regulador
+//                     e escrita na ponte H (rodas paradas)
+//   motor_go          motorGo() das duas rodas, alternando o sentido
+
+#ifndef HOT_PATH_BENCH
+#define HOT_PATH_BENCH 0
+#endif
+
+#if HOT_PATH_BENCH
+
+#define HOT_PATH_KERNELS 7
+#define HOT_PATH_MAX_REPEATS 15
+
+struct HotPathResult {
+  const char* name;
+  uint32_t iterations;   // chamadas por lote
+  float ns_per_op;       // mediana dos lotes
+  float ns_min;          // melhor lote
+  float relative;        // ns_min / melhor lote de `reference` intercalado
+};
+
+// Roda cada kernel em `repeats` lotes de `iterations` chamadas (depois de
+// um lote de aquecimento) e devolve quantos resultados escreveu.
+size_t hot_path_bench_run(HotPathResult* out, size_t cap, uint32_t iterations,
+                          uint8_t repeats);
+// No alvo: roda e manda os resultados para o log
+void hot_path_bench_log(uint32_t iterations);
+
+#endif
+
+#endif
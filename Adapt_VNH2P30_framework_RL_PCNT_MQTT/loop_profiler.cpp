@@ -0,0 +1,154 @@
+#include "loop_profiler.h"
+
+#if LOOP_PROFILING
+
+#include <stdio.h>
+#include <string.h>
+
+#include "async_log.h"
+#include "mqtt_client.h"
+
+// Acumuladores da janela; cada etapa tem um só escritor
+struct StageAccumulator {
+  uint32_t count;
+  uint32_t min_ns;
+  uint32_t max_ns;
+  uint64_t sum_ns;
+  uint32_t misses;
+  uint32_t hist[LOOP_PROFILER_BUCKETS];
+};
+
+static StageAccumulator g_stages[STAGE_COUNT] = {};
+static uint32_t g_deadline_ns[STAGE_COUNT] = {};
+static uint32_t g_window_start_ms = 0;
+static uint32_t g_cycles_per_us = 0;
+
+static const char* const kStageNames[STAGE_COUNT] = {
+    "control_cycle", "encoder", "buttons", "apply_command", "net_loop", "telemetry",
+};
+
+const char* loop_stage_name(LoopStage stage) {
+  return stage < STAGE_COUNT ? kStageNames[stage] : "?";
+}
+
+static uint8_t bucket_of(uint32_t ns) {
+  const uint32_t us = ns / 1000;
+  if (us == 0) {
+    return 0;
+  }
+  const uint8_t bucket = 32 - __builtin_clz(us);  // floor(log2(us)) + 1
+  return bucket < LOOP_PROFILER_BUCKETS ? bucket : LOOP_PROFILER_BUCKETS - 1;
+}
+
+void loop_profiler_record(LoopStage stage, uint32_t cycles) {
+  if (stage >= STAGE_COUNT) {
+    return;
+  }
+  // Frequência lida uma vez; as duas tarefas escrevem o mesmo valor
+  if (g_cycles_per_us == 0) {
+    g_cycles_per_us = hal_cycles_per_us();
+  }
+  const uint64_t wide_ns = static_cast<uint64_t>(cycles) * 1000u / g_cycles_per_us;
+  const uint32_t ns = wide_ns > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(wide_ns);
+  const uint8_t bucket = bucket_of(ns);
+
+  hal_critical_enter();
+  StageAccumulator& acc = g_stages[stage];
+  if (acc.count == 0 || ns < acc.min_ns) acc.min_ns = ns;
+  if (ns > acc.max_ns) acc.max_ns = ns;
+  acc.sum_ns += ns;
+  acc.count++;
+  acc.hist[bucket]++;
+  if (g_deadline_ns[stage] && ns > g_deadline_ns[stage]) acc.misses++;
+  hal_critical_exit();
+}
+
+void loop_profiler_set_deadline(LoopStage stage, uint32_t deadline_us) {
+  if (stage >= STAGE_COUNT) {
+    return;
+  }
+  hal_critical_enter();
+  g_deadline_ns[stage] = deadline_us * 1000u;
+  hal_critical_exit();
+}
+
+void loop_profiler_snapshot(LoopProfile& out, bool reset) {
+  const uint32_t now = hal_millis();
+  hal_critical_enter();
+  out.window_ms = now - g_window_start_ms;
+  for (int i = 0; i < STAGE_COUNT; ++i) {
+    const StageAccumulator& acc = g_stages[i];
+    LoopStageStats& st = out.stage[i];
+    st.count = acc.count;
+    st.min_ns = acc.min_ns;
+    st.max_ns = acc.max_ns;
+    st.mean_ns = acc.count ? static_cast<uint32_t>(acc.sum_ns / acc.count) : 0;
+    st.deadline_us = g_deadline_ns[i] / 1000u;
+    st.misses = acc.misses;
+    for (int b = 0; b < LOOP_PROFILER_BUCKETS; ++b) st.hist[b] = acc.hist[b];
+  }
+  if (reset) {
+    memset(g_stages, 0, sizeof(g_stages));
+    g_window_start_ms = now;
+  }
+  hal_critical_exit();
+}
+
+void loop_profiler_dump(const LoopProfile& profile) {
+  LOG_I(PROF, "[PROF] janela de %u ms (ns: min/média/máx; faixas em us)", profile.window_ms);
+  for (int i = 0; i < STAGE_COUNT; ++i) {
+    const LoopStageStats& st = profile.stage[i];
+    LOG_I(PROF, "[PROF] %s: n=%u %u/%u/%u", loop_stage_name(static_cast<LoopStage>(i)), st.count,
+          st.min_ns, st.mean_ns, st.max_ns);
+    if (st.deadline_us) {
+      LOG_I(PROF, "[PROF]   estouros(%u us)=%u", st.deadline_us, st.misses);
+    }
+    // Só as faixas ocupadas: "<1:n", "1:n" (1–2 us), "2:n" (2–4 us)...,
+    // em registros de até LOG_TEXT_MAX caracteres
+    char text[LOG_TEXT_MAX];
+    size_t length = 0;
+    for (int b = 0; b < LOOP_PROFILER_BUCKETS; ++b) {
+      if (!st.hist[b]) continue;
+      char entry[24];
+      const int n = b == 0 ? snprintf(entry, sizeof(entry), " <1:%lu",
+                                      static_cast<unsigned long>(st.hist[b]))
+                           : snprintf(entry, sizeof(entry), " %lu:%lu", 1UL << (b - 1),
+                                      static_cast<unsigned long>(st.hist[b]));
+      if (length + n > LOG_TEXT_MAX) {
+        LOG_I(PROF, "[PROF]  %s", log_text(text, length));
+        length = 0;
+      }
+      memcpy(text + length, entry, n);
+      length += n;
+    }
+    if (length) {
+      LOG_I(PROF, "[PROF]  %s", log_text(text, length));
+    }
+  }
+}
+
+void loop_profiler_publish() {
+  static unsigned long last_publish = 0;
+  static uint8_t publishes = 0;
+
+  unsigned long now = hal_millis();
+  if ((now - last_publish) < LOOP_PROFILE_PERIOD_MS) {
+    return;
+  }
+  // Offline a janela continua acumulando e sai inteira na volta do broker
+  if (!hal_mqtt_connected()) {
+    return;
+  }
+  last_publish = now;
+
+  LoopProfile profile;
+  loop_profiler_snapshot(profile, true);
+  net_publish_loop_profile(profile);
+
+  if (++publishes >= LOOP_PROFILE_DUMP_EVERY) {
+    publishes = 0;
+    loop_profiler_dump(profile);
+  }
+}
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <stdint.h>
+
+#include "hal.h"
+
+// Perfil por etapa dos laços de controle e de rede: duração de cada
+// chamada medida no contador de ciclos da CPU (hal_cycle_count), com
+// mínimo, máximo, média, histograma em faixas de potência de 2 e contagem
+// de prazos estourados. A janela é publicada a cada LOOP_PROFILE_PERIOD_MS
+// em robot/loop/profile e, de tempos em tempos, impressa na serial.
+//
+// Cada etapa é medida sempre pela mesma tarefa (e pelo mesmo core: o
+// contador de ciclos é por core); a leitura vem de outra tarefa em seção
+// crítica curta.
+//
+// Com LOOP_PROFILING 0 os marcadores viram nada e o módulo não gera código.
+
+#ifndef LOOP_PROFILING
+#define LOOP_PROFILING 1
+#endif
+
+// Faixa 0: < 1 µs; faixa i: [2^(i-1), 2^i) µs; a última junta o resto
+// (>= 65,5 ms)
+#define LOOP_PROFILER_BUCKETS 18
+#define LOOP_PROFILE_PERIOD_MS 5000
+#define LOOP_PROFILE_DUMP_EVERY 12   // janelas entre impressões na serial
+
+enum LoopStage {
+  STAGE_CONTROL_CYCLE = 0,  // control_task_step inteiro
+  STAGE_ENCODER,            // encoder()
+  STAGE_BUTTONS,            // leituraBotoes()
+  STAGE_APPLY_COMMAND,      // apply_motion_command()
+  STAGE_NET_LOOP,           // net_mqtt_loop()
+  STAGE_TELEMETRY,          // odometry_publish_pending()
+  STAGE_COUNT,
+};
+
+struct LoopStageStats {
+  uint32_t count;
+  uint32_t min_ns;
+  uint32_t max_ns;
+  uint32_t mean_ns;
+  uint32_t deadline_us;     // 0 = sem prazo
+  uint32_t misses;          // chamadas que passaram do prazo
+  uint32_t hist[LOOP_PROFILER_BUCKETS];
+};
+
+struct LoopProfile {
+  uint32_t window_ms;
+  LoopStageStats stage[STAGE_COUNT];
+};
+
+#if LOOP_PROFILING
+
+const char* loop_stage_name(LoopStage stage);
+
+void loop_profiler_record(LoopStage stage, uint32_t cycles);
+void loop_profiler_set_deadline(LoopStage stage, uint32_t deadline_us);
+// Cópia consistente da janela; reset=true inicia uma nova
+void loop_profiler_snapshot(LoopProfile& out, bool reset);
+void loop_profiler_dump(const LoopProfile& profile);   // serial
+// Contexto de rede: publica a cada LOOP_PROFILE_PERIOD_MS
+void loop_profiler_publish();
+
+#define LOOP_PROFILE_BEGIN(stage) const uint32_t loop_profile_start_##stage = hal_cycle_count()
+#define LOOP_PROFILE_END(stage) \
+  loop_profiler_record(stage, hal_cycle_count() - loop_profile_start_##stage)
+
+#else
+
+inline void loop_profiler_set_deadline(LoopStage, uint32_t) {}
+inline void loop_profiler_publish() {}
+
+#define LOOP_PROFILE_BEGIN(stage) do {} while (0)
+#define LOOP_PROFILE_END(stage) do {} while (0)
+
+#endif
+
+#endif
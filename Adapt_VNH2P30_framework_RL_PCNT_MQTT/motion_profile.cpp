@@ -0,0 +1,78 @@
+#include "motion_profile.h"
+
+#include <math.h>
+
+// Ajustados em host/tools/motion_profile_bench: 0,5 m/s² faz a rampa do
+// comando "frente" (~0,21 m/s) em ~0,45 s com pico de corrente perto de 1 A.
+// O angular dá 0,25 m/s² na borda das rodas: numa troca de frente para
+// giro os dois eixos se somam na roda que inverte.
+static const MotionProfileConfig kDefaultConfig = {
+    PROFILE_SCURVE,
+    {0.5f, 5.0f},    // linear
+    {0.8f, 8.0f},    // angular (0,62 m entre as rodas)
+};
+
+MotionProfileConfig motion_profile_default_config() {
+  return kDefaultConfig;
+}
+
+void profile_axis_reset(ProfileAxisState& state, float value) {
+  state.value = value;
+  state.rate = 0.0f;
+}
+
+static float clampf(float x, float lo, float hi) {
+  return x < lo ? lo : (x > hi ? hi : x);
+}
+
+// Curva S com o alvo acima da referência (o chamador espelha o sinal).
+// Aceleração a1 do ciclo: a maior em [a0 − J·dt, a0 + J·dt] ∩ [−A, A] que
+// ainda deixa frear em jerk até o alvo:
+//   v + (a0 + a1)·dt/2 + a1²/(2J) <= alvo
+static float scurve_rate(float value, float rate, float target, float accel, float jerk,
+                         float dt_s) {
+  const float lo = fmaxf(-accel, rate - jerk * dt_s);
+  const float hi = fminf(accel, rate + jerk * dt_s);
+  const float c = value + 0.5f * rate * dt_s - target;
+  const float disc = 0.25f * dt_s * dt_s - 2.0f * c / jerk;
+  if (disc < 0.0f) {
+    return lo;  // já vai passar do alvo: freia o máximo
+  }
+  return clampf(jerk * (sqrtf(disc) - 0.5f * dt_s), lo, hi);
+}
+
+float profile_axis_step(ProfileAxisState& state, MotionProfileMode mode,
+                        const ProfileAxisLimits& limits, float target, float dt_s) {
+  if (mode == PROFILE_STEP || limits.accel <= 0.0f || dt_s <= 0.0f || !(target == target)) {
+    profile_axis_reset(state, target == target ? target : 0.0f);
+    return state.value;
+  }
+
+  const float err = target - state.value;
+  if (mode == PROFILE_TRAPEZOID || limits.jerk <= 0.0f) {
+    const float max_step = limits.accel * dt_s;
+    const float step = clampf(err, -max_step, max_step);
+    state.value += step;
+    state.rate = step / dt_s;
+    return state.value;
+  }
+
+  // Espelha para o alvo ficar sempre acima
+  const float sign = err >= 0.0f ? 1.0f : -1.0f;
+  const float value = sign * state.value;
+  const float rate = sign * state.rate;
+  const float goal = sign * target;
+  const float next_rate = scurve_rate(value, rate, goal, limits.accel, limits.jerk, dt_s);
+  float next = value + 0.5f * (rate + next_rate) * dt_s;
+
+  // Chegada: passou do alvo ou falta menos que um passo de jerk, com
+  // aceleração pequena o bastante para zerar em um ciclo
+  const float jerk_step = limits.jerk * dt_s;
+  if ((next >= goal || goal - next <= 0.5f * jerk_step * dt_s) && fabsf(next_rate) <= jerk_step) {
+    profile_axis_reset(state, target);
+    return state.value;
+  }
+  state.value = sign * next;
+  state.rate = sign * next_rate;
+  return state.value;
+}
@@ -0,0 +1,50 @@
+#ifndef MOTION_PROFILE_H
+#define MOTION_PROFILE_H
+
+#include <stdint.h>
+
+// Gerador de perfil entre o comando e o regulador de velocidade: a cada
+// ciclo de controle a referência de um eixo (velocidade linear em m/s ou
+// angular em rad/s) anda em direção ao alvo sem degrau.
+//
+//   STEP:      a referência pula para o alvo (comportamento original).
+//   TRAPEZOID: aceleração limitada (accel); a aceleração em si muda em
+//              degrau no início e no fim da rampa.
+//   SCURVE:    aceleração limitada e variação da aceleração limitada (jerk).
+//              A cada ciclo escolhe a maior aceleração que ainda permite
+//              chegar ao alvo com aceleração zero freando em jerk; um alvo
+//              novo no meio da rampa é seguido sem passar dele.
+//
+// O estado guarda a referência e a aceleração corrente; o alvo pode mudar a
+// qualquer ciclo. Sem limite válido (accel <= 0, ou jerk <= 0 na curva S)
+// o eixo cai para o modo mais simples que os limites permitem.
+
+enum MotionProfileMode {
+  PROFILE_STEP = 0,
+  PROFILE_TRAPEZOID,
+  PROFILE_SCURVE,
+};
+
+struct ProfileAxisLimits {
+  float accel;  // unidade/s²
+  float jerk;   // unidade/s³ (só na curva S)
+};
+
+struct MotionProfileConfig {
+  MotionProfileMode mode;
+  ProfileAxisLimits linear;   // m/s², m/s³
+  ProfileAxisLimits angular;  // rad/s², rad/s³
+};
+
+struct ProfileAxisState {
+  float value;  // referência entregue ao regulador
+  float rate;   // aceleração da referência no último ciclo
+};
+
+MotionProfileConfig motion_profile_default_config();
+void profile_axis_reset(ProfileAxisState& state, float value);
+// Um ciclo de controle: devolve a nova referência (também em state.value)
+float profile_axis_step(ProfileAxisState& state, MotionProfileMode mode,
+                        const ProfileAxisLimits& limits, float target, float dt_s);
+
+#endif
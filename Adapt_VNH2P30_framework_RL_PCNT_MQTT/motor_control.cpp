@@ -1,9 +1,22 @@
 #include "motor_control.h"
 #include <math.h>
+#include "async_log.h"
 #include "mqtt_client.h"
+#include "spsc_ring.h"
+#include "command_trace.h"
+#include "speed_controller.h"
+#include "velocity_estimator.h"
+#include "pose_integrator.h"
+#include "motion_profile.h"
+#include "safety_stop.h"
+#include "session_record.h"
 
 static unsigned short usMotor_Status = BRAKE;
-static unsigned long last_time = 0;
+// Relógio do ciclo anterior (ControlInputs); o ms também serve de "agora"
+// para o timeout dos comandos remotos
+static bool g_encoder_primed = false;
+static uint32_t last_time = 0;
+static uint32_t g_cycle_ms = 0;
 
 static uint8_t currentPwmR = 0;
 static uint8_t currentPwmL = 0;
@@ -11,26 +24,67 @@ static float targetVelR = 0.0f;
 static float targetVelL = 0.0f;
 static uint8_t lastDirectionR = BRAKE;
 static uint8_t lastDirectionL = BRAKE;
-static float poseX = 0.0f;
-static float poseY = 0.0f;
-static float posePhi = 0.0f;
+// Pose integrada pelas contagens; método trocado por outra tarefa
+static PoseState g_pose = {};
+static PoseIntegratorConfig g_pose_config = pose_integrator_default_config();
+// Perfil de movimento: alvo pedido pelo último comando e referência corrente
+// (v, w), só da tarefa de controle; a configuração vem de outra tarefa
+static MotionProfileConfig g_profile_config = motion_profile_default_config();
+static Twist g_profile_goal = {0.0f, 0.0f};
+static ProfileAxisState g_profile_v = {0.0f, 0.0f};
+static ProfileAxisState g_profile_w = {0.0f, 0.0f};
 
 static const bool kPublishDebugOdometry = true;
 
 static const uint8_t PWM_STEP = 2;
-static const float MAX_TARGET_VELOCITY = 400.0f;
 static const uint8_t DEFAULT_PWM_FORWARD = 159;
 static const uint8_t DEFAULT_PWM_REVERSE = 159;
 static const uint8_t DEFAULT_PWM_TURN = 159;
 
-static MotionCommand g_remote_command = MOTION_STOP;
+// Regulador de velocidade: ganhos trocados por outra tarefa, copiados a
+// cada ciclo dentro de seção crítica
+static SpeedControllerMode g_speed_mode = DEFAULT_SPEED_CONTROLLER;
+static SpeedPidGains g_speed_gains = speed_pid_default_gains();
+static SpeedPidState g_pidR = {};
+static SpeedPidState g_pidL = {};
+
+// Velocidade medida: contagem do PCNT ou M/T com a captura de bordas
+static VelocityEstimatorMode g_velocity_mode = DEFAULT_VELOCITY_ESTIMATOR;
+static bool g_edge_capture_ok = false;
+static MtVelocityEstimator g_mtR = {};
+static MtVelocityEstimator g_mtL = {};
+
+// Totais de 64 bits do PCNT da leitura anterior (só a tarefa de controle)
+static int64_t g_pcnt_lastR = 0;
+static int64_t g_pcnt_lastL = 0;
+// PCNT − captura de bordas no setup: as duas contam as mesmas bordas
+static int32_t g_capture_offsetR = 0;
+static int32_t g_capture_offsetL = 0;
+static int32_t g_capture_diff = 0;
+static uint32_t g_count_clamped = 0;
+
 static MotionCommand g_last_applied_command = MOTION_STOP;
-static unsigned long g_remote_command_last_update = 0;
-static const unsigned long REMOTE_COMMAND_TIMEOUT_MS = 3000;  // 1s sem mensagens -> STOP
-static bool g_pcnt_pins_logged = false;
+// Rede -> controle; o registro corrente é só da tarefa de controle
+static CommandQueue g_remote_queue(REMOTE_COMMAND_POLICY);
+static CommandRecord g_remote_current = {MOTION_STOP, {0.0f, 0.0f}, {0, 0, 0}, 0, 0};
+static bool g_remote_received = false;
+// 3 s sem mensagens -> STOP; com o prazo da rede da parada de segurança
+// ligado (remote_ms), vale o dele
+static const unsigned long REMOTE_COMMAND_TIMEOUT_MS = 3000;
+// O comando remoto foi consultado neste ciclo (sem botão pressionado)
+static bool g_remote_in_use = false;
+// Depois de uma parada de segurança, só vale comando enfileirado a partir
+// de g_remote_hold_ms
+static bool g_remote_hold = false;
+static uint32_t g_remote_hold_ms = 0;
+
+// Última amostra do laço de controle, lida pela tarefa de rede
+static OdometrySample g_sample = {};
+// Todas as amostras, para a telemetria em lote (controle -> rede)
+static SpscRing<OdometrySample, ODOMETRY_RING_SIZE> g_sample_ring;
 
 static float pwmToTargetVelocity(uint8_t pwm) {
-  return (pwm / 255.0f) * MAX_TARGET_VELOCITY;
+  return pwm * Robot::kMotorRadSPerPwm;
 }
 
 static void setTargetVelocities(uint8_t pwmR, uint8_t pwmL, bool oppositeDirections) {
@@ -61,7 +115,7 @@ static uint8_t adjustPwm(uint8_t current, float measured, float target) {
   return current;
 }
 
-static void synchronizeWheels(MotionCommand command, float velR, float velL) {
+static void synchronizeWheels(bool stopped, float velR, float velL) {
   const float syncTolerance = 0.5f;
   float diff = fabs(velR) - fabs(velL);
 
@@ -77,165 +131,526 @@ static void synchronizeWheels(MotionCommand command, float velR, float velL) {
     currentPwmR = (currentPwmR < 255) ? currentPwmR + 1 : currentPwmR;
   }
 
-  if (command == MOTION_STOP) {
+  if (stopped) {
     currentPwmR = 0;
     currentPwmL = 0;
   }
 }
 
+static float directionSign(uint8_t direction) {
+  return direction == CW ? 1.0f : (direction == CCW ? -1.0f : 0.0f);
+}
+
+// PWM inicial de um novo comando: o pedido no modo original, o feedforward
+// no PID (o regulador assume no próximo ciclo).
+static uint8_t startPwm(uint8_t requested, float target) {
+  if (g_speed_mode != SPEED_CTRL_PID) {
+    return requested;
+  }
+  hal_critical_enter();
+  SpeedPidGains gains = g_speed_gains;
+  hal_critical_exit();
+  speed_pid_reset(g_pidR);
+  speed_pid_reset(g_pidL);
+  float pwm = speed_pid_feedforward(gains, fabs(target));
+  return pwm >= SPEED_PWM_MAX ? 255 : static_cast<uint8_t>(pwm + 0.5f);
+}
+
+// Velocidade do eixo do motor (rad/s, com sinal) para uma velocidade linear
+// da roda (m/s)
+static float wheelToMotor(float v_mps) {
+  return v_mps * Robot::kMotorRadSPerWheelMps;
+}
+
+static float motorToWheel(float motor_rad_s) {
+  return motor_rad_s * Robot::kWheelMpsPerMotorRadS;
+}
+
+// Nova referência de uma roda; PWM de partida e PID zerado só na troca de
+// sentido (ou saindo do repouso)
+static void setWheelTarget(float motor_rad_s, float& target, uint8_t& direction,
+                           uint8_t& pwm, SpeedPidState& pid) {
+  const float kMinTarget = 0.5f;  // rad/s no motor; abaixo disso, parada
+  uint8_t next = BRAKE;
+  if (motor_rad_s > kMinTarget) next = CW;
+  if (motor_rad_s < -kMinTarget) next = CCW;
+
+  target = next == BRAKE ? 0.0f : motor_rad_s;
+  if (next == direction) {
+    return;
+  }
+  direction = next;
+  speed_pid_reset(pid);
+  if (next == BRAKE) {
+    pwm = 0;
+  } else if (g_speed_mode == SPEED_CTRL_PID) {
+    hal_critical_enter();
+    SpeedPidGains gains = g_speed_gains;
+    hal_critical_exit();
+    float ff = speed_pid_feedforward(gains, fabs(motor_rad_s));
+    pwm = ff >= SPEED_PWM_MAX ? 255 : static_cast<uint8_t>(ff + 0.5f);
+  } else {
+    float ratio = fabs(motor_rad_s) * Robot::kInvMaxMotorRadS;
+    pwm = static_cast<uint8_t>((ratio > 1.0f ? 1.0f : ratio) * 255.0f + 0.5f);
+  }
+}
+
+// Satura as duas pela mesma razão: a curvatura pedida se mantém
+static void limitWheelTargets(float& right, float& left) {
+  const float peak = fabs(right) > fabs(left) ? fabs(right) : fabs(left);
+  if (peak > Robot::kMaxMotorRadS) {
+    const float scale = Robot::kMaxMotorRadS / peak;
+    right *= scale;
+    left *= scale;
+  }
+}
+
+static MotionProfileMode profileMode() {
+  hal_critical_enter();
+  const MotionProfileMode mode = g_profile_config.mode;
+  hal_critical_exit();
+  return mode;
+}
+
+// Alvo de um comando, em rad/s com sinal no eixo de cada motor. Com perfil o
+// comando para aqui e encoder() leva a referência até o alvo; no degrau a
+// referência acompanha o alvo, para uma troca de modo seguir de onde o robô
+// está.
+static bool setProfileGoal(float motorR, float motorL, MotionCommand command) {
+  const float right = motorToWheel(motorR);
+  const float left = motorToWheel(motorL);
+  g_profile_goal.v_mps = 0.5f * (right + left);
+  g_profile_goal.w_radps = (right - left) * Robot::kInvWheelBaseM;
+  if (profileMode() == PROFILE_STEP) {
+    profile_axis_reset(g_profile_v, g_profile_goal.v_mps);
+    profile_axis_reset(g_profile_w, g_profile_goal.w_radps);
+    return false;
+  }
+  g_last_applied_command = command;
+  return true;
+}
+
+// Um ciclo do perfil: referência (v, w) -> velocidade de cada roda
+static void profileStep(float dt_s) {
+  hal_critical_enter();
+  const MotionProfileConfig config = g_profile_config;
+  hal_critical_exit();
+  if (config.mode == PROFILE_STEP) {
+    return;
+  }
+  const float v = profile_axis_step(g_profile_v, config.mode, config.linear,
+                                    g_profile_goal.v_mps, dt_s);
+  const float w = profile_axis_step(g_profile_w, config.mode, config.angular,
+                                    g_profile_goal.w_radps, dt_s);
+  float right = wheelToMotor(v + w * Robot::kHalfWheelBaseM);
+  float left = wheelToMotor(v - w * Robot::kHalfWheelBaseM);
+  limitWheelTargets(right, left);
+  setWheelTarget(right, targetVelR, lastDirectionR, currentPwmR, g_pidR);
+  setWheelTarget(left, targetVelL, lastDirectionL, currentPwmL, g_pidL);
+  usMotor_Status = (lastDirectionR == BRAKE && lastDirectionL == BRAKE) ? BRAKE : CW;
+}
+
+static void regulateSpeed(float velR_motor, float velL_motor, float dt_s) {
+  // Medida projetada no sentido comandado de cada roda
+  float measuredR = velR_motor * directionSign(lastDirectionR);
+  float measuredL = velL_motor * directionSign(lastDirectionL);
+  float targetMagR = fabs(targetVelR);
+  float targetMagL = fabs(targetVelL);
+
+  if (g_speed_mode != SPEED_CTRL_PID) {
+    currentPwmR = adjustPwm(currentPwmR, fabs(velR_motor), targetMagR);
+    currentPwmL = adjustPwm(currentPwmL, fabs(velL_motor), targetMagL);
+    // Iguala as rodas só com a mesma referência nas duas: twist em curva e
+    // transições do perfil pedem velocidades diferentes. Parando pelo perfil,
+    // o PWM só zera quando a referência chega a zero.
+    const bool sameTarget = fabs(targetMagR - targetMagL) < 0.5f;
+    const bool discrete = g_last_applied_command != MOTION_TWIST && profileMode() == PROFILE_STEP;
+    if (sameTarget || discrete) {
+      const bool stopped =
+          g_last_applied_command == MOTION_STOP && targetMagR <= 0.0f && targetMagL <= 0.0f;
+      synchronizeWheels(stopped, velR_motor, velL_motor);
+    }
+    return;
+  }
+
+  hal_critical_enter();
+  SpeedPidGains gains = g_speed_gains;
+  hal_critical_exit();
+
+  // Erro de sincronismo em rad/s: diferença das razões medida/referência,
+  // escalada pela referência média (> 0: direita adiantada). Com o perfil em
+  // rampa cada roda segue a sua: perto de uma troca de sentido a razão de
+  // uma delas explode e arrastaria a outra.
+  const bool ramping = g_profile_v.rate != 0.0f || g_profile_w.rate != 0.0f;
+  float sync = 0.0f;
+  if (targetMagR > 0.0f && targetMagL > 0.0f && !ramping) {
+    sync = (measuredR / targetMagR - measuredL / targetMagL) * 0.5f * (targetMagR + targetMagL);
+  }
+  currentPwmR = speed_pid_update(gains, g_pidR, targetMagR, measuredR, sync, dt_s);
+  currentPwmL = speed_pid_update(gains, g_pidL, targetMagL, measuredL, -sync, dt_s);
+}
+
+void motor_set_speed_controller(SpeedControllerMode mode) {
+  hal_critical_enter();
+  g_speed_mode = mode;
+  hal_critical_exit();
+}
+
+SpeedControllerMode motor_speed_controller() {
+  return g_speed_mode;
+}
+
+void motor_set_speed_gains(const SpeedPidGains& gains) {
+  hal_critical_enter();
+  g_speed_gains = gains;
+  hal_critical_exit();
+}
+
+SpeedPidGains motor_speed_gains() {
+  hal_critical_enter();
+  SpeedPidGains gains = g_speed_gains;
+  hal_critical_exit();
+  return gains;
+}
+
+void motor_set_velocity_estimator(VelocityEstimatorMode mode) {
+  hal_critical_enter();
+  g_velocity_mode = mode;
+  hal_critical_exit();
+}
+
+VelocityEstimatorMode motor_velocity_estimator() {
+  return g_velocity_mode;
+}
+
+void motor_set_pose_integrator(const PoseIntegratorConfig& config) {
+  hal_critical_enter();
+  g_pose_config = config;
+  hal_critical_exit();
+}
+
+PoseIntegratorConfig motor_pose_integrator() {
+  hal_critical_enter();
+  PoseIntegratorConfig config = g_pose_config;
+  hal_critical_exit();
+  return config;
+}
+
+void motor_set_motion_profile(const MotionProfileConfig& config) {
+  hal_critical_enter();
+  g_profile_config = config;
+  hal_critical_exit();
+}
+
+MotionProfileConfig motor_motion_profile() {
+  hal_critical_enter();
+  MotionProfileConfig config = g_profile_config;
+  hal_critical_exit();
+  return config;
+}
+
 void setupPCNT() {
-  pcnt_config_t configR;
-  configR.pulse_gpio_num = ENCODER_RA;
-  configR.ctrl_gpio_num = ENCODER_RB;
-  configR.channel = PCNT_CHANNEL_0;
-  configR.unit = PCNT_UNIT_0;
-  configR.pos_mode = PCNT_COUNT_INC;
-  configR.neg_mode = PCNT_COUNT_DEC;
-  configR.lctrl_mode = PCNT_MODE_REVERSE;
-  configR.hctrl_mode = PCNT_MODE_KEEP;
-  configR.counter_h_lim = 10000;
-  configR.counter_l_lim = -10000;
-  pcnt_unit_config(&configR);
-  pcnt_counter_clear(PCNT_UNIT_0);
-  pcnt_counter_resume(PCNT_UNIT_0);
-
-  pcnt_config_t configL = configR;
-  configL.pulse_gpio_num = ENCODER_LA;
-  configL.ctrl_gpio_num = ENCODER_LB;
-  configL.unit = PCNT_UNIT_1;
-  pcnt_unit_config(&configL);
-  pcnt_counter_clear(PCNT_UNIT_1);
-  pcnt_counter_resume(PCNT_UNIT_1);
+  hal_pcnt_setup(PCNT_UNIT_R, Robot::kEncoderRA, Robot::kEncoderRB, Robot::kPcntLimit,
+                 -Robot::kPcntLimit);
+  hal_pcnt_setup(PCNT_UNIT_L, Robot::kEncoderLA, Robot::kEncoderLB, Robot::kPcntLimit,
+                 -Robot::kPcntLimit);
+
+  g_edge_capture_ok = hal_edge_capture_setup(PCNT_UNIT_R, Robot::kEncoderRA, Robot::kEncoderRB) &&
+                      hal_edge_capture_setup(PCNT_UNIT_L, Robot::kEncoderLA, Robot::kEncoderLB);
+  mt_velocity_reset(g_mtR);
+  mt_velocity_reset(g_mtL);
+
+  g_pcnt_lastR = hal_pcnt_total(PCNT_UNIT_R);
+  g_pcnt_lastL = hal_pcnt_total(PCNT_UNIT_L);
+  g_capture_offsetR = static_cast<int32_t>(g_pcnt_lastR) - hal_edge_capture_read(PCNT_UNIT_R).edges;
+  g_capture_offsetL = static_cast<int32_t>(g_pcnt_lastL) - hal_edge_capture_read(PCNT_UNIT_L).edges;
+  g_capture_diff = 0;
+  g_count_clamped = 0;
+}
+
+EncoderStats encoder_stats() {
+  HalPcntStats r = hal_pcnt_stats(PCNT_UNIT_R);
+  HalPcntStats l = hal_pcnt_stats(PCNT_UNIT_L);
+  EncoderStats out;
+  out.limit_events = r.limit_events + l.limit_events;
+  out.late_events = r.late_events + l.late_events;
+  hal_critical_enter();
+  out.capture_diff = g_capture_diff;
+  out.clamped_samples = g_count_clamped;
+  out.totalR = g_pcnt_lastR;
+  out.totalL = g_pcnt_lastL;
+  hal_critical_exit();
+  return out;
+}
+
+static int16_t clamp_count(int32_t count) {
+  if (count > INT16_MAX || count < INT16_MIN) {
+    g_count_clamped++;
+    return count > 0 ? INT16_MAX : INT16_MIN;
+  }
+  return static_cast<int16_t>(count);
 }
 
 void setupMotor() {
-  pinMode(MOTOR_RA_PIN, OUTPUT);
-  pinMode(MOTOR_RB_PIN, OUTPUT);
-  pinMode(MOTOR_LA_PIN, OUTPUT);
-  pinMode(MOTOR_LB_PIN, OUTPUT);
+  hal_gpio_mode(Robot::kMotorRA, HAL_PIN_OUTPUT);
+  hal_gpio_mode(Robot::kMotorRB, HAL_PIN_OUTPUT);
+  hal_gpio_mode(Robot::kMotorLA, HAL_PIN_OUTPUT);
+  hal_gpio_mode(Robot::kMotorLB, HAL_PIN_OUTPUT);
 
-  pinMode(EN_PIN_R, OUTPUT);
-  pinMode(EN_PIN_L, OUTPUT);
+  hal_gpio_mode(Robot::kEnableR, HAL_PIN_OUTPUT);
+  hal_gpio_mode(Robot::kEnableL, HAL_PIN_OUTPUT);
 
-  ledcSetup(0, 5000, 8);
-  ledcAttachPin(PWM_MOTOR_R, 0);
-  ledcSetup(1, 5000, 8);
-  ledcAttachPin(PWM_MOTOR_L, 1);
+  hal_pwm_setup(PWM_CHANNEL_R, Robot::kPwmR, 5000, 8);
+  hal_pwm_setup(PWM_CHANNEL_L, Robot::kPwmL, 5000, 8);
 
   setupPCNT();
 
   //Libera os motores
-  digitalWrite(EN_PIN_R, HIGH);
-  digitalWrite(EN_PIN_L, HIGH);
+  hal_gpio_write(Robot::kEnableR, true);
+  hal_gpio_write(Robot::kEnableL, true);
 
-  Serial.println("Begin motor control");
+  LOG_I(MOTOR, "Begin motor control (%s)", Robot::kName);
+}
+
+void control_read_inputs(ControlInputs& in) {
+  in.t_us = hal_micros();
+  in.t_ms = hal_millis();
+  in.totalR = hal_pcnt_total(PCNT_UNIT_R);
+  in.totalL = hal_pcnt_total(PCNT_UNIT_L);
+  in.capture_ok = g_edge_capture_ok;
+  if (in.capture_ok) {
+    in.capR = hal_edge_capture_read(PCNT_UNIT_R);
+    in.capL = hal_edge_capture_read(PCNT_UNIT_L);
+  } else {
+    in.capR = HalEdgeCapture();
+    in.capL = HalEdgeCapture();
+  }
 }
 
 void encoder() {
-  // --- Janela não-bloqueante e proteção da 1ª amostra ---
-  static bool prim = true;                     // primeira chamada?
-  static unsigned long last_print = 0;         // para limitar prints (opcional)
-  const  unsigned long janela_ms   = 50;       // período de cálculo (~20 Hz)
-  const  unsigned long print_ms    = 200;      // período de impressão (~5 Hz)
+  ControlInputs in;
+  control_read_inputs(in);
+  session_record_inputs(in);
+  encoder_step(in);
+}
 
-  unsigned long now = millis();
+void encoder_step(const ControlInputs& in) {
+  // --- Proteção da 1ª amostra ---
+  // A cadência vem da tarefa de controle (timer de hardware); aqui só se mede
+  // o dt real entre chamadas.
+  const uint32_t now = in.t_us;
+  g_cycle_ms = in.t_ms;
 
-  if (prim) {                                  // evita dt gigante na primeira vez
+  if (!g_encoder_primed) {                     // evita dt gigante na primeira vez
     last_time = now;
-    prim = false;
+    g_encoder_primed = true;
+    g_pcnt_lastR = in.totalR;
+    g_pcnt_lastL = in.totalL;
     return;
   }
 
-  // Se ainda não passou a janela, não faz nada (não bloqueia o loop)
-  if ((now - last_time) < janela_ms) return;
-
-  unsigned long dt = now - last_time;          // dt real da janela
+  const uint32_t dt_us = now - last_time;      // dt real do ciclo
   last_time = now;
 
-  // --- Leitura e zeragem dos contadores ---
-  int16_t contagemR = 0, contagemL = 0;
-  pcnt_get_counter_value(PCNT_UNIT_0, &contagemR);
-  pcnt_get_counter_value(PCNT_UNIT_1, &contagemL);
-  pcnt_counter_clear(PCNT_UNIT_0);
-  pcnt_counter_clear(PCNT_UNIT_1);
+  // --- Diferença dos totais de 64 bits (contadores nunca são zerados) ---
+  const int64_t totalR = in.totalR;
+  const int64_t totalL = in.totalL;
+  int32_t contagemR = static_cast<int32_t>(totalR - g_pcnt_lastR);
+  int32_t contagemL = static_cast<int32_t>(totalL - g_pcnt_lastL);
+  g_pcnt_lastR = totalR;
+  g_pcnt_lastL = totalL;
 
   // --- Cálculo de velocidades (rad/s) ---
-  float voltasR = contagemR / (float)PULSOS_POR_VOLTA;
-  float voltasL = contagemL / (float)PULSOS_POR_VOLTA;
-  float velR_motor = (dt > 0) ? (voltasR / (dt / 1000.0f)) * (2.0f * PI) : 0.0f;
-  float velL_motor = (dt > 0) ? (voltasL / (dt / 1000.0f)) * (2.0f * PI) : 0.0f;
+  // A pose usa o deslocamento contado (exato na janela); a velocidade do
+  // regulador e da telemetria vem do estimador escolhido.
+  // Conversões já dobradas em constantes (robot_config.h): só multiplicações
+  float dt_s = dt_us * 1e-6f;          // janela em segundos
+  float bordasR = count_velocity(contagemR, dt_us);
+  float bordasL = count_velocity(contagemL, dt_us);
+  int32_t capture_diff = 0;
+  if (in.capture_ok) {
+    // Atualizado mesmo no modo contagem: a troca de modo não precisa reiniciar
+    const HalEdgeCapture& capR = in.capR;
+    const HalEdgeCapture& capL = in.capL;
+    const float mtR = mt_velocity_update(g_mtR, capR, now);
+    const float mtL = mt_velocity_update(g_mtL, capL, now);
+    // Contagem perdida/ruído: PCNT e captura divergem (±1 é borda em trânsito)
+    const int32_t diffR = static_cast<int32_t>(totalR) - capR.edges - g_capture_offsetR;
+    const int32_t diffL = static_cast<int32_t>(totalL) - capL.edges - g_capture_offsetL;
+    capture_diff = abs(diffR) > abs(diffL) ? diffR : diffL;
+    if (g_velocity_mode == VELOCITY_MT) {
+      bordasR = mtR;
+      bordasL = mtL;
+    }
+  }
+  float velR_motor = bordasR * Robot::kMotorRadPerEdge;
+  float velL_motor = bordasL * Robot::kMotorRadPerEdge;
 
-  // Corrige para a velocidade na roda (redução 1:147,4)
-  const float gearReduction = 147.4f;
-  float velR = velR_motor / gearReduction;
-  float velL = velL_motor / gearReduction;
+  // Corrige para a velocidade na roda (redução do motor)
+  float velR = velR_motor * Robot::kWheelPerMotor;
+  float velL = velL_motor * Robot::kWheelPerMotor;
 
   // --- Cinemática diferencial ---
-  const float wheelRadius = 0.125f;   // metros
-  const float wheelBase = 0.62f;       // distância entre rodas (m)
+  float v_r = velR_motor * Robot::kWheelMpsPerMotorRadS;   // m/s
+  float v_l = velL_motor * Robot::kWheelMpsPerMotorRadS;   // m/s
+  float V = 0.5f * (v_r + v_l);                  // velocidade linear (m/s)
+  float w = (v_r - v_l) * Robot::kInvWheelBaseM; // velocidade angular (rad/s)
+
+  hal_critical_enter();
+  const PoseIntegratorConfig pose_config = g_pose_config;
+  hal_critical_exit();
+  // Mesmo seno/cosseno do integrador: nada da libm em double no ciclo
+  float sin_phi;
+  float cos_phi;
+  pose_sincos(pose_config, g_pose.phi, sin_phi, cos_phi);
+  float x_dot = V * cos_phi;
+  float y_dot = V * sin_phi;
+  float phi_dot = w;
 
-  float v_r = velR * wheelRadius;      // m/s
-  float v_l = velL * wheelRadius;      // m/s
-  float V = 0.5f * (v_r + v_l);        // velocidade linear (m/s)
-  float w = (v_r - v_l) / wheelBase;   // velocidade angular (rad/s)
+  // Deslocamento da janela direto das contagens
+  const float d_r = contagemR * Robot::kWheelMetersPerEdge;
+  const float d_l = contagemL * Robot::kWheelMetersPerEdge;
+  pose_integrate(g_pose, pose_config, 0.5f * (d_r + d_l), (d_r - d_l) * Robot::kInvWheelBaseM);
+  command_trace_sample(velR_motor, velL_motor, now);
 
-  float dt_s = dt / 1000.0f;           // janela em segundos
-  float x_dot = V * cos(posePhi);
-  float y_dot = V * sin(posePhi);
-  float phi_dot = w;
+  profileStep(dt_s);
+  regulateSpeed(velR_motor, velL_motor, dt_s);
 
-  poseX += x_dot * dt_s;
-  poseY += y_dot * dt_s;
-  posePhi += phi_dot * dt_s;
-  if (posePhi > PI || posePhi < -PI) {
-    posePhi = fmod(posePhi + PI, 2.0f * PI) - PI;
-  }
+  motorGo(MOTOR_R, lastDirectionR, currentPwmR);
+  motorGo(MOTOR_L, lastDirectionL, currentPwmL);
+  command_trace_output(hal_micros());
+
+  // --- Amostra para a tarefa de rede (publicação/impressão fora do laço) ---
+  hal_critical_enter();
+  g_sample.seq++;
+  g_sample.t_ms = in.t_ms;
+  g_sample.dt_ms = dt_us / 1000;
+  g_sample.x = g_pose.x;
+  g_sample.y = g_pose.y;
+  g_sample.phi = g_pose.phi;
+  g_sample.contagemR = clamp_count(contagemR);
+  g_sample.contagemL = clamp_count(contagemL);
+  g_capture_diff = capture_diff;
+  g_sample.velR_motor = velR_motor;
+  g_sample.velL_motor = velL_motor;
+  g_sample.velR = velR;
+  g_sample.velL = velL;
+  g_sample.x_dot = x_dot;
+  g_sample.y_dot = y_dot;
+  g_sample.phi_dot = phi_dot;
+  hal_critical_exit();
+
+  // Só esta tarefa escreve g_sample: ler fora da seção crítica é seguro
+  g_sample_ring.push(g_sample);
+}
 
-  float targetMagR = fabs(targetVelR);
-  float targetMagL = fabs(targetVelL);
+ControlOutputs control_outputs() {
+  ControlOutputs out;
+  out.dirR = lastDirectionR;
+  out.dirL = lastDirectionL;
+  out.pwmR = currentPwmR;
+  out.pwmL = currentPwmL;
+  out.x = g_pose.x;
+  out.y = g_pose.y;
+  out.phi = g_pose.phi;
+  return out;
+}
 
-  currentPwmR = adjustPwm(currentPwmR, fabs(velR_motor), targetMagR);
-  currentPwmL = adjustPwm(currentPwmL, fabs(velL_motor), targetMagL);
+void control_state_save(ControlState& out) {
+  out.primed = g_encoder_primed;
+  out.last_us = last_time;
+  out.cycle_ms = g_cycle_ms;
+  out.pcnt_lastR = g_pcnt_lastR;
+  out.pcnt_lastL = g_pcnt_lastL;
+  out.status = static_cast<uint8_t>(usMotor_Status);
+  out.dirR = lastDirectionR;
+  out.dirL = lastDirectionL;
+  out.pwmR = currentPwmR;
+  out.pwmL = currentPwmL;
+  out.targetR = targetVelR;
+  out.targetL = targetVelL;
+  out.pose = g_pose;
+  out.profile_goal = g_profile_goal;
+  out.profile_v = g_profile_v;
+  out.profile_w = g_profile_w;
+  out.pidR = g_pidR;
+  out.pidL = g_pidL;
+  out.mtR = g_mtR;
+  out.mtL = g_mtL;
+  out.last_applied = g_last_applied_command;
+  out.remote = g_remote_current;
+  out.remote_received = g_remote_received;
+}
 
-  synchronizeWheels(g_last_applied_command, velR_motor, velL_motor);
+void control_state_load(const ControlState& in) {
+  g_encoder_primed = in.primed;
+  last_time = in.last_us;
+  g_cycle_ms = in.cycle_ms;
+  g_pcnt_lastR = in.pcnt_lastR;
+  g_pcnt_lastL = in.pcnt_lastL;
+  usMotor_Status = in.status;
+  lastDirectionR = in.dirR;
+  lastDirectionL = in.dirL;
+  currentPwmR = in.pwmR;
+  currentPwmL = in.pwmL;
+  targetVelR = in.targetR;
+  targetVelL = in.targetL;
+  g_pose = in.pose;
+  g_profile_goal = in.profile_goal;
+  g_profile_v = in.profile_v;
+  g_profile_w = in.profile_w;
+  g_pidR = in.pidR;
+  g_pidL = in.pidL;
+  g_mtR = in.mtR;
+  g_mtL = in.mtL;
+  g_last_applied_command = in.last_applied;
+  g_remote_current = in.remote;
+  g_remote_received = in.remote_received;
+}
 
-  motorGo(MOTOR_R, lastDirectionR, currentPwmR);
-  motorGo(MOTOR_L, lastDirectionL, currentPwmL);
+bool odometry_latest_sample(OdometrySample& out) {
+  hal_critical_enter();
+  out = g_sample;
+  hal_critical_exit();
+  return out.seq != 0;
+}
+
+void odometry_publish_pending() {
+  static unsigned long last_print = 0;         // para limitar prints (opcional)
+  const  unsigned long print_ms    = 200;      // período de impressão (~5 Hz)
+
+  OdometrySample sample;
+  bool received = false;
+  while (g_sample_ring.pop(sample)) {
+    net_telemetry_add_sample(sample, kPublishDebugOdometry);
+    received = true;
+  }
+  // Publica conforme formato/taxa, independente de quantas amostras chegaram
+  net_telemetry_poll();
+  if (!received) {
+    return;
+  }
 
   // --- Impressão desacoplada (opcional) ---
+  unsigned long now = hal_millis();
   if ((now - last_print) >= print_ms) {
     last_print = now;
-    Serial.print("VelR_motor: ");
-    Serial.println(velR_motor);
-    Serial.print("VelL_motor: ");
-    Serial.println(velL_motor);
-    Serial.print("VelR_wheel: ");
-    Serial.println(velR);
-    Serial.print("VelL_wheel: ");
-    Serial.println(velL);
-    Serial.print("x_dot: ");
-    Serial.println(x_dot);
-    Serial.print("y_dot: ");
-    Serial.println(y_dot);
-    Serial.print("phi_dot: ");
-    Serial.println(phi_dot);
-    Serial.print("poseX: ");
-    Serial.println(poseX);
-    Serial.print("poseY: ");
-    Serial.println(poseY);
-    Serial.print("posePhi: ");
-    Serial.println(posePhi);
-  }
-
-  // Publica odometria via MQTT (não bloqueia se desconectado)
-  net_publish_odometry(poseX, poseY, posePhi);
-
-  if (kPublishDebugOdometry) {
-    net_publish_odometry_debug(contagemR, contagemL, velR, velL, dt);
+    LOG_I(ODOM, "VelR_motor: %.2f VelL_motor: %.2f VelR_wheel: %.2f VelL_wheel: %.2f",
+          sample.velR_motor, sample.velL_motor, sample.velR, sample.velL);
+    LOG_I(ODOM, "x_dot: %.2f y_dot: %.2f phi_dot: %.2f", sample.x_dot, sample.y_dot,
+          sample.phi_dot);
+    LOG_I(ODOM, "poseX: %.2f poseY: %.2f posePhi: %.2f", sample.x, sample.y, sample.phi);
   }
 }
 
+uint32_t odometry_samples_dropped() {
+  return g_sample_ring.dropped();
+}
+
 void Stop() {
+  if (setProfileGoal(0.0f, 0.0f, MOTION_STOP)) {
+    return;
+  }
   usMotor_Status = BRAKE;
   targetVelR = 0.0f;
   targetVelL = 0.0f;
@@ -250,12 +665,16 @@ void Stop() {
 
 void Forward(uint8_t usSpeedR, uint8_t usSpeedL) {
   if (!block_foward) {
+    if (setProfileGoal(pwmToTargetVelocity(usSpeedR), pwmToTargetVelocity(usSpeedL),
+                       MOTION_FORWARD)) {
+      return;
+    }
     usMotor_Status = CW;
     lastDirectionR = CW;
     lastDirectionL = CW;
-    currentPwmR = usSpeedR;
-    currentPwmL = usSpeedL;
     setTargetVelocities(usSpeedR, usSpeedL, false);
+    currentPwmR = startPwm(usSpeedR, targetVelR);
+    currentPwmL = startPwm(usSpeedL, targetVelL);
     motorGo(MOTOR_R, lastDirectionR, currentPwmR);
     motorGo(MOTOR_L, lastDirectionL, currentPwmL);
     g_last_applied_command = MOTION_FORWARD;
@@ -264,12 +683,16 @@ void Forward(uint8_t usSpeedR, uint8_t usSpeedL) {
 
 void Reverse(uint8_t usSpeedR, uint8_t usSpeedL) {
   if (!block_reverse) {
+    if (setProfileGoal(-pwmToTargetVelocity(usSpeedR), -pwmToTargetVelocity(usSpeedL),
+                       MOTION_REVERSE)) {
+      return;
+    }
     usMotor_Status = CCW;
     lastDirectionR = CCW;
     lastDirectionL = CCW;
-    currentPwmR = usSpeedR;
-    currentPwmL = usSpeedL;
     setTargetVelocities(usSpeedR, usSpeedL, false);
+    currentPwmR = startPwm(usSpeedR, targetVelR);
+    currentPwmL = startPwm(usSpeedL, targetVelL);
     motorGo(MOTOR_R, lastDirectionR, currentPwmR);
     motorGo(MOTOR_L, lastDirectionL, currentPwmL);
     g_last_applied_command = MOTION_REVERSE;
@@ -277,22 +700,30 @@ void Reverse(uint8_t usSpeedR, uint8_t usSpeedL) {
 }
 
 void TurnLeft(uint8_t usSpeedR, uint8_t usSpeedL) {
+  if (setProfileGoal(-pwmToTargetVelocity(usSpeedR), pwmToTargetVelocity(usSpeedL),
+                     MOTION_TURN_LEFT)) {
+    return;
+  }
   lastDirectionR = CCW;
   lastDirectionL = CW;
-  currentPwmR = usSpeedR;
-  currentPwmL = usSpeedL;
   setTargetVelocities(usSpeedR, usSpeedL, true);
+  currentPwmR = startPwm(usSpeedR, targetVelR);
+  currentPwmL = startPwm(usSpeedL, targetVelL);
   motorGo(MOTOR_R, lastDirectionR, currentPwmR);  // Usa usSpeedR
   motorGo(MOTOR_L, lastDirectionL, currentPwmL); // Usa usSpeedL
   g_last_applied_command = MOTION_TURN_LEFT;
 }
 
 void TurnRight(uint8_t usSpeedR, uint8_t usSpeedL) {
+  if (setProfileGoal(pwmToTargetVelocity(usSpeedR), -pwmToTargetVelocity(usSpeedL),
+                     MOTION_TURN_RIGHT)) {
+    return;
+  }
   lastDirectionR = CW;
   lastDirectionL = CCW;
-  currentPwmR = usSpeedR;
-  currentPwmL = usSpeedL;
   setTargetVelocities(usSpeedR, usSpeedL, true);
+  currentPwmR = startPwm(usSpeedR, targetVelR);
+  currentPwmL = startPwm(usSpeedL, targetVelL);
   motorGo(MOTOR_R, lastDirectionR, currentPwmR); // Usa usSpeedR
   motorGo(MOTOR_L, lastDirectionL, currentPwmL);  // Usa usSpeedL
   g_last_applied_command = MOTION_TURN_RIGHT;
@@ -308,61 +739,132 @@ void Lock() {
   lastDirectionL = BRAKE;
   motorGo(MOTOR_R, usMotor_Status, 0);
   motorGo(MOTOR_L, usMotor_Status, 0);
-  digitalWrite(EN_PIN_R, LOW);
-  digitalWrite(EN_PIN_L, LOW);
-  Serial.println("Motors locked");
+  hal_gpio_write(Robot::kEnableR, false);
+  hal_gpio_write(Robot::kEnableL, false);
+  // Imediato mesmo com perfil: a referência também vai a zero
+  g_profile_goal.v_mps = 0.0f;
+  g_profile_goal.w_radps = 0.0f;
+  profile_axis_reset(g_profile_v, 0.0f);
+  profile_axis_reset(g_profile_w, 0.0f);
+  LOG_I(MOTOR, "Motors locked");
   g_last_applied_command = MOTION_STOP;
 }
 
+void motor_safety_release(bool discard_remote) {
+  // As pontes foram mexidas pelo ISR por fora: tudo volta a parado, imediato
+  // mesmo com perfil, e EN é religado
+  usMotor_Status = BRAKE;
+  targetVelR = 0.0f;
+  targetVelL = 0.0f;
+  currentPwmR = 0;
+  currentPwmL = 0;
+  lastDirectionR = BRAKE;
+  lastDirectionL = BRAKE;
+  speed_pid_reset(g_pidR);
+  speed_pid_reset(g_pidL);
+  g_profile_goal.v_mps = 0.0f;
+  g_profile_goal.w_radps = 0.0f;
+  profile_axis_reset(g_profile_v, 0.0f);
+  profile_axis_reset(g_profile_w, 0.0f);
+  motorGo(MOTOR_R, BRAKE, 0);
+  motorGo(MOTOR_L, BRAKE, 0);
+  hal_gpio_write(Robot::kEnableR, true);
+  hal_gpio_write(Robot::kEnableL, true);
+  g_last_applied_command = MOTION_STOP;
+  if (!discard_remote) {
+    return;
+  }
+  // O comando corrente e os que chegaram durante a trava não voltam a mover
+  g_remote_received = false;
+  g_remote_hold = true;
+  g_remote_hold_ms = hal_millis();
+}
+
 void motorGo(uint8_t motor, uint8_t direct, uint8_t pwm) {
   if (motor == MOTOR_R) {
     if (direct == CW) {
-      digitalWrite(MOTOR_RA_PIN, LOW);
-      digitalWrite(MOTOR_RB_PIN, HIGH);
+      hal_gpio_write(Robot::kMotorRA, false);
+      hal_gpio_write(Robot::kMotorRB, true);
     } else if (direct == CCW) {
-      digitalWrite(MOTOR_RA_PIN, HIGH);
-      digitalWrite(MOTOR_RB_PIN, LOW);
+      hal_gpio_write(Robot::kMotorRA, true);
+      hal_gpio_write(Robot::kMotorRB, false);
     } else {
-      digitalWrite(MOTOR_RA_PIN, LOW);
-      digitalWrite(MOTOR_RB_PIN, LOW);
+      hal_gpio_write(Robot::kMotorRA, false);
+      hal_gpio_write(Robot::kMotorRB, false);
     }
-    ledcWrite(0, pwm);
+    hal_pwm_write(PWM_CHANNEL_R, pwm);
    }
   if (motor == MOTOR_L) {
     if (direct == CW) {
-      digitalWrite(MOTOR_LA_PIN, LOW);
-      digitalWrite(MOTOR_LB_PIN, HIGH);
+      hal_gpio_write(Robot::kMotorLA, false);
+      hal_gpio_write(Robot::kMotorLB, true);
     } else if (direct == CCW) {
-      digitalWrite(MOTOR_LA_PIN, HIGH);
-      digitalWrite(MOTOR_LB_PIN, LOW);
+      hal_gpio_write(Robot::kMotorLA, true);
+      hal_gpio_write(Robot::kMotorLB, false);
     } else {
-      digitalWrite(MOTOR_LA_PIN, LOW);
-      digitalWrite(MOTOR_LB_PIN, LOW);
+      hal_gpio_write(Robot::kMotorLA, false);
+      hal_gpio_write(Robot::kMotorLB, false);
     }
-    ledcWrite(1, pwm);
+    hal_pwm_write(PWM_CHANNEL_L, pwm);
   }
 }
 
-void set_remote_motion_command(MotionCommand command) {
-  g_remote_command = command;
-  g_remote_command_last_update = millis();
+bool set_remote_motion_command(MotionCommand command, CommandStamp stamp) {
+  // Produtor: tarefa de rede (core 0). Só alimenta a vigia da rede com o
+  // comando que de fato entrou na fila
+  if (!g_remote_queue.push(command, hal_millis(), Twist(), stamp)) {
+    return false;
+  }
+  safety_stop_feed_remote(command != MOTION_STOP);
+  return true;
+}
+
+bool set_remote_twist(Twist twist, CommandStamp stamp) {
+  if (!g_remote_queue.push(MOTION_TWIST, hal_millis(), twist, stamp)) {
+    return false;
+  }
+  safety_stop_feed_remote(twist.v_mps != 0.0f || twist.w_radps != 0.0f);
+  return true;
+}
+
+bool set_remote_command_record(const CommandRecord& record) {
+  if (!g_remote_queue.push(record.command, record.t_ms, record.twist, record.stamp)) {
+    return false;
+  }
+  safety_stop_feed_remote(record.command != MOTION_STOP);
+  return true;
 }
 
 MotionCommand get_remote_motion_command() {
-  unsigned long now = millis();
+  // Consumidor: tarefa de controle (core 1)
+  g_remote_in_use = true;
+  CommandRecord record;
+  if (g_remote_queue.pop(record) &&
+      !(g_remote_hold && static_cast<int32_t>(record.t_ms - g_remote_hold_ms) < 0)) {
+    g_remote_hold = false;
+    g_remote_current = record;
+    g_remote_received = true;
+    command_trace_dequeued(record.stamp, hal_micros());
+    session_record_command(record);
+  }
 
-  if (g_remote_command_last_update == 0) {
+  if (!g_remote_received) {
     return MOTION_STOP;
   }
 
-  if ((now - g_remote_command_last_update) > REMOTE_COMMAND_TIMEOUT_MS) {
-    if (g_remote_command != MOTION_STOP) {
-      g_remote_command = MOTION_STOP;
-    }
-    return MOTION_STOP;
+  // "Agora" é o início do ciclo; um comando enfileirado depois dele fica
+  // com idade negativa
+  const int32_t age_ms = static_cast<int32_t>(g_cycle_ms - g_remote_current.t_ms);
+  const uint32_t remote_ms = safety_stop_config().remote_ms;
+  const uint32_t timeout_ms = remote_ms ? remote_ms : REMOTE_COMMAND_TIMEOUT_MS;
+  if (age_ms > static_cast<int32_t>(timeout_ms)) {
+    g_remote_current.command = MOTION_STOP;
   }
+  return g_remote_current.command;
+}
 
-  return g_remote_command;
+CommandQueueStats remote_command_stats() {
+  return g_remote_queue.stats();
 }
 
 static void apply_motion_now(MotionCommand command) {
@@ -382,14 +884,88 @@ static void apply_motion_now(MotionCommand command) {
     case MOTION_TURN_RIGHT:
       TurnRight(DEFAULT_PWM_TURN, DEFAULT_PWM_TURN);
       break;
+    case MOTION_TWIST:
+      apply_twist(g_remote_current.twist);
+      break;
+  }
+}
+
+Twist motion_command_twist(MotionCommand command) {
+  // Velocidades de cada roda com os PWM padrão (mesmos sentidos de
+  // Forward/Reverse/TurnLeft/TurnRight)
+  float right = 0.0f;
+  float left = 0.0f;
+  switch (command) {
+    case MOTION_FORWARD:
+      right = left = motorToWheel(pwmToTargetVelocity(DEFAULT_PWM_FORWARD));
+      break;
+    case MOTION_REVERSE:
+      right = left = -motorToWheel(pwmToTargetVelocity(DEFAULT_PWM_REVERSE));
+      break;
+    case MOTION_TURN_LEFT:
+      right = -motorToWheel(pwmToTargetVelocity(DEFAULT_PWM_TURN));
+      left = -right;
+      break;
+    case MOTION_TURN_RIGHT:
+      right = motorToWheel(pwmToTargetVelocity(DEFAULT_PWM_TURN));
+      left = -right;
+      break;
+    default:
+      break;
+  }
+  Twist twist = {0.5f * (right + left), (right - left) * Robot::kInvWheelBaseM};
+  return twist;
+}
+
+void apply_twist(Twist twist) {
+  float v = twist.v_mps;
+  if ((v > 0.0f && block_foward) || (v < 0.0f && block_reverse)) {
+    v = 0.0f;
+  }
+  float right = wheelToMotor(v + twist.w_radps * Robot::kHalfWheelBaseM);
+  float left = wheelToMotor(v - twist.w_radps * Robot::kHalfWheelBaseM);
+  if (!(right == right) || !(left == left)) {  // NaN
+    right = left = 0.0f;
+  }
+  limitWheelTargets(right, left);
+  if (setProfileGoal(right, left, MOTION_TWIST)) {
+    return;
+  }
+
+  setWheelTarget(right, targetVelR, lastDirectionR, currentPwmR, g_pidR);
+  setWheelTarget(left, targetVelL, lastDirectionL, currentPwmL, g_pidL);
+  usMotor_Status = (lastDirectionR == BRAKE && lastDirectionL == BRAKE) ? BRAKE : CW;
+  motorGo(MOTOR_R, lastDirectionR, currentPwmR);
+  motorGo(MOTOR_L, lastDirectionL, currentPwmL);
+  g_last_applied_command = MOTION_TWIST;
+}
+
+// Chamada só pela tarefa de controle. O rastreio só abre quando um
+// registro remoto com carimbo sai da fila (command_trace_dequeued); os
+// botões, lidos em selecionaComando, não passam pela fila nem têm carimbo
+// de recepção, então aqui só fecham um rastreio remoto já aberto.
+static void traceDirectOutput() {
+  // Com perfil ativo o comando só mexe na meta; a ponte H é escrita no
+  // próximo encoder()
+  if (profileMode() == PROFILE_STEP) {
+    command_trace_output(hal_micros());
   }
 }
 
 void apply_motion_command(MotionCommand command) {
+  // Prazo da rede no ISR só enquanto o remoto manda nas rodas
+  safety_stop_watch_remote(g_remote_in_use);
+  g_remote_in_use = false;
+  if (command == MOTION_TWIST) {
+    apply_twist(g_remote_current.twist);
+    traceDirectOutput();
+    return;
+  }
   if (command == g_last_applied_command) {
     return;
   }
 
   apply_motion_now(command);
   g_last_applied_command = command;
+  traceDirectOutput();
 }
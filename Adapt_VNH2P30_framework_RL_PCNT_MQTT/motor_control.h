@@ -2,62 +2,189 @@
 #define MOTOR_CONTROL_H
 
 #include <Arduino.h>
-#include "driver/pcnt.h"
+#include "hal.h"
+#include "command_queue.h"
+#include "speed_controller.h"
+#include "velocity_estimator.h"
+#include "pose_integrator.h"
+#include "motion_profile.h"
+#include "robot_config.h"
 
 #define BRAKE 0
 #define CW    1
 #define CCW   2
 
-// MOTOR R (RIGHT)
-#define MOTOR_RA_PIN 4
-#define MOTOR_RB_PIN 27
-
-// MOTOR L (LEFT)
-#define MOTOR_LA_PIN 32
-#define MOTOR_LB_PIN 33
-
-#define PWM_MOTOR_R 25
-#define PWM_MOTOR_L 26
-
-#define EN_PIN_R 19
-#define EN_PIN_L 18
-
 #define MOTOR_R 0
 #define MOTOR_L 1
 
-#define ENCODER_RA 14  // Pino do canal A do encoder do Motor R
-#define ENCODER_RB 12  // Pino do canal B do encoder do Motor R
+// Pinos, encoder e geometria vêm da variante compilada (robot_config.h, Robot::)
+
+// Unidades PCNT e canais LEDC usados por cada motor
+#define PCNT_UNIT_R 0
+#define PCNT_UNIT_L 1
+
+#define PWM_CHANNEL_R 0
+#define PWM_CHANNEL_L 1
+
+// Amostras guardadas entre o controle e a tarefa de rede (potência de 2).
+// Só precisa cobrir uma pausa da tarefa de rede, não o período de publicação.
+#define ODOMETRY_RING_SIZE 64
+
+// Regulador de velocidade das rodas na partida (ver speed_controller.h)
+#define DEFAULT_SPEED_CONTROLLER SPEED_CTRL_PID
+
+// Estimador de velocidade das rodas (ver velocity_estimator.h). Sem a
+// captura de bordas, cai para a contagem do PCNT.
+#define DEFAULT_VELOCITY_ESTIMATOR VELOCITY_MT
+
+// Política da fila de comandos remotos (ver command_queue.h)
+#define REMOTE_COMMAND_POLICY CMDQ_LATEST_WINS
+
+// Amostra do laço de controle entregue à tarefa de rede para publicação
+struct OdometrySample {
+  uint32_t seq;          // incrementa a cada ciclo de encoder()
+  uint32_t t_ms;
+  uint32_t dt_ms;
+  float x;
+  float y;
+  float phi;
+  int16_t contagemR;
+  int16_t contagemL;
+  float velR_motor;      // rad/s no eixo do motor
+  float velL_motor;
+  float velR;            // rad/s na roda
+  float velL;
+  float x_dot;
+  float y_dot;
+  float phi_dot;
+};
+
+// Diagnóstico dos encoders (qualquer tarefa)
+struct EncoderStats {
+  uint32_t limit_events;     // voltas do contador de 16 bits (as duas rodas)
+  uint32_t late_events;      // leituras que corrigiram evento pendente
+  int32_t capture_diff;      // PCNT − captura de bordas, pior roda, último ciclo
+  uint32_t clamped_samples;  // contagem da amostra saturada em int16
+  int64_t totalR;            // totais de 64 bits na última leitura
+  int64_t totalL;
+};
 
-#define ENCODER_LA 16  // Pino do canal A do encoder do Motor L
-#define ENCODER_LB 17  // Pino do canal B do encoder do Motor L
+// Entradas de um ciclo do laço de controle, lidas do hardware de uma vez no
+// início de encoder(): o ciclo inteiro usa só este relógio e estas leituras
+// (gravação e reprodução de sessão, session_record.h)
+struct ControlInputs {
+  uint32_t t_us;          // hal_micros()
+  uint32_t t_ms;          // hal_millis(); também o "agora" do timeout remoto
+  int64_t totalR;         // totais de 64 bits do PCNT
+  int64_t totalL;
+  bool capture_ok;        // captura de bordas disponível (capR/capL válidos)
+  HalEdgeCapture capR;
+  HalEdgeCapture capL;
+};
 
-#define PULSOS_POR_VOLTA 11
+// Sentido/PWM escritos por último na ponte H e pose integrada
+struct ControlOutputs {
+  uint8_t dirR;
+  uint8_t dirL;
+  uint8_t pwmR;
+  uint8_t pwmL;
+  float x;
+  float y;
+  float phi;
+};
 
-enum MotionCommand {
-  MOTION_STOP = 0,
-  MOTION_FORWARD,
-  MOTION_REVERSE,
-  MOTION_TURN_LEFT,
-  MOTION_TURN_RIGHT,
+// Estado do laço de controle entre dois ciclos. Com ele, a configuração
+// (setters abaixo) e as entradas seguintes, os ciclos se repetem bit a bit.
+struct ControlState {
+  bool primed;            // encoder() já passou pela primeira amostra
+  uint32_t last_us;       // t_us do ciclo anterior
+  uint32_t cycle_ms;      // t_ms do ciclo anterior
+  int64_t pcnt_lastR;
+  int64_t pcnt_lastL;
+  uint8_t status;
+  uint8_t dirR;
+  uint8_t dirL;
+  uint8_t pwmR;
+  uint8_t pwmL;
+  float targetR;          // rad/s no motor
+  float targetL;
+  PoseState pose;
+  Twist profile_goal;
+  ProfileAxisState profile_v;
+  ProfileAxisState profile_w;
+  SpeedPidState pidR;
+  SpeedPidState pidL;
+  MtVelocityEstimator mtR;
+  MtVelocityEstimator mtL;
+  MotionCommand last_applied;
+  CommandRecord remote;   // comando remoto corrente (command, twist, t_ms)
+  bool remote_received;
 };
 
 void setupPCNT();
+EncoderStats encoder_stats();
 
 void setupMotor();
-void encoder();
+void encoder();                                   // um ciclo do laço de controle
+// encoder() em duas partes: leitura do hardware e o ciclo sobre as leituras
+void control_read_inputs(ControlInputs& in);
+void encoder_step(const ControlInputs& in);
+// Só a tarefa de controle (ou com ela parada, na reprodução)
+ControlOutputs control_outputs();
+void control_state_save(ControlState& out);
+void control_state_load(const ControlState& in);
+bool odometry_latest_sample(OdometrySample& out); // cópia consistente (qualquer tarefa)
+void odometry_publish_pending();                  // contexto de rede: publica/imprime
+uint32_t odometry_samples_dropped();              // anel cheio (rede atrasada)
 void Stop();
 void Forward(uint8_t usSpeedR, uint8_t usSpeedL);
 void Reverse(uint8_t usSpeedR, uint8_t usSpeedL);
 void TurnLeft(uint8_t usSpeedR, uint8_t usSpeedL);
 void TurnRight(uint8_t usSpeedR, uint8_t usSpeedL);
 void Lock();
-
-void set_remote_motion_command(MotionCommand command);
-MotionCommand get_remote_motion_command();
+// Tarefa de controle, depois de uma parada de segurança (safety_stop.h):
+// para na hora e religa EN; discard_remote (tarefa de controle sumida)
+// descarta também o comando remoto corrente e os enfileirados até agora.
+// Depois de um disparo só da rede, o comando corrente já é o que a encerrou
+void motor_safety_release(bool discard_remote = true);
+
+// Tarefa de rede; stamp.id != 0 liga o rastreio de latência (command_trace.h).
+// false se o comando não entrou na fila (só com REMOTE_COMMAND_POLICY FIFO)
+bool set_remote_motion_command(MotionCommand command, CommandStamp stamp = CommandStamp());
+bool set_remote_twist(Twist twist, CommandStamp stamp = CommandStamp());
+// Reprodução de sessão: reenfileira um registro gravado com o t_ms original
+bool set_remote_command_record(const CommandRecord& record);
+MotionCommand get_remote_motion_command();              // tarefa de controle
+CommandQueueStats remote_command_stats();
+// MOTION_TWIST aplica o twist remoto mais recente a cada chamada; os
+// comandos discretos só agem quando mudam.
 void apply_motion_command(MotionCommand command);
 
+// Referência contínua: cada roda recebe sua velocidade (saturadas juntas,
+// mantendo a curvatura) e o regulador segue sem parar; PWM e PID de uma roda
+// só recomeçam quando ela troca de sentido.
+void apply_twist(Twist twist);
+// Twist equivalente a cada comando discreto (MOTION_TWIST devolve zero)
+Twist motion_command_twist(MotionCommand command);
+
 void motorGo(uint8_t motor, uint8_t direct, uint8_t pwm);
 
+// Regulador e ganhos podem ser trocados a qualquer momento, de qualquer tarefa
+void motor_set_speed_controller(SpeedControllerMode mode);
+SpeedControllerMode motor_speed_controller();
+void motor_set_speed_gains(const SpeedPidGains& gains);
+SpeedPidGains motor_speed_gains();
+void motor_set_velocity_estimator(VelocityEstimatorMode mode);
+VelocityEstimatorMode motor_velocity_estimator();
+// Integrador da pose (ver pose_integrator.h; padrão: arco + Kahan)
+void motor_set_pose_integrator(const PoseIntegratorConfig& config);
+PoseIntegratorConfig motor_pose_integrator();
+// Perfil entre os comandos e o regulador (ver motion_profile.h; padrão:
+// curva S). Com perfil, Forward/Reverse/Turn*/Stop e apply_twist só trocam o
+// alvo e encoder() leva a referência até ele; Lock() continua imediato.
+void motor_set_motion_profile(const MotionProfileConfig& config);
+MotionProfileConfig motor_motion_profile();
+
 extern bool block_foward;
 extern bool block_reverse;
 
@@ -1,12 +1,19 @@
 #include "mqtt_client.h"
 
-#include <WiFi.h>
-#include <WiFiClientSecure.h>
-#include <PubSubClient.h>
 #include <math.h>
-#include <ctype.h>
-
+#include <string.h>
+
+#include "async_log.h"
+#include "command_gate.h"
+#include "command_parser.h"
+#include "command_trace.h"
+#include "control_task.h"
+#include "hal.h"
+#include "loop_profiler.h"
 #include "motor_control.h"
+#include "net_connection.h"
+#include "odometry_store.h"
+#include "topic_namespace.h"
 
 // =======================
 // Defaults (pode editar aqui)
@@ -23,8 +30,46 @@ static bool        DEF_INSECURE_TLS  = true;  // true = conexão sem validação
 // Tópico de subscribe
 static const char* DEF_SUB_TOPIC     = "facemesh/cmd";
 static const char* DEF_PUB_TOPIC     = "facemesh/pong";
+static const char* DEF_TRACE_TOPIC   = "facemesh/pong/trace";
+static const char* DEF_TWIST_TOPIC   = "robot/cmd_vel";
+static const RemoteCommandMode DEF_COMMAND_MODE = REMOTE_DISCRETE;
 static const char* DEF_ODOM_TOPIC    = "robot/odometry";
 static const char* DEF_ODOM_DEBUG    = "robot/odometry/debug";
+static const char* DEF_BACKFILL_TOPIC = "robot/odometry/backfill";
+static const char* DEF_TIMING_TOPIC  = "robot/control/timing";
+static const char* DEF_NET_TOPIC     = "robot/net/stats";
+static const char* DEF_PROFILE_TOPIC = "robot/loop/profile";
+static const char* DEF_SESSION_TOPIC = "robot/session";
+static const char* DEF_CMD_STATS_TOPIC = "robot/cmd/stats";
+// Comando com seq mais atrasado que isto (além do melhor atraso visto) é
+// recusado (command_gate.h); o próprio comando pode trazer outro limite
+static const uint32_t DEF_COMMAND_MAX_AGE_MS = 250;
+// Frota (topic_namespace.h): raiz "" = tópicos acima como estão; id nullptr =
+// MAC do robô
+static const char* DEF_FLEET_ROOT    = "";
+static const char* DEF_FLEET_GROUP   = "all";
+static const char* DEF_ROBOT_ID      = nullptr;
+// O rastreio completo sai depois do pong; passa um pouco do prazo de
+// movimento da tarefa de controle antes de sair só com o que tiver
+static const uint32_t TRACE_REPLY_TIMEOUT_MS = TRACE_MOTION_TIMEOUT_MS + 500;
+static const unsigned long NET_STATS_PERIOD_MS = 5000;
+static const TelemetryFormat DEF_ODOM_FORMAT       = TELEMETRY_JSON;
+static const TelemetryFormat DEF_ODOM_DEBUG_FORMAT = TELEMETRY_JSON;
+static const uint32_t DEF_TELEMETRY_PERIOD_MS      = 50;   // por amostra
+static const uint8_t  DEF_TELEMETRY_BATCH_SAMPLES  = 10;
+static const uint32_t DEF_TELEMETRY_BATCH_AGE_MS   = 500;
+// Reenvio do que ficou na flash: 20 amostras a cada 200 ms = 5x a taxa do
+// controle, então 1 min fora do ar é recuperado em ~15 s
+static const uint8_t  DEF_BACKFILL_SAMPLES         = 20;
+static const uint32_t DEF_BACKFILL_PERIOD_MS       = 200;
+// Fila de saída: uma passada da tarefa de rede publica até OUTBOUND_PASS_BYTES
+// e volta a ler comandos; um publish mais lento que OUTBOUND_SLOW_PUBLISH_US
+// (uns 10x o normal) é o socket cheio: contrapressão, que dura até
+// OUTBOUND_BACKPRESSURE_HOLD_MS sem outro publish lento
+static const bool     DEF_OUTBOUND_QUEUE            = true;
+static const size_t   OUTBOUND_PASS_BYTES           = 2048;
+static const uint32_t OUTBOUND_SLOW_PUBLISH_US      = 10000;
+static const uint32_t OUTBOUND_BACKPRESSURE_HOLD_MS = 1000;
 
 // Root CA (opcional). Exemplo:
 // static const char* DEF_ROOT_CA_PEM = R"EOF(
@@ -48,69 +93,118 @@ static bool        g_insecureTLS = DEF_INSECURE_TLS;
 
 static const char* g_sub_topic   = DEF_SUB_TOPIC;
 static const char* g_pub_topic   = DEF_PUB_TOPIC;
+static const char* g_trace_topic = DEF_TRACE_TOPIC;
+static const char* g_twist_topic = DEF_TWIST_TOPIC;
+static RemoteCommandMode g_command_mode = DEF_COMMAND_MODE;
 static const char* g_odom_topic  = DEF_ODOM_TOPIC;
 static const char* g_odom_debug  = DEF_ODOM_DEBUG;
+static TelemetryFormat g_odom_format       = DEF_ODOM_FORMAT;
+static TelemetryFormat g_odom_debug_format = DEF_ODOM_DEBUG_FORMAT;
+static uint32_t g_telemetry_period_ms  = DEF_TELEMETRY_PERIOD_MS;
+static uint8_t  g_batch_samples        = DEF_TELEMETRY_BATCH_SAMPLES;
+static uint32_t g_batch_age_ms         = DEF_TELEMETRY_BATCH_AGE_MS;
+static const char* g_backfill_topic    = DEF_BACKFILL_TOPIC;
+static uint8_t  g_backfill_samples     = DEF_BACKFILL_SAMPLES;
+static uint32_t g_backfill_period_ms   = DEF_BACKFILL_PERIOD_MS;
+
+// Estado do publicador de telemetria (só a tarefa de rede)
+static TelemetryBatch g_batch;
+static uint32_t g_batch_started_ms = 0;
+static OdometrySample g_latest_sample = {};
+static bool g_latest_pending = false;
+static bool g_latest_with_debug = false;
+static uint32_t g_last_telemetry_ms = 0;
+static uint32_t g_last_backfill_ms = 0;
+static uint32_t g_last_erase_ms = 0;
+static uint32_t g_last_motion_ms = 0;   // última amostra com a roda girando
+// Amostras entre a flash e um lote (reenvio ou lote recusado); estático para
+// não pesar ~4 KiB na pilha da tarefa de rede
+static OdometrySample g_store_samples[TELEMETRY_BATCH_MAX_SAMPLES];
+static TelemetryStats g_telemetry_stats = {};
+static const char* g_timing_topic = DEF_TIMING_TOPIC;
+static const char* g_net_topic   = DEF_NET_TOPIC;
+static const char* g_profile_topic = DEF_PROFILE_TOPIC;
+static const char* g_session_topic = DEF_SESSION_TOPIC;
+static const char* g_cmd_stats_topic = DEF_CMD_STATS_TOPIC;
+static CommandGate g_command_gate(DEF_COMMAND_MAX_AGE_MS);
+static CommandGate g_twist_gate(DEF_COMMAND_MAX_AGE_MS);   // tópico de twist direto
 static const char* g_root_ca_pem = DEF_ROOT_CA_PEM;
-
-// =======================
-// Objetos globais do módulo
-// =======================
-static WiFiClientSecure g_secure_client;
-static PubSubClient     g_mqtt_client(g_secure_client);
+static OutboundQueue g_outbound;   // 8 KiB, só a tarefa de rede
+static bool g_outbound_enabled = DEF_OUTBOUND_QUEUE;
+static uint32_t g_outbound_slow_ms = 0;   // último publish lento ou recusado
+
+// Frota: os setters de tópico guardam o modelo; os g_*_topic acima apontam
+// para o nome expandido com o id do robô, refeito a cada mudança
+static const char* g_fleet_root  = DEF_FLEET_ROOT;
+static const char* g_fleet_group = DEF_FLEET_GROUP;
+static const char* g_robot_id_cfg = DEF_ROBOT_ID;
+static char g_robot_id[ROBOT_ID_MAX] = "";
+static const char* g_group_sub_topic = "";     // comandos para a frota inteira
+static const char* g_group_twist_topic = "";
+struct TopicSlot {
+  const char** name;
+  const char* tmpl;
+  char buf[TOPIC_NAME_MAX];
+};
+static TopicSlot g_topic_slots[] = {
+  {&g_sub_topic, DEF_SUB_TOPIC, ""},
+  {&g_pub_topic, DEF_PUB_TOPIC, ""},
+  {&g_trace_topic, DEF_TRACE_TOPIC, ""},
+  {&g_twist_topic, DEF_TWIST_TOPIC, ""},
+  {&g_odom_topic, DEF_ODOM_TOPIC, ""},
+  {&g_odom_debug, DEF_ODOM_DEBUG, ""},
+  {&g_backfill_topic, DEF_BACKFILL_TOPIC, ""},
+  {&g_timing_topic, DEF_TIMING_TOPIC, ""},
+  {&g_net_topic, DEF_NET_TOPIC, ""},
+  {&g_profile_topic, DEF_PROFILE_TOPIC, ""},
+  {&g_session_topic, DEF_SESSION_TOPIC, ""},
+  {&g_cmd_stats_topic, DEF_CMD_STATS_TOPIC, ""},
+};
+static char g_group_sub_buf[TOPIC_NAME_MAX];
+static char g_group_twist_buf[TOPIC_NAME_MAX];
+
+// Comandos já respondidos à espera do rastreio (command_trace.h); só a
+// tarefa de rede mexe
+#define TRACE_PENDING_MAX 8
+#define PONG_TEXT_MAX 96
+struct PendingTrace {
+  uint32_t created_ms;
+  char head[PONG_TEXT_MAX];   // nonce|timestamp
+  char tail[PONG_TEXT_MAX];   // yaw|pitch|acao|status
+  CommandTrace trace;         // trace.id 0 = slot livre
+};
+static PendingTrace g_pending_traces[TRACE_PENDING_MAX] = {};
+static uint32_t g_next_trace_id = 0;
 
 // =======================
 // Prototypes internos
 // =======================
-static void setup_wifi();
 static void mqtt_callback(char* topic, uint8_t* payload, unsigned int length);
-static void mqtt_reconnect();
-static void handle_command_message(const String& payload);
-static bool parse_command_payload(const String& payload,
-                                  float& yawDeg,
-                                  float& pitchDeg,
-                                  String& nonce,
-                                  String& timestamp);
-static bool parse_angle_field(const String& src, float& value);
+static void handle_command_message(const uint8_t* payload, unsigned int length,
+                                   uint32_t received_us);
 static bool execute_motion_command(float yawDeg,
                                    float pitchDeg,
+                                   const CommandStamp& stamp,
                                    String& executedCommand);
-static void publish_pong(const String& nonce,
-                         const String& timestamp,
-                         unsigned long executed_at,
-                         float yawDeg,
-                         float pitchDeg,
-                         const String& executedCommand,
-                         bool success);
-static bool enable_insecure_tls(WiFiClientSecure& client);
-static void log_insecure_choice(bool used_set_insecure);
-
-namespace {
-template <typename Client>
-auto try_set_insecure(Client& client, int)
-    -> decltype(client.setInsecure(), bool()) {
-  client.setInsecure();
-  return true;
-}
-
-template <typename Client>
-bool try_set_insecure(Client& client, ...) {
-  client.setCACert(nullptr);
-  return false;
-}
-}  // namespace
-
-static bool enable_insecure_tls(WiFiClientSecure& client) {
-  return try_set_insecure(client, 0);
-}
-
-static void log_insecure_choice(bool used_set_insecure) {
-  if (used_set_insecure) {
-    Serial.println(F("[TLS] setInsecure() habilitado (teste)."));
-  } else {
-    Serial.println(
-        F("[TLS] setCACert(nullptr) aplicado (setInsecure indisponível nesta versão do core)."));
-  }
-}
+static bool execute_twist_command(float yawDeg,
+                                  float pitchDeg,
+                                  const CommandStamp& stamp,
+                                  String& executedCommand);
+static bool execute_head_command(float yawDeg,
+                                 float pitchDeg,
+                                 const CommandStamp& stamp,
+                                 String& executedCommand);
+static void handle_twist_message(const uint8_t* payload, unsigned int length,
+                                 uint32_t received_us);
+static void append_view(String& out, const TextView& view);
+static void defer_trace(const String& head, const String& tail, const CommandTrace& trace);
+static void poll_pending_traces();
+static void publish_pong(const char* head, const char* tail, const CommandTrace& trace);
+static void publish_reply(const char* topic, const char* head, const char* tail,
+                          const CommandTrace& trace);
+static void set_topic(const char** name, const char* topic);
+static void expand_topics();
+static void drain_outbound();
 
 // =======================
 // Implementação dos setters
@@ -131,289 +225,891 @@ void net_set_broker(const char* host, int port,
 }
 
 void net_set_topic(const char* topic) {
-  g_sub_topic = topic;
+  set_topic(&g_sub_topic, topic);
+}
+
+void net_set_twist_topic(const char* topic) {
+  set_topic(&g_twist_topic, topic);
+}
+
+void net_set_command_mode(RemoteCommandMode mode) {
+  g_command_mode = mode;
 }
 
 void net_set_pub_topic(const char* topic) {
-  g_pub_topic = topic;
+  set_topic(&g_pub_topic, topic);
+}
+
+void net_set_trace_topic(const char* topic) {
+  set_topic(&g_trace_topic, topic);
 }
 
 void net_set_odom_topic(const char* topic) {
-  g_odom_topic = topic;
+  set_topic(&g_odom_topic, topic);
 }
 
 void net_set_odom_debug_topic(const char* topic) {
-  g_odom_debug = topic;
+  set_topic(&g_odom_debug, topic);
+}
+
+void net_set_odom_format(TelemetryFormat format) {
+  g_odom_format = format;
+}
+
+void net_set_odom_debug_format(TelemetryFormat format) {
+  g_odom_debug_format = format;
+}
+
+void net_set_telemetry_period(uint32_t period_ms) {
+  g_telemetry_period_ms = period_ms;
+}
+
+void net_set_telemetry_batch(uint8_t samples, uint32_t max_age_ms) {
+  if (samples == 0) samples = 1;
+  if (samples > TELEMETRY_BATCH_MAX_SAMPLES) samples = TELEMETRY_BATCH_MAX_SAMPLES;
+  g_batch_samples = samples;
+  g_batch_age_ms = max_age_ms;
+}
+
+void net_set_backfill_topic(const char* topic) {
+  set_topic(&g_backfill_topic, topic);
+}
+
+void net_set_backfill_rate(uint8_t samples, uint32_t period_ms) {
+  if (samples == 0) samples = 1;
+  if (samples > TELEMETRY_BATCH_MAX_SAMPLES) samples = TELEMETRY_BATCH_MAX_SAMPLES;
+  g_backfill_samples = samples;
+  g_backfill_period_ms = period_ms;
+}
+
+void net_set_timing_topic(const char* topic) {
+  set_topic(&g_timing_topic, topic);
+}
+
+void net_set_profile_topic(const char* topic) {
+  set_topic(&g_profile_topic, topic);
+}
+
+void net_set_session_topic(const char* topic) {
+  set_topic(&g_session_topic, topic);
+}
+
+void net_set_net_stats_topic(const char* topic) {
+  set_topic(&g_net_topic, topic);
+}
+
+void net_set_command_stats_topic(const char* topic) {
+  set_topic(&g_cmd_stats_topic, topic);
+}
+
+void net_set_command_max_age(uint32_t max_age_ms) {
+  g_command_gate.set_max_age(max_age_ms);
+  g_twist_gate.set_max_age(max_age_ms);
+}
+
+CommandGateStats net_command_gate_stats() {
+  return g_command_gate.stats();
+}
+
+CommandGateStats net_twist_gate_stats() {
+  return g_twist_gate.stats();
 }
 
 void net_set_root_ca(const char* root_ca_pem) {
   g_root_ca_pem = root_ca_pem;
 }
 
-// =======================
-// WiFi + MQTT
-// =======================
-static void setup_wifi() {
-  delay(10);
-  Serial.println();
-  Serial.print(F("Conectando-se a "));
-  Serial.println(g_wifi_ssid);
-
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(g_wifi_ssid, g_wifi_pass);
-
-  uint32_t t0 = millis();
-  while (WiFi.status() != WL_CONNECTED) {
-    delay(500);
-    Serial.print('.');
-    if (millis() - t0 > 30000) {  // timeout 30s
-      Serial.println(F("\n[WiFi] Timeout ao conectar."));
-      break;
+bool net_set_outbound_budget(uint16_t ack_bytes, uint16_t pose_bytes, uint16_t debug_bytes) {
+  const uint16_t budget[OUTBOUND_CLASS_COUNT] = {ack_bytes, pose_bytes, debug_bytes};
+  return g_outbound.reset(budget);
+}
+
+void net_set_outbound_queue(bool enabled) {
+  g_outbound_enabled = enabled;
+}
+
+OutboundClassStats net_outbound_stats(OutboundClass cls) {
+  return g_outbound.stats(cls);
+}
+
+bool net_set_robot_id(const char* id) {
+  if (id && *id && !robot_id_valid(id)) {
+    return false;
+  }
+  g_robot_id_cfg = id;
+  g_robot_id[0] = '\0';
+  expand_topics();
+  return true;
+}
+
+bool net_set_fleet(const char* root, const char* group) {
+  const bool bad_root = root && (strchr(root, '+') || strchr(root, '#'));
+  if (bad_root || (group && *group && !robot_id_valid(group))) {
+    return false;
+  }
+  g_fleet_root = root;
+  g_fleet_group = group;
+  expand_topics();
+  return true;
+}
+
+const char* net_robot_id() {
+  if (!g_robot_id[0]) {
+    if (g_robot_id_cfg && *g_robot_id_cfg) {
+      strncpy(g_robot_id, g_robot_id_cfg, sizeof(g_robot_id) - 1);
+    } else {
+      uint8_t mac[6];
+      hal_mac_address(mac);
+      robot_id_from_mac(mac, g_robot_id, sizeof(g_robot_id));
     }
   }
+  return g_robot_id;
+}
 
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println(F("\nWiFi conectado!"));
-    Serial.print(F("IP: "));
-    Serial.println(WiFi.localIP());
+// =======================
+// Tópicos por robô
+// =======================
+static void expand_slot(TopicSlot& slot) {
+  if (!slot.tmpl || !*slot.tmpl) {
+    *slot.name = slot.tmpl;
+    return;
+  }
+  if (!topic_expand(slot.tmpl, g_fleet_root, net_robot_id(), slot.buf, sizeof(slot.buf))) {
+    LOG_W(MQTT, "[MQTT] Tópico longo demais: %s", slot.tmpl);
   }
+  *slot.name = slot.buf;
 }
 
-static void mqtt_callback(char* topic, uint8_t* payload, unsigned int length) {
-  Serial.print(F("Mensagem recebida em "));
-  Serial.println(topic);
+// Modelo de comando expandido com o grupo; "" se não muda de um robô para
+// outro (sem frota nem "{id}") e o tópico do robô já é o de todos
+static const char* expand_group(const char* tmpl, const char* own, char* buf, size_t cap) {
+  if (!g_fleet_group || !*g_fleet_group ||
+      !topic_expand(tmpl, g_fleet_root, g_fleet_group, buf, cap) || strcmp(buf, own) == 0) {
+    return "";
+  }
+  return buf;
+}
 
-  String msg;
-  msg.reserve(length);
-  for (unsigned int i = 0; i < length; ++i) {
-    msg += static_cast<char>(payload[i]);
+static const char* topic_template(const char** name) {
+  for (const TopicSlot& slot : g_topic_slots) {
+    if (slot.name == name) return slot.tmpl;
   }
+  return "";
+}
 
-  Serial.print(F("Payload: "));
-  Serial.println(msg);
-  Serial.println(F("-----------------------"));
+static void expand_topics() {
+  for (TopicSlot& slot : g_topic_slots) {
+    expand_slot(slot);
+  }
+  g_group_sub_topic = expand_group(topic_template(&g_sub_topic), g_sub_topic, g_group_sub_buf,
+                                   sizeof(g_group_sub_buf));
+  g_group_twist_topic = expand_group(topic_template(&g_twist_topic), g_twist_topic,
+                                     g_group_twist_buf, sizeof(g_group_twist_buf));
+}
 
-  handle_command_message(msg);
+static void set_topic(const char** name, const char* topic) {
+  for (TopicSlot& slot : g_topic_slots) {
+    if (slot.name == name) {
+      slot.tmpl = topic;
+      expand_topics();
+      return;
+    }
+  }
 }
 
-static void mqtt_reconnect() {
-  while (!g_mqtt_client.connected()) {
-    Serial.print(F("Tentando MQTT... "));
+// =======================
+// WiFi + MQTT
+// =======================
+static void mqtt_callback(char* topic, uint8_t* payload, unsigned int length) {
+  const uint32_t received_us = hal_micros();  // antes dos logs
+  LOG_D(MQTT, "Mensagem recebida em %s", topic);
+  LOG_D(MQTT, "Payload: %s", log_text(reinterpret_cast<const char*>(payload), length));
 
-    String clientId = String("ESP32Client-") + String((uint32_t)esp_random(), HEX);
+  if ((g_twist_topic && strcmp(topic, g_twist_topic) == 0) ||
+      (*g_group_twist_topic && strcmp(topic, g_group_twist_topic) == 0)) {
+    handle_twist_message(payload, length, received_us);
+    return;
+  }
+  handle_command_message(payload, length, received_us);
+}
 
-    // Conecta com usuário/senha (HiveMQ Cloud)
-    if (g_mqtt_client.connect(clientId.c_str(), g_mqtt_user, g_mqtt_pass)) {
-      Serial.println(F("conectado!"));
+static void on_connection_event(ConnEvent event) {
+  if (event == CONN_EVENT_ONLINE) {
+    LOG_I(MQTT, "[MQTT] Conectado!");
 
-      if (g_sub_topic && *g_sub_topic) {
-        g_mqtt_client.subscribe(g_sub_topic);
-        Serial.print(F("Inscrito em: "));
-        Serial.println(g_sub_topic);
-      }
-    } else {
-      Serial.print(F("falhou, rc="));
-      Serial.print(g_mqtt_client.state());
-      Serial.println(F(" — nova tentativa em 5s"));
-      delay(5000);
+    if (g_sub_topic && *g_sub_topic) {
+      hal_mqtt_subscribe(g_sub_topic);
+      LOG_I(MQTT, "Inscrito em: %s", g_sub_topic);
+    }
+    if (g_twist_topic && *g_twist_topic) {
+      hal_mqtt_subscribe(g_twist_topic);
+      LOG_I(MQTT, "Inscrito em: %s", g_twist_topic);
+    }
+    // Difusão para a frota (net_set_fleet)
+    if (*g_group_sub_topic) {
+      hal_mqtt_subscribe(g_group_sub_topic);
+      LOG_I(MQTT, "Inscrito em: %s", g_group_sub_topic);
     }
+    if (*g_group_twist_topic) {
+      hal_mqtt_subscribe(g_group_twist_topic);
+      LOG_I(MQTT, "Inscrito em: %s", g_group_twist_topic);
+    }
+  } else {
+    LOG_W(MQTT, "[MQTT] Conexão perdida, rc=%d", static_cast<int>(conn_stats().last_error));
   }
 }
 
 void net_mqtt_begin() {
-  setup_wifi();
-
-  // TLS: inseguro para testes OU valida root CA
-  if (g_insecureTLS) {
-    log_insecure_choice(enable_insecure_tls(g_secure_client));
-  } else if (g_root_ca_pem && *g_root_ca_pem) {
-    g_secure_client.setCACert(g_root_ca_pem);
-    Serial.println(F("[TLS] Root CA configurado (validação ativa)."));
-  } else {
-    Serial.println(F("[TLS] Aviso: validação pedida sem Root CA — caindo para modo sem validação."));
-    log_insecure_choice(enable_insecure_tls(g_secure_client));
+  LOG_I(MQTT, "Conectando-se a %s", g_wifi_ssid);
+  expand_topics();
+  LOG_I(MQTT, "Robô %s, odometria em %s", net_robot_id(), g_odom_topic);
+
+  hal_mqtt_setup(g_mqtt_host, g_mqtt_port, g_insecureTLS, g_root_ca_pem, mqtt_callback);
+
+  // Wi-Fi e MQTT sobem em segundo plano (net_mqtt_loop), sem bloquear o setup
+  ConnConfig config = conn_default_config();
+  config.wifi_ssid = g_wifi_ssid;
+  config.wifi_pass = g_wifi_pass;
+  config.mqtt_user = g_mqtt_user;
+  config.mqtt_pass = g_mqtt_pass;
+  conn_begin(config, on_connection_event);
+
+  // Amostras de uma queda anterior ao reset continuam pendentes na flash
+  odometry_store_begin();
+  g_outbound.clear();
+  g_command_gate.reset();
+  g_twist_gate.reset();
+}
+
+void net_mqtt_loop() {
+  conn_poll();
+  if (conn_online()) {
+    hal_mqtt_loop();
   }
+  poll_pending_traces();
+  net_publish_connection_stats();
+  net_publish_command_stats();
+  drain_outbound();
+}
 
-  g_mqtt_client.setServer(g_mqtt_host, g_mqtt_port);
-  g_mqtt_client.setCallback(mqtt_callback);
+bool net_mqtt_publish(const char* topic, const char* payload) {
+  return net_mqtt_publish_bytes(topic, reinterpret_cast<const uint8_t*>(payload),
+                                strlen(payload));
+}
 
-  // (Opcional) ajuste de performance
-  // g_mqtt_client.setKeepAlive(30);
-  // g_mqtt_client.setBufferSize(2048);
+bool net_mqtt_publish_bytes(const char* topic, const uint8_t* payload, size_t length) {
+  if (!hal_mqtt_connected()) return false;
+  return hal_mqtt_publish(topic, payload, length);
 }
 
-void net_mqtt_loop() {
-  if (!g_mqtt_client.connected()) mqtt_reconnect();
-  g_mqtt_client.loop();
+// =======================
+// Fila de saída
+// =======================
+// Offline recusa como o publish direto (o lote vai para a flash, o pong é
+// perdido); o que entrou antes de uma queda sai depois da reconexão
+static bool enqueue(OutboundClass cls, const char* topic, const uint8_t* payload, size_t length,
+                    bool coalesce) {
+  if (!hal_mqtt_connected()) return false;
+  if (!g_outbound_enabled) return hal_mqtt_publish(topic, payload, length);
+  return g_outbound.push(cls, topic, payload, length, coalesce);
 }
 
-bool net_mqtt_publish(const char* topic, const char* payload) {
-  if (!g_mqtt_client.connected()) return false;
-  return g_mqtt_client.publish(topic, payload);
+static bool enqueue_text(OutboundClass cls, const char* topic, const String& payload,
+                         bool coalesce) {
+  return enqueue(cls, topic, reinterpret_cast<const uint8_t*>(payload.c_str()),
+                 payload.length(), coalesce);
 }
 
-bool net_publish_odometry(float x, float y, float phi) {
-  if (!g_odom_topic || !*g_odom_topic) {
-    return false;
+static void note_slow_publish() {
+  g_outbound_slow_ms = hal_millis();
+  g_outbound.set_backpressure(true);
+}
+
+// Publica em ordem de classe até OUTBOUND_PASS_BYTES. Publish lento ou
+// recusado para a passada e liga a contrapressão (debug passa a ser
+// descartado na entrada); ela desliga quando uma passada esvazia a fila
+// depois de OUTBOUND_BACKPRESSURE_HOLD_MS sem tropeço: um link que só dá
+// vazão ao pong e à pose não volta a aceitar um perfil de 1,4 KiB, que
+// prenderia o socket. Recusada com a conexão de pé (maior que o buffer do
+// cliente) a mensagem é descartada, para não travar a fila.
+static void drain_outbound() {
+  if (!hal_mqtt_connected()) return;
+  size_t budget = OUTBOUND_PASS_BYTES;
+  OutboundMessage msg;
+  while (g_outbound.peek(msg)) {
+    const uint32_t t0 = hal_micros();
+    const bool ok = hal_mqtt_publish(msg.topic, msg.payload, msg.length);
+    const bool slow = (hal_micros() - t0) > OUTBOUND_SLOW_PUBLISH_US;
+    g_outbound.pop(ok);
+    if (!ok || slow) {
+      note_slow_publish();
+      return;
+    }
+    if (msg.length >= budget) return;
+    budget -= msg.length;
   }
+  if ((hal_millis() - g_outbound_slow_ms) >= OUTBOUND_BACKPRESSURE_HOLD_MS) {
+    g_outbound.set_backpressure(false);
+  }
+}
 
-  String payload;
-  payload.reserve(64);
-  payload += F("{");
-  payload += F("\"x\":");
-  payload += String(x, 6);
-  payload += F(",\"y\":");
-  payload += String(y, 6);
-  payload += F(",\"phi\":");
-  payload += String(phi, 6);
-  payload += F("}");
+// Reenvio da flash e gravação de sessão têm controle de fluxo próprio (tentam
+// de novo depois): ficam fora da fila e só saem com ela vazia e sem
+// contrapressão, atrás de pong e telemetria ao vivo
+static bool publish_bulk(const char* topic, const uint8_t* payload, size_t length) {
+  if (!g_outbound_enabled) return net_mqtt_publish_bytes(topic, payload, length);
+  if (g_outbound.pending() > 0 || g_outbound.backpressure()) return false;
+  const uint32_t t0 = hal_micros();
+  const bool ok = net_mqtt_publish_bytes(topic, payload, length);
+  if (ok && (hal_micros() - t0) > OUTBOUND_SLOW_PUBLISH_US) {
+    note_slow_publish();
+  }
+  return ok;
+}
 
-  return net_mqtt_publish(g_odom_topic, payload.c_str());
+static bool outbound_idle() {
+  return !g_outbound_enabled || (g_outbound.pending() == 0 && !g_outbound.backpressure());
 }
 
-bool net_publish_odometry_debug(int16_t contagemR, int16_t contagemL,
-                                float velR, float velL, unsigned long dt_ms) {
-  if (!g_odom_debug || !*g_odom_debug) {
+// Publica uma amostra no formato do tópico; bytes recebe o tamanho do payload
+static bool publish_sample(const char* topic, TelemetryFormat format, bool debug,
+                           const OdometrySample& sample, size_t& bytes) {
+  bytes = 0;
+  if (!topic || !*topic) {
     return false;
   }
+  // Retrato da pose: na fila, a amostra nova substitui a que não saiu
+  const OutboundClass cls = debug ? OUTBOUND_DEBUG : OUTBOUND_POSE;
+
+  if (format == TELEMETRY_BINARY) {
+    uint8_t frame[TELEMETRY_DEBUG_FRAME_SIZE];
+    bytes = debug ? telemetry_encode_odometry_debug(sample, frame, sizeof(frame))
+                  : telemetry_encode_odometry(sample, frame, sizeof(frame));
+    return enqueue(cls, topic, frame, bytes, true);
+  }
 
   String payload;
-  payload.reserve(96);
-  payload += F("{");
-  payload += F("\"contagemR\":");
-  payload += contagemR;
-  payload += F(",\"contagemL\":");
-  payload += contagemL;
-  payload += F(",\"velR\":");
-  payload += String(velR, 6);
-  payload += F(",\"velL\":");
-  payload += String(velL, 6);
-  payload += F(",\"dt\":");
-  payload += dt_ms;
-  payload += F("}");
+  if (debug) {
+    telemetry_odometry_debug_json(sample, payload);
+  } else {
+    telemetry_odometry_json(sample, payload);
+  }
+  bytes = payload.length();
+  return enqueue_text(cls, topic, payload, true);
+}
+
+bool net_publish_odometry(const OdometrySample& sample) {
+  size_t bytes;
+  // Lote é montado por net_telemetry_*; aqui a amostra avulsa sai em binário
+  TelemetryFormat format = g_odom_format == TELEMETRY_BATCH ? TELEMETRY_BINARY : g_odom_format;
+  return publish_sample(g_odom_topic, format, false, sample, bytes);
+}
+
+bool net_publish_odometry_debug(const OdometrySample& sample) {
+  size_t bytes;
+  TelemetryFormat format =
+      g_odom_debug_format == TELEMETRY_BATCH ? TELEMETRY_BINARY : g_odom_debug_format;
+  return publish_sample(g_odom_debug, format, true, sample, bytes);
+}
+
+static void account_publish(bool ok, size_t bytes, uint32_t t0_us) {
+  uint32_t cost = hal_micros() - t0_us;
+  if (ok) {
+    g_telemetry_stats.messages++;
+    g_telemetry_stats.sent_bytes += bytes;
+  } else {
+    g_telemetry_stats.failed++;
+  }
+  g_telemetry_stats.publish_us_total += cost;
+  if (cost > g_telemetry_stats.publish_us_max) {
+    g_telemetry_stats.publish_us_max = cost;
+  }
+}
+
+static bool backfill_enabled() {
+  return g_backfill_topic && *g_backfill_topic;
+}
 
-  return net_mqtt_publish(g_odom_debug, payload.c_str());
+static void flush_batch() {
+  if (g_batch.count == 0) {
+    return;
+  }
+  uint32_t t0 = hal_micros();
+  // Lote não é substituído: cada um traz amostras que os outros não têm
+  bool ok = g_odom_topic && *g_odom_topic &&
+            enqueue(OUTBOUND_POSE, g_odom_topic, g_batch.buf, g_batch.length, false);
+  account_publish(ok, g_batch.length, t0);
+  // Lote recusado pela queda: as amostras (já quantizadas) vão para a flash
+  if (!ok && backfill_enabled()) {
+    const size_t n = telemetry_decode_odometry_batch(g_batch.buf, g_batch.length,
+                                                     g_store_samples, TELEMETRY_BATCH_MAX_SAMPLES);
+    for (size_t i = 0; i < n; ++i) {
+      if (odometry_store_append(g_store_samples[i])) g_telemetry_stats.stored++;
+    }
+  }
+  telemetry_batch_begin(g_batch, g_batch.with_debug);
 }
 
-static void handle_command_message(const String& payload) {
-  float yawDeg = 0.0f;
-  float pitchDeg = 0.0f;
-  String nonce;
-  String timestamp;
-  if (!parse_command_payload(payload, yawDeg, pitchDeg, nonce, timestamp)) {
-    Serial.println(F("[MQTT] Payload inválido (esperado: yaw|pitch|nonce|timestamp)."));
+// Reenvia as amostras guardadas offline, em lotes sem debug, a no máximo
+// g_backfill_samples por g_backfill_period_ms
+static void poll_backfill(uint32_t now) {
+  if (!backfill_enabled() || !hal_mqtt_connected() || !outbound_idle() ||
+      (now - g_last_backfill_ms) < g_backfill_period_ms) {
     return;
   }
+  static TelemetryBatch batch;   // 1 KiB, fora da pilha
+  OdometrySample* samples = g_store_samples;
+  const size_t n = odometry_store_peek(samples, g_backfill_samples);
+  if (n == 0) {
+    return;
+  }
+  g_last_backfill_ms = now;
 
-  Serial.print(F("[MQTT] Yaw recebido: "));
-  Serial.print(yawDeg, 2);
-  Serial.print(F("° | Pitch: "));
-  if (isnan(pitchDeg)) {
-    Serial.print(F("NaN"));
-  } else {
-    Serial.print(pitchDeg, 2);
-    Serial.print(F("°"));
+  telemetry_batch_begin(batch, false);
+  size_t added = 0;
+  while (added < n && telemetry_batch_add(batch, samples[added])) {
+    added++;
   }
-  Serial.print(F(" | nonce="));
-  Serial.print(nonce);
-  Serial.print(F(" | t0="));
-  Serial.println(timestamp);
+  if (added > 0 && publish_bulk(g_backfill_topic, batch.buf, batch.length)) {
+    odometry_store_consume(added);
+    g_telemetry_stats.backfilled += added;
+  }
+}
 
-  String executedCommand;
-  bool success = execute_motion_command(yawDeg, pitchDeg, executedCommand);
-  if (!success && executedCommand.length() == 0) {
-    executedCommand = F("noop");
+// Rodas sem nenhuma contagem por este tempo: robô parado
+#define STORE_STILL_MS 500
+// Um apagamento à frente (~45 ms de flash parada) por período, no máximo
+#define STORE_ERASE_PERIOD_MS 250
+
+// Deixa apagados os setores da flash que a próxima queda vai usar, para a
+// gravação offline nunca apagar com o robô andando (odometry_store.h)
+static void poll_erase_ahead(uint32_t now) {
+  if (!backfill_enabled() || (now - g_last_erase_ms) < STORE_ERASE_PERIOD_MS) {
+    return;
+  }
+  const bool still = (now - g_last_motion_ms) >= STORE_STILL_MS;
+  const bool online = hal_mqtt_connected();
+  if (!online && !still) {
+    return;
+  }
+  // No ar, com reenvio pendente, a partição cheia esvazia pelo reenvio
+  if (odometry_store_erase_ahead(!online)) {
+    g_last_erase_ms = now;
   }
-  Serial.print(F("[MQTT] Ação derivada: "));
-  Serial.print(executedCommand);
-  Serial.print(F(" | sucesso="));
-  Serial.println(success ? F("sim") : F("não"));
-  unsigned long executed_at = millis();
-  publish_pong(nonce, timestamp, executed_at, yawDeg, pitchDeg, executedCommand, success);
 }
 
-static bool parse_command_payload(const String& payload,
-                                  float& yawDeg,
-                                  float& pitchDeg,
-                                  String& nonce,
-                                  String& timestamp) {
-  int first_sep = payload.indexOf('|');
-  if (first_sep < 0) return false;
+void net_telemetry_add_sample(const OdometrySample& sample, bool with_debug) {
+  g_telemetry_stats.samples++;
+  if (sample.contagemR != 0 || sample.contagemL != 0) {
+    g_last_motion_ms = hal_millis();
+  }
+  g_telemetry_stats.raw_bytes +=
+      TELEMETRY_ODOMETRY_FRAME_SIZE + (with_debug ? TELEMETRY_DEBUG_FRAME_SIZE : 0);
+
+  // Offline a amostra vai para a flash e volta depois pelo tópico de backfill
+  // (o lote em montagem sai antes, recusado, para a ordem na flash ser a do seq)
+  if (!hal_mqtt_connected() && backfill_enabled()) {
+    flush_batch();
+    if (odometry_store_append(sample)) {
+      g_telemetry_stats.stored++;
+      return;
+    }
+  }
 
-  int second_sep = payload.indexOf('|', first_sep + 1);
-  if (second_sep < 0) return false;
+  if (g_odom_format != TELEMETRY_BATCH) {
+    g_latest_sample = sample;
+    g_latest_pending = true;
+    g_latest_with_debug = with_debug;
+    return;
+  }
 
-  int third_sep = payload.indexOf('|', second_sep + 1);
-  if (third_sep < 0) return false;
+  if (g_batch.count > 0 && g_batch.with_debug != with_debug) {
+    flush_batch();
+  }
+  if (g_batch.count == 0) {
+    telemetry_batch_begin(g_batch, with_debug);
+    g_batch_started_ms = hal_millis();
+  }
+  if (!telemetry_batch_add(g_batch, sample)) {
+    flush_batch();
+    g_batch_started_ms = hal_millis();
+    telemetry_batch_add(g_batch, sample);
+  }
+  if (g_batch.count >= g_batch_samples) {
+    flush_batch();
+  }
+}
 
-  String yawStr = payload.substring(0, first_sep);
-  yawStr.trim();
+void net_telemetry_poll() {
+  uint32_t now = hal_millis();
+  poll_backfill(now);
+  poll_erase_ahead(now);
 
-  String pitchStr = payload.substring(first_sep + 1, second_sep);
-  pitchStr.trim();
+  if (g_odom_format == TELEMETRY_BATCH) {
+    if (g_batch.count > 0 && (now - g_batch_started_ms) >= g_batch_age_ms) {
+      flush_batch();
+    }
+    return;
+  }
 
-  nonce = payload.substring(second_sep + 1, third_sep);
-  nonce.trim();
+  if (!g_latest_pending || (now - g_last_telemetry_ms) < g_telemetry_period_ms) {
+    return;
+  }
+  g_latest_pending = false;
+  g_last_telemetry_ms = now;
+
+  size_t bytes;
+  uint32_t t0 = hal_micros();
+  bool ok = publish_sample(g_odom_topic, g_odom_format, false, g_latest_sample, bytes);
+  account_publish(ok, bytes, t0);
+  if (g_latest_with_debug) {
+    TelemetryFormat format =
+        g_odom_debug_format == TELEMETRY_BATCH ? TELEMETRY_BINARY : g_odom_debug_format;
+    t0 = hal_micros();
+    ok = publish_sample(g_odom_debug, format, true, g_latest_sample, bytes);
+    account_publish(ok, bytes, t0);
+  }
+}
 
-  timestamp = payload.substring(third_sep + 1);
-  timestamp.trim();
+TelemetryStats net_telemetry_stats() {
+  return g_telemetry_stats;
+}
 
-  if (yawStr.length() == 0 || pitchStr.length() == 0 || nonce.length() == 0 ||
-      timestamp.length() == 0) {
+bool net_publish_control_timing(const ControlTimingStats& stats) {
+  if (!g_timing_topic || !*g_timing_topic) {
     return false;
   }
 
-  if (!parse_angle_field(yawStr, yawDeg)) {
+  String payload;
+  payload.reserve(304);
+  payload += F("{");
+  payload += F("\"cycles\":");
+  payload += stats.cycles;
+  payload += F(",\"period_us\":");
+  payload += stats.nominal_period_us;
+  payload += F(",\"mean_us\":");
+  payload += stats.mean_period_us;
+  payload += F(",\"min_us\":");
+  payload += stats.min_period_us;
+  payload += F(",\"max_us\":");
+  payload += stats.max_period_us;
+  payload += F(",\"jitter_max_us\":");
+  payload += stats.max_jitter_us;
+  payload += F(",\"jitter_mean_us\":");
+  payload += stats.mean_jitter_us;
+  payload += F(",\"exec_max_us\":");
+  payload += stats.max_exec_us;
+  payload += F(",\"overruns\":");
+  payload += stats.overruns;
+  payload += F(",\"safety_trips\":");
+  payload += stats.safety_trips;
+  payload += F(",\"safety_brakes\":");
+  payload += stats.safety_brakes;
+  payload += F(",\"safety_locks\":");
+  payload += stats.safety_locks;
+  payload += F(",\"button_presses\":");
+  payload += stats.button_presses;
+  payload += F(",\"button_bounces\":");
+  payload += stats.button_bounces;
+  payload += F(",\"button_latency_max_us\":");
+  payload += stats.button_latency_max_us;
+  payload += F("}");
+
+  return enqueue_text(OUTBOUND_DEBUG, g_timing_topic, payload, true);
+}
+
+#if LOOP_PROFILING
+bool net_publish_loop_profile(const LoopProfile& profile) {
+  if (!g_profile_topic || !*g_profile_topic) {
     return false;
   }
 
-  if (!parse_angle_field(pitchStr, pitchDeg)) {
-    return false;
+  // {"window_ms":N,"encoder":{"n":..,"min_ns":..,"mean_ns":..,"max_ns":..,
+  //  "deadline_us":..,"misses":..,"hist":[..]},...}
+  String payload;
+  payload.reserve(1400);
+  payload += F("{\"window_ms\":");
+  payload += profile.window_ms;
+  for (int i = 0; i < STAGE_COUNT; ++i) {
+    const LoopStageStats& st = profile.stage[i];
+    payload += F(",\"");
+    payload += loop_stage_name(static_cast<LoopStage>(i));
+    payload += F("\":{\"n\":");
+    payload += st.count;
+    payload += F(",\"min_ns\":");
+    payload += st.min_ns;
+    payload += F(",\"mean_ns\":");
+    payload += st.mean_ns;
+    payload += F(",\"max_ns\":");
+    payload += st.max_ns;
+    payload += F(",\"deadline_us\":");
+    payload += st.deadline_us;
+    payload += F(",\"misses\":");
+    payload += st.misses;
+    payload += F(",\"hist\":[");
+    for (int b = 0; b < LOOP_PROFILER_BUCKETS; ++b) {
+      if (b) payload += ',';
+      payload += st.hist[b];
+    }
+    payload += F("]}");
   }
+  payload += F("}");
 
-  return true;
+  return enqueue_text(OUTBOUND_DEBUG, g_profile_topic, payload, true);
 }
+#endif
 
-static bool parse_angle_field(const String& src, float& value) {
-  String trimmed = src;
-  trimmed.trim();
-  if (trimmed.length() == 0) {
+bool net_publish_session_chunk(const uint8_t* chunk, size_t length) {
+  if (!g_session_topic || !*g_session_topic || !hal_mqtt_connected()) {
     return false;
   }
+  return publish_bulk(g_session_topic, chunk, length);
+}
 
-  String lower = trimmed;
-  lower.toLowerCase();
-  if (lower == F("nan")) {
-    value = NAN;
-    return true;
+bool net_publish_connection_stats() {
+  static unsigned long last_publish = 0;
+
+  unsigned long now = hal_millis();
+  if (!conn_online() || (now - last_publish) < NET_STATS_PERIOD_MS) {
+    return false;
   }
+  last_publish = now;
 
-  bool hasDigit = false;
-  for (size_t i = 0; i < static_cast<size_t>(trimmed.length()); ++i) {
-    char c = trimmed.charAt(i);
-    if (isdigit(static_cast<unsigned char>(c))) {
-      hasDigit = true;
-      break;
-    }
-    if (c != '-' && c != '+' && c != '.') {
-      return false;
+  if (!g_net_topic || !*g_net_topic) {
+    return false;
+  }
+
+  ConnStats stats = conn_stats();
+  String payload;
+  payload.reserve(720);
+  payload += F("{");
+  payload += F("\"state\":\"");
+  payload += conn_state_name(stats.state);
+  payload += F("\",\"mqtt_connects\":");
+  payload += stats.mqtt_connects;
+  payload += F(",\"reconnects\":");
+  payload += stats.reconnects;
+  payload += F(",\"failed_attempts\":");
+  payload += stats.failed_attempts;
+  payload += F(",\"disconnects\":");
+  payload += stats.disconnects;
+  payload += F(",\"disconnected_ms\":");
+  payload += stats.disconnected_ms;
+  payload += F(",\"last_error\":");
+  payload += static_cast<long>(stats.last_error);
+  payload += F(",\"max_poll_us\":");
+  payload += stats.max_poll_us;
+
+  CommandQueueStats cmd = remote_command_stats();
+  payload += F(",\"cmd_enqueued\":");
+  payload += cmd.enqueued;
+  payload += F(",\"cmd_dropped_full\":");
+  payload += cmd.dropped_full;
+  payload += F(",\"cmd_superseded\":");
+  payload += cmd.dropped_superseded;
+  payload += F(",\"cmd_consumed\":");
+  payload += cmd.consumed;
+
+  TelemetryStats tlm = net_telemetry_stats();
+  uint32_t attempts = tlm.messages + tlm.failed;
+  payload += F(",\"tlm_samples\":");
+  payload += tlm.samples;
+  payload += F(",\"tlm_msgs\":");
+  payload += tlm.messages;
+  payload += F(",\"tlm_ring_dropped\":");
+  payload += odometry_samples_dropped();
+  payload += F(",\"tlm_stored\":");
+  payload += tlm.stored;
+  payload += F(",\"tlm_backfilled\":");
+  payload += tlm.backfilled;
+  OdometryStoreStats store = odometry_store_stats();
+  payload += F(",\"store_pending\":");
+  payload += store.pending;
+  payload += F(",\"store_overwritten\":");
+  payload += store.overwritten;
+  payload += F(",\"store_skipped\":");
+  payload += store.skipped;
+  payload += F(",\"tlm_ratio\":");
+  payload += String(tlm.sent_bytes ? float(tlm.raw_bytes) / tlm.sent_bytes : 0.0f, 2);
+  payload += F(",\"tlm_pub_us_max\":");
+  payload += tlm.publish_us_max;
+  payload += F(",\"tlm_pub_us_mean\":");
+  payload += attempts ? tlm.publish_us_total / attempts : 0;
+
+  EncoderStats enc = encoder_stats();
+  payload += F(",\"enc_wraps\":");
+  payload += enc.limit_events;
+  payload += F(",\"enc_late\":");
+  payload += enc.late_events;
+  payload += F(",\"enc_diff\":");
+  payload += enc.capture_diff;
+  payload += F(",\"enc_clamped\":");
+  payload += enc.clamped_samples;
+
+  LogStats logs = async_log_stats();
+  payload += F(",\"log_written\":");
+  payload += logs.written;
+  payload += F(",\"log_dropped\":");
+  payload += logs.dropped;
+  payload += F(",\"log_truncated\":");
+  payload += logs.truncated;
+
+  // Fila de saída por classe: [pong, pose, debug]
+  static const char* const kOutboundFields[] = {"out_queued", "out_sent", "out_coalesced",
+                                                "out_dropped"};
+  for (int f = 0; f < 4; ++f) {
+    payload += F(",\"");
+    payload += kOutboundFields[f];
+    payload += F("\":[");
+    for (int c = 0; c < OUTBOUND_CLASS_COUNT; ++c) {
+      const OutboundClassStats out = g_outbound.stats(static_cast<OutboundClass>(c));
+      const uint32_t values[] = {out.queued, out.sent, out.coalesced, out.dropped};
+      if (c) payload += ',';
+      payload += values[f];
     }
+    payload += ']';
   }
+  payload += F("}");
+
+  return enqueue_text(OUTBOUND_DEBUG, g_net_topic, payload, true);
+}
 
-  if (!hasDigit) {
+bool net_publish_command_stats() {
+  static unsigned long last_publish = 0;
+
+  unsigned long now = hal_millis();
+  if (!conn_online() || (now - last_publish) < NET_STATS_PERIOD_MS) {
     return false;
   }
+  last_publish = now;
 
-  value = trimmed.toFloat();
-  if (isnan(value) || isinf(value)) {
+  if (!g_cmd_stats_topic || !*g_cmd_stats_topic) {
     return false;
   }
 
-  return true;
+  const CommandGateStats st = g_command_gate.stats();
+  String payload;
+  payload.reserve(320);
+  payload += F("{\"accepted\":");
+  payload += st.accepted;
+  payload += F(",\"stale\":");
+  payload += st.stale;
+  payload += F(",\"reordered\":");
+  payload += st.reordered;
+  payload += F(",\"unsequenced\":");
+  payload += st.unsequenced;
+  payload += F(",\"resyncs\":");
+  payload += st.resyncs;
+  payload += F(",\"last_seq\":");
+  payload += st.last_seq;
+  payload += F(",\"age_ms_last\":");
+  payload += st.age_ms_last;
+  payload += F(",\"age_ms_max\":");
+  payload += st.age_ms_max;
+  payload += F(",\"max_age_ms\":");
+  payload += g_command_gate.max_age();
+  const CommandGateStats tw = g_twist_gate.stats();
+  payload += F(",\"twist_accepted\":");
+  payload += tw.accepted;
+  payload += F(",\"twist_stale\":");
+  payload += tw.stale;
+  payload += F(",\"twist_reordered\":");
+  payload += tw.reordered;
+  payload += F(",\"twist_unsequenced\":");
+  payload += tw.unsequenced;
+  payload += F("}");
+
+  return enqueue_text(OUTBOUND_DEBUG, g_cmd_stats_topic, payload, true);
+}
+
+// Final do pong: yaw|pitch|acao|status
+static String pong_tail(float yawDeg, float pitchDeg, const String& action, const char* status) {
+  String tail;
+  tail.reserve(action.length() + 24);
+  tail += String(yawDeg, 2);
+  tail += '|';
+  tail += String(pitchDeg, 2);
+  tail += '|';
+  tail += action;
+  tail += '|';
+  tail += status;
+  return tail;
+}
+
+static void handle_command_message(const uint8_t* payload, unsigned int length,
+                                   uint32_t received_us) {
+  ParsedCommand cmd;
+  CommandSequence sequence;
+  if (!parse_command(payload, length, cmd) || !parse_command_sequence(cmd, sequence)) {
+    LOG_W(MQTT, "[MQTT] Payload inválido (esperado: yaw|pitch|nonce|timestamp[|seq[|idade]]).");
+    return;
+  }
+  if (++g_next_trace_id == 0) {
+    g_next_trace_id = 1;
+  }
+  const CommandStamp stamp = {g_next_trace_id, received_us, hal_micros()};
+  const float yawDeg = cmd.yaw_deg;
+  const float pitchDeg = cmd.pitch_deg;
+
+  // nonce e timestamp são vizinhos no payload: um só texto "nonce|t0"
+  const size_t ids_length = cmd.timestamp.data + cmd.timestamp.length - cmd.nonce.data;
+  LOG_I(MQTT, "[MQTT] Yaw recebido: %.2f° | Pitch: %.2f° | nonce|t0=%s", yawDeg, pitchDeg,
+        log_text(cmd.nonce.data, ids_length));
+
+  String head;
+  head.reserve(cmd.nonce.length + cmd.timestamp.length + 1);
+  append_view(head, cmd.nonce);
+  head += '|';
+  append_view(head, cmd.timestamp);
+  CommandTrace trace = {stamp.id, stamp.received_us, stamp.parsed_us, 0, 0, 0};
+
+  // Fora de ordem ou velho: não mexe no robô, o pong diz o motivo
+  const CommandVerdict verdict = g_command_gate.check(sequence, hal_millis());
+  if (verdict != CMD_ACCEPTED) {
+    LOG_W(MQTT, "[MQTT] Comando seq %lu recusado: %s (idade %lu ms)",
+          static_cast<unsigned long>(sequence.seq), command_verdict_name(verdict),
+          static_cast<unsigned long>(g_command_gate.stats().age_ms_last));
+    publish_pong(head.c_str(), pong_tail(yawDeg, pitchDeg, F("noop"),
+                                         command_verdict_name(verdict)).c_str(),
+                 trace);
+    return;
+  }
+
+  String executedCommand;
+  bool success = execute_head_command(yawDeg, pitchDeg, stamp, executedCommand);
+  if (!success && executedCommand.length() == 0) {
+    executedCommand = F("noop");
+  }
+  LOG_I(MQTT, success ? "[MQTT] Ação derivada: %s | sucesso=sim"
+                      : "[MQTT] Ação derivada: %s | sucesso=não",
+        executedCommand.c_str());
+
+  // O pong sai já: quem mede a ida e volta não espera o robô mexer (um
+  // comando que não muda a velocidade nunca teria movimento). As etapas da
+  // tarefa de controle seguem depois, no tópico de rastreio
+  const String tail = pong_tail(yawDeg, pitchDeg, executedCommand, success ? "ok" : "error");
+  publish_pong(head.c_str(), tail.c_str(), trace);
+  if (success) {
+    defer_trace(head, tail, trace);
+  }
+}
+
+static bool execute_head_command(float yawDeg,
+                                 float pitchDeg,
+                                 const CommandStamp& stamp,
+                                 String& executedCommand) {
+  return g_command_mode == REMOTE_TWIST
+             ? execute_twist_command(yawDeg, pitchDeg, stamp, executedCommand)
+             : execute_motion_command(yawDeg, pitchDeg, stamp, executedCommand);
+}
+
+bool net_execute_head_command(float yawDeg, float pitchDeg, String& executedCommand) {
+  return execute_head_command(yawDeg, pitchDeg, CommandStamp(), executedCommand);
 }
 
 static bool execute_motion_command(float yawDeg,
                                    float pitchDeg,
+                                   const CommandStamp& stamp,
                                    String& executedCommand) {
   static const float yawDeadbandLeft = 8.0f;
   static const float yawDeadbandRight = 8.0f;
@@ -421,79 +1117,216 @@ static bool execute_motion_command(float yawDeg,
   static const float pitchReverseThreshold = 10.0f;
 
   const bool pitchValid = !isnan(pitchDeg);
+  MotionCommand command = MOTION_STOP;
   if (pitchValid && pitchDeg <= pitchForwardThreshold) {
-    set_remote_motion_command(MOTION_FORWARD);
+    command = MOTION_FORWARD;
     executedCommand = F("forward");
-    return true;
+  } else if (pitchValid && pitchDeg >= pitchReverseThreshold) {
+    command = MOTION_REVERSE;
+    executedCommand = F("reverse");
+  } else if (isnan(yawDeg)) {
+    executedCommand = F("stop");
+    LOG_W(MQTT, "[MQTT] Yaw inválido -> Stop");
+  } else if (yawDeg <= -yawDeadbandLeft) {
+    command = MOTION_TURN_LEFT;
+    executedCommand = F("left");
+  } else if (yawDeg >= yawDeadbandRight) {
+    command = MOTION_TURN_RIGHT;
+    executedCommand = F("right");
+  } else {
+    executedCommand = F("stop");
   }
+  // Fila cheia (política FIFO): o pong sai com "error"
+  return set_remote_motion_command(command, stamp);
+}
 
-  if (pitchValid && pitchDeg >= pitchReverseThreshold) {
-    set_remote_motion_command(MOTION_REVERSE);
-    executedCommand = F("reverse");
-    return true;
+// Fração da deflexão entre a zona morta e o fim de curso, com sinal (-1..1)
+static float deflection(float angleDeg, float deadbandDeg, float fullDeg) {
+  if (isnan(angleDeg)) {
+    return 0.0f;
+  }
+  float magnitude = (fabsf(angleDeg) - deadbandDeg) / (fullDeg - deadbandDeg);
+  if (magnitude <= 0.0f) {
+    return 0.0f;
+  }
+  if (magnitude > 1.0f) {
+    magnitude = 1.0f;
   }
+  return angleDeg < 0.0f ? -magnitude : magnitude;
+}
 
-  if (isnan(yawDeg)) {
-    set_remote_motion_command(MOTION_STOP);
-    executedCommand = F("stop");
-    Serial.println(F("[MQTT] Yaw inválido -> Stop"));
-    return true;
+static bool execute_twist_command(float yawDeg,
+                                  float pitchDeg,
+                                  const CommandStamp& stamp,
+                                  String& executedCommand) {
+  // Mesmas zonas mortas do modo discreto; no fim de curso, as velocidades
+  // dos comandos discretos (frente e giro)
+  static const float yawDeadband = 8.0f;
+  static const float yawFull = 30.0f;
+  static const float pitchDeadband = 10.0f;
+  static const float pitchFull = 30.0f;
+
+  const Twist forward = motion_command_twist(MOTION_FORWARD);
+  const Twist left = motion_command_twist(MOTION_TURN_LEFT);
+  Twist twist;
+  // pitch negativo é frente; yaw negativo gira como MOTION_TURN_LEFT
+  twist.v_mps = -deflection(pitchDeg, pitchDeadband, pitchFull) * forward.v_mps;
+  twist.w_radps = -deflection(yawDeg, yawDeadband, yawFull) * left.w_radps;
+  executedCommand = F("twist(");
+  executedCommand += String(twist.v_mps, 3);
+  executedCommand += ',';
+  executedCommand += String(twist.w_radps, 3);
+  executedCommand += ')';
+  return set_remote_twist(twist, stamp);
+}
+
+static void handle_twist_message(const uint8_t* payload, unsigned int length,
+                                 uint32_t received_us) {
+  ParsedTwist parsed;
+  if (!parse_twist(payload, length, parsed)) {
+    LOG_W(MQTT, "[MQTT] Twist inválido (esperado: v|w[|seq|t0[|idade]]).");
+    return;
+  }
+  Twist twist;
+  twist.v_mps = parsed.v_mps;
+  twist.w_radps = parsed.w_radps;
+  const CommandVerdict verdict = g_twist_gate.check(parsed.sequence, hal_millis());
+  // Sem seq não há cabeça para o pong: só enfileira, como antes
+  if (!parsed.sequence.has_seq) {
+    set_remote_twist(twist);
+    return;
   }
 
-  if (yawDeg <= -yawDeadbandLeft) {
-    set_remote_motion_command(MOTION_TURN_LEFT);
-    executedCommand = F("left");
-    return true;
+  if (++g_next_trace_id == 0) {
+    g_next_trace_id = 1;
   }
-  if (yawDeg >= yawDeadbandRight) {
-    set_remote_motion_command(MOTION_TURN_RIGHT);
-    executedCommand = F("right");
-    return true;
+  const CommandStamp stamp = {g_next_trace_id, received_us, hal_micros()};
+  String head;
+  append_view(head, parsed.head);
+  CommandTrace trace = {stamp.id, stamp.received_us, stamp.parsed_us, 0, 0, 0};
+
+  // Mesmo tratamento do comando de cabeça: recusado não mexe no robô
+  if (verdict != CMD_ACCEPTED) {
+    LOG_W(MQTT, "[MQTT] Twist seq %lu recusado: %s (idade %lu ms)",
+          static_cast<unsigned long>(parsed.sequence.seq), command_verdict_name(verdict),
+          static_cast<unsigned long>(g_twist_gate.stats().age_ms_last));
+    publish_pong(head.c_str(), pong_tail(twist.v_mps, twist.w_radps, F("noop"),
+                                         command_verdict_name(verdict)).c_str(),
+                 trace);
+    return;
   }
 
-  set_remote_motion_command(MOTION_STOP);
-  executedCommand = F("stop");
-  return true;
+  const bool success = set_remote_twist(twist, stamp);
+  String action = F("twist(");
+  action += String(twist.v_mps, 3);
+  action += ',';
+  action += String(twist.w_radps, 3);
+  action += ')';
+  const String tail = pong_tail(twist.v_mps, twist.w_radps, action, success ? "ok" : "error");
+  publish_pong(head.c_str(), tail.c_str(), trace);
+  if (success) {
+    defer_trace(head, tail, trace);
+  }
 }
 
-static void publish_pong(const String& nonce,
-                         const String& timestamp,
-                         unsigned long executed_at,
-                         float yawDeg,
-                         float pitchDeg,
-                         const String& executedCommand,
-                         bool success) {
+static void append_view(String& out, const TextView& view) {
+  for (size_t i = 0; i < view.length; ++i) {
+    out += view.data[i];
+  }
+}
+
+static void publish_pong(const char* head, const char* tail, const CommandTrace& trace) {
   if (!g_pub_topic || !*g_pub_topic) {
-    Serial.println(F("[MQTT] Tópico de pong não configurado."));
+    LOG_W(MQTT, "[MQTT] Tópico de pong não configurado.");
     return;
   }
+  publish_reply(g_pub_topic, head, tail, trace);
+}
 
-  String payload = nonce;
-  payload += '|';
-  payload += timestamp;
+// Pong e rastreio têm o mesmo formato; só o rastreio chega com as etapas da
+// tarefa de controle preenchidas
+static void publish_reply(const char* topic, const char* head, const char* tail,
+                          const CommandTrace& trace) {
+  // executed_at (ms) é o instante em que a ponte H foi escrita; sem ele,
+  // o do envio
+  unsigned long executed_at = hal_millis();
+  if (trace.applied_us) {
+    executed_at -= (hal_micros() - trace.applied_us) / 1000UL;
+  }
+
+  String payload;
+  payload.reserve(strlen(head) + strlen(tail) + 72);
+  payload += head;
   payload += '|';
   payload += String(executed_at);
   payload += '|';
-  payload += String(yawDeg, 2);
-  payload += '|';
-  payload += String(pitchDeg, 2);
-  payload += '|';
-  payload += executedCommand;
-  payload += '|';
-  payload += (success ? F("ok") : F("error"));
+  payload += tail;
+  const uint32_t stamps[] = {trace.received_us, trace.parsed_us, trace.dequeued_us,
+                             trace.applied_us, trace.motion_us};
+  for (uint32_t stamp : stamps) {
+    payload += '|';
+    payload += String(stamp);
+  }
 
-  if (!g_mqtt_client.connected()) {
-    Serial.println(F("[MQTT] Não conectado – não é possível enviar pong."));
+  if (!hal_mqtt_connected()) {
+    LOG_W(MQTT, "[MQTT] Não conectado – não é possível enviar %s.", topic);
     return;
   }
 
-  bool published = g_mqtt_client.publish(g_pub_topic, payload.c_str());
-  if (published) {
-    Serial.print(F("[MQTT] Pong publicado em "));
-    Serial.print(g_pub_topic);
-    Serial.print(F(" | payload="));
-    Serial.println(payload);
+  // Classe mais alta da fila: sai na próxima drenagem, antes da telemetria
+  bool queued = enqueue_text(OUTBOUND_ACK, topic, payload, false);
+  if (queued) {
+    LOG_D(MQTT, "[MQTT] Na fila (%s): %s", topic, payload.c_str());
   } else {
-    Serial.println(F("[MQTT] Falha ao publicar pong."));
+    LOG_E(MQTT, "[MQTT] Falha ao publicar em %s.", topic);
+  }
+}
+
+static void defer_trace(const String& head, const String& tail, const CommandTrace& trace) {
+  if (!g_trace_topic || !*g_trace_topic) {
+    return;   // rastreio desligado
+  }
+  if (head.length() >= PONG_TEXT_MAX || tail.length() >= PONG_TEXT_MAX) {
+    publish_reply(g_trace_topic, head.c_str(), tail.c_str(), trace);  // não cabe: sai sem esperar
+    return;
+  }
+  // Slot livre ou, com todos ocupados, o mais antigo sai como está
+  PendingTrace* slot = nullptr;
+  for (PendingTrace& p : g_pending_traces) {
+    if (p.trace.id == 0) {
+      slot = &p;
+      break;
+    }
+    if (!slot || static_cast<int32_t>(p.created_ms - slot->created_ms) < 0) {
+      slot = &p;
+    }
+  }
+  if (slot->trace.id != 0) {
+    publish_reply(g_trace_topic, slot->head, slot->tail, slot->trace);
+  }
+  slot->created_ms = hal_millis();
+  memcpy(slot->head, head.c_str(), head.length() + 1);
+  memcpy(slot->tail, tail.c_str(), tail.length() + 1);
+  slot->trace = trace;
+}
+
+static void poll_pending_traces() {
+  CommandTrace trace;
+  while (command_trace_pop(trace)) {
+    for (PendingTrace& p : g_pending_traces) {
+      if (p.trace.id == trace.id) {
+        publish_reply(g_trace_topic, p.head, p.tail, trace);
+        p.trace.id = 0;
+        break;
+      }
+    }
+  }
+  // Substituídos na fila nunca voltam da tarefa de controle
+  const uint32_t now = hal_millis();
+  for (PendingTrace& p : g_pending_traces) {
+    if (p.trace.id != 0 && (now - p.created_ms) > TRACE_REPLY_TIMEOUT_MS) {
+      publish_reply(g_trace_topic, p.head, p.tail, p.trace);
+      p.trace.id = 0;
+    }
   }
 }
@@ -1,9 +1,22 @@
 #pragma once
 #include <Arduino.h>
 
+#include "command_gate.h"
+#include "outbound_queue.h"
+#include "telemetry_codec.h"
+
+struct ControlTimingStats;
+struct LoopProfile;
+
+// Como o comando "yaw|pitch|nonce|timestamp" vira movimento
+enum RemoteCommandMode {
+  REMOTE_DISCRETE = 0,  // limiares -> frente/ré/esquerda/direita/stop
+  REMOTE_TWIST,         // proporcional: pitch -> v, yaw -> w (contínuo)
+};
+
 // Inicialização e loop do módulo de comunicação
-void net_mqtt_begin();     // Conecta WiFi, configura TLS/MQTT e prepara callback
-void net_mqtt_loop();      // Mantém conexões (chame em loop())
+void net_mqtt_begin();     // Configura TLS/MQTT e inicia a conexão (não bloqueia)
+void net_mqtt_loop();      // Avança a conexão e processa mensagens (não bloqueia)
 
 // --------- Setters (opcionais) ---------
 // Se não usar, valores padrão do .cpp serão utilizados.
@@ -13,22 +26,120 @@ void net_set_broker(const char* host, int port,
                     bool insecureTLS);
 // Define o tópico de subscribe (ex.: "facemesh/offset")
 void net_set_topic(const char* topic);
-// Define o tópico padrão para respostas (pong)
+// Define o tópico de twist direto em m/s e rad/s (ex.: "robot/cmd_vel"):
+// "v|w|seq|t0[|max_age_ms]" passa pelo aceite com sequência (abaixo, num
+// gate próprio: outro remetente, outra contagem de seq) e ganha pong com
+// cabeça "seq|t0"; "v|w" puro passa direto, sem pong, como unsequenced
+void net_set_twist_topic(const char* topic);
+// Mapeamento do comando de cabeça (padrão REMOTE_DISCRETE; REMOTE_TWIST
+// liga o proporcional)
+void net_set_command_mode(RemoteCommandMode mode);
+// Mapeia yaw/pitch (graus) no modo atual e enfileira, sem rastreio nem
+// pong: o mesmo caminho do callback depois do parse (usado na bancada)
+bool net_execute_head_command(float yawDeg, float pitchDeg, String& executedCommand);
+// Define o tópico padrão para respostas (pong), publicadas assim que o
+// comando é aceito ou recusado:
+// nonce|timestamp|executed_at|yaw|pitch|acao|status|recebido|interpretado|
+// retirado|aplicado|movimento — status ok, error, stale ou reordered; os
+// cinco últimos em µs (command_trace.h), 0 nas etapas que ainda não houve
 void net_set_pub_topic(const char* topic);
+// Tópico do rastreio completo de cada comando aceito, no formato do pong e
+// depois dele: quando a tarefa de controle vê o movimento, quando um comando
+// mais novo é retirado ou em até 1,5 s. Padrão: facemesh/pong/trace; ""
+// desliga.
+void net_set_trace_topic(const char* topic);
 // Define o tópico usado para publicar odometria
 void net_set_odom_topic(const char* topic);
 // Define o tópico de debug de odometria (dados brutos)
 void net_set_odom_debug_topic(const char* topic);
+// Formato de cada tópico de odometria: TELEMETRY_JSON (padrão),
+// TELEMETRY_BINARY (quadro fixo) ou, só no de odometria, TELEMETRY_BATCH
+// (lote delta/varint que já inclui o debug). Ver telemetry_codec.h.
+void net_set_odom_format(TelemetryFormat format);
+void net_set_odom_debug_format(TelemetryFormat format);
+// Intervalo mínimo entre publicações nos formatos por amostra (JSON/binário)
+void net_set_telemetry_period(uint32_t period_ms);
+// Lote: publica a cada `samples` amostras ou quando o mais antigo fizer
+// max_age_ms, o que vier primeiro
+void net_set_telemetry_batch(uint8_t samples, uint32_t max_age_ms);
+// Tópico das amostras guardadas na flash com o broker fora (odometry_store.h),
+// reenviadas em lotes sem debug com seq/t_ms originais; "" desliga o
+// armazenamento. Padrão: robot/odometry/backfill, 20 amostras a cada 200 ms.
+void net_set_backfill_topic(const char* topic);
+void net_set_backfill_rate(uint8_t samples, uint32_t period_ms);
+// Define o tópico das estatísticas de período/jitter do laço de controle
+void net_set_timing_topic(const char* topic);
+void net_set_profile_topic(const char* topic);   // perfil por etapa (loop_profiler.h)
+void net_set_session_topic(const char* topic);   // gravação de sessão (session_record.h)
+// Define o tópico das estatísticas de conexão (reconexões, tempo offline...)
+void net_set_net_stats_topic(const char* topic);
+// Aceite dos comandos com sequência "yaw|pitch|nonce|t0|seq[|max_age_ms]"
+// (command_gate.h): fora de ordem ou mais atrasado que max_age_ms (padrão
+// 250; 0 desliga a idade) vira pong com status "reordered" ou "stale", sem
+// mexer no robô. Contadores a cada 5 s em robot/cmd/stats (os do twist
+// direto com prefixo twist_). max_age_ms vale para os dois gates.
+void net_set_command_max_age(uint32_t max_age_ms);
+void net_set_command_stats_topic(const char* topic);
+CommandGateStats net_command_gate_stats();
+CommandGateStats net_twist_gate_stats();
+
+// Frota: vários robôs no mesmo broker (topic_namespace.h). Os tópicos acima
+// são modelos: "{id}" vira o id do robô. Com a raiz da frota (padrão "",
+// desligado), todo modelo sem "{id}" vira "<raiz>/<id>/<tópico>", e os de
+// comando e twist também são ouvidos em "<raiz>/<grupo>/<tópico>" (difusão
+// para todos). As strings precisam viver enquanto forem usadas.
+// Id nullptr/"" = MAC do robô (12 dígitos hex); false se inválido.
+bool net_set_robot_id(const char* id);
+bool net_set_fleet(const char* root, const char* group);
+const char* net_robot_id();
+
+// Fila de saída (outbound_queue.h): pong, depois pose, depois debug e
+// estatísticas, drenada por net_mqtt_loop. Orçamento de bytes de cada classe
+// (padrão 1/3/4 KiB; soma <= OUTBOUND_POOL_BYTES, false se não couber).
+// Desligada, cada mensagem vai direto ao socket como antes (para comparar).
+bool net_set_outbound_budget(uint16_t ack_bytes, uint16_t pose_bytes, uint16_t debug_bytes);
+void net_set_outbound_queue(bool enabled);
+OutboundClassStats net_outbound_stats(OutboundClass cls);
 
 // (Opcional) definir Root CA (PEM) para validação TLS.
 // Se definido E insecureTLS=false em net_set_broker, usará setCACert(rootCA).
 void net_set_root_ca(const char* root_ca_pem);
 
-// (Opcional) publicar algo, caso integre com outros módulos depois.
+// (Opcional) publicar algo, caso integre com outros módulos depois. Vai
+// direto ao socket, fora da fila de saída.
 bool net_mqtt_publish(const char* topic, const char* payload);
+bool net_mqtt_publish_bytes(const char* topic, const uint8_t* payload, size_t length);
 
-// Publica pose estimada {x, y, phi}
-bool net_publish_odometry(float x, float y, float phi);
+// Publica pose estimada {x, y, phi} no formato do tópico
+bool net_publish_odometry(const OdometrySample& sample);
 // (Opcional) publica contagens e velocidades medidas
-bool net_publish_odometry_debug(int16_t contagemR, int16_t contagemL,
-                                float velR, float velL, unsigned long dt_ms);
+bool net_publish_odometry_debug(const OdometrySample& sample);
+// Telemetria de odometria (contexto de rede): entrega cada amostra do laço de
+// controle e depois chama net_telemetry_poll(), que publica conforme o
+// formato e a taxa configurados — independente da frequência do controle.
+void net_telemetry_add_sample(const OdometrySample& sample, bool with_debug);
+void net_telemetry_poll();
+
+struct TelemetryStats {
+  uint32_t samples;           // amostras recebidas do controle
+  uint32_t messages;          // publicações aceitas (na fila de saída)
+  uint32_t failed;            // publicações recusadas (offline ou contrapressão)
+  uint32_t stored;            // amostras guardadas na flash (offline)
+  uint32_t backfilled;        // amostras reenviadas da flash
+  uint32_t raw_bytes;         // as mesmas amostras em quadros binários individuais
+  uint32_t sent_bytes;        // payload efetivamente publicado
+  uint32_t publish_us_max;    // codificação + entrada na fila de uma mensagem
+  uint32_t publish_us_total;
+};
+TelemetryStats net_telemetry_stats();
+
+// Publica período/jitter medidos da tarefa de controle
+bool net_publish_control_timing(const ControlTimingStats& stats);
+// Publica a janela do perfil por etapa (loop_profiler.h)
+bool net_publish_loop_profile(const LoopProfile& profile);
+// Publica um pedaço da gravação de sessão (false offline: tentar de novo)
+bool net_publish_session_chunk(const uint8_t* chunk, size_t length);
+// Publica as estatísticas de conexão a cada 5 s (chamado por net_mqtt_loop)
+bool net_publish_connection_stats();
+// Publica os contadores do aceite de comandos a cada 5 s (idem)
+bool net_publish_command_stats();
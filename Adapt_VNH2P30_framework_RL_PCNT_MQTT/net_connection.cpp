@@ -0,0 +1,204 @@
+#include "net_connection.h"
+
+#include <stdio.h>
+
+#include "async_log.h"
+#include "hal.h"
+
+static ConnConfig g_config;
+static ConnEventHandler g_handler = nullptr;
+
+static ConnState g_state = CONN_IDLE;
+static uint32_t g_state_since_ms = 0;
+static uint32_t g_offline_since_ms = 0;
+static uint32_t g_consecutive_failures = 0;
+static char g_client_id[48];
+
+static ConnStats g_stats = {};
+
+ConnConfig conn_default_config() {
+  ConnConfig config;
+  config.wifi_ssid = nullptr;
+  config.wifi_pass = nullptr;
+  config.mqtt_user = nullptr;
+  config.mqtt_pass = nullptr;
+  config.client_id_prefix = "ESP32Client-";
+  config.wifi_timeout_ms = 15000;
+  config.backoff_min_ms = 500;
+  config.backoff_max_ms = 30000;
+  return config;
+}
+
+const char* conn_state_name(ConnState state) {
+  switch (state) {
+    case CONN_IDLE:            return "idle";
+    case CONN_WIFI_CONNECTING: return "wifi_connecting";
+    case CONN_WIFI_BACKOFF:    return "wifi_backoff";
+    case CONN_MQTT_CONNECTING: return "mqtt_connecting";
+    case CONN_MQTT_BACKOFF:    return "mqtt_backoff";
+    case CONN_ONLINE:          return "online";
+  }
+  return "?";
+}
+
+static void enter_state(ConnState state, uint32_t now) {
+  g_state = state;
+  g_state_since_ms = now;
+}
+
+// Espera exponencial com "equal jitter": metade fixa + metade aleatória.
+static uint32_t next_backoff_ms() {
+  uint32_t cap = g_config.backoff_min_ms;
+  for (uint32_t i = 1; i < g_consecutive_failures && cap < g_config.backoff_max_ms; ++i) {
+    cap *= 2;
+  }
+  if (cap > g_config.backoff_max_ms) {
+    cap = g_config.backoff_max_ms;
+  }
+  uint32_t half = cap / 2;
+  return half + (half ? hal_random32() % (half + 1) : 0);
+}
+
+static void fail_attempt(int32_t error, ConnState backoff_state, uint32_t now) {
+  g_stats.failed_attempts++;
+  g_stats.last_error = error;
+  g_consecutive_failures++;
+  g_stats.backoff_ms = next_backoff_ms();
+  enter_state(backoff_state, now);
+
+  LOG_W(NET, backoff_state == CONN_WIFI_BACKOFF
+                 ? "[NET] Wi-Fi falhou, rc=%d — nova tentativa em %u ms"
+                 : "[NET] MQTT falhou, rc=%d — nova tentativa em %u ms",
+        static_cast<int>(error), static_cast<unsigned>(g_stats.backoff_ms));
+}
+
+static void start_wifi(uint32_t now) {
+  hal_wifi_begin(g_config.wifi_ssid, g_config.wifi_pass);
+  enter_state(CONN_WIFI_CONNECTING, now);
+}
+
+static void start_mqtt_attempt(uint32_t now) {
+  snprintf(g_client_id, sizeof(g_client_id), "%s%08lx",
+           g_config.client_id_prefix ? g_config.client_id_prefix : "",
+           static_cast<unsigned long>(hal_random32()));
+  if (!hal_mqtt_connect_start(g_client_id, g_config.mqtt_user, g_config.mqtt_pass)) {
+    fail_attempt(CONN_ERR_START_FAILED, CONN_MQTT_BACKOFF, now);
+    return;
+  }
+  enter_state(CONN_MQTT_CONNECTING, now);
+}
+
+static void go_online(uint32_t now) {
+  if (g_stats.mqtt_connects > 0) {
+    g_stats.reconnects++;
+  }
+  g_stats.mqtt_connects++;
+  g_stats.disconnected_ms += now - g_offline_since_ms;
+  g_stats.last_error = CONN_ERR_NONE;
+  g_consecutive_failures = 0;
+  enter_state(CONN_ONLINE, now);
+  if (g_handler) {
+    g_handler(CONN_EVENT_ONLINE);
+  }
+}
+
+static void go_offline(uint32_t now) {
+  bool wifi_up = hal_wifi_connected();
+  g_stats.disconnects++;
+  g_stats.last_error = wifi_up ? hal_mqtt_state() : CONN_ERR_WIFI_LOST;
+  g_offline_since_ms = now;
+  // Primeira tentativa após uma queda também espera (jitter evita avalanche)
+  g_consecutive_failures = 1;
+  g_stats.backoff_ms = next_backoff_ms();
+  enter_state(wifi_up ? CONN_MQTT_BACKOFF : CONN_WIFI_CONNECTING, now);
+  if (g_handler) {
+    g_handler(CONN_EVENT_OFFLINE);
+  }
+}
+
+void conn_begin(const ConnConfig& config, ConnEventHandler handler) {
+  g_config = config;
+  g_handler = handler;
+  g_stats = ConnStats();
+  g_consecutive_failures = 0;
+
+  uint32_t now = hal_millis();
+  g_offline_since_ms = now;
+  start_wifi(now);
+}
+
+void conn_poll() {
+  uint32_t t0 = hal_micros();
+  uint32_t now = hal_millis();
+  uint32_t elapsed = now - g_state_since_ms;
+
+  switch (g_state) {
+    case CONN_IDLE:
+      break;
+
+    case CONN_WIFI_CONNECTING:
+      if (hal_wifi_connected()) {
+        g_stats.wifi_connects++;
+        LOG_I(NET, "[NET] Wi-Fi conectado, IP: %s", hal_wifi_local_ip());
+        start_mqtt_attempt(now);
+      } else if (elapsed >= g_config.wifi_timeout_ms) {
+        hal_wifi_disconnect();
+        fail_attempt(CONN_ERR_WIFI_TIMEOUT, CONN_WIFI_BACKOFF, now);
+      }
+      break;
+
+    case CONN_WIFI_BACKOFF:
+      if (elapsed >= g_stats.backoff_ms) {
+        start_wifi(now);
+      }
+      break;
+
+    case CONN_MQTT_CONNECTING: {
+      HalConnectStatus status = hal_mqtt_connect_poll();
+      if (status == HAL_CONNECT_OK) {
+        go_online(now);
+      } else if (status == HAL_CONNECT_FAILED) {
+        fail_attempt(hal_wifi_connected() ? hal_mqtt_state() : CONN_ERR_WIFI_LOST,
+                     CONN_MQTT_BACKOFF, now);
+      }
+      break;
+    }
+
+    case CONN_MQTT_BACKOFF:
+      if (!hal_wifi_connected()) {
+        // O driver do ESP32 reassocia sozinho; o timeout de Wi-Fi cobre o resto
+        enter_state(CONN_WIFI_CONNECTING, now);
+      } else if (elapsed >= g_stats.backoff_ms) {
+        start_mqtt_attempt(now);
+      }
+      break;
+
+    case CONN_ONLINE:
+      if (!hal_mqtt_connected()) {
+        go_offline(now);
+      }
+      break;
+  }
+
+  uint32_t cost = hal_micros() - t0;
+  if (cost > g_stats.max_poll_us) {
+    g_stats.max_poll_us = cost;
+  }
+}
+
+bool conn_online() {
+  return g_state == CONN_ONLINE;
+}
+
+ConnState conn_state() {
+  return g_state;
+}
+
+ConnStats conn_stats() {
+  ConnStats stats = g_stats;
+  stats.state = g_state;
+  if (g_state != CONN_ONLINE) {
+    stats.disconnected_ms += hal_millis() - g_offline_since_ms;
+  }
+  return stats;
+}
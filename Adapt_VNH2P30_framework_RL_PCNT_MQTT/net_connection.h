@@ -0,0 +1,69 @@
+#ifndef NET_CONNECTION_H
+#define NET_CONNECTION_H
+
+#include <stdint.h>
+
+// Gerenciador de conexão Wi-Fi + MQTT orientado a eventos.
+//
+// conn_poll() só observa o estado do HAL e dispara transições; nenhuma delas
+// espera por rede (o connect MQTT roda fora do chamador, ver
+// hal_mqtt_connect_start), então cada chamada custa poucos microssegundos.
+// Falhas seguidas aumentam o intervalo entre tentativas exponencialmente,
+// com jitter aleatório para robôs não reconectarem todos ao mesmo tempo.
+
+enum ConnState {
+  CONN_IDLE = 0,
+  CONN_WIFI_CONNECTING,
+  CONN_WIFI_BACKOFF,
+  CONN_MQTT_CONNECTING,
+  CONN_MQTT_BACKOFF,
+  CONN_ONLINE,
+};
+
+enum ConnEvent {
+  CONN_EVENT_ONLINE = 0,   // sessão MQTT estabelecida (refazer subscribes)
+  CONN_EVENT_OFFLINE,      // sessão perdida
+};
+
+// last_error: códigos do PubSubClient (hal_mqtt_state) ou os abaixo.
+#define CONN_ERR_NONE          0
+#define CONN_ERR_WIFI_TIMEOUT  -100
+#define CONN_ERR_WIFI_LOST     -101
+#define CONN_ERR_START_FAILED  -102
+
+struct ConnConfig {
+  const char* wifi_ssid;
+  const char* wifi_pass;
+  const char* mqtt_user;
+  const char* mqtt_pass;
+  const char* client_id_prefix;  // id final: prefixo + 8 dígitos hex aleatórios
+  uint32_t wifi_timeout_ms;      // associação Wi-Fi sem sucesso -> backoff
+  uint32_t backoff_min_ms;
+  uint32_t backoff_max_ms;
+};
+
+struct ConnStats {
+  ConnState state;
+  uint32_t wifi_connects;        // associações Wi-Fi bem-sucedidas
+  uint32_t mqtt_connects;        // sessões MQTT estabelecidas
+  uint32_t reconnects;           // sessões após a primeira
+  uint32_t failed_attempts;
+  uint32_t disconnects;          // quedas de sessão já estabelecida
+  uint32_t disconnected_ms;      // tempo total offline (inclui a queda atual)
+  uint32_t backoff_ms;           // espera atual/última
+  int32_t last_error;
+  uint32_t max_poll_us;          // maior custo de um conn_poll()
+};
+
+typedef void (*ConnEventHandler)(ConnEvent event);
+
+ConnConfig conn_default_config();
+void conn_begin(const ConnConfig& config, ConnEventHandler handler);
+void conn_poll();
+
+bool conn_online();
+ConnState conn_state();
+ConnStats conn_stats();
+const char* conn_state_name(ConnState state);
+
+#endif
@@ -0,0 +1,327 @@
+#include "odometry_store.h"
+
+#include <string.h>
+
+#include "async_log.h"
+#include "hal.h"
+#include "telemetry_codec.h"
+
+static const uint32_t kSlots =
+    (HAL_FLASH_SECTOR_BYTES - ODOM_STORE_HEADER_BYTES) / ODOM_STORE_RECORD_BYTES;
+static const uint32_t kFrameOffset = 4;
+
+static_assert(TELEMETRY_ODOMETRY_FRAME_SIZE + kFrameOffset <= ODOM_STORE_RECORD_BYTES,
+              "quadro de odometria não cabe no registro");
+
+// Posição de um registro: setor e índice dentro dele (kSlots = fim do setor)
+struct StorePos {
+  uint32_t sector;
+  uint32_t slot;
+};
+
+static bool g_mounted = false;
+static const uint8_t* g_flash = nullptr;
+static uint32_t g_sectors = 0;
+static uint32_t g_seq = 0;          // seq do setor de escrita
+static StorePos g_write = {0, 0};   // próximo registro livre
+static StorePos g_read = {0, 0};    // próximo a reenviar
+static uint32_t g_erased = 0;       // setores já apagados logo depois do de escrita
+static OdometryStoreStats g_stats = {};
+
+static uint32_t get_u32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+  p[2] = static_cast<uint8_t>(v >> 16);
+  p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+// CRC-16/CCITT-FALSE (poli 0x1021, início 0xFFFF)
+static uint16_t crc16(const uint8_t* p, size_t n) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < n; ++i) {
+    crc ^= static_cast<uint16_t>(p[i]) << 8;
+    for (int b = 0; b < 8; ++b) {
+      crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021)
+                           : static_cast<uint16_t>(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static uint32_t sector_offset(uint32_t sector) {
+  return sector * HAL_FLASH_SECTOR_BYTES;
+}
+
+static uint32_t record_offset(const StorePos& pos) {
+  return sector_offset(pos.sector) + ODOM_STORE_HEADER_BYTES + pos.slot * ODOM_STORE_RECORD_BYTES;
+}
+
+static bool sector_valid(uint32_t sector) {
+  return get_u32(g_flash + sector_offset(sector)) == ODOM_STORE_MAGIC;
+}
+
+static uint32_t sector_seq(uint32_t sector) {
+  return get_u32(g_flash + sector_offset(sector) + 4);
+}
+
+static bool slot_empty(const StorePos& pos) {
+  const uint8_t* rec = g_flash + record_offset(pos);
+  for (uint32_t i = 0; i < ODOM_STORE_RECORD_BYTES; ++i) {
+    if (rec[i] != 0xFF) return false;
+  }
+  return true;
+}
+
+static void advance(StorePos& pos) {
+  if (++pos.slot >= kSlots) {
+    pos.slot = 0;
+    pos.sector = (pos.sector + 1) % g_sectors;
+  }
+}
+
+// Quadro do registro, ou false se a marca ou o CRC não batem
+static bool read_record(const StorePos& pos, OdometrySample& out) {
+  const uint8_t* rec = g_flash + record_offset(pos);
+  if (rec[0] != ODOM_STORE_MARK) return false;
+  const uint8_t* frame = rec + kFrameOffset;
+  const uint16_t crc = static_cast<uint16_t>(rec[2] | (rec[3] << 8));
+  if (crc != crc16(frame, TELEMETRY_ODOMETRY_FRAME_SIZE)) return false;
+  memset(&out, 0, sizeof(out));
+  return telemetry_decode_odometry(frame, TELEMETRY_ODOMETRY_FRAME_SIZE, out);
+}
+
+// Setor sem nenhuma amostra: só o contador de apagamentos pode estar gravado
+static bool sector_blank(uint32_t sector) {
+  const uint8_t* p = g_flash + sector_offset(sector);
+  for (uint32_t i = 0; i < HAL_FLASH_SECTOR_BYTES; ++i) {
+    if (p[i] != 0xFF && (i < 8 || i >= 12)) return false;
+  }
+  return true;
+}
+
+// Abre o próximo setor do rodízio, que já tem de estar apagado: aqui só se
+// grava o cabeçalho
+static bool open_next_sector() {
+  if (g_erased == 0) {
+    g_stats.skipped++;
+    return false;
+  }
+  const uint32_t sector = (g_write.sector + 1) % g_sectors;
+  const uint32_t erases = get_u32(g_flash + sector_offset(sector) + 8);
+  uint8_t header[12];
+  put_u32(header, ODOM_STORE_MAGIC);
+  put_u32(header + 4, g_seq + 1);
+  // Setor ainda de fábrica: nenhum apagamento nosso
+  put_u32(header + 8, erases == 0xFFFFFFFFUL ? 0 : erases);
+  g_erased--;
+  if (!hal_flash_write(sector_offset(sector), header, sizeof(header))) {
+    g_stats.failed++;
+    return false;
+  }
+  g_seq++;
+  g_write.sector = sector;
+  g_write.slot = 0;
+  if (g_stats.pending == 0) {
+    g_read = g_write;
+  }
+  return true;
+}
+
+bool odometry_store_erase_ahead(bool may_overwrite) {
+  if (!g_mounted || g_erased + 1 >= g_sectors) {
+    return false;
+  }
+  const uint32_t sector = (g_write.sector + 1 + g_erased) % g_sectors;
+  // Setor com amostras pendentes (partição cheia): só sem nenhum apagado à
+  // frente e com permissão; as amostras dele que ainda não saíram se perdem
+  if (g_stats.pending > 0 && g_read.sector == sector) {
+    if (g_erased > 0 || !may_overwrite) {
+      return false;
+    }
+    const uint32_t dropped = kSlots - g_read.slot;
+    g_stats.overwritten += dropped;
+    g_stats.pending -= dropped;
+    g_read.sector = (sector + 1) % g_sectors;
+    g_read.slot = 0;
+    if (g_stats.pending == 0) {
+      g_read = g_write;
+    }
+  }
+
+  // Contador de um setor válido ou só apagado; de fábrica, 0xFFFFFFFF
+  uint32_t erases = get_u32(g_flash + sector_offset(sector) + 8);
+  if (erases == 0xFFFFFFFFUL) erases = 0;
+  if (!hal_flash_erase_sector(sector)) {
+    g_stats.failed++;
+    return false;
+  }
+  g_stats.erases++;
+  // O contador vai logo; magic e seq só quando o setor for aberto
+  uint8_t count[4];
+  put_u32(count, erases + 1);
+  if (!hal_flash_write(sector_offset(sector) + 8, count, sizeof(count))) {
+    g_stats.failed++;
+    return false;
+  }
+  g_erased++;
+  return true;
+}
+
+bool odometry_store_begin() {
+  g_mounted = false;
+  memset(&g_stats, 0, sizeof(g_stats));
+  if (!hal_flash_begin()) {
+    return false;
+  }
+  g_flash = hal_flash_data();
+  g_sectors = hal_flash_size() / HAL_FLASH_SECTOR_BYTES;
+  if (!g_flash || g_sectors < 2) {
+    LOG_W(ODOM, "[ODOM] Partição odomlog pequena demais (%u setores).", g_sectors);
+    return false;
+  }
+
+  // Setor de escrita: o de maior seq. Sem nenhum válido, a primeira
+  // gravação abre o setor 0.
+  bool any = false;
+  uint32_t newest = 0;
+  for (uint32_t s = 0; s < g_sectors; ++s) {
+    if (sector_valid(s) && (!any || static_cast<int32_t>(sector_seq(s) - sector_seq(newest)) > 0)) {
+      newest = s;
+      any = true;
+    }
+  }
+  if (!any) {
+    g_seq = 0;
+    g_write.sector = g_sectors - 1;
+    g_write.slot = kSlots;
+    g_read.sector = 0;
+    g_read.slot = 0;
+  } else {
+    g_seq = sector_seq(newest);
+    g_write.sector = newest;
+    g_write.slot = 0;
+    while (g_write.slot < kSlots && !slot_empty(g_write)) g_write.slot++;
+
+    // Log do mais antigo ao mais novo: setores válidos depois do de escrita
+    // no rodízio. O reenvio continua depois do último registro enviado.
+    bool read_set = false;
+    uint32_t since_sent = 0;
+    for (uint32_t i = 1; i <= g_sectors; ++i) {
+      const uint32_t s = (newest + i) % g_sectors;
+      if (!sector_valid(s)) continue;
+      const uint32_t end = (s == newest) ? g_write.slot : kSlots;
+      for (StorePos pos = {s, 0}; pos.slot < end; ++pos.slot) {
+        if (!read_set) {
+          g_read = pos;
+          read_set = true;
+        }
+        since_sent++;
+        if (g_flash[record_offset(pos) + 1] == 0x00) {
+          g_read = pos;
+          advance(g_read);
+          since_sent = 0;
+        }
+      }
+    }
+    if (!read_set || since_sent == 0) {
+      g_read = g_write;
+      if (g_read.slot >= kSlots) {
+        g_read.slot = 0;
+        g_read.sector = (g_read.sector + 1) % g_sectors;
+      }
+    }
+    g_stats.pending = since_sent;
+  }
+
+  // Setores já apagados depois do de escrita (de fábrica ou pelo boot
+  // anterior): a escrita offline usa estes sem apagar nada
+  g_erased = 0;
+  while (g_erased + 1 < g_sectors && sector_blank((g_write.sector + 1 + g_erased) % g_sectors)) {
+    g_erased++;
+  }
+
+  g_stats.capacity = g_sectors * kSlots;
+  g_mounted = true;
+  LOG_I(ODOM, "[ODOM] odomlog: %u setores, %u amostras pendentes, %u setores apagados.",
+        g_sectors, g_stats.pending, g_erased);
+  return true;
+}
+
+bool odometry_store_append(const OdometrySample& sample) {
+  if (!g_mounted) {
+    return false;
+  }
+  if (g_write.slot >= kSlots && !open_next_sector()) {
+    return false;
+  }
+
+  uint8_t rec[ODOM_STORE_RECORD_BYTES];
+  memset(rec, 0xFF, sizeof(rec));
+  uint8_t* frame = rec + kFrameOffset;
+  telemetry_encode_odometry(sample, frame, TELEMETRY_ODOMETRY_FRAME_SIZE);
+  const uint16_t crc = crc16(frame, TELEMETRY_ODOMETRY_FRAME_SIZE);
+  rec[0] = ODOM_STORE_MARK;
+  rec[2] = static_cast<uint8_t>(crc);
+  rec[3] = static_cast<uint8_t>(crc >> 8);
+  const bool ok = hal_flash_write(record_offset(g_write), rec, sizeof(rec));
+  // Mesmo recusada, a posição é gasta: o registro pode ter ficado pela metade
+  g_write.slot++;
+  if (!ok) {
+    g_stats.failed++;
+    return false;
+  }
+  g_stats.pending++;
+  g_stats.stored++;
+  return true;
+}
+
+size_t odometry_store_peek(OdometrySample* out, size_t max) {
+  if (!g_mounted) {
+    return 0;
+  }
+  size_t n = 0;
+  StorePos pos = g_read;
+  for (uint32_t i = 0; i < g_stats.pending && n < max; ++i) {
+    if (read_record(pos, out[n])) {
+      n++;
+    }
+    advance(pos);
+  }
+  return n;
+}
+
+void odometry_store_consume(size_t n) {
+  if (!g_mounted || n == 0) {
+    return;
+  }
+  StorePos last = g_read;
+  while (n > 0 && g_stats.pending > 0) {
+    OdometrySample sample;
+    if (read_record(g_read, sample)) {
+      n--;
+      g_stats.forwarded++;
+    } else {
+      g_stats.corrupt++;
+    }
+    last = g_read;
+    advance(g_read);
+    g_stats.pending--;
+  }
+  // Um byte marca o lote inteiro: na partida o reenvio segue depois dele
+  const uint8_t sent = 0x00;
+  if (!hal_flash_write(record_offset(last) + 1, &sent, 1)) {
+    g_stats.failed++;
+  }
+}
+
+OdometryStoreStats odometry_store_stats() {
+  OdometryStoreStats stats = g_stats;
+  stats.mounted = g_mounted;
+  stats.erased_ahead = g_erased;
+  return stats;
+}
@@ -0,0 +1,83 @@
+#ifndef ODOMETRY_STORE_H
+#define ODOMETRY_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "motor_control.h"
+
+// Armazena e reenvia a odometria pela partição "odomlog" (hal_flash_*). Com
+// o broker fora, cada amostra vai para um log circular na flash. Quando a
+// conexão volta, a tarefa de rede reenvia as amostras em ordem, da mais
+// antiga para a mais nova, com o seq e o t_ms originais, num ritmo limitado
+// (net_set_backfill_*).
+//
+// Os setores de 4 KiB são usados em rodízio (0, 1, ..., N-1, 0, ...), então
+// todos são apagados o mesmo número de vezes. Cada setor tem um cabeçalho
+// de 32 bytes {magic, seq do setor, apagamentos} e 127 registros de 32
+// bytes:
+//   u8  marca (0xFF livre, ODOM_STORE_MARK gravado)
+//   u8  enviado (0x00: este e todos os anteriores já foram reenviados)
+//   u16 CRC-16/CCITT do quadro
+//   24  quadro binário de odometria (telemetry_codec.h: seq, t_ms, x, y, phi)
+//   4   reservados (0xFF)
+// Na partida, a varredura acha o setor de maior seq e, nele, o primeiro
+// registro livre, que é onde a escrita continua. O último registro marcado
+// como enviado diz de onde o reenvio continua. Por lote reenviado, só um
+// byte é escrito. Um registro com CRC errado (energia cortada no meio da
+// escrita) é pulado.
+//
+// Apagar um setor desliga o cache da flash nos dois cores por ~45 ms: as
+// tarefas que rodam da flash param e toda interrupção sem ESP_INTR_FLAG_IRAM
+// fica mascarada. Com o robô andando isso custa um período do laço de
+// controle (overrun em robot/control/timing) e, sem a flag, bordas do
+// encoder: a captura perderia bordas que o PCNT conta, o que desloca
+// capture_diff de vez e falseia a velocidade M/T do PID. Por isso a escrita
+// nunca apaga: ela só abre setores já apagados à frente dela
+// (odometry_store_erase_ahead), que a tarefa de rede prepara com o broker no
+// ar (quando nada é gravado) ou com o robô parado. Todo setor sem amostra
+// pendente fica apagado, então a rede pode ficar fora com o robô andando
+// quase a partição inteira (~6 min a 20 Hz); além disso a amostra nova é
+// descartada (skipped) até o robô parar. Parado e com a partição cheia, o
+// setor mais antigo é apagado e as amostras dele que ainda não saíram se
+// perdem (overwritten).
+//
+// Só a tarefa de rede chama estas funções.
+
+#define ODOM_STORE_MAGIC        0x314C474FUL   // "OGL1"
+#define ODOM_STORE_MARK         0xA5
+#define ODOM_STORE_HEADER_BYTES 32
+#define ODOM_STORE_RECORD_BYTES 32
+
+struct OdometryStoreStats {
+  bool mounted;           // partição encontrada e varrida
+  uint32_t capacity;      // registros na partição
+  uint32_t pending;       // registros ainda não reenviados (com os corrompidos)
+  uint32_t stored;        // desde o boot
+  uint32_t forwarded;
+  uint32_t overwritten;   // perdidos com a partição cheia
+  uint32_t corrupt;       // CRC errado, pulados no reenvio
+  uint32_t erases;        // setores apagados desde o boot
+  uint32_t erased_ahead;  // setores apagados prontos para a escrita
+  uint32_t skipped;       // amostras recusadas sem setor apagado à frente
+  uint32_t failed;        // escritas ou apagamentos recusados pela flash
+};
+
+// Monta a partição e retoma de onde o boot anterior parou; false sem ela
+// (as outras funções viram nada).
+bool odometry_store_begin();
+// Nunca apaga: false (skipped) se o setor atual acabou e não há outro
+// apagado à frente
+bool odometry_store_append(const OdometrySample& sample);
+// Apaga o próximo setor sem amostra pendente depois dos já apagados (um por
+// chamada, ~45 ms). may_overwrite: com a partição cheia e nenhum apagado à
+// frente, apaga o mais antigo mesmo pendente. Só com o broker no ar ou o
+// robô parado; false se não havia o que apagar.
+bool odometry_store_erase_ahead(bool may_overwrite);
+// Copia até max amostras pendentes, a partir da mais antiga, sem consumir
+size_t odometry_store_peek(OdometrySample* out, size_t max);
+// Marca como reenviadas as n primeiras pendentes (n <= o último peek)
+void odometry_store_consume(size_t n);
+OdometryStoreStats odometry_store_stats();
+
+#endif
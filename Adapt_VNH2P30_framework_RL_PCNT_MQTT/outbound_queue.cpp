@@ -0,0 +1,169 @@
+#include "outbound_queue.h"
+
+#include <string.h>
+
+static_assert(OUTBOUND_MAX_MESSAGES <= 255, "contagem de entradas em uint8_t");
+static_assert(OUTBOUND_POOL_BYTES <= 65535, "deslocamentos em uint16_t");
+
+// Pong é pequeno (~100 B); o lote de odometria chega a 1 KiB e o perfil do
+// laço a ~1,4 KiB
+static const uint16_t kDefaultBudget[OUTBOUND_CLASS_COUNT] = {1024, 3072, 4096};
+
+OutboundQueue::OutboundQueue() {
+  reset(kDefaultBudget);
+}
+
+bool OutboundQueue::reset(const uint16_t budget[OUTBOUND_CLASS_COUNT]) {
+  size_t total = 0;
+  for (int i = 0; i < OUTBOUND_CLASS_COUNT; ++i) {
+    total += budget[i];
+  }
+  if (total > OUTBOUND_POOL_BYTES) {
+    return false;
+  }
+  uint16_t offset = 0;
+  for (int i = 0; i < OUTBOUND_CLASS_COUNT; ++i) {
+    lanes_[i].buf = pool_ + offset;
+    lanes_[i].cap = budget[i];
+    offset += budget[i];
+  }
+  clear();
+  return true;
+}
+
+void OutboundQueue::clear() {
+  for (Lane& lane : lanes_) {
+    lane.head = 0;
+    lane.first = 0;
+    lane.count = 0;
+    memset(&lane.stats, 0, sizeof(lane.stats));
+  }
+  peeked_ = 0;
+  backpressure_ = false;
+}
+
+// Espaço contíguo para size bytes depois da escrita; a classe é um anel, e o
+// que não cabe no fim do pedaço recomeça do início (a sobra fica vazia)
+bool OutboundQueue::place(Lane& lane, uint16_t size, uint16_t& offset) const {
+  if (lane.count == 0) {
+    offset = 0;
+    return size <= lane.cap;
+  }
+  const uint16_t tail = lane.entries[lane.first].offset;
+  if (lane.head > tail) {
+    if (lane.cap - lane.head >= size) {
+      offset = lane.head;
+      return true;
+    }
+    offset = 0;
+    return tail >= size;
+  }
+  offset = lane.head;
+  return tail - lane.head >= size;   // head == tail: cheia
+}
+
+void OutboundQueue::drop_front(Lane& lane) {
+  Entry& e = lane.entries[lane.first];
+  if (e.live) {
+    lane.stats.dropped++;
+    lane.stats.pending--;
+    lane.stats.pending_bytes -= e.length;
+  }
+  lane.first = (lane.first + 1) % OUTBOUND_MAX_MESSAGES;
+  if (--lane.count == 0) {
+    lane.head = 0;
+  }
+}
+
+bool OutboundQueue::push(OutboundClass cls, const char* topic, const uint8_t* payload,
+                         size_t length, bool coalesce) {
+  if (cls < 0 || cls >= OUTBOUND_CLASS_COUNT) {
+    return false;
+  }
+  Lane& lane = lanes_[cls];
+  if (length > lane.cap || (backpressure_ && cls == OUTBOUND_CLASS_COUNT - 1)) {
+    lane.stats.dropped++;
+    return false;
+  }
+
+  if (coalesce) {
+    for (uint8_t i = 0; i < lane.count; ++i) {
+      Entry& e = lane.entries[(lane.first + i) % OUTBOUND_MAX_MESSAGES];
+      if (e.live && strcmp(e.topic, topic) == 0) {
+        e.live = false;
+        lane.stats.coalesced++;
+        lane.stats.pending--;
+        lane.stats.pending_bytes -= e.length;
+      }
+    }
+  }
+
+  // Payload vazio ocupa 1 byte: head == tail fica reservado para "cheia"
+  const uint16_t size = length ? static_cast<uint16_t>(length) : 1;
+  uint16_t offset = 0;
+  while (lane.count == OUTBOUND_MAX_MESSAGES || !place(lane, size, offset)) {
+    drop_front(lane);
+  }
+  memcpy(lane.buf + offset, payload, length);
+  Entry& e = lane.entries[(lane.first + lane.count) % OUTBOUND_MAX_MESSAGES];
+  e.topic = topic;
+  e.offset = offset;
+  e.length = static_cast<uint16_t>(length);
+  e.live = true;
+  lane.count++;
+  lane.head = offset + size;
+  lane.stats.queued++;
+  lane.stats.pending++;
+  lane.stats.pending_bytes += length;
+  return true;
+}
+
+bool OutboundQueue::peek(OutboundMessage& out) {
+  for (int i = 0; i < OUTBOUND_CLASS_COUNT; ++i) {
+    Lane& lane = lanes_[i];
+    while (lane.count > 0 && !lane.entries[lane.first].live) {
+      drop_front(lane);   // substituída: sai sem contar
+    }
+    if (lane.count == 0) {
+      continue;
+    }
+    const Entry& e = lane.entries[lane.first];
+    out.cls = static_cast<OutboundClass>(i);
+    out.topic = e.topic;
+    out.payload = lane.buf + e.offset;
+    out.length = e.length;
+    peeked_ = static_cast<uint8_t>(i);
+    return true;
+  }
+  return false;
+}
+
+void OutboundQueue::pop(bool sent) {
+  Lane& lane = lanes_[peeked_];
+  if (lane.count == 0) {
+    return;
+  }
+  Entry& e = lane.entries[lane.first];
+  if (e.live && sent) {
+    lane.stats.sent++;
+    lane.stats.pending--;
+    lane.stats.pending_bytes -= e.length;
+    e.live = false;
+  }
+  drop_front(lane);
+}
+
+uint32_t OutboundQueue::pending() const {
+  uint32_t n = 0;
+  for (const Lane& lane : lanes_) {
+    n += lane.stats.pending;
+  }
+  return n;
+}
+
+OutboundClassStats OutboundQueue::stats(OutboundClass cls) const {
+  if (cls < 0 || cls >= OUTBOUND_CLASS_COUNT) {
+    return OutboundClassStats();
+  }
+  return lanes_[cls].stats;
+}
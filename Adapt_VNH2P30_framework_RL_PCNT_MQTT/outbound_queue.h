@@ -0,0 +1,104 @@
+#ifndef OUTBOUND_QUEUE_H
+#define OUTBOUND_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fila de saída do MQTT com classes de prioridade.
+//
+// As publicações da tarefa de rede entram aqui e saem pela drenagem na mesma
+// tarefa (net_mqtt_loop), sempre da classe mais alta para a mais baixa: um
+// pong nunca espera atrás de telemetria. Cada classe tem o próprio orçamento
+// de bytes, e a classe cheia perde a própria mensagem mais antiga, nunca a
+// de outra classe.
+//
+// Mensagens que são retrato do estado (pose, debug, estatísticas) entram com
+// coalesce: a nova substitui a que ainda espera no mesmo tópico (a última
+// vence; conta em coalesced). Sob contrapressão (o socket não dá vazão), a
+// classe mais baixa é descartada já na entrada.
+//
+// Só a tarefa de rede usa a fila (sem locks). O tópico não é copiado: tem de
+// viver até a mensagem sair (os de mqtt_client são estáticos).
+
+enum OutboundClass {
+  OUTBOUND_ACK = 0,   // pong e rastreio dos comandos
+  OUTBOUND_POSE,      // odometria
+  OUTBOUND_DEBUG,     // odometria de debug e estatísticas
+  OUTBOUND_CLASS_COUNT,
+};
+
+#define OUTBOUND_POOL_BYTES   8192   // soma dos orçamentos das classes
+#define OUTBOUND_MAX_MESSAGES 16     // por classe
+
+struct OutboundClassStats {
+  uint32_t queued;       // aceitas por push()
+  uint32_t sent;
+  uint32_t coalesced;    // substituídas por uma mais nova no mesmo tópico
+  uint32_t dropped;      // sem espaço, sob contrapressão ou recusadas no envio
+  uint32_t pending;      // esperando agora
+  uint32_t pending_bytes;
+};
+
+// Próxima mensagem a sair; payload aponta para dentro da fila até o pop()
+struct OutboundMessage {
+  OutboundClass cls;
+  const char* topic;
+  const uint8_t* payload;
+  size_t length;
+};
+
+class OutboundQueue {
+ public:
+  OutboundQueue();
+
+  // Orçamento em bytes de cada classe (soma <= OUTBOUND_POOL_BYTES); esvazia
+  // a fila e zera os contadores. false (nada muda) se não couber.
+  bool reset(const uint16_t budget[OUTBOUND_CLASS_COUNT]);
+  // Esvazia e zera os contadores, com os mesmos orçamentos
+  void clear();
+
+  // false se a mensagem foi descartada (maior que o orçamento da classe ou
+  // classe mais baixa sob contrapressão)
+  bool push(OutboundClass cls, const char* topic, const uint8_t* payload, size_t length,
+            bool coalesce);
+
+  // Mensagem mais antiga da classe mais alta com alguma; false se vazia
+  bool peek(OutboundMessage& out);
+  // Tira a mensagem do último peek() (sem push() entre os dois); sent = false
+  // conta como descartada
+  void pop(bool sent);
+
+  void set_backpressure(bool on) { backpressure_ = on; }
+  bool backpressure() const { return backpressure_; }
+
+  uint32_t pending() const;
+  OutboundClassStats stats(OutboundClass cls) const;
+
+ private:
+  struct Entry {
+    const char* topic;
+    uint16_t offset;     // no pedaço do pool da classe
+    uint16_t length;
+    bool live;           // false: substituída, só ocupa espaço até chegar à frente
+  };
+
+  struct Lane {
+    uint8_t* buf;
+    uint16_t cap;
+    uint16_t head;       // próxima escrita
+    uint8_t first;       // entrada mais antiga
+    uint8_t count;       // entradas, com as substituídas
+    Entry entries[OUTBOUND_MAX_MESSAGES];
+    OutboundClassStats stats;
+  };
+
+  bool place(Lane& lane, uint16_t size, uint16_t& offset) const;
+  void drop_front(Lane& lane);
+
+  uint8_t pool_[OUTBOUND_POOL_BYTES];
+  Lane lanes_[OUTBOUND_CLASS_COUNT];
+  uint8_t peeked_;       // classe do último peek()
+  bool backpressure_;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include "pose_integrator.h"
+
+#include <math.h>
+
+static const float kPi = 3.14159265358979f;
+static const float kTwoPi = 6.28318530717959f;
+static const float kHalfPi = 1.57079632679490f;
+
+static const PoseIntegratorConfig kDefaultConfig = {POSE_ARC, POSE_ACC_KAHAN, true};
+
+PoseIntegratorConfig pose_integrator_default_config() {
+  return kDefaultConfig;
+}
+
+void pose_reset(PoseState& pose) {
+  pose.x = 0.0f;
+  pose.y = 0.0f;
+  pose.phi = 0.0f;
+  pose.x_comp = 0.0f;
+  pose.y_comp = 0.0f;
+  pose.phi_comp = 0.0f;
+  pose.x_wide = 0.0;
+  pose.y_wide = 0.0;
+}
+
+// sin em [-π/2, π/2], série de Taylor até x^11 (erro < 6e-8)
+static float sin_half_range(float x) {
+  const float x2 = x * x;
+  return x * (1.0f + x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040 +
+         x2 * (1.0f / 362880 + x2 * (-1.0f / 39916800))))));
+}
+
+static float wrap_pi(float a) {
+  if (a > kPi || a < -kPi) {
+    a -= kTwoPi * floorf((a + kPi) / kTwoPi);
+  }
+  return a;
+}
+
+void pose_fast_sincos(float angle, float& s, float& c) {
+  const float a = wrap_pi(angle);
+  // sin(a) = sin(π − a) e cos(a) = sin(a + π/2), trazidos para [-π/2, π/2]
+  float sa = a;
+  if (sa > kHalfPi) sa = kPi - sa;
+  if (sa < -kHalfPi) sa = -kPi - sa;
+  float ca = a + kHalfPi;
+  if (ca > kPi) ca -= kTwoPi;
+  if (ca > kHalfPi) ca = kPi - ca;
+  if (ca < -kHalfPi) ca = -kPi - ca;
+  s = sin_half_range(sa);
+  c = sin_half_range(ca);
+}
+
+void pose_sincos(const PoseIntegratorConfig& config, float angle, float& s, float& c) {
+  if (config.fast_trig) {
+    pose_fast_sincos(angle, s, c);
+  } else {
+    s = sinf(angle);
+    c = cosf(angle);
+  }
+}
+
+// sum += value, guardando em comp o que o float não conseguiu somar
+static void kahan_add(float& sum, float& comp, float value) {
+  const float y = value - comp;
+  const float t = sum + y;
+  comp = (t - sum) - y;
+  sum = t;
+}
+
+void pose_integrate(PoseState& pose, const PoseIntegratorConfig& config, float ds, float dphi) {
+  // Direção e comprimento do deslocamento no ciclo
+  float heading = pose.phi;
+  float length = ds;
+  if (config.method == POSE_RK2) {
+    heading = pose.phi + 0.5f * dphi;
+  } else if (config.method == POSE_ARC) {
+    heading = pose.phi + 0.5f * dphi;
+    const float half = 0.5f * dphi;
+    if (fabsf(half) > 1e-4f) {
+      float sh, ch;
+      pose_sincos(config, half, sh, ch);
+      length = ds * sh / half;
+    } else {
+      length = ds * (1.0f - half * half / 6.0f);  // sin(h)/h para h pequeno
+    }
+  }
+  float s, c;
+  pose_sincos(config, heading, s, c);
+  const float dx = length * c;
+  const float dy = length * s;
+
+  switch (config.accumulator) {
+    case POSE_ACC_KAHAN:
+      kahan_add(pose.x, pose.x_comp, dx);
+      kahan_add(pose.y, pose.y_comp, dy);
+      break;
+    case POSE_ACC_DOUBLE:
+      // Acumuladores velhos (modo trocado em execução): parte do float
+      if (static_cast<float>(pose.x_wide) != pose.x) pose.x_wide = pose.x;
+      if (static_cast<float>(pose.y_wide) != pose.y) pose.y_wide = pose.y;
+      pose.x_wide += dx;
+      pose.y_wide += dy;
+      pose.x = static_cast<float>(pose.x_wide);
+      pose.y = static_cast<float>(pose.y_wide);
+      break;
+    default:
+      pose.x += dx;
+      pose.y += dy;
+      pose.x_comp = 0.0f;
+      pose.y_comp = 0.0f;
+      break;
+  }
+
+  // Rumo: soma compensada e volta a [-π, π] a cada passo (dphi é pequeno)
+  if (config.accumulator == POSE_ACC_FLOAT) {
+    pose.phi += dphi;
+    pose.phi_comp = 0.0f;
+  } else {
+    kahan_add(pose.phi, pose.phi_comp, dphi);
+  }
+  if (pose.phi > kPi) {
+    pose.phi -= kTwoPi;
+    pose.phi_comp = 0.0f;
+  } else if (pose.phi < -kPi) {
+    pose.phi += kTwoPi;
+    pose.phi_comp = 0.0f;
+  }
+  if (pose.phi > kPi || pose.phi < -kPi) {
+    pose.phi = wrap_pi(pose.phi);
+  }
+}
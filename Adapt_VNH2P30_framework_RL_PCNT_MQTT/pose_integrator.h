@@ -0,0 +1,63 @@
+#ifndef POSE_INTEGRATOR_H
+#define POSE_INTEGRATOR_H
+
+#include <stdint.h>
+
+// Integração da pose (x, y, phi) a partir do deslocamento de cada ciclo:
+// ds = avanço do centro do eixo (m), dphi = giro (rad), ambos vindos das
+// contagens dos encoders.
+//
+// Métodos:
+//   EULER: x += ds·cos(phi) com o rumo do início do ciclo (original). Erro
+//          de 1ª ordem em dphi: em curva o robô "abre" a trajetória.
+//   RK2:   ponto médio, x += ds·cos(phi + dphi/2). Erro de 3ª ordem.
+//   ARC:   arco de curvatura constante, exato quando v e w são constantes no
+//          ciclo: corda ds·sin(dphi/2)/(dphi/2) na direção phi + dphi/2.
+//
+// Acumuladores: float puro; float com soma compensada (Kahan), que mantém a
+// precisão do incremento mesmo longe da origem sem custo de double; ou
+// double (em software no ESP32, mais caro).
+//
+// O rumo é mantido em [-π, π] a cada passo, com a soma também compensada.
+// fast_trig troca sinf/cosf por um polinômio (erro < 1e-6).
+
+enum PoseIntegratorMethod {
+  POSE_EULER = 0,
+  POSE_RK2,
+  POSE_ARC,
+};
+
+enum PoseAccumulator {
+  POSE_ACC_FLOAT = 0,
+  POSE_ACC_KAHAN,
+  POSE_ACC_DOUBLE,
+};
+
+struct PoseIntegratorConfig {
+  PoseIntegratorMethod method;
+  PoseAccumulator accumulator;
+  bool fast_trig;
+};
+
+struct PoseState {
+  float x;
+  float y;
+  float phi;              // sempre em [-π, π]
+  float x_comp;           // compensação de Kahan (parte perdida da soma)
+  float y_comp;
+  float phi_comp;
+  double x_wide;          // acumuladores do modo double
+  double y_wide;
+};
+
+PoseIntegratorConfig pose_integrator_default_config();
+void pose_reset(PoseState& pose);
+void pose_integrate(PoseState& pose, const PoseIntegratorConfig& config, float ds, float dphi);
+
+// Polinômio usado com fast_trig (ângulo qualquer)
+void pose_fast_sincos(float angle, float& s, float& c);
+// Seno e cosseno como o integrador os calcula: o polinômio com fast_trig,
+// senão sinf/cosf
+void pose_sincos(const PoseIntegratorConfig& config, float angle, float& s, float& c);
+
+#endif
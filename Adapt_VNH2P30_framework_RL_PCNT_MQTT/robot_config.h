@@ -0,0 +1,164 @@
+#ifndef ROBOT_CONFIG_H
+#define ROBOT_CONFIG_H
+
+#include <stdint.h>
+
+// Geometria, encoder e pinagem de cada variante do robô, resolvidas em tempo
+// de compilação. Cada variante é um tipo: uma struct de especificação (só os
+// valores medidos/da montagem) passada a RobotConfig, que deriva as
+// constantes de conversão usadas no laço de controle e confere tudo com
+// static_assert. O laço só multiplica por essas constantes.
+//
+// A variante compilada vem de ROBOT_VARIANT (padrão AdaptVnh2sp30), sem
+// editar o código:
+//   cmake -DROBOT_VARIANT=CompactJgb37 ...
+//   arduino-cli compile --build-property
+//       "compiler.cpp.extra_flags=-DROBOT_VARIANT=CompactJgb37" ...
+//
+// Nova variante: uma struct *Spec com os mesmos campos, o typedef e uma
+// linha em ROBOT_CONFIG_CHECK no fim deste arquivo.
+
+// Pino de saída do ESP32: existe, não é da flash (6..11) nem só entrada (34..39)
+constexpr bool robot_output_pin(int pin) {
+  return pin >= 0 && pin < 34 && (pin < 6 || pin > 11);
+}
+
+constexpr bool robot_input_pin(int pin) {
+  return pin >= 0 && pin < 40 && (pin < 6 || pin > 11);
+}
+
+constexpr bool robot_pin_absent(int) {
+  return true;
+}
+
+template <class... Rest>
+constexpr bool robot_pin_absent(int pin, int first, Rest... rest) {
+  return pin != first && robot_pin_absent(pin, rest...);
+}
+
+// Nenhum pino repetido
+constexpr bool robot_pins_distinct() {
+  return true;
+}
+
+template <class... Rest>
+constexpr bool robot_pins_distinct(int first, Rest... rest) {
+  return robot_pin_absent(first, rest...) && robot_pins_distinct(rest...);
+}
+
+template <class Spec>
+struct RobotConfig : Spec {
+  static constexpr float kTwoPi = 6.28318530717958648f;
+
+  // Encoder: contagem do PCNT (bordas) -> rad no eixo do motor
+  static constexpr float kMotorRadPerEdge = kTwoPi / Spec::kPulsesPerRev;
+  // Eixo do motor -> roda (rad/s), e roda -> chão (m/s)
+  static constexpr float kWheelPerMotor = 1.0f / Spec::kGearReduction;
+  static constexpr float kWheelMpsPerMotorRadS = Spec::kWheelRadiusM / Spec::kGearReduction;
+  static constexpr float kMotorRadSPerWheelMps = Spec::kGearReduction / Spec::kWheelRadiusM;
+  // Deslocamento da roda no chão por borda contada (pose)
+  static constexpr float kWheelMetersPerEdge = kMotorRadPerEdge * kWheelMpsPerMotorRadS;
+  // Cinemática diferencial
+  static constexpr float kHalfWheelBaseM = 0.5f * Spec::kWheelBaseM;
+  static constexpr float kInvWheelBaseM = 1.0f / Spec::kWheelBaseM;
+  // Referência do modo original: PWM 0..255 -> rad/s no eixo do motor
+  static constexpr float kMotorRadSPerPwm = Spec::kMaxMotorRadS / 255.0f;
+  static constexpr float kInvMaxMotorRadS = 1.0f / Spec::kMaxMotorRadS;
+  // Feedforward do PID: PWM por rad/s do motor em vazio
+  static constexpr float kPwmPerFreeRadS = 255.0f / Spec::kMotorFreeSpeedRadS;
+
+  static_assert(Spec::kPulsesPerRev > 0, "encoder sem pulsos por volta");
+  static_assert(Spec::kGearReduction >= 1.0f, "redução menor que 1:1");
+  static_assert(Spec::kWheelRadiusM > 0.0f && Spec::kWheelRadiusM < 1.0f,
+                "raio da roda fora de (0, 1) m");
+  static_assert(Spec::kWheelBaseM > 2.0f * Spec::kWheelRadiusM && Spec::kWheelBaseM < 5.0f,
+                "distância entre rodas incoerente com o raio");
+  static_assert(Spec::kMaxMotorRadS > 0.0f, "velocidade máxima do motor não positiva");
+  static_assert(Spec::kMotorFreeSpeedRadS >= Spec::kMaxMotorRadS,
+                "velocidade máxima acima da velocidade em vazio do motor");
+  static_assert(Spec::kPcntLimit > 0 && Spec::kPcntLimit <= 32767,
+                "limite do PCNT fora do contador de 16 bits");
+  static_assert(robot_output_pin(Spec::kMotorRA) && robot_output_pin(Spec::kMotorRB) &&
+                    robot_output_pin(Spec::kMotorLA) && robot_output_pin(Spec::kMotorLB) &&
+                    robot_output_pin(Spec::kPwmR) && robot_output_pin(Spec::kPwmL) &&
+                    robot_output_pin(Spec::kEnableR) && robot_output_pin(Spec::kEnableL),
+                "pino de saída inválido (flash, só entrada ou inexistente)");
+  static_assert(robot_input_pin(Spec::kEncoderRA) && robot_input_pin(Spec::kEncoderRB) &&
+                    robot_input_pin(Spec::kEncoderLA) && robot_input_pin(Spec::kEncoderLB),
+                "pino de encoder inválido");
+  static_assert(robot_pins_distinct(Spec::kMotorRA, Spec::kMotorRB, Spec::kMotorLA,
+                                    Spec::kMotorLB, Spec::kPwmR, Spec::kPwmL, Spec::kEnableR,
+                                    Spec::kEnableL, Spec::kEncoderRA, Spec::kEncoderRB,
+                                    Spec::kEncoderLA, Spec::kEncoderLB),
+                "pino usado duas vezes");
+};
+
+// Robô original: VNH2SP30, motor com redução 1:147,4 e encoder de 11 pulsos
+struct AdaptVnh2sp30Spec {
+  static constexpr const char* kName = "AdaptVnh2sp30";
+  static constexpr int kPulsesPerRev = 11;
+  static constexpr float kGearReduction = 147.4f;
+  static constexpr float kWheelRadiusM = 0.125f;
+  static constexpr float kWheelBaseM = 0.62f;
+  // Motor de 12 V: ~450 rad/s em vazio com PWM 255, ~400 rad/s com carga
+  static constexpr float kMotorFreeSpeedRadS = 450.0f;
+  static constexpr float kMaxMotorRadS = 400.0f;
+  static constexpr int kPcntLimit = 10000;
+
+  static constexpr int kMotorRA = 4;    // INA/INB da ponte de cada motor
+  static constexpr int kMotorRB = 27;
+  static constexpr int kMotorLA = 32;
+  static constexpr int kMotorLB = 33;
+  static constexpr int kPwmR = 25;
+  static constexpr int kPwmL = 26;
+  static constexpr int kEnableR = 19;
+  static constexpr int kEnableL = 18;
+  static constexpr int kEncoderRA = 14;  // canais A/B do encoder de cada motor
+  static constexpr int kEncoderRB = 12;
+  static constexpr int kEncoderLA = 16;
+  static constexpr int kEncoderLB = 17;
+};
+typedef RobotConfig<AdaptVnh2sp30Spec> AdaptVnh2sp30;
+
+// Base menor: JGB37-520 (1:30), rodas de 65 mm e encoders nos pinos 32/33
+struct CompactJgb37Spec {
+  static constexpr const char* kName = "CompactJgb37";
+  static constexpr int kPulsesPerRev = 11;
+  static constexpr float kGearReduction = 30.0f;
+  static constexpr float kWheelRadiusM = 0.0325f;
+  static constexpr float kWheelBaseM = 0.20f;
+  // JGB37-520 12 V 1:30: ~333 rpm em vazio na saída (~1050 rad/s no motor)
+  static constexpr float kMotorFreeSpeedRadS = 1050.0f;
+  static constexpr float kMaxMotorRadS = 940.0f;
+  static constexpr int kPcntLimit = 10000;
+
+  static constexpr int kMotorRA = 21;
+  static constexpr int kMotorRB = 22;
+  static constexpr int kMotorLA = 23;
+  static constexpr int kMotorLB = 13;
+  static constexpr int kPwmR = 25;
+  static constexpr int kPwmL = 26;
+  static constexpr int kEnableR = 19;
+  static constexpr int kEnableL = 18;
+  static constexpr int kEncoderRA = 32;
+  static constexpr int kEncoderRB = 33;
+  static constexpr int kEncoderLA = 16;
+  static constexpr int kEncoderLB = 17;
+};
+typedef RobotConfig<CompactJgb37Spec> CompactJgb37;
+
+// Instancia todas as variantes: os static_assert valem em qualquer build,
+// não só na variante escolhida
+#define ROBOT_CONFIG_CHECK(variant) \
+  static_assert(variant::kMotorRadPerEdge > 0.0f, #variant)
+ROBOT_CONFIG_CHECK(AdaptVnh2sp30);
+ROBOT_CONFIG_CHECK(CompactJgb37);
+
+#ifndef ROBOT_VARIANT
+#define ROBOT_VARIANT AdaptVnh2sp30
+#endif
+
+// Variante compilada; o firmware só usa Robot::
+typedef ROBOT_VARIANT Robot;
+
+#endif
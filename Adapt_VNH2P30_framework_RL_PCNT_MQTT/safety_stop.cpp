@@ -0,0 +1,184 @@
+#include "safety_stop.h"
+
+#include "motor_control.h"
+
+// Tudo o que o ISR lê fica na DRAM (nada const, que iria para a flash), e
+// os pinos e canais são constantes de compilação.
+// Escritos pelo ISR e pela tarefa de controle, no mesmo core: o ISR roda
+// inteiro entre duas instruções da tarefa
+static SafetyStopConfig g_config = safety_stop_default_config();
+static volatile uint32_t g_last_feed_us = 0;
+static volatile uint8_t g_tier = SAFETY_OK;
+static volatile bool g_tripped = false;
+static volatile bool g_task_tripped = false;   // o silêncio da tarefa chegou a um degrau
+static volatile bool g_remote_in_charge = false;
+static SafetyStopStats g_stats = {};
+// Escritos pela tarefa de rede (outro core): palavras de 32 bits, lidas
+// inteiras pelo ISR
+static volatile uint32_t g_last_remote_us = 0;
+static volatile bool g_remote_moving = false;
+
+SafetyStopConfig safety_stop_default_config() {
+  SafetyStopConfig config;
+  config.decel_ms = 100;
+  config.brake_ms = 200;
+  config.lock_ms = 1000;
+  config.decel_step = 8;
+  config.remote_ms = 3000;
+  return config;
+}
+
+SafetyStopTier HAL_ISR_ATTR safety_stop_tier(const SafetyStopConfig& config,
+                                             uint32_t silence_us) {
+  if (config.brake_ms == 0) {
+    return SAFETY_OK;
+  }
+  if (config.lock_ms && silence_us >= config.lock_ms * 1000u) {
+    return SAFETY_LOCK;
+  }
+  if (silence_us >= config.brake_ms * 1000u) {
+    return SAFETY_BRAKE;
+  }
+  if (config.decel_ms && silence_us >= config.decel_ms * 1000u) {
+    return SAFETY_DECEL;
+  }
+  return SAFETY_OK;
+}
+
+SafetyStopTier HAL_ISR_ATTR safety_stop_remote_tier(const SafetyStopConfig& config,
+                                                    uint32_t silence_us) {
+  if (config.remote_ms == 0 || config.brake_ms == 0 || silence_us < config.remote_ms * 1000u) {
+    return SAFETY_OK;
+  }
+  const uint32_t first_ms =
+      config.decel_ms && config.decel_ms < config.brake_ms ? config.decel_ms : config.brake_ms;
+  return safety_stop_tier(config, silence_us - config.remote_ms * 1000u + first_ms * 1000u);
+}
+
+// Só com o comando remoto mandando e em movimento: parado, ou nos botões,
+// o silêncio da rede não importa
+static SafetyStopTier HAL_ISR_ATTR remote_tier(uint32_t now_us) {
+  if (!g_remote_in_charge || !g_remote_moving) {
+    return SAFETY_OK;
+  }
+  return safety_stop_remote_tier(g_config, now_us - g_last_remote_us);
+}
+
+static void HAL_ISR_ATTR decelerate(uint8_t channel, uint8_t step) {
+  const uint32_t duty = hal_isr_pwm_duty(channel);
+  hal_isr_pwm_write(channel, duty > step ? duty - step : 0);
+}
+
+static void HAL_ISR_ATTR safety_stop_isr() {
+  const uint32_t now = hal_isr_micros();
+  const uint32_t silence = now - g_last_feed_us;
+  if (silence > g_stats.max_silence_us) {
+    g_stats.max_silence_us = silence;
+  }
+  const SafetyStopTier task_tier = safety_stop_tier(g_config, silence);
+  const SafetyStopTier net_tier = remote_tier(now);
+  const SafetyStopTier tier = task_tier > net_tier ? task_tier : net_tier;
+  const uint8_t previous = g_tier;
+  g_tier = tier;
+  if (tier == SAFETY_OK) {
+    return;
+  }
+  if (previous == SAFETY_OK) {
+    g_stats.trips++;
+    if (task_tier == SAFETY_OK) {
+      g_stats.remote_trips++;
+    }
+  }
+  // Também depois de um feed que soltou só a tarefa, com a rede ainda parada
+  g_tripped = true;
+  if (task_tier != SAFETY_OK) {
+    g_task_tripped = true;
+  }
+
+  if (tier == SAFETY_DECEL) {
+    decelerate(PWM_CHANNEL_R, g_config.decel_step);
+    decelerate(PWM_CHANNEL_L, g_config.decel_step);
+    return;
+  }
+
+  // Mesmo estado de motorGo(BRAKE, 0)
+  if (previous < SAFETY_BRAKE) {
+    g_stats.brakes++;
+  }
+  hal_isr_gpio_write(Robot::kMotorRA, false);
+  hal_isr_gpio_write(Robot::kMotorRB, false);
+  hal_isr_gpio_write(Robot::kMotorLA, false);
+  hal_isr_gpio_write(Robot::kMotorLB, false);
+  hal_isr_pwm_write(PWM_CHANNEL_R, 0);
+  hal_isr_pwm_write(PWM_CHANNEL_L, 0);
+
+  if (tier == SAFETY_LOCK) {
+    if (previous != SAFETY_LOCK) {
+      g_stats.locks++;
+    }
+    hal_isr_gpio_write(Robot::kEnableR, false);
+    hal_isr_gpio_write(Robot::kEnableL, false);
+  }
+}
+
+void safety_stop_set_config(const SafetyStopConfig& config) {
+  g_config = config;
+}
+
+SafetyStopConfig safety_stop_config() {
+  return g_config;
+}
+
+bool safety_stop_begin() {
+  g_last_feed_us = hal_micros();
+  g_tier = SAFETY_OK;
+  g_tripped = false;
+  g_task_tripped = false;
+  g_remote_moving = false;
+  return hal_timer_isr_start(SAFETY_STOP_TICK_US, safety_stop_isr);
+}
+
+SafetyStopRelease safety_stop_feed() {
+  // Primeiro o instante: um tique depois dele já vê silêncio zero e não
+  // dispara de novo
+  g_last_feed_us = hal_micros();
+  if (!g_tripped) {
+    return SAFETY_RELEASE_NONE;
+  }
+  SafetyStopRelease release = SAFETY_RELEASE_NONE;
+  hal_critical_enter();
+  if (g_task_tripped) {
+    release = SAFETY_RELEASE_TASK;
+  } else if (remote_tier(hal_micros()) == SAFETY_OK) {
+    release = SAFETY_RELEASE_REMOTE;
+  }
+  // Rede ainda parada: o ISR segue dono das pontes
+  if (release != SAFETY_RELEASE_NONE) {
+    g_tripped = false;
+    g_task_tripped = false;
+    g_stats.recoveries++;
+  }
+  hal_critical_exit();
+  return release;
+}
+
+void safety_stop_watch_remote(bool in_charge) {
+  g_remote_in_charge = in_charge;
+}
+
+void safety_stop_feed_remote(bool moving) {
+  // Instante antes do tipo: o ISR nunca vê o movimento novo com o carimbo velho
+  g_last_remote_us = hal_micros();
+  g_remote_moving = moving;
+}
+
+SafetyStopTier safety_stop_tier_now() {
+  return static_cast<SafetyStopTier>(g_tier);
+}
+
+SafetyStopStats safety_stop_stats() {
+  hal_critical_enter();
+  const SafetyStopStats stats = g_stats;
+  hal_critical_exit();
+  return stats;
+}
@@ -0,0 +1,94 @@
+#ifndef SAFETY_STOP_H
+#define SAFETY_STOP_H
+
+#include <stdint.h>
+
+#include "hal.h"
+
+// Parada de segurança (dead-man) independente das tarefas: um timer de
+// hardware próprio (hal_timer_isr_start) confere a cada SAFETY_STOP_TICK_US
+// há quanto tempo a tarefa de controle não começa um ciclo
+// (safety_stop_feed). Passado cada prazo, o ISR age direto nas duas pontes H,
+// em degraus:
+//   decel_ms  desacelera: o duty das duas pontes cai decel_step por tique
+//   brake_ms  freia: INA = INB = 0 e duty 0 (freio para GND no VNH2SP30)
+//   lock_ms   desliga: EN_R/EN_L em 0, como Lock() (0 = nunca)
+// O degrau é reaplicado a cada tique, então uma tarefa meio viva não volta a
+// ligar os motores. A reação fica em um tique (1 ms) depois do prazo, também
+// durante um apagamento de setor da flash (interrupção na IRAM, ver
+// hal_timer_isr_start): o ISR e o estado abaixo não dependem do cache.
+//
+// O disparo dura até a tarefa de controle voltar: o safety_stop_feed()
+// seguinte devolve SAFETY_RELEASE_TASK e o controle zera o próprio estado,
+// religa EN e descarta o comando remoto corrente (motor_safety_release).
+//
+// A rede tem o próprio prazo (remote_ms): a tarefa de rede carimba cada
+// comando remoto aceito (safety_stop_feed_remote) e, enquanto o comando
+// remoto manda nas rodas (safety_stop_watch_remote) e é de movimento, o ISR
+// conta o silêncio desde o último. Passado remote_ms, aplica os mesmos
+// degraus, deslocados para o primeiro agir no prazo (desacelera em
+// remote_ms, freia brake_ms - decel_ms depois, desliga EN lock_ms - decel_ms
+// depois). Com a tarefa de controle viva, o disparo da rede dura até chegar
+// um comando novo (ou um de parada, ou os botões assumirem): aí o feed
+// devolve SAFETY_RELEASE_REMOTE e o comando novo já vale.
+
+#define SAFETY_STOP_TICK_US 1000
+
+struct SafetyStopConfig {
+  uint32_t decel_ms;    // silêncio até desacelerar; 0 ou >= brake_ms pula
+  uint32_t brake_ms;    // 0 desliga a parada de segurança
+  uint32_t lock_ms;     // 0: nunca desliga EN
+  uint8_t decel_step;   // duty (de 255) a menos por tique
+  uint32_t remote_ms;   // sem comando remoto até o primeiro degrau; 0 desliga
+};
+
+enum SafetyStopTier {
+  SAFETY_OK = 0,
+  SAFETY_DECEL,
+  SAFETY_BRAKE,
+  SAFETY_LOCK,
+};
+
+enum SafetyStopRelease {
+  SAFETY_RELEASE_NONE = 0,
+  SAFETY_RELEASE_TASK,     // a tarefa de controle sumiu (pode ter sido também a rede)
+  SAFETY_RELEASE_REMOTE,   // só a rede: o comando corrente é posterior à parada
+};
+
+struct SafetyStopStats {
+  uint32_t trips;            // saídas de SAFETY_OK
+  uint32_t remote_trips;     // delas, só pelo prazo da rede
+  uint32_t brakes;           // chegaram a frear
+  uint32_t locks;            // chegaram a desligar EN
+  uint32_t recoveries;       // feeds depois de um disparo
+  uint32_t max_silence_us;   // maior silêncio visto pelo ISR
+};
+
+// Duas vezes o período de controle até desacelerar, quatro até frear, 1 s até
+// desligar; de 255 a 0 em ~32 ms. Rede: 3 s, o timeout de comandos remotos
+SafetyStopConfig safety_stop_default_config();
+
+// Degrau para um silêncio de silence_us (puro; usado pelo ISR)
+SafetyStopTier safety_stop_tier(const SafetyStopConfig& config, uint32_t silence_us);
+// Degrau para silence_us sem comando remoto: o primeiro degrau em remote_ms
+SafetyStopTier safety_stop_remote_tier(const SafetyStopConfig& config, uint32_t silence_us);
+
+// Só antes de safety_stop_begin (o ISR lê sem trava)
+void safety_stop_set_config(const SafetyStopConfig& config);
+SafetyStopConfig safety_stop_config();
+
+// Arma o timer no core que chama (o mesmo da tarefa de controle); o
+// silêncio conta a partir daqui
+bool safety_stop_begin();
+// Tarefa de controle, no começo de cada ciclo. Diferente de NONE: o ISR
+// disparou e já soltou as pontes (chamar motor_safety_release)
+SafetyStopRelease safety_stop_feed();
+// Tarefa de controle, a cada ciclo: o comando remoto é o que manda nas rodas
+// (sem botão pressionado)
+void safety_stop_watch_remote(bool in_charge);
+// Tarefa de rede, a cada comando remoto aceito; moving = não é parada
+void safety_stop_feed_remote(bool moving);
+SafetyStopTier safety_stop_tier_now();
+SafetyStopStats safety_stop_stats();
+
+#endif
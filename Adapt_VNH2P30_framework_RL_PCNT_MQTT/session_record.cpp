@@ -0,0 +1,740 @@
+#include "session_record.h"
+
+#include <string.h>
+
+#include <atomic>
+
+#include <Arduino.h>
+#include "control_task.h"
+#include "hal.h"
+#include "mqtt_client.h"
+
+// ---------- Escrita e leitura little-endian ----------
+static size_t put_u8(uint8_t* p, uint8_t v) {
+  p[0] = v;
+  return 1;
+}
+
+static size_t put_u32(uint8_t* p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+  p[2] = static_cast<uint8_t>(v >> 16);
+  p[3] = static_cast<uint8_t>(v >> 24);
+  return 4;
+}
+
+static size_t put_u64(uint8_t* p, uint64_t v) {
+  put_u32(p, static_cast<uint32_t>(v));
+  put_u32(p + 4, static_cast<uint32_t>(v >> 32));
+  return 8;
+}
+
+static size_t put_f32(uint8_t* p, float v) {
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return put_u32(p, bits);
+}
+
+static size_t put_f64(uint8_t* p, double v) {
+  uint64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return put_u64(p, bits);
+}
+
+static size_t put_varint(uint8_t* p, uint32_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    p[n++] = static_cast<uint8_t>(v | 0x80);
+    v >>= 7;
+  }
+  p[n++] = static_cast<uint8_t>(v);
+  return n;
+}
+
+static uint32_t zigzag(int32_t v) {
+  return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+  return static_cast<int32_t>((v >> 1) ^ (~(v & 1) + 1));
+}
+
+// Leitor com limite: qualquer leitura além do fim zera ok
+struct Reader {
+  const uint8_t* buf;
+  size_t length;
+  size_t pos;
+  bool ok;
+};
+
+static uint8_t get_u8(Reader& r) {
+  if (r.pos + 1 > r.length) {
+    r.ok = false;
+    return 0;
+  }
+  return r.buf[r.pos++];
+}
+
+static uint32_t get_u32(Reader& r) {
+  if (r.pos + 4 > r.length) {
+    r.ok = false;
+    return 0;
+  }
+  const uint8_t* p = r.buf + r.pos;
+  r.pos += 4;
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static uint64_t get_u64(Reader& r) {
+  const uint64_t lo = get_u32(r);
+  const uint64_t hi = get_u32(r);
+  return lo | (hi << 32);
+}
+
+static float get_f32(Reader& r) {
+  const uint32_t bits = get_u32(r);
+  float v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+static double get_f64(Reader& r) {
+  const uint64_t bits = get_u64(r);
+  double v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+static uint32_t get_varint(Reader& r) {
+  uint32_t v = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    const uint8_t byte = get_u8(r);
+    if (!r.ok) return 0;
+    v |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) return v;
+  }
+  r.ok = false;
+  return 0;
+}
+
+// ---------- Configuração, base e estado ----------
+void session_config_capture(SessionConfig& out) {
+  out.speed_mode = motor_speed_controller();
+  out.gains = motor_speed_gains();
+  out.velocity_mode = motor_velocity_estimator();
+  out.pose = motor_pose_integrator();
+  out.profile = motor_motion_profile();
+}
+
+void session_config_apply(const SessionConfig& config) {
+  motor_set_speed_controller(config.speed_mode);
+  motor_set_speed_gains(config.gains);
+  motor_set_velocity_estimator(config.velocity_mode);
+  motor_set_pose_integrator(config.pose);
+  motor_set_motion_profile(config.profile);
+}
+
+void session_base_from_inputs(SessionBase& base, const ControlInputs& in) {
+  base.t_us = in.t_us;
+  base.t_ms = in.t_ms;
+  base.totalR = in.totalR;
+  base.totalL = in.totalL;
+  base.edgesR = in.capture_ok ? in.capR.edges : 0;
+  base.edgesL = in.capture_ok ? in.capL.edges : 0;
+}
+
+// 54 bytes
+static size_t encode_config(const SessionConfig& c, uint8_t* p) {
+  size_t n = 0;
+  n += put_u8(p + n, static_cast<uint8_t>(c.speed_mode));
+  n += put_f32(p + n, c.gains.kp);
+  n += put_f32(p + n, c.gains.ki);
+  n += put_f32(p + n, c.gains.kd);
+  n += put_f32(p + n, c.gains.kff);
+  n += put_f32(p + n, c.gains.ff_offset);
+  n += put_f32(p + n, c.gains.kc);
+  n += put_f32(p + n, c.gains.d_alpha);
+  n += put_f32(p + n, c.gains.ref_tau_s);
+  n += put_u8(p + n, static_cast<uint8_t>(c.velocity_mode));
+  n += put_u8(p + n, static_cast<uint8_t>(c.pose.method));
+  n += put_u8(p + n, static_cast<uint8_t>(c.pose.accumulator));
+  n += put_u8(p + n, c.pose.fast_trig ? 1 : 0);
+  n += put_u8(p + n, static_cast<uint8_t>(c.profile.mode));
+  n += put_f32(p + n, c.profile.linear.accel);
+  n += put_f32(p + n, c.profile.linear.jerk);
+  n += put_f32(p + n, c.profile.angular.accel);
+  n += put_f32(p + n, c.profile.angular.jerk);
+  return n;
+}
+
+static void decode_config(Reader& r, SessionConfig& c) {
+  c.speed_mode = static_cast<SpeedControllerMode>(get_u8(r));
+  c.gains.kp = get_f32(r);
+  c.gains.ki = get_f32(r);
+  c.gains.kd = get_f32(r);
+  c.gains.kff = get_f32(r);
+  c.gains.ff_offset = get_f32(r);
+  c.gains.kc = get_f32(r);
+  c.gains.d_alpha = get_f32(r);
+  c.gains.ref_tau_s = get_f32(r);
+  c.velocity_mode = static_cast<VelocityEstimatorMode>(get_u8(r));
+  c.pose.method = static_cast<PoseIntegratorMethod>(get_u8(r));
+  c.pose.accumulator = static_cast<PoseAccumulator>(get_u8(r));
+  c.pose.fast_trig = get_u8(r) != 0;
+  c.profile.mode = static_cast<MotionProfileMode>(get_u8(r));
+  c.profile.linear.accel = get_f32(r);
+  c.profile.linear.jerk = get_f32(r);
+  c.profile.angular.accel = get_f32(r);
+  c.profile.angular.jerk = get_f32(r);
+}
+
+static const size_t kConfigBytes = 54;
+static const size_t kBaseBytes = 32;
+static const size_t kStateBytes = 187;
+
+static size_t encode_base(const SessionBase& b, uint8_t* p) {
+  size_t n = 0;
+  n += put_u32(p + n, b.t_us);
+  n += put_u32(p + n, b.t_ms);
+  n += put_u64(p + n, static_cast<uint64_t>(b.totalR));
+  n += put_u64(p + n, static_cast<uint64_t>(b.totalL));
+  n += put_u32(p + n, static_cast<uint32_t>(b.edgesR));
+  n += put_u32(p + n, static_cast<uint32_t>(b.edgesL));
+  return n;
+}
+
+static void decode_base(Reader& r, SessionBase& b) {
+  b.t_us = get_u32(r);
+  b.t_ms = get_u32(r);
+  b.totalR = static_cast<int64_t>(get_u64(r));
+  b.totalL = static_cast<int64_t>(get_u64(r));
+  b.edgesR = static_cast<int32_t>(get_u32(r));
+  b.edgesL = static_cast<int32_t>(get_u32(r));
+}
+
+static size_t encode_pid(const SpeedPidState& s, uint8_t* p) {
+  size_t n = 0;
+  n += put_f32(p + n, s.integral);
+  n += put_f32(p + n, s.prev_measured);
+  n += put_f32(p + n, s.d_filtered);
+  n += put_f32(p + n, s.ref_model);
+  n += put_u8(p + n, s.primed ? 1 : 0);
+  return n;
+}
+
+static void decode_pid(Reader& r, SpeedPidState& s) {
+  s.integral = get_f32(r);
+  s.prev_measured = get_f32(r);
+  s.d_filtered = get_f32(r);
+  s.ref_model = get_f32(r);
+  s.primed = get_u8(r) != 0;
+}
+
+static size_t encode_mt(const MtVelocityEstimator& m, uint8_t* p) {
+  size_t n = 0;
+  n += put_u32(p + n, static_cast<uint32_t>(m.edges));
+  n += put_u32(p + n, m.edge_us);
+  n += put_u32(p + n, m.sample_us);
+  n += put_f32(p + n, m.rate);
+  n += put_u8(p + n, m.primed ? 1 : 0);
+  n += put_u8(p + n, m.stopped ? 1 : 0);
+  return n;
+}
+
+static void decode_mt(Reader& r, MtVelocityEstimator& m) {
+  m.edges = static_cast<int32_t>(get_u32(r));
+  m.edge_us = get_u32(r);
+  m.sample_us = get_u32(r);
+  m.rate = get_f32(r);
+  m.primed = get_u8(r) != 0;
+  m.stopped = get_u8(r) != 0;
+}
+
+static size_t encode_state(const ControlState& s, uint8_t* p) {
+  size_t n = 0;
+  n += put_u8(p + n, s.primed ? 1 : 0);
+  n += put_u32(p + n, s.last_us);
+  n += put_u32(p + n, s.cycle_ms);
+  n += put_u64(p + n, static_cast<uint64_t>(s.pcnt_lastR));
+  n += put_u64(p + n, static_cast<uint64_t>(s.pcnt_lastL));
+  n += put_u8(p + n, s.status);
+  n += put_u8(p + n, s.dirR);
+  n += put_u8(p + n, s.dirL);
+  n += put_u8(p + n, s.pwmR);
+  n += put_u8(p + n, s.pwmL);
+  n += put_f32(p + n, s.targetR);
+  n += put_f32(p + n, s.targetL);
+  n += put_f32(p + n, s.pose.x);
+  n += put_f32(p + n, s.pose.y);
+  n += put_f32(p + n, s.pose.phi);
+  n += put_f32(p + n, s.pose.x_comp);
+  n += put_f32(p + n, s.pose.y_comp);
+  n += put_f32(p + n, s.pose.phi_comp);
+  n += put_f64(p + n, s.pose.x_wide);
+  n += put_f64(p + n, s.pose.y_wide);
+  n += put_f32(p + n, s.profile_goal.v_mps);
+  n += put_f32(p + n, s.profile_goal.w_radps);
+  n += put_f32(p + n, s.profile_v.value);
+  n += put_f32(p + n, s.profile_v.rate);
+  n += put_f32(p + n, s.profile_w.value);
+  n += put_f32(p + n, s.profile_w.rate);
+  n += encode_pid(s.pidR, p + n);
+  n += encode_pid(s.pidL, p + n);
+  n += encode_mt(s.mtR, p + n);
+  n += encode_mt(s.mtL, p + n);
+  n += put_u8(p + n, static_cast<uint8_t>(s.last_applied));
+  n += put_u8(p + n, static_cast<uint8_t>(s.remote.command));
+  n += put_f32(p + n, s.remote.twist.v_mps);
+  n += put_f32(p + n, s.remote.twist.w_radps);
+  n += put_u32(p + n, s.remote.t_ms);
+  n += put_u8(p + n, s.remote_received ? 1 : 0);
+  return n;
+}
+
+static void decode_state(Reader& r, ControlState& s) {
+  s = ControlState();
+  s.primed = get_u8(r) != 0;
+  s.last_us = get_u32(r);
+  s.cycle_ms = get_u32(r);
+  s.pcnt_lastR = static_cast<int64_t>(get_u64(r));
+  s.pcnt_lastL = static_cast<int64_t>(get_u64(r));
+  s.status = get_u8(r);
+  s.dirR = get_u8(r);
+  s.dirL = get_u8(r);
+  s.pwmR = get_u8(r);
+  s.pwmL = get_u8(r);
+  s.targetR = get_f32(r);
+  s.targetL = get_f32(r);
+  s.pose.x = get_f32(r);
+  s.pose.y = get_f32(r);
+  s.pose.phi = get_f32(r);
+  s.pose.x_comp = get_f32(r);
+  s.pose.y_comp = get_f32(r);
+  s.pose.phi_comp = get_f32(r);
+  s.pose.x_wide = get_f64(r);
+  s.pose.y_wide = get_f64(r);
+  s.profile_goal.v_mps = get_f32(r);
+  s.profile_goal.w_radps = get_f32(r);
+  s.profile_v.value = get_f32(r);
+  s.profile_v.rate = get_f32(r);
+  s.profile_w.value = get_f32(r);
+  s.profile_w.rate = get_f32(r);
+  decode_pid(r, s.pidR);
+  decode_pid(r, s.pidL);
+  decode_mt(r, s.mtR);
+  decode_mt(r, s.mtL);
+  s.last_applied = static_cast<MotionCommand>(get_u8(r));
+  s.remote.command = static_cast<MotionCommand>(get_u8(r));
+  s.remote.twist.v_mps = get_f32(r);
+  s.remote.twist.w_radps = get_f32(r);
+  s.remote.t_ms = get_u32(r);
+  s.remote_received = get_u8(r) != 0;
+}
+
+size_t session_encode_config(const SessionConfig& config, uint8_t* out, size_t cap) {
+  return cap < kConfigBytes ? 0 : encode_config(config, out);
+}
+
+size_t session_encode_state(const ControlState& state, uint8_t* out, size_t cap) {
+  return cap < kStateBytes ? 0 : encode_state(state, out);
+}
+
+size_t session_encode_keyframe(const SessionKeyframe& key, uint8_t* out, size_t cap) {
+  if (cap < 6 + kConfigBytes + kBaseBytes + kStateBytes) {
+    return 0;
+  }
+  size_t n = 0;
+  n += put_u8(out + n, SESSION_KEYFRAME);
+  n += put_u8(out + n, SESSION_RECORD_VERSION);
+  n += put_u32(out + n, key.period_us);
+  n += encode_config(key.config, out + n);
+  n += encode_base(key.base, out + n);
+  n += encode_state(key.state, out + n);
+  return n;
+}
+
+size_t session_encode_cycle(SessionBase& base, const SessionCycle& cycle, uint8_t* out,
+                            size_t cap) {
+  if (cap < SESSION_CYCLE_MAX_BYTES) {
+    return 0;
+  }
+  const ControlInputs& in = cycle.in;
+  uint8_t flags = cycle.buttons & 0x07;
+  if (in.capture_ok) flags |= 0x08;
+  if (cycle.has_command) flags |= 0x10;
+
+  size_t n = 0;
+  n += put_u8(out + n, SESSION_CYCLE);
+  n += put_u8(out + n, flags);
+  n += put_varint(out + n, in.t_us - base.t_us);
+  n += put_varint(out + n, in.t_ms - base.t_ms);
+  n += put_varint(out + n, zigzag(static_cast<int32_t>(in.totalR - base.totalR)));
+  n += put_varint(out + n, zigzag(static_cast<int32_t>(in.totalL - base.totalL)));
+  if (in.capture_ok) {
+    n += put_varint(out + n, zigzag(in.capR.edges - base.edgesR));
+    n += put_varint(out + n, in.t_us - in.capR.last_edge_us);
+    n += put_varint(out + n, zigzag(in.capL.edges - base.edgesL));
+    n += put_varint(out + n, in.t_us - in.capL.last_edge_us);
+  }
+  if (cycle.has_command) {
+    n += put_u8(out + n, static_cast<uint8_t>(cycle.command.command));
+    if (cycle.command.command == MOTION_TWIST) {
+      n += put_f32(out + n, cycle.command.twist.v_mps);
+      n += put_f32(out + n, cycle.command.twist.w_radps);
+    }
+    n += put_varint(out + n, zigzag(static_cast<int32_t>(in.t_ms - cycle.command.t_ms)));
+  }
+  n += put_u8(out + n, static_cast<uint8_t>((cycle.out.dirR & 0x03) | ((cycle.out.dirL & 0x03) << 2)));
+  n += put_u8(out + n, cycle.out.pwmR);
+  n += put_u8(out + n, cycle.out.pwmL);
+
+  session_base_from_inputs(base, in);
+  return n;
+}
+
+void session_decoder_reset(SessionDecoder& decoder) {
+  decoder.base = SessionBase();
+}
+
+static bool decode_cycle(Reader& r, const SessionBase& base, SessionCycle& cycle) {
+  cycle = SessionCycle();
+  const uint8_t flags = get_u8(r);
+  ControlInputs& in = cycle.in;
+  cycle.buttons = flags & 0x07;
+  in.capture_ok = (flags & 0x08) != 0;
+  cycle.has_command = (flags & 0x10) != 0;
+  in.t_us = base.t_us + get_varint(r);
+  in.t_ms = base.t_ms + get_varint(r);
+  in.totalR = base.totalR + unzigzag(get_varint(r));
+  in.totalL = base.totalL + unzigzag(get_varint(r));
+  if (in.capture_ok) {
+    in.capR.edges = base.edgesR + unzigzag(get_varint(r));
+    in.capR.last_edge_us = in.t_us - get_varint(r);
+    in.capL.edges = base.edgesL + unzigzag(get_varint(r));
+    in.capL.last_edge_us = in.t_us - get_varint(r);
+  }
+  if (cycle.has_command) {
+    const uint8_t command = get_u8(r);
+    if (command > MOTION_TWIST) return false;
+    cycle.command.command = static_cast<MotionCommand>(command);
+    if (command == MOTION_TWIST) {
+      cycle.command.twist.v_mps = get_f32(r);
+      cycle.command.twist.w_radps = get_f32(r);
+    }
+    cycle.command.t_ms = in.t_ms - static_cast<uint32_t>(unzigzag(get_varint(r)));
+  }
+  const uint8_t dirs = get_u8(r);
+  cycle.out.dirR = dirs & 0x03;
+  cycle.out.dirL = (dirs >> 2) & 0x03;
+  cycle.out.pwmR = get_u8(r);
+  cycle.out.pwmL = get_u8(r);
+  return r.ok && cycle.buttons <= 4;
+}
+
+int session_decode(SessionDecoder& decoder, const uint8_t* buf, size_t length, size_t& pos,
+                   SessionEvent& ev) {
+  if (pos >= length) {
+    return 0;
+  }
+  Reader r = {buf, length, pos, true};
+  const uint8_t type = get_u8(r);
+  ev.type = static_cast<SessionRecordType>(type);
+  switch (type) {
+    case SESSION_SYNC:
+      ev.chunk_seq = get_varint(r);
+      break;
+    case SESSION_GAP:
+      ev.lost = get_varint(r);
+      break;
+    case SESSION_KEYFRAME: {
+      if (get_u8(r) != SESSION_RECORD_VERSION) return -1;
+      SessionKeyframe& key = ev.keyframe;
+      key.period_us = get_u32(r);
+      decode_config(r, key.config);
+      decode_base(r, key.base);
+      decode_state(r, key.state);
+      if (r.ok) decoder.base = key.base;
+      break;
+    }
+    case SESSION_CYCLE:
+      if (!decode_cycle(r, decoder.base, ev.cycle)) return -1;
+      session_base_from_inputs(decoder.base, ev.cycle.in);
+      break;
+    default:
+      return -1;
+  }
+  if (!r.ok) {
+    return -1;
+  }
+  pos = r.pos;
+  return 1;
+}
+
+#if SESSION_RECORD
+
+static_assert((SESSION_RING_BYTES & (SESSION_RING_BYTES - 1)) == 0,
+              "SESSION_RING_BYTES deve ser potência de 2");
+
+// Maior unidade que o controle grava de uma vez: GAP + KEYFRAME + CYCLE
+static const size_t kUnitMaxBytes = 6 + SESSION_KEYFRAME_MAX_BYTES + SESSION_CYCLE_MAX_BYTES;
+static_assert(kUnitMaxBytes + 6 <= SESSION_CHUNK_BYTES, "pedaço menor que um quadro-chave");
+
+// Anel de bytes SPSC (controle -> rede), mesmo protocolo do SpscRing: cada
+// unidade vai com o tamanho na frente (u16) e só entra inteira.
+static uint8_t g_ring[SESSION_RING_BYTES];
+static std::atomic<uint32_t> g_head(0);
+static std::atomic<uint32_t> g_tail(0);
+
+static std::atomic<bool> g_requested(false);
+static std::atomic<uint32_t> g_cycles(0);
+static std::atomic<uint32_t> g_keyframes(0);
+static std::atomic<uint32_t> g_lost_total(0);
+static std::atomic<uint32_t> g_chunks(0);
+static std::atomic<uint32_t> g_bytes(0);
+
+// Ciclo em andamento e estado da gravação (só a tarefa de controle)
+static bool g_active = false;
+static bool g_have_inputs = false;
+static ControlInputs g_inputs;
+static uint8_t g_buttons = 0;
+static bool g_has_command = false;
+static CommandRecord g_command;
+static SessionBase g_base;
+static uint32_t g_since_keyframe = 0;
+static uint32_t g_lost = 0;           // desde o último quadro-chave
+static bool g_need_keyframe = false;
+static bool g_break = false;          // session_record_break() neste ciclo
+static uint8_t g_config_bytes[kConfigBytes];
+
+static void ring_copy_in(uint32_t at, const uint8_t* p, size_t n) {
+  for (size_t i = 0; i < n; ++i) g_ring[(at + i) & (SESSION_RING_BYTES - 1)] = p[i];
+}
+
+static void ring_copy_out(uint32_t at, uint8_t* p, size_t n) {
+  for (size_t i = 0; i < n; ++i) p[i] = g_ring[(at + i) & (SESSION_RING_BYTES - 1)];
+}
+
+static uint32_t ring_free() {
+  const uint32_t head = g_head.load(std::memory_order_relaxed);
+  return SESSION_RING_BYTES - (head - g_tail.load(std::memory_order_acquire));
+}
+
+static bool ring_push(const uint8_t* p, size_t n) {
+  if (ring_free() < n + 2) {
+    return false;
+  }
+  const uint32_t head = g_head.load(std::memory_order_relaxed);
+  const uint8_t length[2] = {static_cast<uint8_t>(n), static_cast<uint8_t>(n >> 8)};
+  ring_copy_in(head, length, 2);
+  ring_copy_in(head + 2, p, n);
+  g_head.store(head + 2 + n, std::memory_order_release);
+  return true;
+}
+
+// Tamanho da próxima unidade (0 se vazio)
+static size_t ring_peek() {
+  const uint32_t tail = g_tail.load(std::memory_order_relaxed);
+  if (tail == g_head.load(std::memory_order_acquire)) {
+    return 0;
+  }
+  uint8_t length[2];
+  ring_copy_out(tail, length, 2);
+  return length[0] | (length[1] << 8);
+}
+
+static void ring_pop(uint8_t* out, size_t n) {
+  const uint32_t tail = g_tail.load(std::memory_order_relaxed);
+  ring_copy_out(tail + 2, out, n);
+  g_tail.store(tail + 2 + n, std::memory_order_release);
+}
+
+void session_record_start() {
+  g_requested.store(true, std::memory_order_relaxed);
+}
+
+void session_record_stop() {
+  g_requested.store(false, std::memory_order_relaxed);
+}
+
+bool session_record_active() {
+  return g_requested.load(std::memory_order_relaxed);
+}
+
+void session_record_inputs(const ControlInputs& in) {
+  if (!g_requested.load(std::memory_order_relaxed)) {
+    return;
+  }
+  g_inputs = in;
+  g_have_inputs = true;
+}
+
+void session_record_buttons(uint8_t state) {
+  g_buttons = state;
+}
+
+void session_record_command(const CommandRecord& record) {
+  g_command = record;
+  g_has_command = true;
+}
+
+void session_record_break() {
+  if (g_active) {
+    g_break = true;
+    g_need_keyframe = true;
+  }
+}
+
+void session_record_cycle_end() {
+  const bool have_inputs = g_have_inputs;
+  const bool has_command = g_has_command;
+  const uint8_t buttons = g_buttons;
+  g_have_inputs = false;
+  g_has_command = false;
+  g_buttons = 0;
+  if (!g_requested.load(std::memory_order_relaxed)) {
+    g_active = false;
+    return;
+  }
+  if (!have_inputs) {
+    return;   // ciclo sem encoder() (gravação pedida no meio do ciclo)
+  }
+
+  SessionConfig config;
+  session_config_capture(config);
+  uint8_t config_bytes[kConfigBytes];
+  encode_config(config, config_bytes);
+  const bool config_changed = memcmp(config_bytes, g_config_bytes, kConfigBytes) != 0;
+  const bool keyframe = !g_active || g_need_keyframe || config_changed ||
+                        g_since_keyframe + 1 >= SESSION_KEYFRAME_CYCLES;
+
+  // Anel cheio: nem monta o quadro; o ciclo entra na conta do próximo GAP
+  if (ring_free() < kUnitMaxBytes + 2) {
+    if (g_active) {
+      g_lost++;
+      g_lost_total.fetch_add(1, std::memory_order_relaxed);
+      g_need_keyframe = true;
+    }
+    return;
+  }
+
+  uint8_t unit[kUnitMaxBytes];
+  size_t n = 0;
+  SessionBase base = g_base;
+  bool cycle_written = false;
+  if (g_active && !g_need_keyframe) {
+    SessionCycle cycle;
+    cycle.buttons = buttons;
+    cycle.in = g_inputs;
+    cycle.has_command = has_command;
+    cycle.command = g_command;
+    cycle.out = control_outputs();
+    n += session_encode_cycle(base, cycle, unit + n, sizeof(unit) - n);
+    cycle_written = true;
+  }
+  if (keyframe) {
+    if (g_lost || g_break) {
+      n += put_u8(unit + n, SESSION_GAP);
+      n += put_varint(unit + n, g_lost);
+    }
+    SessionKeyframe key;
+    key.period_us = CONTROL_PERIOD_US;
+    key.config = config;
+    session_base_from_inputs(key.base, g_inputs);
+    control_state_save(key.state);
+    n += session_encode_keyframe(key, unit + n, sizeof(unit) - n);
+    base = key.base;
+  }
+  if (!ring_push(unit, n)) {
+    return;   // não acontece: o espaço foi conferido acima
+  }
+
+  g_base = base;
+  g_active = true;
+  if (cycle_written) {
+    g_cycles.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (keyframe) {
+    g_since_keyframe = 0;
+    g_lost = 0;
+    g_break = false;
+    g_need_keyframe = false;
+    memcpy(g_config_bytes, config_bytes, kConfigBytes);
+    g_keyframes.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    g_since_keyframe++;
+  }
+}
+
+static bool deliver_chunk(const uint8_t* chunk, size_t length) {
+#if SESSION_RECORD_SINK == SESSION_SINK_SERIAL
+  static const char kHex[] = "0123456789abcdef";
+  char line[6 + 2 * SESSION_CHUNK_BYTES + 1];
+  memcpy(line, "@REC ", 5);
+  size_t n = 5;
+  for (size_t i = 0; i < length; ++i) {
+    line[n++] = kHex[chunk[i] >> 4];
+    line[n++] = kHex[chunk[i] & 0x0F];
+  }
+  line[n++] = '\n';
+  Serial.write(reinterpret_cast<const uint8_t*>(line), n);
+  return true;
+#else
+  return net_publish_session_chunk(chunk, length);
+#endif
+}
+
+void session_record_flush() {
+  static uint8_t chunk[SESSION_CHUNK_BYTES];
+  static size_t length = 0;
+  static size_t header = 0;       // SYNC no início do pedaço
+  static uint32_t seq = 0;
+  static uint32_t opened_ms = 0;
+
+  bool full = false;
+  for (;;) {
+    if (length == 0) {
+      length = put_u8(chunk, SESSION_SYNC);
+      length += put_varint(chunk + length, seq);
+      header = length;
+      opened_ms = hal_millis();
+    }
+    const size_t unit = ring_peek();
+    if (unit == 0) {
+      break;
+    }
+    if (length + unit > sizeof(chunk)) {
+      full = true;
+      break;
+    }
+    ring_pop(chunk + length, unit);
+    length += unit;
+  }
+
+  if (length == header) {
+    return;
+  }
+  if (!full && (hal_millis() - opened_ms) < SESSION_FLUSH_MS) {
+    return;
+  }
+  // Offline o pedaço espera inteiro; o anel enche e o controle marca a perda
+  if (!deliver_chunk(chunk, length)) {
+    return;
+  }
+  g_chunks.fetch_add(1, std::memory_order_relaxed);
+  g_bytes.fetch_add(static_cast<uint32_t>(length), std::memory_order_relaxed);
+  seq++;
+  length = 0;
+}
+
+SessionRecordStats session_record_stats() {
+  SessionRecordStats stats;
+  stats.cycles = g_cycles.load(std::memory_order_relaxed);
+  stats.keyframes = g_keyframes.load(std::memory_order_relaxed);
+  stats.lost = g_lost_total.load(std::memory_order_relaxed);
+  stats.chunks = g_chunks.load(std::memory_order_relaxed);
+  stats.bytes = g_bytes.load(std::memory_order_relaxed);
+  return stats;
+}
+
+#endif
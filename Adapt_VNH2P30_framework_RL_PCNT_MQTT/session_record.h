@@ -0,0 +1,177 @@
+#ifndef SESSION_RECORD_H
+#define SESSION_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "motor_control.h"
+
+// Gravação de sessão: tudo o que move o estado do laço de controle, para
+// reproduzir no build nativo (host/tools/session_replay) os mesmos sentidos,
+// PWM e pose, bit a bit.
+//
+// A cada ciclo a tarefa de controle grava as entradas lidas do hardware
+// (ControlInputs: relógio, totais do PCNT, captura de bordas), o estado dos
+// botões, o comando remoto retirado da fila (com o t_ms do enfileiramento) e
+// o sentido/PWM que ficou na ponte H. Um quadro-chave leva a configuração e
+// o ControlState inteiro: sai no início, a cada SESSION_KEYFRAME_CYCLES
+// ciclos, quando a configuração muda e depois de uma perda. Assim a gravação
+// pode começar a qualquer momento, sobrevive a um anel cheio (rede fora) e,
+// na reprodução, cada quadro-chave confere o estado inteiro.
+//
+// Formato (little-endian; varint/zigzag como no lote de telemetria): uma
+// sequência de registros, cada um começando pelo tipo (u8).
+//   SYNC      varint número do pedaço (primeiro registro de cada pedaço)
+//   KEYFRAME  u8 versão, u32 período de controle (µs), configuração, base
+//             das diferenças (t_us, t_ms, totais, bordas) e ControlState
+//   CYCLE     u8 flags: bits 0-2 botões (0-4), bit 3 captura, bit 4 comando
+//             varint Δt_us, varint Δt_ms, zigzag Δtotal R, zigzag Δtotal L
+//             [captura: zigzag Δbordas R, varint t_us − última borda R, idem L]
+//             [comando: u8 MotionCommand, f32 v e f32 w se MOTION_TWIST,
+//              zigzag (t_ms do ciclo − t_ms do comando)]
+//             u8 sentidos (R | L << 2), u8 PWM R, u8 PWM L
+//   GAP       varint ciclos perdidos; o próximo registro é um KEYFRAME. Com
+//             0, o estado foi mexido fora do ciclo (parada de segurança)
+// Um ciclo típico ocupa ~15 bytes (~300 B/s a 20 Hz). Os pedaços — mensagens
+// MQTT ou linhas "@REC <hex>" na serial — só contêm registros inteiros e
+// podem ser concatenados num arquivo.
+//
+// Com SESSION_RECORD 0 (padrão no sketch) os ganchos viram nada; o codec
+// continua disponível para as ferramentas.
+
+#ifndef SESSION_RECORD
+#define SESSION_RECORD 0
+#endif
+
+#define SESSION_SINK_MQTT   0   // tópico robot/session (net_set_session_topic)
+#define SESSION_SINK_SERIAL 1   // linhas "@REC <hex>" junto do log
+
+#ifndef SESSION_RECORD_SINK
+#define SESSION_RECORD_SINK SESSION_SINK_MQTT
+#endif
+
+#define SESSION_RECORD_VERSION  1
+#define SESSION_RING_BYTES      8192  // potência de 2; ~25 s de ciclos sem rede
+#define SESSION_CHUNK_BYTES     512   // payload de cada pedaço
+#define SESSION_FLUSH_MS        500   // idade máxima de um pedaço incompleto
+#define SESSION_KEYFRAME_CYCLES 100   // 5 s a 50 ms
+#define SESSION_CYCLE_MAX_BYTES 64
+#define SESSION_KEYFRAME_MAX_BYTES 320
+
+enum SessionRecordType {
+  SESSION_SYNC = 1,
+  SESSION_KEYFRAME,
+  SESSION_CYCLE,
+  SESSION_GAP,
+};
+
+// Configuração do laço (setters de motor_control.h)
+struct SessionConfig {
+  SpeedControllerMode speed_mode;
+  SpeedPidGains gains;
+  VelocityEstimatorMode velocity_mode;
+  PoseIntegratorConfig pose;
+  MotionProfileConfig profile;
+};
+
+// Leituras do último ciclo gravado, base das diferenças do ciclo seguinte
+struct SessionBase {
+  uint32_t t_us;
+  uint32_t t_ms;
+  int64_t totalR;
+  int64_t totalL;
+  int32_t edgesR;
+  int32_t edgesL;
+};
+
+struct SessionKeyframe {
+  uint32_t period_us;
+  SessionConfig config;
+  SessionBase base;
+  ControlState state;   // depois do ciclo da base
+};
+
+struct SessionCycle {
+  uint8_t buttons;         // estado_botoes do sketch
+  ControlInputs in;
+  bool has_command;        // comando retirado da fila neste ciclo
+  CommandRecord command;   // command, twist e t_ms
+  ControlOutputs out;      // só sentidos e PWM vão no registro
+};
+
+struct SessionEvent {
+  SessionRecordType type;
+  uint32_t chunk_seq;      // SYNC
+  uint32_t lost;           // GAP
+  SessionKeyframe keyframe;
+  SessionCycle cycle;
+};
+
+// Antes do primeiro KEYFRAME (ou depois de um pedaço perdido) os ciclos
+// saem com a base errada: quem reproduz os ignora até o próximo quadro-chave
+struct SessionDecoder {
+  SessionBase base;
+};
+
+// --------- Codec (qualquer build) ---------
+void session_config_capture(SessionConfig& out);
+void session_config_apply(const SessionConfig& config);
+void session_base_from_inputs(SessionBase& base, const ControlInputs& in);
+
+// Devolvem o tamanho escrito, ou 0 se cap for insuficiente. O ciclo avança
+// a base.
+size_t session_encode_keyframe(const SessionKeyframe& key, uint8_t* out, size_t cap);
+size_t session_encode_cycle(SessionBase& base, const SessionCycle& cycle, uint8_t* out,
+                            size_t cap);
+size_t session_encode_config(const SessionConfig& config, uint8_t* out, size_t cap);
+// Só o ControlState, para comparar estados byte a byte
+size_t session_encode_state(const ControlState& state, uint8_t* out, size_t cap);
+
+void session_decoder_reset(SessionDecoder& decoder);
+// Próximo registro de buf a partir de pos: 1 com um evento, 0 no fim, -1 se
+// o registro está truncado ou é inválido (pos fica no início dele).
+int session_decode(SessionDecoder& decoder, const uint8_t* buf, size_t length, size_t& pos,
+                   SessionEvent& ev);
+
+// --------- Gravação ---------
+struct SessionRecordStats {
+  uint32_t cycles;      // ciclos gravados
+  uint32_t keyframes;
+  uint32_t lost;        // ciclos perdidos com o anel cheio
+  uint32_t chunks;      // pedaços entregues
+  uint32_t bytes;
+};
+
+#if SESSION_RECORD
+// Qualquer tarefa; a gravação começa no fim do próximo ciclo de controle,
+// com um quadro-chave.
+void session_record_start();
+void session_record_stop();
+bool session_record_active();
+
+// Tarefa de controle, nesta ordem em cada ciclo
+void session_record_inputs(const ControlInputs& in);        // encoder()
+void session_record_buttons(uint8_t state);                 // seleção do comando
+void session_record_command(const CommandRecord& record);   // pop da fila remota
+void session_record_cycle_end();                            // fim de control_task_step()
+// Tarefa de controle: o estado mudou fora do ciclo gravado; o ciclo sai
+// como GAP + KEYFRAME
+void session_record_break();
+
+// Tarefa de rede: monta os pedaços e publica (ou escreve na serial)
+void session_record_flush();
+SessionRecordStats session_record_stats();
+#else
+inline void session_record_start() {}
+inline void session_record_stop() {}
+inline bool session_record_active() { return false; }
+inline void session_record_inputs(const ControlInputs&) {}
+inline void session_record_buttons(uint8_t) {}
+inline void session_record_command(const CommandRecord&) {}
+inline void session_record_cycle_end() {}
+inline void session_record_break() {}
+inline void session_record_flush() {}
+inline SessionRecordStats session_record_stats() { return SessionRecordStats(); }
+#endif
+
+#endif
@@ -0,0 +1,79 @@
+#include "speed_controller.h"
+
+#include <math.h>
+
+#include "robot_config.h"
+
+// Ajustados no simulador (host/tools/step_response_bench): período de 50 ms,
+// constante de tempo mecânica ~0,1 s e medida atrasada de meio período.
+static const SpeedPidGains kDefaultGains = {
+    0.25f,  // kp
+    2.5f,   // ki
+    0.0f,   // kd
+    1.0f,   // kff
+    0.0f,   // ff_offset
+    0.5f,   // kc
+    0.5f,   // d_alpha
+    0.12f,  // ref_tau_s: 0,1 s do motor + meio período de atraso da medida
+};
+
+SpeedPidGains speed_pid_default_gains() {
+  return kDefaultGains;
+}
+
+void speed_pid_reset(SpeedPidState& state) {
+  state.integral = 0.0f;
+  state.prev_measured = 0.0f;
+  state.d_filtered = 0.0f;
+  state.ref_model = 0.0f;
+  state.primed = false;
+}
+
+float speed_pid_feedforward(const SpeedPidGains& gains, float target) {
+  if (target <= 0.0f) {
+    return 0.0f;
+  }
+  return gains.kff * target * Robot::kPwmPerFreeRadS + gains.ff_offset;
+}
+
+uint8_t speed_pid_update(const SpeedPidGains& gains, SpeedPidState& state, float target,
+                         float measured, float sync_error, float dt_s) {
+  if (target <= 0.0f || dt_s <= 0.0f) {
+    speed_pid_reset(state);
+    return 0;
+  }
+
+  // O modelo parte de onde a roda está quando o comando começa
+  if (!state.primed) {
+    state.ref_model = measured > 0.0f ? measured : 0.0f;
+  }
+  if (gains.ref_tau_s > 0.0f) {
+    state.ref_model += (target - state.ref_model) * (1.0f - expf(-dt_s / gains.ref_tau_s));
+  } else {
+    state.ref_model = target;
+  }
+  const float error = state.ref_model - measured - gains.kc * sync_error;
+
+  float derivative = 0.0f;
+  if (state.primed && gains.kd != 0.0f) {
+    const float d = -gains.kd * (measured - state.prev_measured) / dt_s;
+    state.d_filtered += gains.d_alpha * (d - state.d_filtered);
+    derivative = state.d_filtered;
+  }
+  state.prev_measured = measured;
+  state.primed = true;
+
+  const float base = speed_pid_feedforward(gains, target) + gains.kp * error + derivative;
+  const float candidate = state.integral + gains.ki * error * dt_s;
+  const float u = base + candidate;
+
+  // Integração condicional: saturado, só aceita o passo que alivia
+  if ((u < SPEED_PWM_MAX || error < 0.0f) && (u > 0.0f || error > 0.0f)) {
+    state.integral = candidate;
+  }
+
+  float out = base + state.integral;
+  if (out < 0.0f) out = 0.0f;
+  if (out > SPEED_PWM_MAX) out = SPEED_PWM_MAX;
+  return static_cast<uint8_t>(out + 0.5f);
+}
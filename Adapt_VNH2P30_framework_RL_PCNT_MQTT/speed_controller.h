@@ -0,0 +1,57 @@
+#ifndef SPEED_CONTROLLER_H
+#define SPEED_CONTROLLER_H
+
+#include <stdint.h>
+
+// Controle de velocidade de uma roda: referência e medida em rad/s no eixo
+// do motor, já projetadas no sentido comandado (módulo); saída em PWM 0..255.
+//
+// u = ff(ref) + kp·e + ki·∫e − kd·d(medida)/dt
+//   ff(ref) = kff·ref·Robot::kPwmPerFreeRadS + ff_offset
+//             (255 / velocidade do motor em vazio, por variante)
+//   e       = ref_m − medida − kc·erro_de_sincronismo
+//
+// ref_m é a referência passada por um modelo de 1ª ordem (ref_tau_s) com a
+// constante de tempo do motor: o feedforward já leva a roda até a
+// referência, e o PI só corrige o quanto a resposta foge do esperado. Sem o
+// modelo, o integrador acumula o erro da subida inteira e a roda passa do
+// alvo.
+//
+// O erro de sincronismo (acoplamento cruzado) vem de fora: diferença entre
+// as duas rodas normalizada pelas referências, positiva quando esta roda
+// está adiantada. Anti-windup por integração condicional: com a saída
+// saturada, o integrador só anda no sentido que tira da saturação.
+
+#define SPEED_PWM_MAX 255.0f
+
+enum SpeedControllerMode {
+  SPEED_CTRL_STEPPER = 0,  // ±PWM_STEP por ciclo (comportamento original)
+  SPEED_CTRL_PID,
+};
+
+struct SpeedPidGains {
+  float kp;         // PWM por rad/s
+  float ki;         // PWM por rad
+  float kd;         // PWM·s por rad/s (derivativo na medida)
+  float kff;        // 1 = modelo do motor exato, 0 desliga o feedforward
+  float ff_offset;  // PWM somado ao feedforward para vencer o atrito estático
+  float kc;         // ganho do acoplamento cruzado (adimensional)
+  float d_alpha;    // filtro do derivativo, 0..1 (1 = sem filtro)
+  float ref_tau_s;  // constante de tempo do modelo de referência (0 = degrau)
+};
+
+struct SpeedPidState {
+  float integral;
+  float prev_measured;
+  float d_filtered;
+  float ref_model;
+  bool primed;      // prev_measured e ref_model válidos
+};
+
+SpeedPidGains speed_pid_default_gains();
+void speed_pid_reset(SpeedPidState& state);
+float speed_pid_feedforward(const SpeedPidGains& gains, float target);
+uint8_t speed_pid_update(const SpeedPidGains& gains, SpeedPidState& state, float target,
+                         float measured, float sync_error, float dt_s);
+
+#endif
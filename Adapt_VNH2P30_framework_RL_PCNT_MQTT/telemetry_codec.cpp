@@ -0,0 +1,286 @@
+#include "telemetry_codec.h"
+
+#include <math.h>
+#include <string.h>
+
+// Escrita/leitura byte a byte: independe do alinhamento e do endianness da CPU
+static void put_u16(uint8_t* p, uint16_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+static void put_u32(uint8_t* p, uint32_t v) {
+  p[0] = static_cast<uint8_t>(v);
+  p[1] = static_cast<uint8_t>(v >> 8);
+  p[2] = static_cast<uint8_t>(v >> 16);
+  p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+static void put_f32(uint8_t* p, float v) {
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  put_u32(p, bits);
+}
+
+static uint16_t get_u16(const uint8_t* p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static float get_f32(const uint8_t* p) {
+  uint32_t bits = get_u32(p);
+  float v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+static void put_header(uint8_t* p, TelemetryFrameType type, const OdometrySample& sample) {
+  p[0] = TELEMETRY_MAGIC;
+  p[1] = TELEMETRY_VERSION;
+  p[2] = static_cast<uint8_t>(type);
+  p[3] = 0;
+  put_u32(p + 4, sample.seq);
+  put_u32(p + 8, sample.t_ms);
+}
+
+static bool check_header(const uint8_t* p, size_t length, TelemetryFrameType type,
+                         size_t min_size, OdometrySample& out) {
+  if (!p || length < min_size || p[0] != TELEMETRY_MAGIC || p[1] != TELEMETRY_VERSION ||
+      p[2] != type) {
+    return false;
+  }
+  out.seq = get_u32(p + 4);
+  out.t_ms = get_u32(p + 8);
+  return true;
+}
+
+size_t telemetry_encode_odometry(const OdometrySample& sample, uint8_t* buf, size_t cap) {
+  if (!buf || cap < TELEMETRY_ODOMETRY_FRAME_SIZE) {
+    return 0;
+  }
+  put_header(buf, TELEMETRY_FRAME_ODOMETRY, sample);
+  put_f32(buf + 12, sample.x);
+  put_f32(buf + 16, sample.y);
+  put_f32(buf + 20, sample.phi);
+  return TELEMETRY_ODOMETRY_FRAME_SIZE;
+}
+
+size_t telemetry_encode_odometry_debug(const OdometrySample& sample, uint8_t* buf, size_t cap) {
+  if (!buf || cap < TELEMETRY_DEBUG_FRAME_SIZE) {
+    return 0;
+  }
+  put_header(buf, TELEMETRY_FRAME_ODOMETRY_DEBUG, sample);
+  put_u16(buf + 12, static_cast<uint16_t>(sample.contagemR));
+  put_u16(buf + 14, static_cast<uint16_t>(sample.contagemL));
+  put_f32(buf + 16, sample.velR);
+  put_f32(buf + 20, sample.velL);
+  put_u16(buf + 24, sample.dt_ms > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(sample.dt_ms));
+  return TELEMETRY_DEBUG_FRAME_SIZE;
+}
+
+bool telemetry_decode_odometry(const uint8_t* buf, size_t length, OdometrySample& out) {
+  if (!check_header(buf, length, TELEMETRY_FRAME_ODOMETRY, TELEMETRY_ODOMETRY_FRAME_SIZE, out)) {
+    return false;
+  }
+  out.x = get_f32(buf + 12);
+  out.y = get_f32(buf + 16);
+  out.phi = get_f32(buf + 20);
+  return true;
+}
+
+bool telemetry_decode_odometry_debug(const uint8_t* buf, size_t length, OdometrySample& out) {
+  if (!check_header(buf, length, TELEMETRY_FRAME_ODOMETRY_DEBUG, TELEMETRY_DEBUG_FRAME_SIZE,
+                    out)) {
+    return false;
+  }
+  out.contagemR = static_cast<int16_t>(get_u16(buf + 12));
+  out.contagemL = static_cast<int16_t>(get_u16(buf + 14));
+  out.velR = get_f32(buf + 16);
+  out.velL = get_f32(buf + 20);
+  out.dt_ms = get_u16(buf + 24);
+  return true;
+}
+
+// ---------- Lote delta/varint ----------
+// Pior caso de uma amostra: 2 varints de 32 bits + 8 campos, 5 bytes cada
+static const size_t kBatchSampleMaxBytes = 10 * 5;
+
+static size_t put_varint(uint8_t* p, uint32_t v) {
+  size_t n = 0;
+  while (v >= 0x80) {
+    p[n++] = static_cast<uint8_t>(v | 0x80);
+    v >>= 7;
+  }
+  p[n++] = static_cast<uint8_t>(v);
+  return n;
+}
+
+static bool get_varint(const uint8_t* p, size_t length, size_t& pos, uint32_t& v) {
+  v = 0;
+  for (int shift = 0; shift < 35; shift += 7) {
+    if (pos >= length) return false;
+    uint8_t byte = p[pos++];
+    v |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+static uint32_t zigzag(int32_t v) {
+  return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v) {
+  return static_cast<int32_t>((v >> 1) ^ (~(v & 1) + 1));
+}
+
+static int32_t quantize(float v, float scale) {
+  return static_cast<int32_t>(lroundf(v * scale));
+}
+
+static size_t batch_fields(bool with_debug) {
+  return with_debug ? 8 : 3;
+}
+
+static void quantize_sample(const OdometrySample& s, int32_t q[8]) {
+  q[0] = quantize(s.x, TELEMETRY_POS_SCALE);
+  q[1] = quantize(s.y, TELEMETRY_POS_SCALE);
+  q[2] = quantize(s.phi, TELEMETRY_ANGLE_SCALE);
+  q[3] = s.contagemR;
+  q[4] = s.contagemL;
+  q[5] = quantize(s.velR, TELEMETRY_VEL_SCALE);
+  q[6] = quantize(s.velL, TELEMETRY_VEL_SCALE);
+  q[7] = static_cast<int32_t>(s.dt_ms);
+}
+
+static void dequantize_sample(const int32_t q[8], OdometrySample& s) {
+  s.x = q[0] / TELEMETRY_POS_SCALE;
+  s.y = q[1] / TELEMETRY_POS_SCALE;
+  s.phi = q[2] / TELEMETRY_ANGLE_SCALE;
+  s.contagemR = static_cast<int16_t>(q[3]);
+  s.contagemL = static_cast<int16_t>(q[4]);
+  s.velR = q[5] / TELEMETRY_VEL_SCALE;
+  s.velL = q[6] / TELEMETRY_VEL_SCALE;
+  s.dt_ms = static_cast<uint32_t>(q[7]);
+}
+
+void telemetry_batch_begin(TelemetryBatch& batch, bool with_debug) {
+  batch.length = 0;
+  batch.count = 0;
+  batch.with_debug = with_debug;
+}
+
+bool telemetry_batch_add(TelemetryBatch& batch, const OdometrySample& sample) {
+  if (batch.count >= TELEMETRY_BATCH_MAX_SAMPLES ||
+      batch.length + kBatchSampleMaxBytes > sizeof(batch.buf)) {
+    return false;
+  }
+
+  const size_t fields = batch_fields(batch.with_debug);
+  int32_t q[8];
+  quantize_sample(sample, q);
+
+  if (batch.count == 0) {
+    put_header(batch.buf, TELEMETRY_FRAME_ODOMETRY_BATCH, sample);
+    batch.buf[3] = batch.with_debug ? TELEMETRY_BATCH_FLAG_DEBUG : 0;
+    batch.length = TELEMETRY_HEADER_SIZE + 1;
+    batch.seq0 = sample.seq;
+    batch.t0 = sample.t_ms;
+    memcpy(batch.q0, q, sizeof(q));
+    for (size_t f = 0; f < fields; ++f) {
+      batch.length += put_varint(batch.buf + batch.length, zigzag(q[f]));
+    }
+  } else {
+    batch.length += put_varint(batch.buf + batch.length, sample.seq - batch.seq0);
+    batch.length += put_varint(batch.buf + batch.length, sample.t_ms - batch.t0);
+    for (size_t f = 0; f < fields; ++f) {
+      batch.length += put_varint(batch.buf + batch.length,
+                                 zigzag(static_cast<int32_t>(static_cast<uint32_t>(q[f]) -
+                                                             static_cast<uint32_t>(batch.q0[f]))));
+    }
+  }
+
+  batch.count++;
+  batch.buf[TELEMETRY_HEADER_SIZE] = batch.count;
+  return true;
+}
+
+size_t telemetry_decode_odometry_batch(const uint8_t* buf, size_t length, OdometrySample* out,
+                                       size_t max_samples) {
+  OdometrySample first = {};
+  if (!out || !check_header(buf, length, TELEMETRY_FRAME_ODOMETRY_BATCH,
+                            TELEMETRY_HEADER_SIZE + 1, first)) {
+    return 0;
+  }
+  const bool with_debug = (buf[3] & TELEMETRY_BATCH_FLAG_DEBUG) != 0;
+  const size_t fields = batch_fields(with_debug);
+  const size_t count = buf[TELEMETRY_HEADER_SIZE];
+  size_t pos = TELEMETRY_HEADER_SIZE + 1;
+  int32_t q0[8] = {};
+
+  size_t decoded = 0;
+  for (size_t i = 0; i < count && decoded < max_samples; ++i) {
+    OdometrySample s = {};
+    int32_t q[8] = {};
+    uint32_t v;
+    if (i == 0) {
+      s.seq = first.seq;
+      s.t_ms = first.t_ms;
+      for (size_t f = 0; f < fields; ++f) {
+        if (!get_varint(buf, length, pos, v)) return 0;
+        q0[f] = unzigzag(v);
+        q[f] = q0[f];
+      }
+    } else {
+      if (!get_varint(buf, length, pos, v)) return 0;
+      s.seq = first.seq + v;
+      if (!get_varint(buf, length, pos, v)) return 0;
+      s.t_ms = first.t_ms + v;
+      for (size_t f = 0; f < fields; ++f) {
+        if (!get_varint(buf, length, pos, v)) return 0;
+        q[f] = static_cast<int32_t>(static_cast<uint32_t>(q0[f]) +
+                                    static_cast<uint32_t>(unzigzag(v)));
+      }
+    }
+    dequantize_sample(q, s);
+    if (!with_debug) {
+      s.contagemR = s.contagemL = 0;
+      s.velR = s.velL = 0.0f;
+      s.dt_ms = 0;
+    }
+    out[decoded++] = s;
+  }
+  return decoded;
+}
+
+void telemetry_odometry_json(const OdometrySample& sample, String& out) {
+  out.reserve(64);
+  out += F("{");
+  out += F("\"x\":");
+  out += String(sample.x, 6);
+  out += F(",\"y\":");
+  out += String(sample.y, 6);
+  out += F(",\"phi\":");
+  out += String(sample.phi, 6);
+  out += F("}");
+}
+
+void telemetry_odometry_debug_json(const OdometrySample& sample, String& out) {
+  out.reserve(96);
+  out += F("{");
+  out += F("\"contagemR\":");
+  out += sample.contagemR;
+  out += F(",\"contagemL\":");
+  out += sample.contagemL;
+  out += F(",\"velR\":");
+  out += String(sample.velR, 6);
+  out += F(",\"velL\":");
+  out += String(sample.velL, 6);
+  out += F(",\"dt\":");
+  out += static_cast<unsigned long>(sample.dt_ms);
+  out += F("}");
+}
@@ -0,0 +1,97 @@
+#ifndef TELEMETRY_CODEC_H
+#define TELEMETRY_CODEC_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "motor_control.h"
+
+// Codificação da telemetria de odometria: JSON (formato original, legível)
+// ou quadro binário versionado de layout fixo.
+//
+// Quadro binário, little-endian, sem padding:
+//   0  u8   magic 'R' (0x52)
+//   1  u8   versão (TELEMETRY_VERSION)
+//   2  u8   tipo (TelemetryFrameType)
+//   3  u8   flags (reservado, 0)
+//   4  u32  seq (OdometrySample.seq)
+//   8  u32  t_ms
+//   12 ...  corpo do tipo
+//
+// Odometria (24 bytes):  f32 x, f32 y, f32 phi
+// Debug (26 bytes):      i16 contagemR, i16 contagemL, f32 velR, f32 velL,
+//                        u16 dt_ms
+//
+// Lote (tipo 3): várias amostras em um quadro; o cabeçalho leva seq/t_ms da
+// primeira e flags bit 0 indica campos de debug. Corpo:
+//   u8 n
+//   amostra 0: zigzag-varint de cada campo quantizado
+//   amostra i: varint (seq_i - seq_0), varint (t_i - t_0) e zigzag-varint de
+//              (q_i - q_0) de cada campo (delta contra a primeira amostra)
+// Campos: x, y, phi [, contagemR, contagemL, velR, velL, dt_ms].
+// Quantização: x/y em 10 µm, phi em 1e-5 rad, velR/velL em 1e-4 rad/s;
+// contagens e dt exatos.
+//
+// Campos novos só entram no fim do corpo; quem decodifica aceita quadros
+// maiores que o esperado para a mesma versão.
+
+#define TELEMETRY_MAGIC   0x52
+#define TELEMETRY_VERSION 1
+
+#define TELEMETRY_HEADER_SIZE          12
+#define TELEMETRY_ODOMETRY_FRAME_SIZE  24
+#define TELEMETRY_DEBUG_FRAME_SIZE     26
+
+#define TELEMETRY_BATCH_MAX_SAMPLES  64
+#define TELEMETRY_BATCH_MAX_BYTES    1024
+#define TELEMETRY_BATCH_FLAG_DEBUG   0x01
+
+#define TELEMETRY_POS_SCALE    100000.0f  // 1/m
+#define TELEMETRY_ANGLE_SCALE  100000.0f  // 1/rad
+#define TELEMETRY_VEL_SCALE    10000.0f   // s/rad
+
+enum TelemetryFrameType {
+  TELEMETRY_FRAME_ODOMETRY = 1,
+  TELEMETRY_FRAME_ODOMETRY_DEBUG = 2,
+  TELEMETRY_FRAME_ODOMETRY_BATCH = 3,
+};
+
+enum TelemetryFormat {
+  TELEMETRY_JSON = 0,
+  TELEMETRY_BINARY,
+  TELEMETRY_BATCH,   // só no tópico de odometria; leva o debug junto
+};
+
+// Lote sendo montado, codificado de forma incremental (sem guardar amostras)
+struct TelemetryBatch {
+  uint8_t buf[TELEMETRY_BATCH_MAX_BYTES];
+  size_t length;
+  uint8_t count;
+  bool with_debug;
+  uint32_t seq0;
+  uint32_t t0;
+  int32_t q0[8];
+};
+
+// Devolvem o tamanho do quadro, ou 0 se cap for insuficiente.
+size_t telemetry_encode_odometry(const OdometrySample& sample, uint8_t* buf, size_t cap);
+size_t telemetry_encode_odometry_debug(const OdometrySample& sample, uint8_t* buf, size_t cap);
+
+// Preenchem só os campos presentes no quadro; false se inválido.
+bool telemetry_decode_odometry(const uint8_t* buf, size_t length, OdometrySample& out);
+bool telemetry_decode_odometry_debug(const uint8_t* buf, size_t length, OdometrySample& out);
+
+void telemetry_batch_begin(TelemetryBatch& batch, bool with_debug);
+// false se o lote está cheio (amostras ou bytes): publicar e recomeçar.
+bool telemetry_batch_add(TelemetryBatch& batch, const OdometrySample& sample);
+// Número de amostras escritas em out (0 se o quadro for inválido). Campos
+// voltam dequantizados; os ausentes (sem debug) ficam zerados.
+size_t telemetry_decode_odometry_batch(const uint8_t* buf, size_t length, OdometrySample* out,
+                                       size_t max_samples);
+
+// JSON {x, y, phi} e {contagemR, contagemL, velR, velL, dt}
+void telemetry_odometry_json(const OdometrySample& sample, String& out);
+void telemetry_odometry_debug_json(const OdometrySample& sample, String& out);
+
+#endif
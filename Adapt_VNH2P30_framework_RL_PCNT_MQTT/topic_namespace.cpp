@@ -0,0 +1,67 @@
+#include "topic_namespace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char kIdToken[] = "{id}";
+static const size_t kIdTokenLen = sizeof(kIdToken) - 1;
+
+bool robot_id_valid(const char* id) {
+  if (!id || !*id) {
+    return false;
+  }
+  size_t n = 0;
+  for (; id[n]; ++n) {
+    if (id[n] == '/' || id[n] == '+' || id[n] == '#') {
+      return false;
+    }
+  }
+  return n < ROBOT_ID_MAX;
+}
+
+void robot_id_from_mac(const uint8_t mac[6], char* out, size_t cap) {
+  snprintf(out, cap, "%02x%02x%02x%02x%02x%02x", mac[0], mac[1], mac[2], mac[3], mac[4],
+           mac[5]);
+}
+
+// Acrescenta n bytes de s; false se não couber (com o NUL)
+static bool append(char* out, size_t cap, size_t& len, const char* s, size_t n) {
+  if (len + n >= cap) {
+    return false;
+  }
+  memcpy(out + len, s, n);
+  len += n;
+  out[len] = '\0';
+  return true;
+}
+
+bool topic_expand(const char* tmpl, const char* root, const char* who, char* out, size_t cap) {
+  if (cap == 0) {
+    return false;
+  }
+  out[0] = '\0';
+  if (!tmpl || !*tmpl) {
+    return true;
+  }
+  const size_t who_len = who ? strlen(who) : 0;
+  size_t len = 0;
+  bool ok = true;
+  if (root && *root && !strstr(tmpl, kIdToken)) {
+    ok = append(out, cap, len, root, strlen(root)) && append(out, cap, len, "/", 1) &&
+         append(out, cap, len, who, who_len) && append(out, cap, len, "/", 1);
+  }
+  for (const char* p = tmpl; ok && *p;) {
+    const char* token = strstr(p, kIdToken);
+    const size_t n = token ? static_cast<size_t>(token - p) : strlen(p);
+    ok = append(out, cap, len, p, n);
+    if (!token) {
+      break;
+    }
+    ok = ok && append(out, cap, len, who, who_len);
+    p = token + kIdTokenLen;
+  }
+  if (!ok) {
+    out[0] = '\0';
+  }
+  return ok;
+}
@@ -0,0 +1,28 @@
+#ifndef TOPIC_NAMESPACE_H
+#define TOPIC_NAMESPACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Nomes de tópico por robô, para vários robôs no mesmo broker.
+//
+// Um tópico é um modelo: "{id}" vira o id do robô (ex.: "robots/{id}/odom").
+// No modo frota (raiz não vazia), um modelo sem "{id}" ganha o prefixo
+// "<raiz>/<id>/": "robot/odometry" vira "fleet/240ac4000001/robot/odometry".
+// O tópico de grupo é o mesmo modelo expandido com o nome do grupo no lugar
+// do id ("fleet/all/facemesh/cmd"): um comando publicado nele chega a todos.
+//
+// O id vem da configuração ou, sem ela, do MAC (12 dígitos hex minúsculos).
+// Id e grupo são um nível de tópico: não vazios, sem '/', '+' ou '#'.
+
+#define ROBOT_ID_MAX   24    // com o NUL
+#define TOPIC_NAME_MAX 96
+
+bool robot_id_valid(const char* id);
+void robot_id_from_mac(const uint8_t mac[6], char* out, size_t cap);
+
+// Expande tmpl em out; false (out vazio) se não couber. tmpl "" continua "":
+// tópico desligado.
+bool topic_expand(const char* tmpl, const char* root, const char* who, char* out, size_t cap);
+
+#endif
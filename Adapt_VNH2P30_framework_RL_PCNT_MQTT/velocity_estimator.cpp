@@ -0,0 +1,56 @@
+#include "velocity_estimator.h"
+
+void mt_velocity_reset(MtVelocityEstimator& est) {
+  est.edges = 0;
+  est.edge_us = 0;
+  est.sample_us = 0;
+  est.rate = 0.0f;
+  est.primed = false;
+  est.stopped = true;
+}
+
+float mt_velocity_update(MtVelocityEstimator& est, const HalEdgeCapture& capture,
+                         uint32_t now_us) {
+  if (!est.primed) {
+    est.edges = capture.edges;
+    est.edge_us = capture.last_edge_us;
+    est.sample_us = now_us;
+    est.rate = 0.0f;
+    est.primed = true;
+    est.stopped = true;
+    return 0.0f;
+  }
+
+  const int32_t dn = capture.edges - est.edges;
+  if (dn != 0) {
+    // Parada, a borda anterior não marca o início do movimento: usa o
+    // instante da atualização anterior (início desta janela)
+    const uint32_t start_us = est.stopped ? est.sample_us : est.edge_us;
+    const int32_t span_us = static_cast<int32_t>(capture.last_edge_us - start_us);
+    if (span_us > 0) {
+      est.rate = dn * 1e6f / span_us;
+    }
+    est.edges = capture.edges;
+    est.edge_us = capture.last_edge_us;
+    est.stopped = false;
+  }
+
+  est.sample_us = now_us;
+
+  // Limite: nenhuma borda desde last_edge -> no máximo uma borda nesse tempo
+  // Com sinal: a borda pode ter chegado depois de now_us ser lido
+  const int32_t since_us = static_cast<int32_t>(now_us - est.edge_us);
+  if (since_us >= static_cast<int32_t>(MT_STOP_TIMEOUT_US)) {
+    est.rate = 0.0f;
+    est.stopped = true;
+  } else if (since_us > 0) {
+    const float bound = 1e6f / since_us;
+    if (est.rate > bound) est.rate = bound;
+    if (est.rate < -bound) est.rate = -bound;
+  }
+  return est.rate;
+}
+
+float count_velocity(int32_t edges, uint32_t dt_us) {
+  return dt_us > 0 ? edges * 1e6f / dt_us : 0.0f;
+}
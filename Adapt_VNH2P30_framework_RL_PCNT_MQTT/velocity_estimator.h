@@ -0,0 +1,45 @@
+#ifndef VELOCITY_ESTIMATOR_H
+#define VELOCITY_ESTIMATOR_H
+
+#include <stdint.h>
+
+#include "hal.h"
+
+// Estimativa de velocidade do encoder, em bordas por segundo (com sinal).
+//
+// Contagem (método M): bordas na janela / duração da janela. Resolução de
+// uma borda por janela: com 11 bordas por volta e janela de 50 ms são
+// ~11,4 rad/s no eixo do motor, e piora na mesma proporção quando o período
+// de controle diminui.
+//
+// M/T: bordas na janela / tempo entre a última borda da janela anterior e a
+// última desta. O tempo vem do carimbo de cada borda (hal_edge_capture_*),
+// então a medida é a média exata entre duas bordas e não depende de onde a
+// janela começa. Sem borda na janela, a velocidade não pode ser maior que
+// uma borda pelo tempo desde a última: a estimativa decai por esse limite e
+// vai a zero depois de MT_STOP_TIMEOUT_US.
+
+// Sem borda por esse tempo a roda é considerada parada (~0,6 rad/s no motor)
+#define MT_STOP_TIMEOUT_US 250000UL
+
+enum VelocityEstimatorMode {
+  VELOCITY_COUNT = 0,  // contagem por janela (comportamento original)
+  VELOCITY_MT,
+};
+
+struct MtVelocityEstimator {
+  int32_t edges;        // leitura anterior da captura
+  uint32_t edge_us;     // instante da última borda já usada
+  uint32_t sample_us;   // instante da atualização anterior
+  float rate;           // última estimativa (bordas/s)
+  bool primed;
+  bool stopped;         // edge_us velho demais para servir de início
+};
+
+void mt_velocity_reset(MtVelocityEstimator& est);
+// Uma atualização por ciclo de controle; now_us na base de hal_micros()
+float mt_velocity_update(MtVelocityEstimator& est, const HalEdgeCapture& capture,
+                         uint32_t now_us);
+float count_velocity(int32_t edges, uint32_t dt_us);
+
+#endif
@@ -87,6 +87,10 @@ const lastAnglesSent = {
   pitch: null
 };
 let lastCommandSentAt = 0;
+let commandSeq = 0;
+// sequência dos comandos: o robô recusa fora de ordem ou velhos (status
+// "reordered"/"stale" no pong)
+const COMMAND_MAX_AGE_MS = 250;
 // ---------- Calibração (tara) ----------
 let yawOffset = 0, pitchOffset = 0, rollOffset = 0;
 let lastRaw = null;
@@ -493,7 +497,8 @@ function sendMotionCommand(yawDeg, pitchDeg, { force = false } = {}) {
     yawDeg.toFixed(1) : 'NaN';
   const pitchStr = Number.isFinite(pitchDeg) ?
     pitchDeg.toFixed(1) : 'NaN';
-  const payload = `${yawStr}|${pitchStr}|${nonce}|${t0}`;
+  commandSeq = (commandSeq + 1) >>> 0;
+  const payload = `${yawStr}|${pitchStr}|${nonce}|${t0}|${commandSeq}|${COMMAND_MAX_AGE_MS}`;
 
   client.publish(commandTopic, payload);
   pendingCommands.set(nonce, {
@@ -511,7 +516,7 @@ function sendMotionCommand(yawDeg, pitchDeg, { force = false } = {}) {
   latencyStats.lastAction = previewAction;
   latencyStats.lastStatus = force ? 'forçado' : 'pendente';
 
-  console.log(`MQTT [${commandTopic}] yaw=${yawStr} pitch=${pitchStr} nonce=${nonce} t0=${t0}`);
+  console.log(`MQTT [${commandTopic}] yaw=${yawStr} pitch=${pitchStr} nonce=${nonce} t0=${t0} seq=${commandSeq}`);
 }
 
 function handlePongMessage(rawMessage) {
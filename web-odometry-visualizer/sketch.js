@@ -12,8 +12,21 @@ const ROBOT_DIM = {
 const SCALE = 80; // pixels por metro
 const TRAIL_LIMIT = 8000;
 
+// Quadro binário de odometria (telemetry_codec.h no firmware), little-endian:
+// magic 'R', versão, tipo, flags, u32 seq, u32 t_ms, f32 x, f32 y, f32 phi.
+const TELEMETRY_MAGIC = 0x52;
+const TELEMETRY_VERSION = 1;
+const TELEMETRY_FRAME_ODOMETRY = 1;
+const TELEMETRY_FRAME_ODOMETRY_BATCH = 3;
+const TELEMETRY_ODOMETRY_FRAME_SIZE = 24;
+const TELEMETRY_HEADER_SIZE = 12;
+const TELEMETRY_BATCH_FLAG_DEBUG = 0x01;
+const TELEMETRY_POS_SCALE = 100000; // 1/m
+const TELEMETRY_ANGLE_SCALE = 100000; // 1/rad
+
 let pose = { x: 0, y: 0, phi: 0 };
 let lastPose = null;
+let lastSeq = null;
 let trail = [];
 let totalDistance = 0;
 
@@ -174,6 +187,103 @@ function drawRobot() {
   pop();
 }
 
+// Lê um varint (7 bits por byte, LSB primeiro) a partir de state.pos.
+function readVarint(bytes, state) {
+  let value = 0;
+  for (let shift = 0; shift < 35; shift += 7) {
+    if (state.pos >= bytes.length) return null;
+    const byte = bytes[state.pos++];
+    value += (byte & 0x7f) * 2 ** shift;
+    if ((byte & 0x80) === 0) return value;
+  }
+  return null;
+}
+
+function unzigzag(v) {
+  return v % 2 === 0 ? v / 2 : -(v + 1) / 2;
+}
+
+// Lote delta/varint (tipo 3): devolve as amostras na ordem, ou null se inválido.
+function decodeOdometryBatch(payload, view) {
+  const fields = view.getUint8(3) & TELEMETRY_BATCH_FLAG_DEBUG ? 8 : 3;
+  const seq0 = view.getUint32(4, true);
+  const t0 = view.getUint32(8, true);
+  const count = payload[TELEMETRY_HEADER_SIZE];
+  const state = { pos: TELEMETRY_HEADER_SIZE + 1 };
+  const q0 = [];
+  const samples = [];
+
+  for (let i = 0; i < count; i++) {
+    let seq = seq0;
+    let tMs = t0;
+    if (i > 0) {
+      const dSeq = readVarint(payload, state);
+      const dT = readVarint(payload, state);
+      if (dSeq === null || dT === null) return null;
+      seq = (seq0 + dSeq) >>> 0;
+      tMs = (t0 + dT) >>> 0;
+    }
+    const q = [];
+    for (let f = 0; f < fields; f++) {
+      const v = readVarint(payload, state);
+      if (v === null) return null;
+      q.push(i === 0 ? unzigzag(v) : q0[f] + unzigzag(v));
+    }
+    if (i === 0) q0.push(...q);
+    samples.push({
+      seq,
+      tMs,
+      x: q[0] / TELEMETRY_POS_SCALE,
+      y: q[1] / TELEMETRY_POS_SCALE,
+      phi: q[2] / TELEMETRY_ANGLE_SCALE,
+    });
+  }
+  return samples;
+}
+
+// Aceita o quadro binário, o lote ou o JSON { x, y, phi }; devolve a lista de
+// amostras (uma só, exceto no lote) ou null se inválido.
+function decodeOdometry(payload) {
+  if (payload.length > 0 && payload[0] === TELEMETRY_MAGIC) {
+    if (payload.length <= TELEMETRY_HEADER_SIZE) return null;
+    const view = new DataView(payload.buffer, payload.byteOffset, payload.byteLength);
+    if (view.getUint8(1) !== TELEMETRY_VERSION) return null;
+    const type = view.getUint8(2);
+    if (type === TELEMETRY_FRAME_ODOMETRY_BATCH) return decodeOdometryBatch(payload, view);
+    if (type !== TELEMETRY_FRAME_ODOMETRY || payload.length < TELEMETRY_ODOMETRY_FRAME_SIZE) {
+      return null;
+    }
+    return [
+      {
+        seq: view.getUint32(4, true),
+        tMs: view.getUint32(8, true),
+        x: view.getFloat32(12, true),
+        y: view.getFloat32(16, true),
+        phi: view.getFloat32(20, true),
+      },
+    ];
+  }
+
+  const msg = JSON.parse(payload.toString());
+  return [
+    {
+      seq: null,
+      x: Number(msg.x),
+      y: Number(msg.y),
+      phi: Number(msg.phi),
+    },
+  ];
+}
+
+// Com seq (quadro binário), descarta duplicadas e atrasadas. Um salto grande
+// para trás é tratado como reinício do robô.
+function isStale(seq) {
+  if (seq === null) return false;
+  if (lastSeq !== null && seq <= lastSeq && lastSeq - seq < 1000) return true;
+  lastSeq = seq;
+  return false;
+}
+
 function applyPoseUpdate(newPose) {
   if (!Number.isFinite(newPose.x) || !Number.isFinite(newPose.y) || !Number.isFinite(newPose.phi)) {
     return;
@@ -246,12 +356,15 @@ function connectToBroker() {
 
   client.on('message', (topic, payload) => {
     try {
-      const msg = JSON.parse(payload.toString());
-      applyPoseUpdate({
-        x: Number(msg.x),
-        y: Number(msg.y),
-        phi: Number(msg.phi),
-      });
+      const samples = decodeOdometry(payload);
+      if (!samples) {
+        console.warn('Quadro de odometria desconhecido');
+        return;
+      }
+      for (const msg of samples) {
+        if (isStale(msg.seq)) continue;
+        applyPoseUpdate({ x: msg.x, y: msg.y, phi: msg.phi });
+      }
     } catch (err) {
       console.warn('Mensagem de odometria inválida', err);
     }
@@ -261,6 +374,7 @@ function connectToBroker() {
 function resetPath() {
   pose = { x: 0, y: 0, phi: 0 };
   lastPose = { ...pose };
+  lastSeq = null;
   trail = [];
   totalDistance = 0;
   xLabel.html('0.000 m');